@@ -1,5 +1,30 @@
 pathGRDK = "C:/Program Files (x86)/Microsoft GDK/221001/GRDK/"
 
+newoption {
+    trigger = "aot",
+    description = "Link the ROMs recompiled by chip8_aot into tmp/aot/ and use them with the aot backend"
+}
+
+newoption {
+    trigger = "opcode_stats",
+    description = "Compile the -opcode_stats instrumentation of the decoded backends in (CHIP8_OPCODE_STATS)"
+}
+
+newoption {
+    trigger = "jit_perf_map",
+    description = "List the blocks of the jit backend in /tmp/perf-PID.map for perf (CHIP8_JIT_PERF_MAP)"
+}
+
+newoption {
+    trigger = "simd",
+    value = "ISA",
+    description = "Instruction set of the lanes of the Chip8 batches (SSE2 by default on x64)",
+    allowed = {
+        { "avx2", "AVX2, 16 lanes per vector" },
+        { "avx512", "AVX-512BW, 32 lanes per vector" }
+    }
+}
+
 workspace "VisualSolution"
 
     -- Configuration ; Platforms
@@ -7,8 +32,10 @@ workspace "VisualSolution"
     configurations { "Debug", "Release" }
     platforms { "x64" }
 
-    filter "platforms:x64"
+    filter { "platforms:x64", "system:windows" }
         toolset "msc"
+    filter { "platforms:x64", "not system:windows" }
+        toolset "gcc"
 
     filter{}
 
@@ -38,6 +65,8 @@ workspace "VisualSolution"
         location "VisualStudio"
     filter "kind:WindowedApp"
         targetdir "bin/"
+    filter "kind:ConsoleApp"
+        targetdir "bin/"
     filter "kind:StaticLib"
         targetdir "bin/lib"
 
@@ -48,8 +77,10 @@ workspace "VisualSolution"
     filter "toolset:msc"
         buildoptions { "/std:c++17 /nologo /EHs-c- /GR-" }
         linkoptions { "/NOLOGO" }
+    filter "toolset:gcc"
+        buildoptions { "-std=c++17 -fno-exceptions -fno-rtti -fno-strict-aliasing" }
 
-    filter "configurations:Debug"
+    filter { "toolset:msc", "configurations:Debug" }
         buildoptions{ "/fsanitize=address /Zi" }
         linkoptions{ "/INCREMENTAL:NO" }
 
@@ -57,6 +88,24 @@ workspace "VisualSolution"
         buildoptions { "/Od" }
     filter { "toolset:msc", "configurations:Release" }
         buildoptions { "/Oi /O2" }
+    filter { "toolset:gcc", "configurations:Debug" }
+        buildoptions { "-O0 -g" }
+    filter { "toolset:gcc", "configurations:Release" }
+        buildoptions { "-O2" }
+
+    filter "options:opcode_stats"
+        defines { "CHIP8_OPCODE_STATS" }
+
+    filter "options:jit_perf_map"
+        defines { "CHIP8_JIT_PERF_MAP" }
+
+    -- the binaries only run on processors with the instruction set
+    filter "options:simd=avx2"
+        vectorextensions "AVX2"
+    filter { "options:simd=avx512", "toolset:msc" }
+        buildoptions { "/arch:AVX512" }
+    filter { "options:simd=avx512", "toolset:gcc" }
+        buildoptions { "-mavx512f -mavx512bw" }
 
     filter {}
 
@@ -67,8 +116,71 @@ workspace "VisualSolution"
         language "C++"
 
         files { "source/*.cpp", "source/*.h", "source/*.inl" }
-        links { "dwmapi" }
 
         includedirs { "external" }
 
+    -- one platform layer per system ; engine_posix.cpp has no window and runs in a terminal
+    filter "system:windows"
+        removefiles { "source/engine_posix.cpp" }
+        links { "dwmapi" }
+    filter "not system:windows"
+        kind "ConsoleApp"
+        removefiles { "source/engine_win32.cpp" }
+        links { "pthread" }
+
+    filter "options:aot"
+        files { "tmp/aot/*.cpp" }
+        includedirs { "source" }
+        defines { "CHIP8_AOT" }
+
+    filter {}
+
+    -- chip8_run ROM [-frames=N | -instructions=N] [-backend=NAME] [-machine=chip8|superchip|xochip] [-quirks=auto|NAME] [-ips=N] [-keys=FRAME:KEYS,...] [-replay=MOVIE] [-batch=N] [-memory_profile=PATH] [-opcode_stats[=N]]
+    -- the Chip8 core without the platform layer ; ram_retail so that Chip8 errors are reported instead of breaking
+    project "chip8_run"
+        kind "ConsoleApp"
+        language "C++"
+
+        files { "tools/chip8_run.cpp", "tools/tool_platform.cpp", "source/chip8*.cpp", "source/core.cpp", "source/*.h", "source/*.inl" }
+        defines { "ram_retail" }
+
+        includedirs { "source" }
+
+    filter "not system:windows"
+        links { "pthread" }
+
+    filter "options:aot"
+        files { "tmp/aot/*.cpp" }
+        defines { "CHIP8_AOT" }
+
+    filter {}
+
+    -- chip8_bench [-instructions=N] [-runs=N] [-backend=NAME] [-ips=N] [-data=DIRECTORY] [ROM ...] > report.json
+    project "chip8_bench"
+        kind "ConsoleApp"
+        language "C++"
+
+        files { "tools/chip8_bench.cpp", "tools/tool_platform.cpp", "source/chip8*.cpp", "source/core.cpp", "source/*.h", "source/*.inl" }
+        defines { "ram_retail" }
+
+        includedirs { "source" }
+
+    filter "not system:windows"
+        links { "pthread" }
+
+    filter "options:aot"
+        files { "tmp/aot/*.cpp" }
+        defines { "CHIP8_AOT" }
+
+    filter {}
+
+    -- chip8_aot OUTPUT.cpp [-quirks=NAME] ROM [[-quirks=NAME] ROM ...]
+    project "chip8_aot"
+        kind "ConsoleApp"
+        language "C++"
+
+        files { "tools/chip8_aot.cpp" }
+
+        includedirs { "source" }
+
     filter {}
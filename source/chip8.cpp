@@ -0,0 +1,1829 @@
+#include "chip8.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#endif
+
+Chip8_Op Chip8_decode_fused(Chip8* chip8, u16 adress){
+	Chip8_Op op = Chip8_decode(Chip8_fetch(chip8, adress), chip8->MACHINE);
+
+	// the next instructions are executed without validating PC
+	if (!Chip8_is_valid_memory(chip8, adress + 2, 2)) return op;
+	Chip8_Op next = Chip8_decode(Chip8_fetch(chip8, adress + 2), chip8->MACHINE);
+
+	switch (op.type){
+		case Chip8_Op::SE_VX_BYTE:
+		case Chip8_Op::SNE_VX_BYTE:
+		case Chip8_Op::SE_VX_VY:
+		case Chip8_Op::SNE_VX_VY:
+		{
+			if (next.type != Chip8_Op::JP_ADDR || !Chip8_is_valid_memory(chip8, next.nnn, 1)) break;
+
+			if (op.type == Chip8_Op::SE_VX_BYTE)		op.type = Chip8_Op::SE_VX_BYTE_JP;
+			else if (op.type == Chip8_Op::SNE_VX_BYTE)	op.type = Chip8_Op::SNE_VX_BYTE_JP;
+			else if (op.type == Chip8_Op::SE_VX_VY)		op.type = Chip8_Op::SE_VX_VY_JP;
+			else										op.type = Chip8_Op::SNE_VX_VY_JP;
+			op.nnn = next.nnn;
+			break;
+		}
+		case Chip8_Op::LD_I_ADDR:
+		{
+			if (next.type != Chip8_Op::DRW_VX_VY_N) break;
+
+			op.type = Chip8_Op::LD_I_ADDR_DRW;
+			op.x = next.x;
+			op.y = next.y;
+			op.n = next.n;
+			break;
+		}
+		case Chip8_Op::LD_VX_DT:
+		{
+			if (next.type != Chip8_Op::SE_VX_BYTE || next.x != op.x || next.kk != 0) break;
+			if (!Chip8_is_valid_memory(chip8, adress + 4, 2)) break;
+
+			Chip8_Op last = Chip8_decode(Chip8_fetch(chip8, adress + 4), chip8->MACHINE);
+			if (last.type != Chip8_Op::JP_ADDR || !Chip8_is_valid_memory(chip8, last.nnn, 1)) break;
+
+			op.type = Chip8_Op::LD_VX_DT_SE_VX_0_JP;
+			op.nnn = last.nnn;
+			break;
+		}
+		case Chip8_Op::SKP_VX:
+		case Chip8_Op::SKNP_VX:
+		{
+			if (next.type != Chip8_Op::JP_ADDR || !Chip8_is_valid_memory(chip8, next.nnn, 1)) break;
+
+			op.type = op.type == Chip8_Op::SKP_VX ? Chip8_Op::SKP_VX_JP : Chip8_Op::SKNP_VX_JP;
+			op.nnn = next.nnn;
+			break;
+		}
+		case Chip8_Op::LD_VX_BYTE:
+		{
+			if ((next.type != Chip8_Op::SKP_VX && next.type != Chip8_Op::SKNP_VX) || next.x != op.x) break;
+
+			op.type = next.type == Chip8_Op::SKP_VX ? Chip8_Op::LD_VX_BYTE_SKP_VX : Chip8_Op::LD_VX_BYTE_SKNP_VX;
+			op.skip = Chip8_skip_size(chip8, adress + 4);
+			break;
+		}
+		case Chip8_Op::ADD_I_VX:
+		{
+			if (next.type != Chip8_Op::LD_VX_MEM) break;
+
+			op.type = Chip8_Op::ADD_I_VX_LD_VY_MEM;
+			op.y = next.x;
+			break;
+		}
+		default:
+			break;
+	}
+
+	return op;
+}
+
+Chip8_Op Chip8_decode_checked(Chip8* chip8, u16 adress, int fusion){
+	Chip8_Op op = {};
+	if (!Chip8_is_valid_memory(chip8, adress, 2)){
+		op.type = Chip8_Op::TRAP;
+		return op;
+	}
+
+	op = fusion ? Chip8_decode_fused(chip8, adress) : Chip8_decode(Chip8_fetch(chip8, adress), chip8->MACHINE);
+
+	// same bounds as the interpreter
+	if ((op.type == Chip8_Op::JP_ADDR && !Chip8_is_valid_memory(chip8, op.nnn, 1))
+	|| (op.type == Chip8_Op::CALL_ADDR && !Chip8_is_valid_memory(chip8, op.nnn, 2)))
+		op.type = Chip8_Op::TRAP;
+
+	// the skips of superinstructions are set by Chip8_decode_fused
+	if (op.type == Chip8_Op::SE_VX_BYTE || op.type == Chip8_Op::SNE_VX_BYTE || op.type == Chip8_Op::SE_VX_VY
+	|| op.type == Chip8_Op::SNE_VX_VY || op.type == Chip8_Op::SKP_VX || op.type == Chip8_Op::SKNP_VX)
+		op.skip = Chip8_skip_size(chip8, adress + 2);
+
+	if (op.type == Chip8_Op::LD_I_LONG){
+		if (!Chip8_is_valid_memory(chip8, adress + 2, 2))	op.type = Chip8_Op::TRAP;
+		else												op.nnn = Chip8_fetch(chip8, adress + 2);
+	}
+
+	return op;
+}
+
+void Chip8_fill_decode_cache(Chip8* chip8){
+	// PC never reaches the entries past memory_size
+	int op_count = chip8->memory_size / 2 + 1;
+	for (int iop = 0; iop != op_count; ++iop)
+		chip8->DECODE_CACHE[iop] = Chip8_decode_checked(chip8, iop * 2, chip8->DECODE_FUSION);
+	memset(chip8->DECODE_CACHE + op_count, 0x00, sizeof(Chip8::DECODE_CACHE) - op_count * sizeof(Chip8_Op));
+}
+
+void Chip8_invalidate_decode(Chip8* chip8, u16 adress, u16 size){
+	// superinstructions cover up to two instructions after their own
+	u16 first = max(adress / 2 - 2, 0);
+	u16 last = (adress + size - 1) / 2;
+	for (u16 iop = first; iop <= last && iop < carray_size(Chip8::DECODE_CACHE); ++iop)
+		chip8->DECODE_CACHE[iop].type = Chip8_Op::UNDECODED;
+
+	if (chip8->JIT_CACHE) Chip8_jit_invalidate(chip8, adress, size);
+	Chip8_aot_invalidate(chip8, adress, size);
+}
+
+void Chip8_create_memory(Chip8::Memory& memory, const void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine){
+	static_assert(offsetof(Chip8::Memory, user_range) == 0x200);
+	static_assert(sizeof(Chip8::Memory) == Kilobytes(64));
+
+	u32 memory_size = Chip8_memory_size(machine);
+	memset(&memory, 0x00, memory_size);
+
+	u8 sprite_data[] = {
+		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+		0x20, 0x60, 0x20, 0x20, 0x70, // 1
+		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+	};
+
+	// sizeof(sprite_data) == sizeof(Chip8::memory::interpreter_range::sprites)
+	static_assert(sizeof(sprite_data) == sizeof(Chip8::Memory::Interpreter::sprites));
+
+	memcpy(memory.interpreter_range.sprites, sprite_data, sizeof(Chip8::Memory::Interpreter::sprites));
+
+	// SUPER-CHIP 1.1 only has the digits 0 to 9 ; A to F are the ones of Octo
+	// REF: https://github.com/JohnEarnest/Octo/blob/gh-pages/docs/SuperChip.md [SuperChip]
+	u8 big_sprite_data[] = {
+		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+	};
+	static_assert(sizeof(big_sprite_data) == sizeof(Chip8::Memory::Interpreter::big_sprites));
+
+	if (machine != Chip8::CHIP8)
+		memcpy(memory.interpreter_range.big_sprites, big_sprite_data, sizeof(Chip8::Memory::Interpreter::big_sprites));
+
+	ram_assert(ROM_size <= memory_size - sizeof(Chip8::Memory::Interpreter));
+	memcpy((void*)(memory.user_range), ROM, ROM_size);
+}
+
+// instruction at adress or 0x0000 outside of the ROM
+static u16 Chip8_fetch_ROM(const void* ROM, size_t ROM_size, u16 adress){
+	if (adress < 0x200 || (size_t)(adress - 0x200) + 2u > ROM_size) return 0x0000;
+
+	const u8* memptr = (const u8*)ROM + (adress - 0x200);
+	return ((u16)memptr[0] << 8) | (u16)memptr[1];
+}
+
+Chip8::MACHINE_TYPE Chip8_detect_machine(const void* ROM, size_t ROM_size){
+	if (ROM_size > Chip8_memory_size(Chip8::SUPERCHIP) - sizeof(Chip8::Memory::Interpreter)) return Chip8::XOCHIP;
+
+	u16 instruction = Chip8_fetch_ROM(ROM, ROM_size, 0x200);
+	if ((instruction & 0xF000) == 0x1000)
+		instruction = Chip8_fetch_ROM(ROM, ROM_size, instruction & 0x0FFF);
+
+	return (instruction == 0x00FE || instruction == 0x00FF) ? Chip8::SUPERCHIP : Chip8::CHIP8;
+}
+
+u32 Chip8_memory_size(Chip8::MACHINE_TYPE machine){
+	return machine == Chip8::XOCHIP ? Kilobytes(64) : Kilobytes(4);
+}
+
+Chip8_Quirks::TYPE Chip8_default_quirks(Chip8::MACHINE_TYPE machine){
+	static constexpr Chip8_Quirks::TYPE machine_quirks[Chip8::MACHINE_COUNT] = { Chip8_Quirks::COWGOD, Chip8_Quirks::SUPERCHIP, Chip8_Quirks::XOCHIP };
+	return machine_quirks[machine];
+}
+
+void Chip8_create( Chip8* chip8, void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine )
+{
+	chip8->MACHINE = machine;
+	chip8->QUIRKS = Chip8_default_quirks(machine);
+
+	chip8->screen_width = 64;
+	chip8->screen_height = 32;
+
+	chip8->memory_size = Chip8_memory_size(machine);
+	chip8->reserved_start = Chip8_reserved_start(machine);
+
+	chip8->emulation_speed = 1.f;
+
+	chip8->instructions_per_second = 500u;
+	chip8->timer_per_second = 60u;
+
+	chip8->instruction_accumulator = 0.f;
+	chip8->CYCLE = 0u;
+	chip8->IDLE_CYCLE = 0u;
+
+	chip8->ROM = (const u8*)ROM;
+	chip8->ROM_SIZE = (u32)ROM_size;
+	chip8->ROM_HASH = FNV1a(ROM, ROM_size);
+
+	Chip8_create_memory(chip8->memory, ROM, ROM_size, machine);
+	memset((u8*)&chip8->memory + chip8->memory_size, 0x00, sizeof(Chip8::Memory) - chip8->memory_size);
+	memset(&chip8->memory_guard, 0x00, sizeof(Chip8::memory_guard));
+	memset(&chip8->registers, 0x00, sizeof(Chip8::registers));
+
+	chip8->I = 0;
+
+	chip8->DT = 0;
+	chip8->ST = 0;
+	chip8->DT_TICK = 0u;
+	chip8->ST_TICK = 0u;
+
+	chip8->PC = 0x200;
+	chip8->SP = 0;
+
+	memset(&chip8->STACK, 0x00, sizeof(Chip8::STACK));
+	memset(&chip8->SCREEN, 0x00, sizeof(Chip8::SCREEN));
+	chip8->PLANES = 1u;
+	chip8->SCREEN_DIRTY = UINT64_MAX;
+	chip8->SCREEN_GENERATION = 0u;
+	memset(&chip8->KEYBOARD, 0x00, sizeof(Chip8::KEYBOARD));
+	memset(&chip8->LAST_KEYBOARD, 0x00, sizeof(Chip8::KEYBOARD));
+	memset(&chip8->RPL, 0x00, sizeof(Chip8::RPL));
+
+	// REF: https://github.com/JohnEarnest/Octo/blob/gh-pages/docs/XO-ChipSpecification.md [XO-CHIP Specification]
+	// the pattern is undefined until AUDIO ; a square wave keeps the buzzer of the other machines
+	for (int ibyte = 0; ibyte != carray_size(Chip8::AUDIO_PATTERN); ++ibyte)
+		chip8->AUDIO_PATTERN[ibyte] = ibyte < 8 ? 0xFF : 0x00;
+	chip8->PITCH = 64u;
+	create_default_random(chip8->RANDOM);
+
+	chip8->ERROR = Chip8::NONE;
+	chip8->BACKEND = Chip8::DECODED;
+	chip8->JIT_CACHE = NULL;
+	chip8->AOT_PROGRAM = NULL;
+	chip8->AOT_WRITTEN_LINES = 0u;
+	chip8->DECODE_FUSION = false;
+	chip8->PROFILE = NULL;
+	chip8->MEMORY_PROFILE = NULL;
+#if defined(CHIP8_OPCODE_STATS)
+	chip8->OPCODE_STATS = NULL;
+#endif
+
+	Chip8_fill_decode_cache(chip8);
+}
+
+void Chip8_destroy(Chip8* chip8){
+	Chip8_jit_destroy(chip8);
+}
+
+static void Chip8_screen_modified(Chip8* chip8, u64 dirty){
+	if (dirty){
+		chip8->SCREEN_DIRTY |= dirty;
+		++chip8->SCREEN_GENERATION;
+	}
+}
+
+// rows of the current resolution
+static u64 Chip8_screen_rows(Chip8* chip8){
+	return chip8->screen_height == 64 ? UINT64_MAX : ((u64)1u << chip8->screen_height) - 1u;
+}
+
+// planes modified by CLS, DRW and the scrolls
+static int Chip8_plane_selected(Chip8* chip8, int plane){
+	return (chip8->PLANES >> plane) & 1u;
+}
+
+// planes of SCREEN drawn by the machine ; PLANES is 1 except with XOCHIP
+template<Chip8::MACHINE_TYPE machine>
+static constexpr int Chip8_plane_count(){
+	return machine == Chip8::XOCHIP ? carray_size(Chip8::SCREEN) : 1;
+}
+
+// sprite_rows are left-aligned on bit 63 ; returns the number of rows that collide in plane
+template<Chip8::MACHINE_TYPE machine>
+static int Chip8_draw_rows(Chip8* chip8, int plane, u8 x, u8 y, const u64* sprite_rows, int n){
+	// every sprite row is moved to its column with a rotate so that pixels past the right edge wrap around to x = 0
+	// rows past the bottom of the screen wrap around to y = 0
+	// x and y are only outside the screen with SUPERCHIP and XOCHIP, where they are taken modulo the resolution
+	//
+	// sprite byte 11000011 at x = 60 in 64x32:
+	// bit  63                                                             0
+	//      0011 00000000 ... 00000000 1100
+	//      [x = 0]                    [x = 60]
+	//
+	// in 128x64 the row is rotated across its two words: the word of x gets the row shifted by x % 64
+	// and the other word gets the pixels shifted out of it, which is the next word or the wrap around to x = 0
+
+	// constants with CHIP8
+	int screen_width = Chip8_screen_width<machine>(chip8);
+	int screen_height = Chip8_screen_height<machine>(chip8);
+
+	x &= screen_width - 1;
+	y &= screen_height - 1;
+
+	u64 (*SCREEN)[2] = chip8->SCREEN[plane];
+	int collision_rows = 0;
+	u64 dirty = 0u;
+
+	int row = y;
+	if (screen_width == 64){
+		for (int iy = 0; iy != n; ++iy){
+			ram_assert(row < screen_height);
+
+			u64 sprite_row = Chip8_rotate_right(sprite_rows[iy], x);
+			collision_rows += (SCREEN[row][0] & sprite_row) != 0u;
+			SCREEN[row][0] ^= sprite_row;
+			dirty |= (u64)(sprite_row != 0u) << row;
+
+			if (++row == screen_height) row = 0;
+		}
+	}
+	else{
+		u32 word = x >> 6u;
+		u32 shift = x & 63u;
+		for (int iy = 0; iy != n; ++iy){
+			ram_assert(row < screen_height);
+
+			u64 head = sprite_rows[iy] >> shift;
+			u64 tail = (sprite_rows[iy] << 1u) << (63u - shift);
+			u64* SCREENrow = SCREEN[row];
+			collision_rows += ((SCREENrow[word] & head) | (SCREENrow[word ^ 1u] & tail)) != 0u;
+			SCREENrow[word] ^= head;
+			SCREENrow[word ^ 1u] ^= tail;
+			dirty |= (u64)(sprite_rows[iy] != 0u) << row;
+
+			if (++row == screen_height) row = 0;
+		}
+	}
+
+	Chip8_screen_modified(chip8, dirty);
+	return collision_rows;
+}
+
+// VF is 1 on a collision except in 128x64 with SUPERCHIP where it is the number of rows that collide like SUPER-CHIP 1.1
+template<Chip8::MACHINE_TYPE machine>
+static void Chip8_set_collision(Chip8* chip8, int collision_rows){
+	int row_count = machine == Chip8::SUPERCHIP && chip8->screen_width == 128;
+	chip8->registers.VF = row_count ? (u8)collision_rows : (u8)(collision_rows != 0);
+}
+
+u16 Chip8_sprite_size(const Chip8* chip8, u16 row_bytes){
+	return row_bytes * ((chip8->PLANES & 1u) + (chip8->PLANES >> 1u));
+}
+
+template<Chip8::MACHINE_TYPE machine>
+void Chip8_draw_sprite(Chip8* chip8, u8 x, u8 y, short n){
+	u8* src = Chip8_get_memory(chip8, chip8->I);
+
+	int collision_rows = 0;
+	for (int iplane = 0; iplane != Chip8_plane_count<machine>(); ++iplane){
+		if (machine == Chip8::XOCHIP && !Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 sprite_rows[16];
+		for (int iy = 0; iy != n; ++iy)
+			sprite_rows[iy] = (u64)src[iy] << 56u;
+
+		collision_rows += Chip8_draw_rows<machine>(chip8, iplane, x, y, sprite_rows, n);
+		src += n;
+	}
+
+	Chip8_set_collision<machine>(chip8, collision_rows);
+}
+
+template<Chip8::MACHINE_TYPE machine>
+void Chip8_draw_sprite_16(Chip8* chip8, u8 x, u8 y){
+	u8* src = Chip8_get_memory(chip8, chip8->I);
+
+	int collision_rows = 0;
+	for (int iplane = 0; iplane != Chip8_plane_count<machine>(); ++iplane){
+		if (machine == Chip8::XOCHIP && !Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 sprite_rows[16];
+		for (int iy = 0; iy != 16; ++iy)
+			sprite_rows[iy] = ((u64)src[2 * iy] << 56u) | ((u64)src[2 * iy + 1] << 48u);
+
+		collision_rows += Chip8_draw_rows<machine>(chip8, iplane, x, y, sprite_rows, 16);
+		src += 32;
+	}
+
+	Chip8_set_collision<machine>(chip8, collision_rows);
+}
+
+template<Chip8::MACHINE_TYPE machine>
+void Chip8_clear_screen(Chip8* chip8){
+	u64 dirty = 0u;
+	for (int iplane = 0; iplane != Chip8_plane_count<machine>(); ++iplane){
+		if (machine == Chip8::XOCHIP && !Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 (*SCREEN)[2] = chip8->SCREEN[iplane];
+		for (int iy = 0; iy != Chip8_screen_height<machine>(chip8); ++iy)
+			dirty |= (u64)((SCREEN[iy][0] | SCREEN[iy][1]) != 0u) << iy;
+
+		memset(SCREEN, 0x00, sizeof(Chip8::SCREEN[0]));
+	}
+
+	Chip8_screen_modified(chip8, dirty);
+}
+
+#define Chip8_MACHINE_INSTANTIATION(machine)																\
+	template void Chip8_draw_sprite<machine>(Chip8* chip8, u8 x, u8 y, short n);						\
+	template void Chip8_draw_sprite_16<machine>(Chip8* chip8, u8 x, u8 y);								\
+	template void Chip8_clear_screen<machine>(Chip8* chip8)
+
+Chip8_MACHINE_INSTANTIATION(Chip8::CHIP8);
+Chip8_MACHINE_INSTANTIATION(Chip8::SUPERCHIP);
+Chip8_MACHINE_INSTANTIATION(Chip8::XOCHIP);
+
+#undef Chip8_MACHINE_INSTANTIATION
+
+void Chip8_draw_sprite(Chip8* chip8, u8 x, u8 y, short n){
+	static void (* const machines[Chip8::MACHINE_COUNT])(Chip8*, u8, u8, short) = {
+		Chip8_draw_sprite<Chip8::CHIP8>, Chip8_draw_sprite<Chip8::SUPERCHIP>, Chip8_draw_sprite<Chip8::XOCHIP>,
+	};
+	machines[chip8->MACHINE](chip8, x, y, n);
+}
+
+void Chip8_draw_sprite_16(Chip8* chip8, u8 x, u8 y){
+	static void (* const machines[Chip8::MACHINE_COUNT])(Chip8*, u8, u8) = {
+		Chip8_draw_sprite_16<Chip8::CHIP8>, Chip8_draw_sprite_16<Chip8::SUPERCHIP>, Chip8_draw_sprite_16<Chip8::XOCHIP>,
+	};
+	machines[chip8->MACHINE](chip8, x, y);
+}
+
+void Chip8_clear_screen(Chip8* chip8){
+	static void (* const machines[Chip8::MACHINE_COUNT])(Chip8*) = {
+		Chip8_clear_screen<Chip8::CHIP8>, Chip8_clear_screen<Chip8::SUPERCHIP>, Chip8_clear_screen<Chip8::XOCHIP>,
+	};
+	machines[chip8->MACHINE](chip8);
+}
+
+void Chip8_scroll_down(Chip8* chip8, int n){
+	n = min(n, chip8->screen_height);
+
+	// rows are 16 bytes so the scroll is a single move of the rows that stay on screen
+	for (int iplane = 0; iplane != carray_size(Chip8::SCREEN); ++iplane){
+		if (!Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 (*SCREEN)[2] = chip8->SCREEN[iplane];
+		memmove(SCREEN[n], SCREEN[0], sizeof(Chip8::SCREEN[0][0]) * (chip8->screen_height - n));
+		memset(SCREEN[0], 0x00, sizeof(Chip8::SCREEN[0][0]) * n);
+	}
+
+	if (n && chip8->PLANES) Chip8_screen_modified(chip8, Chip8_screen_rows(chip8));
+}
+
+void Chip8_scroll_up(Chip8* chip8, int n){
+	n = min(n, chip8->screen_height);
+
+	for (int iplane = 0; iplane != carray_size(Chip8::SCREEN); ++iplane){
+		if (!Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 (*SCREEN)[2] = chip8->SCREEN[iplane];
+		memmove(SCREEN[0], SCREEN[n], sizeof(Chip8::SCREEN[0][0]) * (chip8->screen_height - n));
+		memset(SCREEN[chip8->screen_height - n], 0x00, sizeof(Chip8::SCREEN[0][0]) * n);
+	}
+
+	if (n && chip8->PLANES) Chip8_screen_modified(chip8, Chip8_screen_rows(chip8));
+}
+
+void Chip8_scroll_right(Chip8* chip8){
+	for (int iplane = 0; iplane != carray_size(Chip8::SCREEN); ++iplane){
+		if (!Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 (*SCREEN)[2] = chip8->SCREEN[iplane];
+		if (chip8->screen_width == 64){
+			for (int iy = 0; iy != chip8->screen_height; ++iy)
+				SCREEN[iy][0] >>= 4u;
+		}
+		else{
+			for (int iy = 0; iy != chip8->screen_height; ++iy){
+				u64* SCREENrow = SCREEN[iy];
+				SCREENrow[1] = (SCREENrow[1] >> 4u) | (SCREENrow[0] << 60u);
+				SCREENrow[0] >>= 4u;
+			}
+		}
+	}
+
+	if (chip8->PLANES) Chip8_screen_modified(chip8, Chip8_screen_rows(chip8));
+}
+
+void Chip8_scroll_left(Chip8* chip8){
+	for (int iplane = 0; iplane != carray_size(Chip8::SCREEN); ++iplane){
+		if (!Chip8_plane_selected(chip8, iplane)) continue;
+
+		u64 (*SCREEN)[2] = chip8->SCREEN[iplane];
+		if (chip8->screen_width == 64){
+			for (int iy = 0; iy != chip8->screen_height; ++iy)
+				SCREEN[iy][0] <<= 4u;
+		}
+		else{
+			for (int iy = 0; iy != chip8->screen_height; ++iy){
+				u64* SCREENrow = SCREEN[iy];
+				SCREENrow[0] = (SCREENrow[0] << 4u) | (SCREENrow[1] >> 60u);
+				SCREENrow[1] <<= 4u;
+			}
+		}
+	}
+
+	if (chip8->PLANES) Chip8_screen_modified(chip8, Chip8_screen_rows(chip8));
+}
+
+void Chip8_set_resolution(Chip8* chip8, int width, int height){
+	ram_assert((width == 64 && height == 32) || (width == 128 && height == 64));
+	if (width == chip8->screen_width) return;
+
+	memset(chip8->SCREEN, 0x00, sizeof(Chip8::SCREEN));
+	chip8->screen_width = width;
+	chip8->screen_height = height;
+
+	// every row of the new resolution is written by the next Chip8_to_screen
+	chip8->SCREEN_DIRTY = Chip8_screen_rows(chip8);
+	++chip8->SCREEN_GENERATION;
+}
+
+// Chip8::CYCLE of the current instruction ; end_cycle is Chip8::CYCLE + instruction_count when the backend is entered
+#define Chip8_SYNC_CYCLE() chip8->CYCLE = end_cycle - (u64)instruction_count
+
+template<typename Variant>
+static void Chip8_execute_interpreter(Chip8* chip8, int instruction_count){
+	short instruction = 0x0000;
+	char* instruction_byte = (char*)&instruction;
+
+	u64 end_cycle = chip8->CYCLE + instruction_count;
+
+	constexpr int superchip = Variant::machine != Chip8::CHIP8;
+	constexpr int xochip = Variant::machine == Chip8::XOCHIP;
+
+	//instruction_count = 1;
+	while (instruction_count)
+	{
+		Chip8_validate_memory(chip8, chip8->PC, 2);
+		if (chip8->ERROR) break;
+
+		u8* memptr = Chip8_get_memory(chip8, chip8->PC);
+		instruction_byte[1] = *memptr;
+		++memptr;
+		instruction_byte[0] = *memptr;
+		chip8->PC += 2;
+
+		if( instruction == 0x00E0 ) // CLS
+		{
+			Chip8_clear_screen<Variant::machine>( chip8 );
+		}
+		else if( superchip && ( instruction & 0xFFF0 ) == 0x00C0 ) // SCD nibble
+		{
+			Chip8_scroll_down(chip8, instruction & 0x000F);
+		}
+		else if( xochip && ( instruction & 0xFFF0 ) == 0x00D0 ) // SCU nibble
+		{
+			Chip8_scroll_up(chip8, instruction & 0x000F);
+		}
+		else if( superchip && instruction == 0x00FB ) // SCR
+		{
+			Chip8_scroll_right(chip8);
+		}
+		else if( superchip && instruction == 0x00FC ) // SCL
+		{
+			Chip8_scroll_left(chip8);
+		}
+		else if( superchip && instruction == 0x00FD ) // EXIT
+		{
+			chip8->PC -= 2; // the Chip8 stays on EXIT
+		}
+		else if( superchip && instruction == 0x00FE ) // LOW
+		{
+			Chip8_set_resolution(chip8, 64, 32);
+		}
+		else if( superchip && instruction == 0x00FF ) // HIGH
+		{
+			Chip8_set_resolution(chip8, 128, 64);
+		}
+		else if( instruction == 0x00EE ) // RET
+		{
+			if (chip8->SP == 0){
+				chip8->ERROR = Chip8::SP_INCORRECT;
+				break;
+			}
+
+			--chip8->SP;
+			chip8->PC = chip8->STACK[chip8->SP];
+		}
+		else if( ( instruction & 0xF000 ) == 0x1000 ) // JP addr
+		{
+			short addr = instruction & 0x0FFF;
+
+			Chip8_validate_memory(chip8, addr, 1);
+			if (chip8->ERROR) break;
+
+			chip8->PC = addr;
+		}
+		else if( ( instruction & 0xF000 ) == 0x2000 ) // CALL addr
+		{
+			short addr = instruction & 0x0FFF;
+
+			if (chip8->SP == carray_size(Chip8::STACK)) chip8->ERROR = Chip8::SP_INCORRECT;
+			Chip8_validate_memory(chip8, addr, 2);
+			if (chip8->ERROR) break;
+
+			chip8->STACK[chip8->SP++] = chip8->PC;
+			chip8->PC = addr;
+		}
+		else if( ( instruction & 0xF000 ) == 0x3000 ) // SE Vx, byte
+		{
+			short regindex = (instruction & 0x0F00) >> 8;
+
+			short regcmp = instruction & 0x00FF;
+			if (chip8->registers.by_index[regindex] == regcmp)
+				chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+		}
+		else if( ( instruction & 0xF000 ) == 0x4000 ) // SNE Vx, byte
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			short regcmp = ( instruction & 0x00FF );
+			if( chip8->registers.by_index[regindex] != regcmp )
+				chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+		}
+		else if( ( instruction & 0xF00F ) == 0x5000 ) // SE Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			if (chip8->registers.by_index[regA] == chip8->registers.by_index[regB])
+				chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+		}
+		else if( xochip && ( instruction & 0xF00E ) == 0x5002 ) // LD [I], Vx - Vy and LD Vx - Vy, [I]
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			// the registers are in reverse order when x > y
+			short regcount = ( regA <= regB ? regB - regA : regA - regB ) + 1;
+			short regstep = regA <= regB ? 1 : -1;
+
+			Chip8_validate_memory( chip8, chip8->I, regcount );
+			if( chip8->ERROR ) break;
+
+			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+
+			if( ( instruction & 0x000F ) == 0x0002 ){
+				for (int ireg = 0; ireg != regcount; ++ireg)
+					memptr[ireg] = chip8->registers.by_index[regA + ireg * regstep];
+
+				Chip8_invalidate_decode(chip8, chip8->I, regcount);
+			}
+			else{
+				for (int ireg = 0; ireg != regcount; ++ireg)
+					chip8->registers.by_index[regA + ireg * regstep] = memptr[ireg];
+			}
+		}
+		else if( (instruction & 0xF000) == 0x6000 ) // LD Vx, byte
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			short regvalue = ( instruction & 0x00FF );
+			chip8->registers.by_index[regindex] = (u8)regvalue;
+		}
+		else if( (instruction & 0xF000) == 0x7000 ) // ADD Vx, byte
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			short regadd = ( instruction & 0x00FF );
+			chip8->registers.by_index[regindex] += regadd;
+		}
+		else if( (instruction & 0xF00F) == 0x8000 ) // LD Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			chip8->registers.by_index[regA] = chip8->registers.by_index[regB];
+		}
+		else if( (instruction & 0xF00F) == 0x8001 ) // OR Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			chip8->registers.by_index[regA] |= chip8->registers.by_index[regB];
+			Chip8_logic_VF<Variant>(chip8);
+		}
+		else if( (instruction & 0xF00F) == 0x8002 ) // AND Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			chip8->registers.by_index[regA] &= chip8->registers.by_index[regB];
+			Chip8_logic_VF<Variant>(chip8);
+		}
+		else if( (instruction & 0xF00F) == 0x8003 ) // XOR Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			chip8->registers.by_index[regA] ^= chip8->registers.by_index[regB];
+			Chip8_logic_VF<Variant>(chip8);
+		}
+		else if( (instruction & 0xF00F) == 0x8004 ) // ADD Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			short add = chip8->registers.by_index[regA] + chip8->registers.by_index[regB];
+			chip8->registers.VF = add > 255 ? 1 : 0;
+			chip8->registers.by_index[regA] = (u8)add;
+		}
+		else if( (instruction & 0xF00F) == 0x8005 ) // SUB Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			chip8->registers.VF = chip8->registers.by_index[regA] > chip8->registers.by_index[regB] ? 1 : 0;
+			chip8->registers.by_index[regA] -= chip8->registers.by_index[regB];
+		}
+		else if( (instruction & 0xF00F) == 0x8006 ) // SHR Vx {, Vy}
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			if constexpr (Variant::quirks.shift_vy){
+				u8 value = chip8->registers.by_index[( instruction & 0x00F0 ) >> 4];
+				chip8->registers.VF = value & 0x01;
+				chip8->registers.by_index[regindex] = value >> 1;
+			}
+			else{
+				chip8->registers.VF = chip8->registers.by_index[regindex] & 0x01;
+				chip8->registers.by_index[regindex] >>= 1;
+			}
+		}
+		else if( (instruction & 0xF00F) == 0x8007 ) // SUBN Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			chip8->registers.VF = chip8->registers.by_index[regB] > chip8->registers.by_index[regA] ? 1 : 0;
+			chip8->registers.by_index[regA] = chip8->registers.by_index[regB] - chip8->registers.by_index[regA];
+		}
+		else if( (instruction & 0xF00F) == 0x800E ) // SHL Vx {, Vy}
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			if constexpr (Variant::quirks.shift_vy){
+				u8 value = chip8->registers.by_index[( instruction & 0x00F0 ) >> 4];
+				chip8->registers.VF = (value & 0x80) >> 7;
+				chip8->registers.by_index[regindex] = value << 1;
+			}
+			else{
+				chip8->registers.VF = (chip8->registers.by_index[regindex] & 0x80) >> 7;
+				chip8->registers.by_index[regindex] <<= 1;
+			}
+		}
+		else if( (instruction & 0xF00F) == 0x9000 ) // SNE Vx, Vy
+		{
+			short regA = ( instruction & 0x0F00 ) >> 8;
+			short regB = ( instruction & 0x00F0 ) >> 4;
+
+			if (chip8->registers.by_index[regA] != chip8->registers.by_index[regB])
+				chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+		}
+		else if( ( instruction & 0xF000 ) == 0xA000 ) // LD I, addr
+		{
+			short regvalue = ( instruction & 0x0FFF );
+			chip8->I = regvalue;
+		}
+		else if( ( instruction & 0xF000 ) == 0xB000 ) // JP V0, addr
+		{
+			short regvalue = (instruction & 0x0FFF);
+
+			// BXNN with jump_vx
+			short regindex = Variant::quirks.jump_vx ? ( instruction & 0x0F00 ) >> 8 : 0;
+
+			short new_PC = regvalue + chip8->registers.by_index[regindex];
+
+			Chip8_validate_memory(chip8, new_PC, 2);
+			if (chip8->ERROR) break;
+
+			chip8->PC = new_PC;
+		}
+		else if( ( instruction & 0xF000 ) == 0xC000 ) // RND Vx, byte
+		{
+			short regindex = (instruction & 0x0F00) >> 8;
+			short regvalue = (instruction & 0x00FF);
+
+			u8 random_byte = random_char(chip8->RANDOM);
+			chip8->registers.by_index[regindex] = random_byte & (u8)regvalue;
+		}
+		else if( superchip && ( instruction & 0xF00F ) == 0xD000 ) // DRW Vx, Vy, 0
+		{
+			short regx = (instruction & 0x0F00) >> 8;
+			short regy = (instruction & 0x00F0) >> 4;
+
+			u8 x = chip8->registers.by_index[regx];
+			u8 y = chip8->registers.by_index[regy];
+
+			if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y))
+				chip8->ERROR = Chip8::SCREEN_COORD_INCORRECT;
+			Chip8_validate_memory(chip8, chip8->I, Chip8_sprite_size(chip8, 32));
+			if (chip8->ERROR) break;
+
+			Chip8_draw_sprite_16<Variant::machine>(chip8, x, y);
+		}
+		else if( ( instruction & 0xF000 ) == 0xD000 ) // DRW Vx, Vy, nibble
+		{
+			short regx = (instruction & 0x0F00) >> 8;
+			short regy = (instruction & 0x00F0) >> 4;
+			short n = (instruction & 0x000F);
+
+			u8 x = chip8->registers.by_index[regx];
+			u8 y = chip8->registers.by_index[regy];
+
+			if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y) || n >= Chip8_screen_height<Variant::machine>(chip8))
+				chip8->ERROR = Chip8::SCREEN_COORD_INCORRECT;
+			Chip8_validate_memory(chip8, chip8->I, Chip8_sprite_size(chip8, n));
+			if (chip8->ERROR) break;
+
+			Chip8_draw_sprite<Variant::machine>(chip8, x, y, n);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xE09E ) // SKP Vx
+		{
+			short regindex = (instruction & 0x0F00) >> 8;
+
+			u8 keyindex = chip8->registers.by_index[regindex];
+
+			if( keyindex >= sizeof( Chip8::KEYBOARD ) )
+			{
+				chip8->ERROR = Chip8::KEY_UNKNOWN;
+				break;
+			}
+
+			if( chip8->KEYBOARD[keyindex] )
+				chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xE0A1 ) // SKNP Vx
+		{
+			short regindex = (instruction & 0x0F00) >> 8;
+
+			u8 keyindex = chip8->registers.by_index[regindex];
+
+			if( keyindex >= sizeof( Chip8::KEYBOARD ) )
+			{
+				chip8->ERROR = Chip8::KEY_UNKNOWN;
+				break;
+			}
+
+			if (!chip8->KEYBOARD[keyindex])
+				chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+		}
+		else if( xochip && ( instruction & 0xFFFF ) == 0xF000 ) // LD I, long
+		{
+			Chip8_validate_memory(chip8, chip8->PC, 2);
+			if (chip8->ERROR) break;
+
+			chip8->I = Chip8_fetch(chip8, chip8->PC);
+			chip8->PC += 2;
+		}
+		else if( xochip && ( instruction & 0xFCFF ) == 0xF001 ) // PLANE n
+		{
+			chip8->PLANES = ( instruction & 0x0F00 ) >> 8;
+		}
+		else if( xochip && ( instruction & 0xFFFF ) == 0xF002 ) // AUDIO
+		{
+			Chip8_validate_memory(chip8, chip8->I, sizeof(Chip8::AUDIO_PATTERN));
+			if (chip8->ERROR) break;
+
+			memcpy(chip8->AUDIO_PATTERN, Chip8_get_memory(chip8, chip8->I), sizeof(Chip8::AUDIO_PATTERN));
+		}
+		else if( xochip && ( instruction & 0xF0FF ) == 0xF03A ) // PITCH Vx
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			chip8->PITCH = chip8->registers.by_index[regindex];
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF007 ) // LD Vx, DT
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			Chip8_SYNC_CYCLE();
+			chip8->registers.by_index[regindex] = Chip8_get_DT(chip8);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF00A ) // LD Vx, K
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			int keypress = -1;
+			for (int ikey = 0; ikey != carray_size(Chip8::KEYBOARD); ++ikey){
+				if (!chip8->KEYBOARD[ikey] && chip8->LAST_KEYBOARD[ikey]){
+					keypress = ikey;
+					break;
+				}
+			}
+
+			if (keypress != -1)
+				chip8->registers.by_index[regindex] = keypress;
+			else
+				chip8->PC -= 2; // rewing the instruction to wait
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF015 ) // LD DT, Vx
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			Chip8_SYNC_CYCLE();
+			Chip8_set_DT(chip8, chip8->registers.by_index[regindex]);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF018 ) // LD ST, Vx
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			Chip8_SYNC_CYCLE();
+			Chip8_set_ST(chip8, chip8->registers.by_index[regindex]);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF01E ) // ADD I, Vx
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			chip8->I += chip8->registers.by_index[regindex];
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF029 ) // LD F, Vx
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			u8 charindex = chip8->registers.by_index[regindex] & 0x0F;
+			short addr = (short)charindex * 5;
+
+			if( addr >= sizeof( Chip8::Memory::Interpreter::sprites) )
+			{
+				chip8->ERROR = Chip8::KEY_UNKNOWN;
+				break;
+			}
+
+			chip8->I = addr;
+		}
+		else if( superchip && ( instruction & 0xF0FF ) == 0xF030 ) // LD HF, Vx
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			u8 charindex = chip8->registers.by_index[regindex] & 0x0F;
+			chip8->I = Chip8_big_sprites_adress + (short)charindex * 10;
+		}
+		else if( superchip && ( instruction & ( xochip ? 0xF0FF : 0xF8FF ) ) == 0xF075 ) // LD R, Vx
+		{
+			short regcount = ( ( instruction & 0x0F00 ) >> 8 ) + 1;
+
+			memcpy(chip8->RPL, chip8->registers.by_index, regcount);
+		}
+		else if( superchip && ( instruction & ( xochip ? 0xF0FF : 0xF8FF ) ) == 0xF085 ) // LD Vx, R
+		{
+			short regcount = ( ( instruction & 0x0F00 ) >> 8 ) + 1;
+
+			memcpy(chip8->registers.by_index, chip8->RPL, regcount);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF033 ) // LD B, VX
+		{
+			short regindex = ( instruction & 0x0F00 ) >> 8;
+
+			Chip8_validate_memory(chip8, chip8->I, 3);
+			if (chip8->ERROR) break;
+
+			u8 byte = chip8->registers.by_index[regindex];
+
+			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+
+			*memptr = byte / 100;
+			++memptr;
+			*memptr = (byte % 100) / 10;
+			++memptr;
+			*memptr = (byte % 10);
+
+			Chip8_invalidate_decode(chip8, chip8->I, 3);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF055 ) // LD [I], Vx
+		{
+			short regcount = ( instruction & 0x0F00 ) >> 8;
+
+			Chip8_validate_memory( chip8, chip8->I, regcount + 1 );
+			if( chip8->ERROR ) break;
+
+			++regcount;	
+
+			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+
+			for (int ireg = 0; ireg != regcount; ++ireg)
+				memptr[ireg] = chip8->registers.by_index[ireg];
+
+			Chip8_invalidate_decode(chip8, chip8->I, regcount);
+			Chip8_load_store_I<Variant>(chip8, regcount);
+		}
+		else if( ( instruction & 0xF0FF ) == 0xF065 ) // LD Vx, [I]
+		{
+			short regcount = ( instruction & 0xF00 ) >> 8;
+
+			Chip8_validate_memory( chip8, chip8->I, regcount + 1 );
+			if( chip8->ERROR ) break;
+
+			++regcount;
+
+			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+
+			for( int ireg = 0; ireg != regcount; ++ireg )
+				chip8->registers.by_index[ireg] = memptr[ireg];
+
+			Chip8_load_store_I<Variant>(chip8, regcount);
+		}
+		else
+		{
+			chip8->ERROR = Chip8::INSTRUCTION_UNKNOWN;
+			break;
+		}
+
+		memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));
+
+		--instruction_count;
+	}
+
+	Chip8_SYNC_CYCLE();
+}
+
+static void Chip8_execute_interpreter(Chip8* chip8, int instruction_count){
+	static constexpr Chip8_Execute variants[Chip8::MACHINE_COUNT][Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_TABLE(Chip8_execute_interpreter);
+	variants[chip8->MACHINE][chip8->QUIRKS](chip8, instruction_count);
+}
+
+// slow path of Chip8_execute_decoded for the instruction before PC
+// the instruction is executed again by the interpreter so that faults set the same Chip8::ERROR as the other backends
+template<typename Variant>
+static void Chip8_trap(Chip8* chip8){
+	chip8->PC -= 2;
+	Chip8_execute_interpreter<Variant>(chip8, 1);
+}
+
+// ---- idle loops
+//
+// polling loops that can only exit when a timer or KEYBOARD changes are retired without being dispatched
+// the timers are evaluated from Chip8::CYCLE so the skipped instructions are only counted, in Chip8::IDLE_CYCLE too
+
+// retires the rest of the step on an instruction that waits for it:
+// * JP to itself and EXIT never exit
+// * KEYBOARD does not change during a step and LAST_KEYBOARD is equal to KEYBOARD once LD Vx, K retires
+//   when LD Vx, K finds no released key, the next ones of the step do not find one either
+static void Chip8_skip_idle_wait(Chip8* chip8, int& instruction_count){
+	if (instruction_count <= 1) return;
+
+	chip8->IDLE_CYCLE += (u64)(instruction_count - 1);
+	instruction_count = 1;
+}
+
+int Chip8_is_DT_wait_loop(Chip8* chip8, u16 adress, u8 x){
+	return Chip8_is_valid_memory(chip8, adress + 2, 4)
+		&& Chip8_fetch(chip8, adress + 2) == (0x3000 | (x << 8))
+		&& Chip8_fetch(chip8, adress + 4) == (0x1000 | adress);
+}
+
+// the state after each iteration only differs by Chip8::CYCLE and Vx
+void Chip8_skip_DT_wait_loop(Chip8* chip8, u8 x, int& instruction_count){
+	u8* V = chip8->registers.by_index;
+	if (!V[x] || instruction_count <= 3) return;
+
+	// iterations until LD Vx, DT reads 0 or the step ends
+	u64 zero_cycle = Chip8_timer_zero_cycle(chip8, chip8->DT, chip8->DT_TICK);
+	u64 iteration_count = min((zero_cycle - chip8->CYCLE - 1u) / 3u + 1u, (u64)(instruction_count - 1) / 3u);
+
+	instruction_count -= (int)iteration_count * 3;
+	chip8->CYCLE += iteration_count * 3u;
+	chip8->IDLE_CYCLE += iteration_count * 3u;
+	V[x] = Chip8_get_DT(chip8);
+}
+
+// completes the current instruction of a superinstruction like the end of the loop and starts the next one
+// the adress of the next instruction was validated by Chip8_decode_fused
+#define Chip8_FUSED_NEXT()																\
+	memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));				\
+	if (!--instruction_count) continue;													\
+	chip8->PC += 2
+
+// counted also adds every dispatched opcode to Chip8::OPCODE_STATS and sampled returns early when its next sample is due
+// the other instantiations have no counting code
+// to_jump returns after the first instruction that does not continue at the next adress
+template<typename Variant, int counted = false, int sampled = false, int to_jump = false>
+static void Chip8_execute_decoded(Chip8* chip8, int instruction_count){
+	u64 end_cycle = chip8->CYCLE + instruction_count;
+
+#if defined(CHIP8_OPCODE_STATS)
+	u64* opcode_count = counted ? chip8->OPCODE_STATS->count : NULL;
+	u32 sample_countdown = sampled ? chip8->OPCODE_STATS->sample_countdown : 0u;
+#endif
+
+	while (instruction_count)
+	{
+#if defined(CHIP8_OPCODE_STATS)
+		if constexpr (sampled){
+			if (!sample_countdown) break;
+		}
+#endif
+
+		// PC is validated when decoding and faults in Chip8_trap
+		// instructions at odd adresses are not cached
+		Chip8_Op op;
+		if (chip8->PC & 1){
+			op = Chip8_decode_checked(chip8, chip8->PC, false);
+		}
+		else{
+			ram_assert(chip8->PC / 2 < carray_size(Chip8::DECODE_CACHE));
+			Chip8_Op& cached = chip8->DECODE_CACHE[chip8->PC / 2];
+			if (cached.type == Chip8_Op::UNDECODED)
+				cached = Chip8_decode_checked(chip8, chip8->PC, chip8->DECODE_FUSION);
+			op = cached;
+		}
+		chip8->PC += 2;
+		u16 next_PC = chip8->PC;
+
+#if defined(CHIP8_OPCODE_STATS)
+		if constexpr (counted) ++opcode_count[op.type];
+		if constexpr (sampled) --sample_countdown;
+#endif
+
+		u8* V = chip8->registers.by_index;
+
+		switch (op.type){
+			case Chip8_Op::TRAP:
+			{
+				Chip8_trap<Variant>(chip8);
+				break;
+			}
+			case Chip8_Op::CLS:
+			{
+				Chip8_clear_screen<Variant::machine>(chip8);
+				break;
+			}
+			case Chip8_Op::RET:
+			{
+				if (chip8->SP == 0){
+					chip8->ERROR = Chip8::SP_INCORRECT;
+					break;
+				}
+
+				--chip8->SP;
+				chip8->PC = chip8->STACK[chip8->SP];
+				break;
+			}
+			case Chip8_Op::JP_ADDR:
+			{
+				if (op.nnn == chip8->PC - 2) Chip8_skip_idle_wait(chip8, instruction_count);
+
+				chip8->PC = op.nnn;
+				break;
+			}
+			case Chip8_Op::CALL_ADDR:
+			{
+				if (chip8->SP == carray_size(Chip8::STACK)){
+					chip8->ERROR = Chip8::SP_INCORRECT;
+					break;
+				}
+
+				chip8->STACK[chip8->SP++] = chip8->PC;
+				chip8->PC = op.nnn;
+				break;
+			}
+			case Chip8_Op::SE_VX_BYTE:	if (V[op.x] == op.kk) chip8->PC += op.skip; break;
+			case Chip8_Op::SNE_VX_BYTE:	if (V[op.x] != op.kk) chip8->PC += op.skip; break;
+			case Chip8_Op::SE_VX_VY:	if (V[op.x] == V[op.y]) chip8->PC += op.skip; break;
+			case Chip8_Op::LD_VX_BYTE:	V[op.x] = op.kk; break;
+			case Chip8_Op::ADD_VX_BYTE:	V[op.x] += op.kk; break;
+			case Chip8_Op::LD_VX_VY:	V[op.x] = V[op.y]; break;
+			case Chip8_Op::OR_VX_VY:	V[op.x] |= V[op.y]; Chip8_logic_VF<Variant>(chip8); break;
+			case Chip8_Op::AND_VX_VY:	V[op.x] &= V[op.y]; Chip8_logic_VF<Variant>(chip8); break;
+			case Chip8_Op::XOR_VX_VY:	V[op.x] ^= V[op.y]; Chip8_logic_VF<Variant>(chip8); break;
+			case Chip8_Op::ADD_VX_VY:
+			{
+				short add = V[op.x] + V[op.y];
+				chip8->registers.VF = add > 255 ? 1 : 0;
+				V[op.x] = (u8)add;
+				break;
+			}
+			case Chip8_Op::SUB_VX_VY:
+			{
+				chip8->registers.VF = V[op.x] > V[op.y] ? 1 : 0;
+				V[op.x] -= V[op.y];
+				break;
+			}
+			case Chip8_Op::SHR_VX:
+			{
+				if constexpr (Variant::quirks.shift_vy){
+					u8 value = V[op.y];
+					chip8->registers.VF = value & 0x01;
+					V[op.x] = value >> 1;
+				}
+				else{
+					chip8->registers.VF = V[op.x] & 0x01;
+					V[op.x] >>= 1;
+				}
+				break;
+			}
+			case Chip8_Op::SUBN_VX_VY:
+			{
+				chip8->registers.VF = V[op.y] > V[op.x] ? 1 : 0;
+				V[op.x] = V[op.y] - V[op.x];
+				break;
+			}
+			case Chip8_Op::SHL_VX:
+			{
+				if constexpr (Variant::quirks.shift_vy){
+					u8 value = V[op.y];
+					chip8->registers.VF = (value & 0x80) >> 7;
+					V[op.x] = value << 1;
+				}
+				else{
+					chip8->registers.VF = (V[op.x] & 0x80) >> 7;
+					V[op.x] <<= 1;
+				}
+				break;
+			}
+			case Chip8_Op::SNE_VX_VY:	if (V[op.x] != V[op.y]) chip8->PC += op.skip; break;
+			case Chip8_Op::LD_I_ADDR:	chip8->I = op.nnn; break;
+			case Chip8_Op::JP_V0_ADDR:
+			{
+				// BXNN with jump_vx
+				u16 new_PC = op.nnn + V[Variant::quirks.jump_vx ? op.x : 0];
+				if (!Chip8_is_valid_memory(chip8, new_PC, 2)){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				chip8->PC = new_PC;
+				break;
+			}
+			case Chip8_Op::RND_VX_BYTE:
+			{
+				u8 random_byte = random_char(chip8->RANDOM);
+				V[op.x] = random_byte & op.kk;
+				break;
+			}
+			case Chip8_Op::DRW_VX_VY_N:
+			{
+				u8 x = V[op.x];
+				u8 y = V[op.y];
+				if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y) | (op.n >= Chip8_screen_height<Variant::machine>(chip8)) | !Chip8_is_valid_memory(chip8, chip8->I, Chip8_sprite_size(chip8, op.n))){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				Chip8_draw_sprite<Variant::machine>(chip8, x, y, op.n);
+				break;
+			}
+			case Chip8_Op::SKP_VX:
+			{
+				u8 keyindex = V[op.x];
+				if (keyindex >= sizeof(Chip8::KEYBOARD)){
+					chip8->ERROR = Chip8::KEY_UNKNOWN;
+					break;
+				}
+
+				if (chip8->KEYBOARD[keyindex])
+					chip8->PC += op.skip;
+				break;
+			}
+			case Chip8_Op::SKNP_VX:
+			{
+				u8 keyindex = V[op.x];
+				if (keyindex >= sizeof(Chip8::KEYBOARD)){
+					chip8->ERROR = Chip8::KEY_UNKNOWN;
+					break;
+				}
+
+				if (!chip8->KEYBOARD[keyindex])
+					chip8->PC += op.skip;
+				break;
+			}
+			case Chip8_Op::LD_VX_DT:
+			{
+				Chip8_SYNC_CYCLE();
+				V[op.x] = Chip8_get_DT(chip8);
+
+				if (V[op.x] && Chip8_is_DT_wait_loop(chip8, chip8->PC - 2, op.x))
+					Chip8_skip_DT_wait_loop(chip8, op.x, instruction_count);
+				break;
+			}
+			case Chip8_Op::LD_VX_K:
+			{
+				int keypress = -1;
+				for (int ikey = 0; ikey != carray_size(Chip8::KEYBOARD); ++ikey){
+					if (!chip8->KEYBOARD[ikey] && chip8->LAST_KEYBOARD[ikey]){
+						keypress = ikey;
+						break;
+					}
+				}
+
+				if (keypress != -1){
+					V[op.x] = keypress;
+				}
+				else{
+					chip8->PC -= 2; // rewing the instruction to wait
+					Chip8_skip_idle_wait(chip8, instruction_count);
+				}
+				break;
+			}
+			case Chip8_Op::LD_DT_VX:
+			{
+				Chip8_SYNC_CYCLE();
+				Chip8_set_DT(chip8, V[op.x]);
+				break;
+			}
+			case Chip8_Op::LD_ST_VX:
+			{
+				Chip8_SYNC_CYCLE();
+				Chip8_set_ST(chip8, V[op.x]);
+				break;
+			}
+			case Chip8_Op::ADD_I_VX:	chip8->I += V[op.x]; break;
+			case Chip8_Op::LD_F_VX:		chip8->I = (V[op.x] & 0x0F) * 5; break;
+			case Chip8_Op::LD_B_VX:
+			{
+				if (!Chip8_is_valid_memory(chip8, chip8->I, 3)){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				u8 byte = V[op.x];
+				u8* memptr = Chip8_get_memory(chip8, chip8->I);
+
+				memptr[0] = byte / 100;
+				memptr[1] = (byte % 100) / 10;
+				memptr[2] = (byte % 10);
+
+				Chip8_invalidate_decode(chip8, chip8->I, 3);
+				break;
+			}
+			case Chip8_Op::LD_MEM_VX:
+			{
+				u16 regcount = op.x + 1;
+				if (!Chip8_is_valid_memory(chip8, chip8->I, regcount)){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				memcpy(Chip8_get_memory(chip8, chip8->I), V, regcount);
+
+				Chip8_invalidate_decode(chip8, chip8->I, regcount);
+				Chip8_load_store_I<Variant>(chip8, regcount);
+				break;
+			}
+			case Chip8_Op::LD_VX_MEM:
+			{
+				u16 regcount = op.x + 1;
+				if (!Chip8_is_valid_memory(chip8, chip8->I, regcount)){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				memcpy(V, Chip8_get_memory(chip8, chip8->I), regcount);
+				Chip8_load_store_I<Variant>(chip8, regcount);
+				break;
+			}
+			case Chip8_Op::SCD_N:		Chip8_scroll_down(chip8, op.n); break;
+			case Chip8_Op::SCR:			Chip8_scroll_right(chip8); break;
+			case Chip8_Op::SCL:			Chip8_scroll_left(chip8); break;
+			case Chip8_Op::EXIT:
+			{
+				chip8->PC -= 2;
+				Chip8_skip_idle_wait(chip8, instruction_count);
+				break;
+			}
+			case Chip8_Op::LOW:			Chip8_set_resolution(chip8, 64, 32); break;
+			case Chip8_Op::HIGH:		Chip8_set_resolution(chip8, 128, 64); break;
+			case Chip8_Op::DRW_VX_VY_0:
+			{
+				u8 x = V[op.x];
+				u8 y = V[op.y];
+				if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y) | !Chip8_is_valid_memory(chip8, chip8->I, Chip8_sprite_size(chip8, 32))){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				Chip8_draw_sprite_16<Variant::machine>(chip8, x, y);
+				break;
+			}
+			case Chip8_Op::LD_HF_VX:	chip8->I = Chip8_big_sprites_adress + (V[op.x] & 0x0F) * 10; break;
+			case Chip8_Op::LD_R_VX:		memcpy(chip8->RPL, V, op.x + 1); break;
+			case Chip8_Op::LD_VX_R:		memcpy(V, chip8->RPL, op.x + 1); break;
+			case Chip8_Op::SCU_N:		Chip8_scroll_up(chip8, op.n); break;
+			case Chip8_Op::LD_MEM_VX_VY:
+			case Chip8_Op::LD_VX_VY_MEM:
+			{
+				// the registers are in reverse order when x > y
+				u16 regcount = (op.x <= op.y ? op.y - op.x : op.x - op.y) + 1;
+				int regstep = op.x <= op.y ? 1 : -1;
+				if (!Chip8_is_valid_memory(chip8, chip8->I, regcount)){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				u8* memptr = Chip8_get_memory(chip8, chip8->I);
+				if (op.type == Chip8_Op::LD_MEM_VX_VY){
+					for (int ireg = 0; ireg != regcount; ++ireg)
+						memptr[ireg] = V[op.x + ireg * regstep];
+
+					Chip8_invalidate_decode(chip8, chip8->I, regcount);
+				}
+				else{
+					for (int ireg = 0; ireg != regcount; ++ireg)
+						V[op.x + ireg * regstep] = memptr[ireg];
+				}
+				break;
+			}
+			case Chip8_Op::LD_I_LONG:
+			{
+				chip8->I = op.nnn;
+				chip8->PC += 2;
+				break;
+			}
+			case Chip8_Op::PLANE_N:		chip8->PLANES = op.x; break;
+			case Chip8_Op::LD_AUDIO:
+			{
+				if (!Chip8_is_valid_memory(chip8, chip8->I, sizeof(Chip8::AUDIO_PATTERN))){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				memcpy(chip8->AUDIO_PATTERN, Chip8_get_memory(chip8, chip8->I), sizeof(Chip8::AUDIO_PATTERN));
+				break;
+			}
+			case Chip8_Op::LD_PITCH_VX:	chip8->PITCH = V[op.x]; break;
+			case Chip8_Op::SE_VX_BYTE_JP:
+			case Chip8_Op::SNE_VX_BYTE_JP:
+			case Chip8_Op::SE_VX_VY_JP:
+			case Chip8_Op::SNE_VX_VY_JP:
+			{
+				int equal;
+				if (op.type == Chip8_Op::SE_VX_BYTE_JP || op.type == Chip8_Op::SNE_VX_BYTE_JP)
+					equal = V[op.x] == op.kk;
+				else
+					equal = V[op.x] == V[op.y];
+
+				int skip = (op.type == Chip8_Op::SE_VX_BYTE_JP || op.type == Chip8_Op::SE_VX_VY_JP) ? equal : !equal;
+				if (skip){
+					chip8->PC += 2;
+					break;
+				}
+
+				Chip8_FUSED_NEXT();
+				chip8->PC = op.nnn;
+				break;
+			}
+			case Chip8_Op::LD_I_ADDR_DRW:
+			{
+				chip8->I = op.nnn;
+
+				Chip8_FUSED_NEXT();
+
+				u8 x = V[op.x];
+				u8 y = V[op.y];
+				if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y) | (op.n >= Chip8_screen_height<Variant::machine>(chip8)) | !Chip8_is_valid_memory(chip8, chip8->I, Chip8_sprite_size(chip8, op.n))){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				Chip8_draw_sprite<Variant::machine>(chip8, x, y, op.n);
+				break;
+			}
+			case Chip8_Op::LD_VX_DT_SE_VX_0_JP:
+			{
+				Chip8_SYNC_CYCLE();
+				V[op.x] = Chip8_get_DT(chip8);
+
+				if (op.nnn == chip8->PC - 2)
+					Chip8_skip_DT_wait_loop(chip8, op.x, instruction_count);
+
+				Chip8_FUSED_NEXT();
+
+				if (V[op.x] == 0){
+					chip8->PC += 2;
+					break;
+				}
+
+				Chip8_FUSED_NEXT();
+				chip8->PC = op.nnn;
+				break;
+			}
+			case Chip8_Op::ADD_I_VX_LD_VY_MEM:
+			{
+				chip8->I += V[op.x];
+
+				Chip8_FUSED_NEXT();
+
+				u16 regcount = op.y + 1;
+				if (!Chip8_is_valid_memory(chip8, chip8->I, regcount)){
+					Chip8_trap<Variant>(chip8);
+					break;
+				}
+
+				memcpy(V, Chip8_get_memory(chip8, chip8->I), regcount);
+				Chip8_load_store_I<Variant>(chip8, regcount);
+				break;
+			}
+			case Chip8_Op::SKP_VX_JP:
+			case Chip8_Op::SKNP_VX_JP:
+			case Chip8_Op::LD_VX_BYTE_SKP_VX:
+			case Chip8_Op::LD_VX_BYTE_SKNP_VX:
+			{
+				if (op.type == Chip8_Op::LD_VX_BYTE_SKP_VX || op.type == Chip8_Op::LD_VX_BYTE_SKNP_VX){
+					V[op.x] = op.kk;
+					Chip8_FUSED_NEXT();
+				}
+
+				u8 keyindex = V[op.x];
+				if (keyindex >= sizeof(Chip8::KEYBOARD)){
+					chip8->ERROR = Chip8::KEY_UNKNOWN;
+					break;
+				}
+
+				int skip = chip8->KEYBOARD[keyindex];
+				if (op.type == Chip8_Op::SKNP_VX_JP || op.type == Chip8_Op::LD_VX_BYTE_SKNP_VX)
+					skip = !skip;
+
+				if (skip){
+					chip8->PC += op.skip;
+					break;
+				}
+
+				if (op.type == Chip8_Op::SKP_VX_JP || op.type == Chip8_Op::SKNP_VX_JP){
+					Chip8_FUSED_NEXT();
+					chip8->PC = op.nnn;
+				}
+				break;
+			}
+			default:
+			{
+				chip8->ERROR = Chip8::INSTRUCTION_UNKNOWN;
+				break;
+			}
+		}
+		if (chip8->ERROR) break;
+
+		memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));
+
+		--instruction_count;
+
+		if constexpr (to_jump){
+			if (chip8->PC != next_PC) break;
+		}
+	}
+
+#if defined(CHIP8_OPCODE_STATS)
+	if constexpr (sampled) chip8->OPCODE_STATS->sample_countdown = sample_countdown;
+#endif
+
+	Chip8_SYNC_CYCLE();
+}
+
+void Chip8_execute_decoded(Chip8* chip8, int instruction_count){
+	static constexpr Chip8_Execute variants[Chip8::MACHINE_COUNT][Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_TABLE(Chip8_execute_decoded);
+	variants[chip8->MACHINE][chip8->QUIRKS](chip8, instruction_count);
+}
+
+template<typename Variant>
+static void Chip8_execute_decoded_to_jump(Chip8* chip8, int instruction_count){
+	Chip8_execute_decoded<Variant, false, false, true>(chip8, instruction_count);
+}
+
+void Chip8_execute_decoded_to_jump(Chip8* chip8, int instruction_count){
+	static constexpr Chip8_Execute variants[Chip8::MACHINE_COUNT][Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_TABLE(Chip8_execute_decoded_to_jump);
+	variants[chip8->MACHINE][chip8->QUIRKS](chip8, instruction_count);
+}
+
+#if defined(CHIP8_OPCODE_STATS)
+template<typename Variant>
+static void Chip8_execute_counted(Chip8* chip8, int instruction_count){
+	Chip8_execute_decoded<Variant, true>(chip8, instruction_count);
+}
+
+template<typename Variant>
+static void Chip8_execute_counted_to_sample(Chip8* chip8, int instruction_count){
+	Chip8_execute_decoded<Variant, true, true>(chip8, instruction_count);
+}
+
+void Chip8_execute_counted(Chip8* chip8, int instruction_count){
+	static constexpr Chip8_Execute variants[Chip8::MACHINE_COUNT][Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_TABLE(Chip8_execute_counted);
+	static constexpr Chip8_Execute sampled_variants[Chip8::MACHINE_COUNT][Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_TABLE(Chip8_execute_counted_to_sample);
+	if (chip8->OPCODE_STATS->sample_period)
+		sampled_variants[chip8->MACHINE][chip8->QUIRKS](chip8, instruction_count);
+	else
+		variants[chip8->MACHINE][chip8->QUIRKS](chip8, instruction_count);
+}
+#endif
+
+void Chip8_step(Chip8* chip8, float dtime_sec ){
+	dtime_sec *= chip8->emulation_speed;
+	
+	chip8->instruction_accumulator += (float)chip8->instructions_per_second * dtime_sec;
+	int instruction_count = (int)floorf(chip8->instruction_accumulator);
+	chip8->instruction_accumulator -= (float)instruction_count;
+
+	Chip8_run(chip8, instruction_count);
+}
+
+void Chip8_run(Chip8* chip8, int instruction_count){
+	if ((chip8->BACKEND == Chip8::FUSED) != chip8->DECODE_FUSION){
+		chip8->DECODE_FUSION = chip8->BACKEND == Chip8::FUSED;
+		Chip8_fill_decode_cache(chip8);
+	}
+
+	if (chip8->PROFILE || chip8->MEMORY_PROFILE)
+		Chip8_execute_profiled(chip8, instruction_count);
+#if defined(CHIP8_OPCODE_STATS)
+	// a run shorter than the countdown does not reach the next sample
+	else if (chip8->OPCODE_STATS && chip8->OPCODE_STATS->sample_period && (u32)instruction_count >= chip8->OPCODE_STATS->sample_countdown)
+		Chip8_execute_sampled(chip8, instruction_count);
+	else if (chip8->OPCODE_STATS)
+		Chip8_execute_counted(chip8, instruction_count);
+#endif
+	else if (chip8->BACKEND == Chip8::DECODED || chip8->BACKEND == Chip8::FUSED)
+		Chip8_execute_decoded(chip8, instruction_count);
+	else if (chip8->BACKEND == Chip8::THREADED)
+		Chip8_execute_threaded(chip8, instruction_count);
+	else if (chip8->BACKEND == Chip8::JIT)
+		Chip8_execute_jit(chip8, instruction_count);
+	else if (chip8->BACKEND == Chip8::AOT)
+		Chip8_execute_aot(chip8, instruction_count);
+	else
+		Chip8_execute_interpreter(chip8, instruction_count);
+}
+
+int Chip8_backend_from_name(const char* name, Chip8::BACKEND_TYPE& backend){
+	for (int ibackend = 0; ibackend != Chip8::BACKEND_COUNT; ++ibackend){
+		if (strcmp(Chip8::BACKEND_NAME[ibackend], name) == 0){
+			backend = (Chip8::BACKEND_TYPE)ibackend;
+			return true;
+		}
+	}
+	return false;
+}
+
+int Chip8_machine_from_name(const char* name, Chip8::MACHINE_TYPE& machine){
+	for (int imachine = 0; imachine != Chip8::MACHINE_COUNT; ++imachine){
+		if (strcmp(Chip8::MACHINE_NAME[imachine], name) == 0){
+			machine = (Chip8::MACHINE_TYPE)imachine;
+			return true;
+		}
+	}
+	return false;
+}
+
+int Chip8_quirks_from_name(const char* name, Chip8_Quirks::TYPE& quirks){
+	for (int iquirks = 0; iquirks != Chip8_Quirks::TYPE_COUNT; ++iquirks){
+		if (strcmp(Chip8_Quirks::TYPE_NAME[iquirks], name) == 0){
+			quirks = (Chip8_Quirks::TYPE)iquirks;
+			return true;
+		}
+	}
+	return false;
+}
+
+u16 Chip8_keyboard_to_mask(const u8 keyboard[16]){
+	u16 mask = 0u;
+	for (int ikey = 0; ikey != 16; ++ikey)
+		mask |= (u16)(keyboard[ikey] != 0) << ikey;
+	return mask;
+}
+
+void Chip8_keyboard_from_mask(u8 keyboard[16], u16 mask){
+	for (int ikey = 0; ikey != 16; ++ikey)
+		keyboard[ikey] = (mask >> ikey) & 0x01;
+}
+
+u64 Chip8_hash_state(Chip8* chip8){
+	u8 DT = Chip8_get_DT(chip8);
+	u8 ST = Chip8_get_ST(chip8);
+
+	u64 hash = FNV1a(&chip8->memory, chip8->memory_size);
+	hash = FNV1a(&chip8->registers, sizeof(Chip8::registers), hash);
+	hash = FNV1a(&chip8->I, sizeof(Chip8::I), hash);
+	hash = FNV1a(&chip8->PC, sizeof(Chip8::PC), hash);
+	hash = FNV1a(&chip8->SP, sizeof(Chip8::SP), hash);
+	hash = FNV1a(&chip8->STACK, sizeof(Chip8::STACK), hash);
+	// the words of the current resolution ; 64x32 hashes like the previous SCREEN of one u64 per row
+	for (int iy = 0; iy != chip8->screen_height; ++iy)
+		hash = FNV1a(chip8->SCREEN[0][iy], chip8->screen_width / 8, hash);
+	hash = FNV1a(&DT, sizeof(DT), hash);
+	hash = FNV1a(&ST, sizeof(ST), hash);
+	hash = FNV1a(&chip8->CYCLE, sizeof(Chip8::CYCLE), hash);
+	hash = FNV1a(&chip8->ERROR, sizeof(Chip8::ERROR), hash);
+	if (chip8->MACHINE == Chip8::SUPERCHIP)
+		hash = FNV1a(&chip8->RPL, 8u, hash);
+	if (chip8->MACHINE == Chip8::XOCHIP){
+		hash = FNV1a(&chip8->RPL, sizeof(Chip8::RPL), hash);
+		for (int iy = 0; iy != chip8->screen_height; ++iy)
+			hash = FNV1a(chip8->SCREEN[1][iy], chip8->screen_width / 8, hash);
+		hash = FNV1a(&chip8->PLANES, sizeof(Chip8::PLANES), hash);
+		hash = FNV1a(&chip8->AUDIO_PATTERN, sizeof(Chip8::AUDIO_PATTERN), hash);
+		hash = FNV1a(&chip8->PITCH, sizeof(Chip8::PITCH), hash);
+	}
+	return hash;
+}
+
+// ---- 1bpp and 2bpp to RGBA expansion
+//
+// rows are written directly to the canvas rows in their final orientation
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+
+static __m128i Chip8_select_color(__m128i mask, __m128i on, __m128i off){
+	return _mm_or_si128(_mm_and_si128(mask, on), _mm_andnot_si128(mask, off));
+}
+
+// every pixel is compared to its bit in a broadcast of the SCREEN byte and the comparison mask selects the color
+static void Chip8_expand_row(u64 SCREENrow, RGBA* output, const u32 palette[4]){
+	const __m128i bits_high = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+	const __m128i bits_low = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+	const __m128i on = _mm_set1_epi32((int)palette[1]);
+	const __m128i off = _mm_set1_epi32((int)palette[0]);
+
+	for (int ibyte = 0; ibyte != 8; ++ibyte){
+		__m128i byte = _mm_set1_epi32((int)((SCREENrow >> (56u - 8u * ibyte)) & 0xFFu));
+
+		__m128i mask_high = _mm_cmpeq_epi32(_mm_and_si128(byte, bits_high), bits_high);
+		__m128i mask_low = _mm_cmpeq_epi32(_mm_and_si128(byte, bits_low), bits_low);
+
+		_mm_storeu_si128((__m128i*)(output + 8 * ibyte), Chip8_select_color(mask_high, on, off));
+		_mm_storeu_si128((__m128i*)(output + 8 * ibyte + 4), Chip8_select_color(mask_low, on, off));
+	}
+}
+
+// same with the mask of the second plane selecting between the colors of the first plane
+static void Chip8_expand_row_planes(u64 SCREENrow0, u64 SCREENrow1, RGBA* output, const u32 palette[4]){
+	const __m128i bits[2] = {_mm_setr_epi32(0x80, 0x40, 0x20, 0x10), _mm_setr_epi32(0x08, 0x04, 0x02, 0x01)};
+	const __m128i colors[4] = {
+		_mm_set1_epi32((int)palette[0]), _mm_set1_epi32((int)palette[1]),
+		_mm_set1_epi32((int)palette[2]), _mm_set1_epi32((int)palette[3])
+	};
+
+	for (int ibyte = 0; ibyte != 8; ++ibyte){
+		__m128i byte0 = _mm_set1_epi32((int)((SCREENrow0 >> (56u - 8u * ibyte)) & 0xFFu));
+		__m128i byte1 = _mm_set1_epi32((int)((SCREENrow1 >> (56u - 8u * ibyte)) & 0xFFu));
+
+		for (int ihalf = 0; ihalf != 2; ++ihalf){
+			__m128i mask0 = _mm_cmpeq_epi32(_mm_and_si128(byte0, bits[ihalf]), bits[ihalf]);
+			__m128i mask1 = _mm_cmpeq_epi32(_mm_and_si128(byte1, bits[ihalf]), bits[ihalf]);
+
+			__m128i color = Chip8_select_color(mask1,
+				Chip8_select_color(mask0, colors[3], colors[2]),
+				Chip8_select_color(mask0, colors[1], colors[0]));
+			_mm_storeu_si128((__m128i*)(output + 8 * ibyte + 4 * ihalf), color);
+		}
+	}
+}
+
+#else
+
+static void Chip8_expand_row(u64 SCREENrow, RGBA* output, const u32 palette[4]){
+	for (int ix = 0; ix != 64; ++ix){
+		u32 mask = 0u - (u32)((SCREENrow >> (63 - ix)) & 0x01);
+		u32 color = (palette[1] & mask) | (palette[0] & ~mask);
+		memcpy(output + ix, &color, sizeof(RGBA));
+	}
+}
+
+static void Chip8_expand_row_planes(u64 SCREENrow0, u64 SCREENrow1, RGBA* output, const u32 palette[4]){
+	for (int ix = 0; ix != 64; ++ix){
+		u32 index = ((SCREENrow0 >> (63 - ix)) & 0x01) | (((SCREENrow1 >> (63 - ix)) & 0x01) << 1u);
+		memcpy(output + ix, &palette[index], sizeof(RGBA));
+	}
+}
+
+#endif
+
+u64 Chip8_to_screen(Chip8* chip8, Pixel_Canvas& screen, const RGBA palette[4]){
+	ram_assert(screen.width == chip8->screen_width && screen.height == chip8->screen_height);
+
+	u32 colors[4];
+	memcpy(colors, palette, sizeof(colors));
+
+	u64 dirty = chip8->SCREEN_DIRTY;
+	chip8->SCREEN_DIRTY = 0u;
+
+	// only XOCHIP draws in the second plane
+	int planes = chip8->MACHINE == Chip8::XOCHIP;
+
+	// Pixel_Canvas has a bottom-left origin
+	for (int iy = 0; iy != chip8->screen_height; ++iy){
+		if (!(dirty & ((u64)1u << iy))) continue;
+
+		RGBA* output = screen.canvas + (screen.height - 1 - iy) * screen.width;
+		for (int iword = 0; iword != chip8->screen_width / 64; ++iword){
+			if (planes)	Chip8_expand_row_planes(chip8->SCREEN[0][iy][iword], chip8->SCREEN[1][iy][iword], output + 64 * iword, colors);
+			else		Chip8_expand_row(chip8->SCREEN[0][iy][iword], output + 64 * iword, colors);
+		}
+	}
+
+	return dirty & Chip8_screen_rows(chip8);
+}
+
+float Chip8_audio_rate(u8 pitch){
+	return 4000.f * powf(2.f, ((float)pitch - 64.f) / 48.f);
+}
@@ -0,0 +1,869 @@
+#pragma once
+
+#include "engine.h"
+#include "core.h"
+
+#if defined(CHIP8_OPCODE_STATS)
+#if defined(_M_X64)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#endif
+
+// REF: http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#1.0 [Cowgod's Chip-8 Technical Reference v1.0]
+// REF: https://johnearnest.github.io/Octo/docs/XO-ChipSpecification.html [XO-CHIP Specification]
+// REF: https://github.com/Timendus/chip8-test-suite#quirks-test [CHIP-8 test suite - Quirks test]
+
+// pre-decoded instruction ; operands are extracted once when the instruction is decoded
+struct Chip8_Op{
+	enum TYPE : u8{
+		UNDECODED = 0, // invalidated entry, decoded again on the next fetch
+		UNKNOWN,
+		TRAP,			// instruction that always faults ; executed by the interpreter to set Chip8::ERROR
+		CLS,
+		RET,
+		JP_ADDR,
+		CALL_ADDR,
+		SE_VX_BYTE,
+		SNE_VX_BYTE,
+		SE_VX_VY,
+		LD_VX_BYTE,
+		ADD_VX_BYTE,
+		LD_VX_VY,
+		OR_VX_VY,
+		AND_VX_VY,
+		XOR_VX_VY,
+		ADD_VX_VY,
+		SUB_VX_VY,
+		SHR_VX,
+		SUBN_VX_VY,
+		SHL_VX,
+		SNE_VX_VY,
+		LD_I_ADDR,
+		JP_V0_ADDR,
+		RND_VX_BYTE,
+		DRW_VX_VY_N,
+		SKP_VX,
+		SKNP_VX,
+		LD_VX_DT,
+		LD_VX_K,
+		LD_DT_VX,
+		LD_ST_VX,
+		ADD_I_VX,
+		LD_F_VX,
+		LD_B_VX,
+		LD_MEM_VX,
+		LD_VX_MEM,
+
+		// SUPER-CHIP 1.1 ; only decoded for Chip8::SUPERCHIP
+		SCD_N,					// 00Cn scroll down n rows
+		SCR,					// 00FB scroll right 4 pixels
+		SCL,					// 00FC scroll left 4 pixels
+		EXIT,					// 00FD
+		LOW,					// 00FE 64x32
+		HIGH,					// 00FF 128x64
+		DRW_VX_VY_0,			// DXY0 16x16 sprite
+		LD_HF_VX,				// FX30 10-byte digit
+		LD_R_VX,				// FX75 x <= 7
+		LD_VX_R,				// FX85 x <= 7 ; any x with XOCHIP
+
+		// XO-CHIP ; only decoded for Chip8::XOCHIP
+		SCU_N,					// 00Dn scroll up n rows
+		LD_MEM_VX_VY,			// 5XY2 save Vx to Vy at I ; I is not modified
+		LD_VX_VY_MEM,			// 5XY3 load Vx to Vy from I ; I is not modified
+		LD_I_LONG,				// F000 NNNN ; nnn is NNNN, read from the next word by Chip8_decode_checked
+		PLANE_N,				// FN01 n <= 3
+		LD_AUDIO,				// F002 16-byte audio pattern at I
+		LD_PITCH_VX,			// FX3A
+
+		// superinstructions built by Chip8_decode_fused ; they execute up to three instructions with a single dispatch
+		SE_VX_BYTE_JP,			// SE Vx, kk ; JP nnn
+		SNE_VX_BYTE_JP,			// SNE Vx, kk ; JP nnn
+		SE_VX_VY_JP,			// SE Vx, Vy ; JP nnn
+		SNE_VX_VY_JP,			// SNE Vx, Vy ; JP nnn
+		LD_I_ADDR_DRW,			// LD I, nnn ; DRW Vx, Vy, n
+		LD_VX_DT_SE_VX_0_JP,	// LD Vx, DT ; SE Vx, 0 ; JP nnn
+		ADD_I_VX_LD_VY_MEM,		// ADD I, Vx ; LD Vy, [I]
+		SKP_VX_JP,				// SKP Vx ; JP nnn
+		SKNP_VX_JP,				// SKNP Vx ; JP nnn
+		LD_VX_BYTE_SKP_VX,		// LD Vx, kk ; SKP Vx
+		LD_VX_BYTE_SKNP_VX,		// LD Vx, kk ; SKNP Vx
+		TYPE_COUNT
+	};
+	static constexpr const char* TYPE_NAME[65u] = {
+		"UNDECODED",
+		"UNKNOWN",
+		"TRAP",
+		"CLS",
+		"RET",
+		"JP addr",
+		"CALL addr",
+		"SE Vx, byte",
+		"SNE Vx, byte",
+		"SE Vx, Vy",
+		"LD Vx, byte",
+		"ADD Vx, byte",
+		"LD Vx, Vy",
+		"OR Vx, Vy",
+		"AND Vx, Vy",
+		"XOR Vx, Vy",
+		"ADD Vx, Vy",
+		"SUB Vx, Vy",
+		"SHR Vx",
+		"SUBN Vx, Vy",
+		"SHL Vx",
+		"SNE Vx, Vy",
+		"LD I, addr",
+		"JP V0, addr",
+		"RND Vx, byte",
+		"DRW Vx, Vy, n",
+		"SKP Vx",
+		"SKNP Vx",
+		"LD Vx, DT",
+		"LD Vx, K",
+		"LD DT, Vx",
+		"LD ST, Vx",
+		"ADD I, Vx",
+		"LD F, Vx",
+		"LD B, Vx",
+		"LD [I], Vx",
+		"LD Vx, [I]",
+		"SCD nibble",
+		"SCR",
+		"SCL",
+		"EXIT",
+		"LOW",
+		"HIGH",
+		"DRW Vx, Vy, 0",
+		"LD HF, Vx",
+		"LD R, Vx",
+		"LD Vx, R",
+		"SCU nibble",
+		"LD [I], Vx - Vy",
+		"LD Vx - Vy, [I]",
+		"LD I, long",
+		"PLANE n",
+		"AUDIO",
+		"PITCH Vx",
+		"SE Vx, byte ; JP addr",
+		"SNE Vx, byte ; JP addr",
+		"SE Vx, Vy ; JP addr",
+		"SNE Vx, Vy ; JP addr",
+		"LD I, addr ; DRW Vx, Vy, n",
+		"LD Vx, DT ; SE Vx, 0 ; JP addr",
+		"ADD I, Vx ; LD Vy, [I]",
+		"SKP Vx ; JP addr",
+		"SKNP Vx ; JP addr",
+		"LD Vx, byte ; SKP Vx",
+		"LD Vx, byte ; SKNP Vx",
+	};
+	static_assert(carray_size(TYPE_NAME) == TYPE_COUNT, "Mismatch in size between TYPE_NAME and TYPE_COUNT");
+
+	TYPE type;
+	u8 x;
+	u8 y;
+	u8 n;
+	u8 kk;
+	// bytes skipped by SE, SNE, SKP and SKNP ; 4 over F000 NNNN with XOCHIP, 2 otherwise
+	u8 skip;
+	u16 nnn;
+};
+static_assert(sizeof(Chip8_Op) == 8);
+
+// behaviors that differ between the interpreters of the Chip8 family for the same instruction
+// the backends are instantiated for every quirk set so that the quirks are constants ; see Chip8_Variant
+struct Chip8_Quirks{
+	enum TYPE : u8{
+		COWGOD = 0,		// Cowgod's Chip-8 Technical Reference
+		VIP,			// CHIP-8 of the COSMAC VIP
+		CHIP48,			// CHIP-48 of the HP-48
+		SUPERCHIP,		// SUPER-CHIP 1.1
+		XOCHIP,			// XO-CHIP of Octo
+		TYPE_COUNT
+	};
+	static constexpr const char* TYPE_NAME[5u] = { "cowgod", "vip", "chip48", "superchip", "xochip" };
+	static_assert(carray_size(TYPE_NAME) == TYPE_COUNT, "Mismatch in size between TYPE_NAME and TYPE_COUNT");
+
+	// I after LD [I], Vx and LD Vx, [I]
+	enum LOAD_STORE_TYPE : u8{
+		I_UNCHANGED = 0,
+		I_PLUS_X,
+		I_PLUS_X_PLUS_1,
+	};
+
+	// SHR Vx, Vy and SHL Vx, Vy shift Vy into Vx instead of shifting Vx
+	u8 shift_vy;
+	LOAD_STORE_TYPE load_store;
+	// BXNN jumps to XNN + Vx instead of NNN + V0
+	u8 jump_vx;
+	// OR, AND and XOR Vx, Vy set VF to 0
+	u8 vf_reset;
+};
+
+static constexpr Chip8_Quirks Chip8_quirk_sets[Chip8_Quirks::TYPE_COUNT] = {
+	// shift_vy, load_store, jump_vx, vf_reset
+	{ false,	Chip8_Quirks::I_UNCHANGED,		false,	false },	// COWGOD
+	{ true,		Chip8_Quirks::I_PLUS_X_PLUS_1,	false,	true },		// VIP
+	{ false,	Chip8_Quirks::I_PLUS_X,			true,	false },	// CHIP48
+	{ false,	Chip8_Quirks::I_UNCHANGED,		true,	false },	// SUPERCHIP
+	{ true,		Chip8_Quirks::I_PLUS_X_PLUS_1,	false,	false },	// XOCHIP
+};
+
+struct Chip8_Jit;
+struct Chip8_AOT_Program;
+struct Chip8_Profile;
+struct Chip8_Memory_Profile;
+struct Chip8_Opcode_Stats;
+
+struct Chip8{
+	enum MACHINE_TYPE{
+		CHIP8 = 0,
+		SUPERCHIP,			// SUPER-CHIP 1.1 ; 128x64 with HIGH, scrolling, 16x16 sprites, 10-byte digits and RPL flags
+		XOCHIP,				// XO-CHIP ; SUPERCHIP with 64 KB of memory, two bitplanes and an audio pattern
+		MACHINE_COUNT
+	};
+	static constexpr const char* MACHINE_NAME[3u] = { "chip8", "superchip", "xochip" };
+	static_assert(carray_size(MACHINE_NAME) == MACHINE_COUNT, "Mismatch in size between MACHINE_NAME and MACHINE_COUNT");
+	MACHINE_TYPE MACHINE;
+
+	// Chip8_default_quirks of MACHINE unless changed before running the ROM
+	Chip8_Quirks::TYPE QUIRKS;
+
+	// resolution of SCREEN ; 64x32 or 128x64 between HIGH and LOW with SUPERCHIP and XOCHIP
+	int screen_width;
+	int screen_height;
+
+	// adresses of memory available to the machine ; Chip8_memory_size
+	u32 memory_size;
+	// first adress of the interpreter range that is out of bounds ; Chip8_reserved_start
+	u32 reserved_start;
+
+	float emulation_speed;
+
+	// the timers are decremented timer_per_second times every instructions_per_second instructions
+	// expected to stay constant once the ROM is running
+	u32 instructions_per_second;
+	u32 timer_per_second;
+
+	// fraction of an instruction carried over to the next Chip8_step
+	float instruction_accumulator;
+
+	// ROM given to Chip8_create ; must stay valid while the Chip8 is used
+	// save states store the memory as a delta against the memory created from the ROM and are only loaded with the same ROM_HASH
+	const u8* ROM;
+	u32 ROM_SIZE;
+	u64 ROM_HASH;
+
+	// instructions retired since Chip8_create
+	// the backends only bring it up to date before the instructions that access the timers and when returning
+	u64 CYCLE;
+	// instructions of CYCLE retired by the idle loops without being dispatched ; not stored in save states
+	u64 IDLE_CYCLE;
+
+	// every u16 adress is in memory ; the machine only uses the first memory_size bytes and the rest stays zero
+	struct Memory{
+		// interpreter memory covers adresses 0x000 - 0x1FF
+		struct Interpreter{
+			u8 sprites[80];
+			// SUPERCHIP and XOCHIP only ; zero with CHIP8
+			u8 big_sprites[160];
+			u8 unused[512 - sizeof(sprites) - sizeof(big_sprites)];
+		} interpreter_range;
+
+		// user memory covers adresses 0x200 - 0xFFF, or 0x200 - 0xFFFF with XOCHIP
+		u8 user_range[Kilobytes(64) - sizeof(Interpreter)];
+	} memory;
+
+	// accesses of up to 16 bytes from any u16 adress stay in memory and memory_guard
+	u8 memory_guard[16];
+
+	union Registers
+	{
+		struct
+		{
+			u8 V0;
+			u8 V1;
+			u8 V2;
+			u8 V3;
+			u8 V4;
+			u8 V5;
+			u8 V6;
+			u8 V7;
+			u8 V8;
+			u8 V9;
+			u8 VA;
+			u8 VB;
+			u8 VC;
+			u8 VD;
+			u8 VE;
+			u8 VF; // flag register
+		};
+		u8 by_index[16];
+	} registers;
+
+	u16 I;
+
+	// values written by LD DT, Vx and LD ST, Vx ; read the timers with Chip8_get_DT and Chip8_get_ST
+	u8 DT; // delay timer register
+	u8 ST; // sound timer register
+
+	// timer ticks when DT and ST were written ; see Chip8_timer_ticks
+	u64 DT_TICK;
+	u64 ST_TICK;
+
+	u16 PC; // program counter
+	u16 SP; // stack pointer
+
+	u16 STACK[16];
+
+	// one bitplane per SCREEN[plane] ; screen_width x screen_height ; (0, 0) top-left
+	// row y of a plane is [y][0] for x < 64 and [y][1] for x >= 64 with pixel x at bit 63 - x % 64
+	// the rows and words outside of the resolution are zero and only XOCHIP draws in the second plane
+	u64 SCREEN[2][64][2];
+
+	// bitmask of the planes modified by CLS, DRW and the scrolls ; selected by PLANE n with XOCHIP, 1 otherwise
+	u8 PLANES;
+
+	// one bit per SCREEN row modified since the last Chip8_to_screen
+	// SCREEN_GENERATION is incremented by every instruction that modifies SCREEN or the resolution
+	u64 SCREEN_DIRTY;
+	u64 SCREEN_GENERATION;
+
+	// 0 1 2 3 4 5 6 7 8 9 A B C D E F
+	// with original layout
+	// 1 2 3 C
+	// 4 5 6 D
+	// 7 8 9 E
+	// A 0 B F
+	u8 KEYBOARD[16];
+	u8 LAST_KEYBOARD[16];
+
+	// flags saved by LD R, Vx and restored by LD Vx, R ; 8 with SUPERCHIP and 16 with XOCHIP
+	u8 RPL[16];
+
+	// XOCHIP audio ; the 128 bits of AUDIO_PATTERN are played in a loop while ST is not 0
+	// at Chip8_audio_rate(PITCH) bits per second ; a square wave until AUDIO loads a pattern
+	u8 AUDIO_PATTERN[16];
+	u8 PITCH;
+
+	// generator of RND ; seeded by Chip8_create with the seed of create_default_random so that every instance draws the same bytes
+	Random_Data RANDOM;
+
+	enum ERROR_TYPE{
+		NONE = 0,
+		MEMORY_OUT_OF_BOUNDS,
+		REGISTER_OUT_OF_BOUNDS,
+		PC_INCORRECT,
+		SP_INCORRECT,
+		INSTRUCTION_UNKNOWN,
+		KEY_UNKNOWN,
+		SCREEN_COORD_INCORRECT,
+	};
+	ERROR_TYPE ERROR;
+
+	enum BACKEND_TYPE{
+		INTERPRETER = 0,	// decodes every instruction with the mask-compare chain
+		DECODED,			// executes the micro-ops of DECODE_CACHE
+		FUSED,				// executes the micro-ops of DECODE_CACHE with superinstructions
+		THREADED,			// dispatches on the first nibble through handler tables
+		JIT,				// translates basic blocks to x86-64 ; falls back to DECODED on other platforms
+		AOT,				// executes the basic blocks of AOT_PROGRAM ; falls back to DECODED for the rest
+		BACKEND_COUNT
+	};
+	static constexpr const char* BACKEND_NAME[6u] = { "interpreter", "decoded", "fused", "threaded", "jit", "aot" };
+	static_assert(carray_size(BACKEND_NAME) == BACKEND_COUNT, "Mismatch in size between BACKEND_NAME and BACKEND_COUNT");
+	BACKEND_TYPE BACKEND;
+
+	// one micro-op per even adress of Chip8::Memory ; filled by Chip8_create
+	// entries are reset to Chip8_Op::UNDECODED when LD B, Vx or LD [I], Vx write over them
+	// the last entry is a Chip8_Op::TRAP for PC == 0x1000 after a skip at 0xFFC
+	Chip8_Op DECODE_CACHE[sizeof(Memory) / 2 + 1];
+
+	// DECODE_CACHE contains superinstructions from Chip8_decode_fused ; set by Chip8_step for the FUSED backend
+	int DECODE_FUSION;
+
+	// created on the first step with the JIT backend
+	Chip8_Jit* JIT_CACHE;
+
+	// ROM recompiled by tools/chip8_aot.cpp ; NULL when the ROM was not recompiled
+	const Chip8_AOT_Program* AOT_PROGRAM;
+
+	// one bit per 64-byte line of memory written by LD B, Vx or LD [I], Vx
+	// recompiled blocks covering these lines are checked against the ROM before being executed
+	u64 AOT_WRITTEN_LINES;
+
+	// records the dynamic opcode sequences when set ; see Chip8_create_profile
+	Chip8_Profile* PROFILE;
+
+	// records the accesses per memory adress when set ; see Chip8_create_memory_profile
+	Chip8_Memory_Profile* MEMORY_PROFILE;
+
+#if defined(CHIP8_OPCODE_STATS)
+	// counts the executed opcodes when set ; see Chip8_create_opcode_stats
+	Chip8_Opcode_Stats* OPCODE_STATS;
+#endif
+};
+
+// ROM recompiled ahead of time by tools/chip8_aot.cpp
+struct Chip8_AOT_Program{
+	const char* name;
+
+	const u8* ROM;
+	size_t ROM_size;
+	// quirk set the blocks were recompiled for ; other quirk sets are executed by Chip8_execute_decoded
+	Chip8_Quirks::TYPE quirks;
+
+	// executes the basic block starting at Chip8::PC and returns the number of instructions executed before an ERROR or the end of the block
+	// returns -1 when there is no block at Chip8::PC, when the block is longer than instruction_count or when its code was overwritten
+	// Chip8::CYCLE is the cycle of the first instruction of the block
+	int (*execute_block)(Chip8* chip8, int instruction_count);
+};
+
+// compile-time machine and quirk set of the backends
+// Chip8_VARIANT_TABLE instantiates a backend for every pair and the backend runs the instantiation of Chip8::MACHINE and Chip8::QUIRKS
+template<Chip8::MACHINE_TYPE machine_type, Chip8_Quirks::TYPE quirks_type>
+struct Chip8_Variant{
+	static constexpr Chip8::MACHINE_TYPE machine = machine_type;
+	static constexpr Chip8_Quirks quirks = Chip8_quirk_sets[quirks_type];
+};
+
+#define Chip8_VARIANT_ROW(function, machine) {									\
+	function<Chip8_Variant<machine, Chip8_Quirks::COWGOD>>,						\
+	function<Chip8_Variant<machine, Chip8_Quirks::VIP>>,						\
+	function<Chip8_Variant<machine, Chip8_Quirks::CHIP48>>,						\
+	function<Chip8_Variant<machine, Chip8_Quirks::SUPERCHIP>>,					\
+	function<Chip8_Variant<machine, Chip8_Quirks::XOCHIP>>,						\
+}
+
+// table of the instantiations of function indexed by [Chip8::MACHINE][Chip8::QUIRKS]
+#define Chip8_VARIANT_TABLE(function) {											\
+	Chip8_VARIANT_ROW(function, Chip8::CHIP8),									\
+	Chip8_VARIANT_ROW(function, Chip8::SUPERCHIP),								\
+	Chip8_VARIANT_ROW(function, Chip8::XOCHIP),									\
+}
+
+typedef void (*Chip8_Execute)(Chip8* chip8, int instruction_count);
+
+void Chip8_create(Chip8* chip8, void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine);
+// fonts at 0x000 and ROM at 0x200 ; the memory of Chip8_create
+// only the Chip8_memory_size(machine) first bytes are written
+void Chip8_create_memory(Chip8::Memory& memory, const void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine);
+// XOCHIP when the ROM does not fit in 4 KB
+// SUPERCHIP when the first instruction, after a JP at 0x200, is LOW or HIGH like in the SUPER-CHIP ROMs of data/superchip8
+Chip8::MACHINE_TYPE Chip8_detect_machine(const void* ROM, size_t ROM_size);
+// 4 KB, or 64 KB with XOCHIP ; the largest ROM is 0x200 bytes smaller
+u32 Chip8_memory_size(Chip8::MACHINE_TYPE machine);
+// 0x51 after the font with CHIP8, 0xF1 after the big font with SUPERCHIP and XOCHIP
+u32 Chip8_reserved_start(Chip8::MACHINE_TYPE machine);
+// COWGOD with CHIP8, the quirk set of the machine otherwise
+Chip8_Quirks::TYPE Chip8_default_quirks(Chip8::MACHINE_TYPE machine);
+void Chip8_destroy(Chip8* chip8);
+
+void Chip8_step(Chip8* chip8, float dtime_sec);
+
+// executes instruction_count instructions with Chip8::BACKEND ; Chip8_step converts dtime_sec to instructions
+void Chip8_run(Chip8* chip8, int instruction_count);
+int Chip8_backend_from_name(const char* name, Chip8::BACKEND_TYPE& backend);
+int Chip8_machine_from_name(const char* name, Chip8::MACHINE_TYPE& machine);
+int Chip8_quirks_from_name(const char* name, Chip8_Quirks::TYPE& quirks);
+// bit k of the mask is KEYBOARD[k]
+u16 Chip8_keyboard_to_mask(const u8 keyboard[16]);
+void Chip8_keyboard_from_mask(u8 keyboard[16], u16 mask);
+// hash of the state visible to the program: memory, registers, stack, SCREEN, timers, CYCLE, ERROR,
+// RPL with SUPERCHIP and XOCHIP, the second plane, PLANES, AUDIO_PATTERN and PITCH with XOCHIP
+// identical for every backend after the same instructions
+u64 Chip8_hash_state(Chip8* chip8);
+// writes the rows of screen in Chip8::SCREEN_DIRTY and resets it ; screen has the current resolution of the Chip8 screen
+// palette is indexed by the bits of the pixel in the second plane and the first plane: off, first plane, second plane, both
+// returns the SCREEN rows that were written
+u64 Chip8_to_screen(Chip8* chip8, Pixel_Canvas& screen, const RGBA palette[4]);
+
+// bits per second of AUDIO_PATTERN ; 4000 at the initial PITCH of 64 and doubled every 48
+float Chip8_audio_rate(u8 pitch);
+
+// the SUPER-CHIP instructions are UNKNOWN and DXY0 is a DRW_VX_VY_N drawing nothing with CHIP8
+// the XO-CHIP instructions are UNKNOWN except with XOCHIP
+Chip8_Op Chip8_decode(u16 instruction, Chip8::MACHINE_TYPE machine);
+
+// decodes the instruction at adress and fuses it with the next ones when they form a superinstruction
+// the next instructions keep their own entry in DECODE_CACHE and can still be jump targets
+Chip8_Op Chip8_decode_fused(Chip8* chip8, u16 adress);
+
+// decodes the instruction at adress for DECODE_CACHE ; PC and the targets of JP and CALL are validated here instead of on execution
+// returns a Chip8_Op::TRAP when the instruction always faults
+Chip8_Op Chip8_decode_checked(Chip8* chip8, u16 adress, int fusion);
+
+// ---- save states
+//
+// little-endian binary format, identical on every platform:
+// header ; registers, I, PC, SP, STACK, DT, ST, resolution, PLANES, SCREEN, KEYBOARD, RANDOM, RPL, AUDIO_PATTERN and PITCH ; memory delta ; FNV1a checksum
+// only the SCREEN words of the current resolution are stored, and the second plane only with XOCHIP
+// the memory delta lists the ranges of memory that differ from the memory created by Chip8_create
+
+constexpr u16 Chip8_state_version = 3u;
+constexpr size_t Chip8_state_max_size = 512u + sizeof(Chip8::SCREEN) + sizeof(Chip8::Memory) + 8u;
+
+// returns the size of the state written to data or 0 when capacity is too small
+size_t Chip8_save_state(Chip8* chip8, void* data, size_t capacity);
+
+// returns false and leaves the Chip8 unchanged when data is not a valid state of the same ROM, machine and version
+// the configuration (backend, instructions_per_second, timer_per_second, emulation_speed) is kept
+int Chip8_load_state(Chip8* chip8, const void* data, size_t size);
+
+// ---- rewind
+//
+// ring buffer of the states captured every frame ; the oldest keyframe and its frames are dropped when it is full
+// a keyframe stores a whole state every keyframe_period frames ; the frames in between store the run-length encoded XOR with the previous state
+// the XOR is its own inverse so stepping back applies the delta of the newest frame to the newest state
+
+struct Chip8_Rewind_Entry{
+	u32 offset;
+	u32 size;
+	u32 state_size;
+	// frames since the keyframe of the entry ; 0 for a keyframe
+	u32 keyframe_distance;
+};
+
+struct Chip8_Rewind{
+	u32 keyframe_period;
+
+	u8* data;
+	size_t data_capacity;
+	// end of the newest entry ; entries that do not fit before data_capacity start from 0
+	size_t data_head;
+
+	Chip8_Rewind_Entry* entries;
+	u32 entry_capacity;
+	u32 first_entry;
+	u32 entry_count;
+
+	// newest state and the state being captured ; zero padded up to Chip8_state_max_size so that states of different sizes XOR
+	u8 states[2][Chip8_state_max_size];
+	u32 state_sizes[2];
+	int newest_state;
+
+	u8 delta[Chip8_state_max_size];
+};
+
+// data_capacity bytes of states for up to frame_capacity frames
+Chip8_Rewind* Chip8_create_rewind(size_t data_capacity, u32 frame_capacity, u32 keyframe_period);
+void Chip8_destroy_rewind(Chip8_Rewind* rewind);
+
+// appends the state of chip8 as the newest frame
+void Chip8_rewind_capture(Chip8_Rewind* rewind, Chip8* chip8);
+
+// drops the newest frame and loads the frame before it into chip8 ; returns false when there is no frame before it
+int Chip8_rewind_step_back(Chip8_Rewind* rewind, Chip8* chip8);
+
+// ---- movies
+//
+// little-endian binary format:
+// header with the ROM hash, the machine, the quirks, RANDOM and the timing of the Chip8 ; records ; end record
+// every record is a tag, the LEB128 frame count since the previous record and a payload:
+// * keys: u16 KEYBOARD mask held from this frame onwards
+// * checkpoint: u64 Chip8_hash_state after this frame
+// * end: u64 Chip8_hash_state after the last frame
+
+constexpr u16 Chip8_movie_version = 3u;
+
+struct Chip8_Movie_Recorder{
+	FILE* file;
+	u32 checkpoint_period;
+	u64 frame;
+	// frame of the last record
+	u64 record_frame;
+	u16 keys;
+};
+
+// writes the header ; the movie starts from the current state of chip8 which must be the one of Chip8_create
+// frames_per_second is the rate of the Chip8_step of the movie ; a checkpoint is written every checkpoint_period frames
+int Chip8_movie_record_begin(Chip8_Movie_Recorder& recorder, Chip8* chip8, const char* path, u32 frames_per_second, u32 checkpoint_period);
+// records the frame that was just stepped with Chip8_step
+void Chip8_movie_record_frame(Chip8_Movie_Recorder& recorder, Chip8* chip8);
+// writes the end record and closes the file ; returns false when the movie could not be written entirely
+int Chip8_movie_record_end(Chip8_Movie_Recorder& recorder, Chip8* chip8);
+
+struct Chip8_Movie_Replay{
+	u64 frame_count;
+	u32 checkpoint_count;
+	u32 mismatch_count;
+	// UINT64_MAX without mismatch
+	u64 first_mismatch_frame;
+};
+
+// steps chip8, created from the ROM of the movie, through every frame of the movie as fast as possible and compares the checkpoints
+// returns false when the movie is invalid or was recorded with another ROM or machine
+int Chip8_movie_replay(Chip8* chip8, const void* movie, size_t size, Chip8_Movie_Replay& replay);
+
+// ---- quirk detection
+//
+// the ROM runs headless with every quirk set, each on its own thread, and the best trial gives the quirk set:
+// the one without ERROR or with the latest ERROR, then the one executing clearly more distinct adresses, then the one
+// changing SCREEN on clearly more frames ; Chip8_default_quirks is kept unless another trial is clearly better
+// the cache is a text file of "ROM_HASH quirks" lines
+
+// a minute at 60 frames per second ; the quirks of most ROMs only show after a few thousand instructions
+constexpr u32 Chip8_quirk_trial_frames = 3600u;
+
+struct Chip8_Quirk_Trial{
+	Chip8_Quirks::TYPE quirks;
+	Chip8::ERROR_TYPE ERROR;
+	// frames completed before the ERROR
+	u32 frame_count;
+	// distinct adresses of the executed instructions
+	u32 PC_count;
+	// frames that changed SCREEN
+	u32 screen_frame_count;
+};
+
+// runs frame_count frames of the ROM with quirks on the calling thread ; the keys are pressed in turn
+void Chip8_quirk_trial(Chip8_Quirk_Trial& trial, const void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine, Chip8_Quirks::TYPE quirks, u32 frame_count);
+// returns whether trial is clearly better than other ; small leads in adresses or screen frames are not enough
+int Chip8_quirk_trial_is_better(const Chip8_Quirk_Trial& trial, const Chip8_Quirk_Trial& other);
+// runs the trial of every quirk set in parallel, writes them to trials and returns the quirk set of the best one
+Chip8_Quirks::TYPE Chip8_detect_quirks(const void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine, Chip8_Quirk_Trial (&trials)[Chip8_Quirks::TYPE_COUNT]);
+
+// returns false when the file does not exist or has no line for ROM_hash ; the last line of ROM_hash is used
+int Chip8_quirk_cache_find(const char* path, u64 ROM_hash, Chip8_Quirks::TYPE& quirks);
+// appends a line to the file ; returns false when it could not be written
+int Chip8_quirk_cache_add(const char* path, u64 ROM_hash, Chip8_Quirks::TYPE quirks);
+
+// ---- batches
+//
+// lanes running copies of the same CHIP8 ROM in lockstep, each lane ending bit-identical to a Chip8 running the same frames with Chip8_step
+// the registers are stored by register then by lane in chunks of Chip8_batch_chunk_lanes lanes: an instruction at the same PC
+// in many lanes of a chunk executes as a few vector operations over the lanes ; see chip8_batch.cpp
+// only the CHIP8 machine is supported ; the SUPER-CHIP and XO-CHIP screens and memory do not fit the lanes
+
+constexpr int Chip8_batch_chunk_lanes = 64;
+// memory_size and reserved_start of Chip8::CHIP8
+constexpr u32 Chip8_batch_memory_size = 4096u;
+constexpr u32 Chip8_batch_reserved_start = offsetof(Chip8::Memory::Interpreter, big_sprites) + 1u;
+
+struct Chip8_Batch_Chunk;
+
+struct Chip8_Batch{
+	Chip8_Quirks::TYPE QUIRKS;
+
+	// configuration of the Chip8 given to Chip8_create_batch ; identical for every lane
+	float emulation_speed;
+	u32 instructions_per_second;
+	u32 timer_per_second;
+	float instruction_accumulator;
+
+	u64 ROM_HASH;
+
+	u32 lane_count;
+	u32 chunk_count;
+	Chip8_Batch_Chunk* chunks;
+
+	// memory of the Chip8 given to Chip8_create_batch ; the lanes fetch from it except at the adresses written since
+	u8 image[Chip8_batch_memory_size];
+	// micro-op of every adress of image ; Chip8_Op::UNDECODED until its first fetch
+	Chip8_Op DECODE[Chip8_batch_memory_size];
+};
+
+// every lane starts as a copy of chip8 ; returns NULL when chip8 is not a Chip8::CHIP8
+Chip8_Batch* Chip8_create_batch(const Chip8* chip8, u32 lane_count);
+void Chip8_destroy_batch(Chip8_Batch* batch);
+
+// copies the state of chip8, running the ROM of the batch, to lane ; the configuration of the batch is kept
+void Chip8_batch_set_lane(Chip8_Batch* batch, u32 lane, const Chip8* chip8);
+// copies lane and the configuration of the batch to chip8, created from the ROM of the batch, so that chip8 continues like the lane
+void Chip8_batch_get_lane(Chip8_Batch* batch, u32 lane, Chip8* chip8);
+
+// bit k of the mask is KEYBOARD[k]
+void Chip8_batch_set_keyboard(Chip8_Batch* batch, u32 lane, u16 mask);
+Chip8::ERROR_TYPE Chip8_batch_get_error(Chip8_Batch* batch, u32 lane);
+
+// Chip8_step and Chip8_run of every lane
+void Chip8_batch_step(Chip8_Batch* batch, float dtime_sec);
+void Chip8_batch_run(Chip8_Batch* batch, int instruction_count);
+
+// ---- execution helpers shared by the backends
+
+// adress and size are checked against the reserved_start and memory_size of chip8 ; the other form is for the tools without a Chip8
+int Chip8_is_valid_memory(const Chip8* chip8, u16 adress, u16 size);
+int Chip8_is_valid_memory(u16 adress, u16 size, u32 reserved_start, u32 memory_size);
+void Chip8_validate_memory(Chip8* chip8, u16 adress, u16 size);
+
+u8* Chip8_get_memory(Chip8* chip8, u16 adress);
+u16 Chip8_fetch(Chip8* chip8, u16 adress);
+
+// bytes of the instruction at adress skipped by SE, SNE, SKP and SKNP ; 4 for F000 NNNN with XOCHIP
+u8 Chip8_skip_size(Chip8* chip8, u16 adress);
+template<Chip8::MACHINE_TYPE machine>
+u8 Chip8_skip_size(Chip8* chip8, u16 adress);
+
+// resolution of SCREEN ; constant with CHIP8 since it cannot switch
+template<Chip8::MACHINE_TYPE machine>
+int Chip8_screen_width(const Chip8* chip8);
+template<Chip8::MACHINE_TYPE machine>
+int Chip8_screen_height(const Chip8* chip8);
+
+// quirks of Variant::quirks: VF after OR, AND and XOR ; I after LD [I], Vx and LD Vx, [I] of regcount registers
+template<typename Variant>
+void Chip8_logic_VF(Chip8* chip8);
+template<typename Variant>
+void Chip8_load_store_I(Chip8* chip8, u16 regcount);
+
+// ---- timers
+//
+// DT and ST are evaluated lazily from Chip8::CYCLE ; nothing is done per instruction
+
+// number of timer decrements from cycle 0 to cycle ; the other form is for the batches without a Chip8
+u64 Chip8_timer_ticks(Chip8* chip8, u64 cycle);
+u64 Chip8_timer_ticks(u64 cycle, u32 timer_per_second, u32 instructions_per_second);
+
+// first cycle when a timer holding value at tick reaches 0
+u64 Chip8_timer_zero_cycle(Chip8* chip8, u8 value, u64 tick);
+
+u8 Chip8_get_DT(Chip8* chip8);
+u8 Chip8_get_ST(Chip8* chip8);
+void Chip8_set_DT(Chip8* chip8, u8 value);
+void Chip8_set_ST(Chip8* chip8, u8 value);
+
+// LD Vx, DT at adress ; SE Vx, 0 ; JP adress
+int Chip8_is_DT_wait_loop(Chip8* chip8, u16 adress, u8 x);
+// retires whole iterations of the DT wait loop after its LD Vx, DT was executed and before it retires
+// Chip8::CYCLE is expected to be up to date ; the iterations are subtracted from instruction_count and added to Chip8::IDLE_CYCLE
+void Chip8_skip_DT_wait_loop(Chip8* chip8, u8 x, int& instruction_count);
+
+// fill DECODE_CACHE from memory according to Chip8::DECODE_FUSION
+void Chip8_fill_decode_cache(Chip8* chip8);
+
+// reset the micro-ops covering the bytes [adress ; adress + size[ after a write to memory
+void Chip8_invalidate_decode(Chip8* chip8, u16 adress, u16 size);
+
+// NOTE: x, y and n are expected to be validated by the caller
+// the sprite of every plane in PLANES follows the one of the previous plane at I ; see Chip8_sprite_size
+// the templates are instantiated for every machine and used by the templated backends ; the functions select the one of Chip8::MACHINE
+void Chip8_draw_sprite(Chip8* chip8, u8 x, u8 y, short n);
+template<Chip8::MACHINE_TYPE machine>
+void Chip8_draw_sprite(Chip8* chip8, u8 x, u8 y, short n);
+// 16x16 sprite of DXY0 ; 32 bytes per plane at I
+void Chip8_draw_sprite_16(Chip8* chip8, u8 x, u8 y);
+template<Chip8::MACHINE_TYPE machine>
+void Chip8_draw_sprite_16(Chip8* chip8, u8 x, u8 y);
+// bytes read at I by a sprite of row_bytes bytes per plane
+u16 Chip8_sprite_size(const Chip8* chip8, u16 row_bytes);
+void Chip8_clear_screen(Chip8* chip8);
+template<Chip8::MACHINE_TYPE machine>
+void Chip8_clear_screen(Chip8* chip8);
+
+// scrolls move whole SCREEN words of the planes in PLANES ; the pixels scrolled out are lost
+void Chip8_scroll_down(Chip8* chip8, int n);
+void Chip8_scroll_up(Chip8* chip8, int n);
+void Chip8_scroll_right(Chip8* chip8);
+void Chip8_scroll_left(Chip8* chip8);
+// clears both planes when the resolution changes
+void Chip8_set_resolution(Chip8* chip8, int width, int height);
+
+// the interpreter range adress of the 10-byte digit of LD HF, Vx
+constexpr u16 Chip8_big_sprites_adress = offsetof(Chip8::Memory::Interpreter, big_sprites);
+
+u64 Chip8_rotate_right(u64 value, u32 shift);
+
+// ---- backends
+
+void Chip8_execute_decoded(Chip8* chip8, int instruction_count);
+// Chip8_execute_decoded that returns after the first instruction that does not continue at the next adress:
+// a jump, CALL, RET, a skip taken or an idle wait
+void Chip8_execute_decoded_to_jump(Chip8* chip8, int instruction_count);
+void Chip8_execute_threaded(Chip8* chip8, int instruction_count);
+
+void Chip8_execute_jit(Chip8* chip8, int instruction_count);
+void Chip8_jit_invalidate(Chip8* chip8, u16 adress, u16 size);
+void Chip8_jit_destroy(Chip8* chip8);
+
+void Chip8_execute_aot(Chip8* chip8, int instruction_count);
+void Chip8_aot_invalidate(Chip8* chip8, u16 adress, u16 size);
+
+// returns the program recompiled from ROM or NULL
+const Chip8_AOT_Program* Chip8_aot_find(const Chip8_AOT_Program* programs, int program_count, void* ROM, size_t ROM_size);
+
+// ---- profiling
+
+// dynamic opcode pairs and triples executed while Chip8::PROFILE is set
+struct Chip8_Profile{
+	u64 instruction_count;
+
+	// last two executed opcodes ; Chip8_Op::UNDECODED when none
+	Chip8_Op::TYPE previous[2];
+
+	u64 pair_count[Chip8_Op::TYPE_COUNT][Chip8_Op::TYPE_COUNT];
+	u64 triple_count[Chip8_Op::TYPE_COUNT][Chip8_Op::TYPE_COUNT][Chip8_Op::TYPE_COUNT];
+};
+
+Chip8_Profile* Chip8_create_profile();
+void Chip8_destroy_profile(Chip8_Profile* profile);
+
+void Chip8_execute_profiled(Chip8* chip8, int instruction_count);
+
+// writes the most frequent pairs and triples to output
+void Chip8_profile_report(Chip8_Profile* profile, FILE* output, int entry_count);
+
+// accesses per adress of Chip8::memory executed while Chip8::MEMORY_PROFILE is set ; counters saturate at UINT16_MAX
+// * fetch counts both bytes of every executed instruction
+// * read counts the bytes read from I by DRW and LD Vx, [I]
+// * write counts the bytes written from I by LD [I], Vx and LD B, Vx
+struct Chip8_Memory_Profile{
+	u16 fetch[sizeof(Chip8::Memory)];
+	u16 read[sizeof(Chip8::Memory)];
+	u16 write[sizeof(Chip8::Memory)];
+};
+
+Chip8_Memory_Profile* Chip8_create_memory_profile();
+void Chip8_destroy_memory_profile(Chip8_Memory_Profile* profile);
+
+// heatmap of 64 adresses per row from the top-left corner, each adress being a square of scale pixels
+// red is write, green is read and blue is fetch with a logarithmic intensity ; code that writes itself is magenta
+void Chip8_memory_profile_to_canvas(Chip8_Memory_Profile* profile, Pixel_Canvas& canvas, int scale);
+
+// writes "adress,fetch,read,write" for every accessed adress
+void Chip8_memory_profile_report(Chip8_Memory_Profile* profile, FILE* output);
+
+// writes the report to path.csv and the heatmap to path.ppm
+int Chip8_save_memory_profile(Chip8_Memory_Profile* profile, const char* path);
+
+#if defined(CHIP8_OPCODE_STATS)
+// executions and sampled cycles per opcode class while Chip8::OPCODE_STATS is set ; compiled out without CHIP8_OPCODE_STATS
+// opcodes are counted by Chip8_execute_counted and Chip8_run uses it instead of the INTERPRETER, THREADED, JIT and AOT backends
+struct Chip8_Opcode_Stats{
+	static constexpr int histogram_size = 16;
+
+	u64 count[Chip8_Op::TYPE_COUNT];
+
+	// one instruction every sample_period dispatched instructions is executed alone and timed with the cycle counter ; 0 disables sampling
+	// the instructions retired by the idle loops of Chip8_execute_decoded without being dispatched are not counted
+	u32 sample_period;
+	// decremented by Chip8_execute_counted
+	u32 sample_countdown;
+
+	// cycles of an empty Chip8_execute_counted call subtracted from the samples ; UINT64_MAX until calibrated
+	u64 sample_overhead;
+
+	u64 sample_count[Chip8_Op::TYPE_COUNT];
+	u64 sample_cycles[Chip8_Op::TYPE_COUNT];
+
+	// bucket b counts the samples of [2^b ; 2^(b + 1)[ cycles ; bucket 0 also counts 0 and the last bucket the longer ones
+	u64 histogram[Chip8_Op::TYPE_COUNT][histogram_size];
+};
+
+Chip8_Opcode_Stats* Chip8_create_opcode_stats(u32 sample_period);
+void Chip8_destroy_opcode_stats(Chip8_Opcode_Stats* stats);
+
+u64 Chip8_read_cycle_counter();
+
+// Chip8_execute_decoded that adds every dispatched opcode to Chip8::OPCODE_STATS::count
+// with a sample_period, it returns before dispatching when sample_countdown reaches 0 ; Chip8::CYCLE gives the instructions retired
+void Chip8_execute_counted(Chip8* chip8, int instruction_count);
+
+void Chip8_execute_sampled(Chip8* chip8, int instruction_count);
+
+// writes the opcode classes sorted by execution count to output
+void Chip8_opcode_stats_report(Chip8_Opcode_Stats* stats, FILE* output);
+#endif
+
+#include "chip8.inl"
@@ -0,0 +1,202 @@
+inline Chip8_Op Chip8_decode(u16 instruction, Chip8::MACHINE_TYPE machine){
+	Chip8_Op op;
+	op.type = Chip8_Op::UNKNOWN;
+	op.x = (instruction & 0x0F00) >> 8;
+	op.y = (instruction & 0x00F0) >> 4;
+	op.n = (instruction & 0x000F);
+	op.kk = (instruction & 0x00FF);
+	op.skip = 2u;
+	op.nnn = (instruction & 0x0FFF);
+
+	if (machine == Chip8::XOCHIP){
+		if( ( instruction & 0xFFF0 ) == 0x00D0 )			op.type = Chip8_Op::SCU_N;
+		else if( ( instruction & 0xF00F ) == 0x5002 )	op.type = Chip8_Op::LD_MEM_VX_VY;
+		else if( ( instruction & 0xF00F ) == 0x5003 )	op.type = Chip8_Op::LD_VX_VY_MEM;
+		else if( instruction == 0xF000 )				op.type = Chip8_Op::LD_I_LONG;
+		else if( ( instruction & 0xFCFF ) == 0xF001 )	op.type = Chip8_Op::PLANE_N;
+		else if( instruction == 0xF002 )				op.type = Chip8_Op::LD_AUDIO;
+		else if( ( instruction & 0xF0FF ) == 0xF03A )	op.type = Chip8_Op::LD_PITCH_VX;
+		else if( ( instruction & 0xF0FF ) == 0xF075 )	op.type = Chip8_Op::LD_R_VX;
+		else if( ( instruction & 0xF0FF ) == 0xF085 )	op.type = Chip8_Op::LD_VX_R;
+		if (op.type != Chip8_Op::UNKNOWN) return op;
+	}
+
+	if (machine != Chip8::CHIP8){
+		if( ( instruction & 0xFFF0 ) == 0x00C0 )			op.type = Chip8_Op::SCD_N;
+		else if( instruction == 0x00FB )				op.type = Chip8_Op::SCR;
+		else if( instruction == 0x00FC )				op.type = Chip8_Op::SCL;
+		else if( instruction == 0x00FD )				op.type = Chip8_Op::EXIT;
+		else if( instruction == 0x00FE )				op.type = Chip8_Op::LOW;
+		else if( instruction == 0x00FF )				op.type = Chip8_Op::HIGH;
+		else if( ( instruction & 0xF00F ) == 0xD000 )	op.type = Chip8_Op::DRW_VX_VY_0;
+		else if( ( instruction & 0xF0FF ) == 0xF030 )	op.type = Chip8_Op::LD_HF_VX;
+		else if( ( instruction & 0xF8FF ) == 0xF075 )	op.type = Chip8_Op::LD_R_VX;
+		else if( ( instruction & 0xF8FF ) == 0xF085 )	op.type = Chip8_Op::LD_VX_R;
+		if (op.type != Chip8_Op::UNKNOWN) return op;
+	}
+
+	if( instruction == 0x00E0 )							op.type = Chip8_Op::CLS;
+	else if( instruction == 0x00EE )					op.type = Chip8_Op::RET;
+	else if( ( instruction & 0xF000 ) == 0x1000 )		op.type = Chip8_Op::JP_ADDR;
+	else if( ( instruction & 0xF000 ) == 0x2000 )		op.type = Chip8_Op::CALL_ADDR;
+	else if( ( instruction & 0xF000 ) == 0x3000 )		op.type = Chip8_Op::SE_VX_BYTE;
+	else if( ( instruction & 0xF000 ) == 0x4000 )		op.type = Chip8_Op::SNE_VX_BYTE;
+	else if( ( instruction & 0xF00F ) == 0x5000 )		op.type = Chip8_Op::SE_VX_VY;
+	else if( ( instruction & 0xF000 ) == 0x6000 )		op.type = Chip8_Op::LD_VX_BYTE;
+	else if( ( instruction & 0xF000 ) == 0x7000 )		op.type = Chip8_Op::ADD_VX_BYTE;
+	else if( ( instruction & 0xF00F ) == 0x8000 )		op.type = Chip8_Op::LD_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x8001 )		op.type = Chip8_Op::OR_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x8002 )		op.type = Chip8_Op::AND_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x8003 )		op.type = Chip8_Op::XOR_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x8004 )		op.type = Chip8_Op::ADD_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x8005 )		op.type = Chip8_Op::SUB_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x8006 )		op.type = Chip8_Op::SHR_VX;
+	else if( ( instruction & 0xF00F ) == 0x8007 )		op.type = Chip8_Op::SUBN_VX_VY;
+	else if( ( instruction & 0xF00F ) == 0x800E )		op.type = Chip8_Op::SHL_VX;
+	else if( ( instruction & 0xF00F ) == 0x9000 )		op.type = Chip8_Op::SNE_VX_VY;
+	else if( ( instruction & 0xF000 ) == 0xA000 )		op.type = Chip8_Op::LD_I_ADDR;
+	else if( ( instruction & 0xF000 ) == 0xB000 )		op.type = Chip8_Op::JP_V0_ADDR;
+	else if( ( instruction & 0xF000 ) == 0xC000 )		op.type = Chip8_Op::RND_VX_BYTE;
+	else if( ( instruction & 0xF000 ) == 0xD000 )		op.type = Chip8_Op::DRW_VX_VY_N;
+	else if( ( instruction & 0xF0FF ) == 0xE09E )		op.type = Chip8_Op::SKP_VX;
+	else if( ( instruction & 0xF0FF ) == 0xE0A1 )		op.type = Chip8_Op::SKNP_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF007 )		op.type = Chip8_Op::LD_VX_DT;
+	else if( ( instruction & 0xF0FF ) == 0xF00A )		op.type = Chip8_Op::LD_VX_K;
+	else if( ( instruction & 0xF0FF ) == 0xF015 )		op.type = Chip8_Op::LD_DT_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF018 )		op.type = Chip8_Op::LD_ST_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF01E )		op.type = Chip8_Op::ADD_I_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF029 )		op.type = Chip8_Op::LD_F_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF033 )		op.type = Chip8_Op::LD_B_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF055 )		op.type = Chip8_Op::LD_MEM_VX;
+	else if( ( instruction & 0xF0FF ) == 0xF065 )		op.type = Chip8_Op::LD_VX_MEM;
+
+	return op;
+}
+
+inline u32 Chip8_reserved_start(Chip8::MACHINE_TYPE machine){
+	return (machine == Chip8::CHIP8 ? offsetof(Chip8::Memory::Interpreter, big_sprites) : offsetof(Chip8::Memory::Interpreter, unused)) + 1u;
+}
+
+// branchless: adresses in [reserved_start ; 0x200[ wrap around to be the only ones below 0x200 - reserved_start after the subtraction
+inline int Chip8_is_valid_memory(u16 adress, u16 size, u32 reserved_start, u32 memory_size){
+	u32 reserved_size = 0x200 - reserved_start;
+	return ((u32)adress - reserved_start >= reserved_size) & ((u32)adress + size < memory_size);
+}
+
+inline int Chip8_is_valid_memory(const Chip8* chip8, u16 adress, u16 size){
+	return Chip8_is_valid_memory(adress, size, chip8->reserved_start, chip8->memory_size);
+}
+
+// reported through Chip8::ERROR like the other errors ; the quirk trials of Chip8_detect_quirks expect them
+inline void Chip8_validate_memory(Chip8* chip8, u16 adress, u16 size){
+	if (!Chip8_is_valid_memory(chip8, adress, size)) chip8->ERROR = Chip8::MEMORY_OUT_OF_BOUNDS;
+}
+
+template<Chip8::MACHINE_TYPE machine>
+inline int Chip8_screen_width(const Chip8* chip8){
+	return machine == Chip8::CHIP8 ? 64 : chip8->screen_width;
+}
+
+template<Chip8::MACHINE_TYPE machine>
+inline int Chip8_screen_height(const Chip8* chip8){
+	return machine == Chip8::CHIP8 ? 32 : chip8->screen_height;
+}
+
+// SUPER-CHIP 1.1 and XO-CHIP take the coordinates of DRW modulo the resolution so that any Vx, Vy is valid with SUPERCHIP and XOCHIP
+template<Chip8::MACHINE_TYPE machine>
+inline int Chip8_is_valid_screen_coord(const Chip8* chip8, u8 x, u8 y){
+	return (machine != Chip8::CHIP8) || ((x < Chip8_screen_width<machine>(chip8)) & (y < Chip8_screen_height<machine>(chip8)));
+}
+
+inline int Chip8_is_valid_screen_coord(const Chip8* chip8, u8 x, u8 y){
+	return (chip8->MACHINE != Chip8::CHIP8) | ((x < chip8->screen_width) & (y < chip8->screen_height));
+}
+
+inline u8* Chip8_get_memory(Chip8* chip8, u16 adress){
+	return (u8*)&chip8->memory + adress;
+}
+
+// compiles to a single rotate with MSVC, GCC and Clang
+inline u64 Chip8_rotate_right(u64 value, u32 shift){
+	shift &= 63u;
+	return (value >> shift) | (value << ((64u - shift) & 63u));
+}
+
+inline u16 Chip8_fetch(Chip8* chip8, u16 adress){
+	u8* memptr = Chip8_get_memory(chip8, adress);
+	return ((u16)memptr[0] << 8) | (u16)memptr[1];
+}
+
+inline u8 Chip8_skip_size(Chip8* chip8, u16 adress){
+	return (chip8->MACHINE == Chip8::XOCHIP && Chip8_fetch(chip8, adress) == 0xF000) ? 4u : 2u;
+}
+
+template<Chip8::MACHINE_TYPE machine>
+inline u8 Chip8_skip_size(Chip8* chip8, u16 adress){
+	return (machine == Chip8::XOCHIP && Chip8_fetch(chip8, adress) == 0xF000) ? 4u : 2u;
+}
+
+// VF after OR, AND and XOR
+template<typename Variant>
+inline void Chip8_logic_VF(Chip8* chip8){
+	if constexpr (Variant::quirks.vf_reset) chip8->registers.VF = 0;
+}
+
+// I after LD [I], Vx or LD Vx, [I] of regcount registers
+template<typename Variant>
+inline void Chip8_load_store_I(Chip8* chip8, u16 regcount){
+	if constexpr (Variant::quirks.load_store == Chip8_Quirks::I_PLUS_X_PLUS_1) chip8->I += regcount;
+	else if constexpr (Variant::quirks.load_store == Chip8_Quirks::I_PLUS_X) chip8->I += regcount - 1u;
+}
+
+inline u64 Chip8_timer_ticks(u64 cycle, u32 timer_per_second, u32 instructions_per_second){
+	if (!instructions_per_second) return 0u;
+	return cycle * timer_per_second / instructions_per_second;
+}
+
+inline u64 Chip8_timer_ticks(Chip8* chip8, u64 cycle){
+	return Chip8_timer_ticks(cycle, chip8->timer_per_second, chip8->instructions_per_second);
+}
+
+inline u64 Chip8_timer_zero_cycle(Chip8* chip8, u8 value, u64 tick){
+	if (!chip8->timer_per_second) return UINT64_MAX;
+
+	// smallest cycle with cycle * timer_per_second / instructions_per_second >= tick + value
+	u64 zero_tick = tick + value;
+	return (zero_tick * chip8->instructions_per_second + chip8->timer_per_second - 1u) / chip8->timer_per_second;
+}
+
+inline u8 Chip8_timer_value(Chip8* chip8, u8 value, u64 tick){
+	u64 elapsed = Chip8_timer_ticks(chip8, chip8->CYCLE) - tick;
+	return elapsed < value ? value - (u8)elapsed : 0u;
+}
+
+inline u8 Chip8_get_DT(Chip8* chip8){
+	return Chip8_timer_value(chip8, chip8->DT, chip8->DT_TICK);
+}
+
+inline u8 Chip8_get_ST(Chip8* chip8){
+	return Chip8_timer_value(chip8, chip8->ST, chip8->ST_TICK);
+}
+
+inline void Chip8_set_DT(Chip8* chip8, u8 value){
+	chip8->DT = value;
+	chip8->DT_TICK = Chip8_timer_ticks(chip8, chip8->CYCLE);
+}
+
+inline void Chip8_set_ST(Chip8* chip8, u8 value){
+	chip8->ST = value;
+	chip8->ST_TICK = Chip8_timer_ticks(chip8, chip8->CYCLE);
+}
+
+#if defined(CHIP8_OPCODE_STATS)
+
+inline u64 Chip8_read_cycle_counter(){
+#if defined(_M_X64) || defined(__x86_64__)
+	return __rdtsc();
+#else
+	return g_timer->ticks();
+#endif
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "chip8.h"
+
+// Runtime of the ROMs recompiled ahead of time by tools/chip8_aot.cpp
+//
+// * the recompiled blocks are executed while Chip8::PC is the start of a block
+// * instructions outside of the recovered blocks, targets of BXXX and RET that were not found statically
+//   and blocks whose code was overwritten are executed by Chip8_execute_decoded
+// * XOCHIP is not recompiled and always executed by Chip8_execute_decoded
+// * the blocks are recompiled for one quirk set ; the ROM is executed by Chip8_execute_decoded when Chip8::QUIRKS differs
+
+void Chip8_aot_invalidate(Chip8* chip8, u16 adress, u16 size){
+	u32 first_line = adress / 64u;
+	u32 last_line = min((u32)(adress + size - 1u) / 64u, 63u);
+	for (u32 iline = first_line; iline <= last_line; ++iline)
+		chip8->AOT_WRITTEN_LINES |= (u64)1u << iline;
+}
+
+const Chip8_AOT_Program* Chip8_aot_find(const Chip8_AOT_Program* programs, int program_count, void* ROM, size_t ROM_size){
+	for (int iprogram = 0; iprogram != program_count; ++iprogram){
+		const Chip8_AOT_Program& program = programs[iprogram];
+		if (program.ROM_size == ROM_size && memcmp(program.ROM, ROM, ROM_size) == 0)
+			return &program;
+	}
+	return NULL;
+}
+
+void Chip8_execute_aot(Chip8* chip8, int instruction_count){
+	const Chip8_AOT_Program* program = chip8->AOT_PROGRAM;
+	if (!program || chip8->MACHINE == Chip8::XOCHIP || chip8->QUIRKS != program->quirks){
+		Chip8_execute_decoded(chip8, instruction_count);
+		return;
+	}
+
+	while (instruction_count && !chip8->ERROR){
+		// recompiled blocks set Chip8::CYCLE before accessing the timers
+		u64 cycle = chip8->CYCLE;
+		int executed = program->execute_block(chip8, instruction_count);
+
+		if (executed < 0){
+			Chip8_execute_decoded(chip8, 1);
+			if (!chip8->ERROR) --instruction_count;
+			continue;
+		}
+
+		// KEYBOARD does not change during a step
+		if (executed) memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));
+		instruction_count -= executed;
+		chip8->CYCLE = cycle + executed;
+	}
+}
@@ -0,0 +1,828 @@
+#include "chip8.h"
+
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Batch
+//
+// * every register of a chunk is a row of Chip8_batch_chunk_lanes u16, one per lane ; the registers are u16 so that the masks
+//   of a PC comparison apply to every row
+// * every instruction of a chunk executes the lanes grouped by PC: the first lane left gives the PC and the micro-op, and every
+//   lane left at the same PC executes it
+// * the ALU instructions, LD I, ADD I, LD F, JP and the skips on registers are vector operations masked by the group ;
+//   the other instructions are executed lane by lane by Chip8_batch_execute_lanes
+// * the memory and SCREEN are stored per lane ; the micro-ops are decoded once from Chip8_Batch::image and the adresses
+//   written by any lane of a chunk are fetched per lane instead
+// * errors, CYCLE, the timers and LAST_KEYBOARD follow Chip8_execute_interpreter
+//
+// the vectors are AVX-512BW, AVX2 or SSE2 when the compiler targets them and a single u16 otherwise ; see premake5 --simd
+
+#if defined(__AVX512BW__)
+
+typedef __m512i Chip8_Lanes;
+static constexpr int Chip8_lanes_width = 32;
+
+static Chip8_Lanes Chip8_lanes_load(const u16* src){ return _mm512_loadu_si512(src); }
+static void Chip8_lanes_store(u16* dst, Chip8_Lanes value){ _mm512_storeu_si512(dst, value); }
+static Chip8_Lanes Chip8_lanes_set(u16 value){ return _mm512_set1_epi16((short)value); }
+static Chip8_Lanes Chip8_lanes_add(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_add_epi16(A, B); }
+static Chip8_Lanes Chip8_lanes_sub(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_sub_epi16(A, B); }
+static Chip8_Lanes Chip8_lanes_and(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_and_si512(A, B); }
+static Chip8_Lanes Chip8_lanes_andnot(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_andnot_si512(A, B); }
+static Chip8_Lanes Chip8_lanes_or(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_or_si512(A, B); }
+static Chip8_Lanes Chip8_lanes_xor(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_xor_si512(A, B); }
+static Chip8_Lanes Chip8_lanes_shift_right(Chip8_Lanes A, int shift){ return _mm512_srl_epi16(A, _mm_cvtsi32_si128(shift)); }
+static Chip8_Lanes Chip8_lanes_shift_left(Chip8_Lanes A, int shift){ return _mm512_sll_epi16(A, _mm_cvtsi32_si128(shift)); }
+static Chip8_Lanes Chip8_lanes_equal(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(A, B)); }
+// signed ; the registers are in [0 ; 255]
+static Chip8_Lanes Chip8_lanes_greater(Chip8_Lanes A, Chip8_Lanes B){ return _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(A, B)); }
+static u32 Chip8_lanes_to_bits(Chip8_Lanes mask){ return (u32)_mm512_movepi16_mask(mask); }
+static Chip8_Lanes Chip8_lanes_from_bits(u32 bits){ return _mm512_movm_epi16((__mmask32)bits); }
+
+#elif defined(__AVX2__)
+
+typedef __m256i Chip8_Lanes;
+static constexpr int Chip8_lanes_width = 16;
+
+static Chip8_Lanes Chip8_lanes_load(const u16* src){ return _mm256_loadu_si256((const __m256i*)src); }
+static void Chip8_lanes_store(u16* dst, Chip8_Lanes value){ _mm256_storeu_si256((__m256i*)dst, value); }
+static Chip8_Lanes Chip8_lanes_set(u16 value){ return _mm256_set1_epi16((short)value); }
+static Chip8_Lanes Chip8_lanes_add(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_add_epi16(A, B); }
+static Chip8_Lanes Chip8_lanes_sub(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_sub_epi16(A, B); }
+static Chip8_Lanes Chip8_lanes_and(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_and_si256(A, B); }
+static Chip8_Lanes Chip8_lanes_andnot(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_andnot_si256(A, B); }
+static Chip8_Lanes Chip8_lanes_or(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_or_si256(A, B); }
+static Chip8_Lanes Chip8_lanes_xor(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_xor_si256(A, B); }
+static Chip8_Lanes Chip8_lanes_shift_right(Chip8_Lanes A, int shift){ return _mm256_srl_epi16(A, _mm_cvtsi32_si128(shift)); }
+static Chip8_Lanes Chip8_lanes_shift_left(Chip8_Lanes A, int shift){ return _mm256_sll_epi16(A, _mm_cvtsi32_si128(shift)); }
+static Chip8_Lanes Chip8_lanes_equal(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_cmpeq_epi16(A, B); }
+// signed ; the registers are in [0 ; 255]
+static Chip8_Lanes Chip8_lanes_greater(Chip8_Lanes A, Chip8_Lanes B){ return _mm256_cmpgt_epi16(A, B); }
+static u32 Chip8_lanes_to_bits(Chip8_Lanes mask){
+	return (u32)_mm_movemask_epi8(_mm_packs_epi16(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1)));
+}
+static Chip8_Lanes Chip8_lanes_from_bits(u32 bits){
+	const __m256i lane_bits = _mm256_setr_epi16(0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+		0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, (short)0x8000);
+	return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16((short)bits), lane_bits), lane_bits);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+
+typedef __m128i Chip8_Lanes;
+static constexpr int Chip8_lanes_width = 8;
+
+static Chip8_Lanes Chip8_lanes_load(const u16* src){ return _mm_loadu_si128((const __m128i*)src); }
+static void Chip8_lanes_store(u16* dst, Chip8_Lanes value){ _mm_storeu_si128((__m128i*)dst, value); }
+static Chip8_Lanes Chip8_lanes_set(u16 value){ return _mm_set1_epi16((short)value); }
+static Chip8_Lanes Chip8_lanes_add(Chip8_Lanes A, Chip8_Lanes B){ return _mm_add_epi16(A, B); }
+static Chip8_Lanes Chip8_lanes_sub(Chip8_Lanes A, Chip8_Lanes B){ return _mm_sub_epi16(A, B); }
+static Chip8_Lanes Chip8_lanes_and(Chip8_Lanes A, Chip8_Lanes B){ return _mm_and_si128(A, B); }
+static Chip8_Lanes Chip8_lanes_andnot(Chip8_Lanes A, Chip8_Lanes B){ return _mm_andnot_si128(A, B); }
+static Chip8_Lanes Chip8_lanes_or(Chip8_Lanes A, Chip8_Lanes B){ return _mm_or_si128(A, B); }
+static Chip8_Lanes Chip8_lanes_xor(Chip8_Lanes A, Chip8_Lanes B){ return _mm_xor_si128(A, B); }
+static Chip8_Lanes Chip8_lanes_shift_right(Chip8_Lanes A, int shift){ return _mm_srl_epi16(A, _mm_cvtsi32_si128(shift)); }
+static Chip8_Lanes Chip8_lanes_shift_left(Chip8_Lanes A, int shift){ return _mm_sll_epi16(A, _mm_cvtsi32_si128(shift)); }
+static Chip8_Lanes Chip8_lanes_equal(Chip8_Lanes A, Chip8_Lanes B){ return _mm_cmpeq_epi16(A, B); }
+// signed ; the registers are in [0 ; 255]
+static Chip8_Lanes Chip8_lanes_greater(Chip8_Lanes A, Chip8_Lanes B){ return _mm_cmpgt_epi16(A, B); }
+static u32 Chip8_lanes_to_bits(Chip8_Lanes mask){ return (u32)_mm_movemask_epi8(_mm_packs_epi16(mask, _mm_setzero_si128())); }
+static Chip8_Lanes Chip8_lanes_from_bits(u32 bits){
+	const __m128i lane_bits = _mm_setr_epi16(0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080);
+	return _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16((short)bits), lane_bits), lane_bits);
+}
+
+#else
+
+typedef u16 Chip8_Lanes;
+static constexpr int Chip8_lanes_width = 1;
+
+static Chip8_Lanes Chip8_lanes_load(const u16* src){ return *src; }
+static void Chip8_lanes_store(u16* dst, Chip8_Lanes value){ *dst = value; }
+static Chip8_Lanes Chip8_lanes_set(u16 value){ return value; }
+static Chip8_Lanes Chip8_lanes_add(Chip8_Lanes A, Chip8_Lanes B){ return (u16)(A + B); }
+static Chip8_Lanes Chip8_lanes_sub(Chip8_Lanes A, Chip8_Lanes B){ return (u16)(A - B); }
+static Chip8_Lanes Chip8_lanes_and(Chip8_Lanes A, Chip8_Lanes B){ return A & B; }
+static Chip8_Lanes Chip8_lanes_andnot(Chip8_Lanes A, Chip8_Lanes B){ return (u16)~A & B; }
+static Chip8_Lanes Chip8_lanes_or(Chip8_Lanes A, Chip8_Lanes B){ return A | B; }
+static Chip8_Lanes Chip8_lanes_xor(Chip8_Lanes A, Chip8_Lanes B){ return A ^ B; }
+static Chip8_Lanes Chip8_lanes_shift_right(Chip8_Lanes A, int shift){ return (u16)(A >> shift); }
+static Chip8_Lanes Chip8_lanes_shift_left(Chip8_Lanes A, int shift){ return (u16)(A << shift); }
+static Chip8_Lanes Chip8_lanes_equal(Chip8_Lanes A, Chip8_Lanes B){ return A == B ? 0xFFFFu : 0x0000u; }
+static Chip8_Lanes Chip8_lanes_greater(Chip8_Lanes A, Chip8_Lanes B){ return A > B ? 0xFFFFu : 0x0000u; }
+static u32 Chip8_lanes_to_bits(Chip8_Lanes mask){ return mask & 0x01u; }
+static Chip8_Lanes Chip8_lanes_from_bits(u32 bits){ return bits ? 0xFFFFu : 0x0000u; }
+
+#endif
+
+static_assert(Chip8_batch_chunk_lanes % Chip8_lanes_width == 0);
+static_assert(Chip8_batch_chunk_lanes <= 64, "the lanes of a chunk are the bits of a u64");
+
+static Chip8_Lanes Chip8_lanes_select(Chip8_Lanes mask, Chip8_Lanes A, Chip8_Lanes B){
+	return Chip8_lanes_or(Chip8_lanes_and(mask, A), Chip8_lanes_andnot(mask, B));
+}
+
+// writes value to the lanes of mask only
+static void Chip8_lanes_store(u16* dst, Chip8_Lanes mask, Chip8_Lanes value){
+	Chip8_lanes_store(dst, Chip8_lanes_select(mask, value, Chip8_lanes_load(dst)));
+}
+
+static int Chip8_batch_first_lane(u64 lanes){
+	ram_assert(lanes);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, lanes);
+	return (int)index;
+#else
+	return __builtin_ctzll(lanes);
+#endif
+}
+
+static constexpr u64 Chip8_batch_vector_lanes = Chip8_lanes_width == 64 ? UINT64_MAX : ((u64)1u << Chip8_lanes_width) - 1u;
+
+struct Chip8_Batch_Chunk{
+	u16 V[16][Chip8_batch_chunk_lanes];
+	u16 I[Chip8_batch_chunk_lanes];
+	u16 PC[Chip8_batch_chunk_lanes];
+	u16 SP[Chip8_batch_chunk_lanes];
+	u16 STACK[16][Chip8_batch_chunk_lanes];
+	// masks of Chip8_keyboard_to_mask
+	u16 KEYBOARD[Chip8_batch_chunk_lanes];
+	u16 LAST_KEYBOARD[Chip8_batch_chunk_lanes];
+
+	u8 DT[Chip8_batch_chunk_lanes];
+	u8 ST[Chip8_batch_chunk_lanes];
+	u64 DT_TICK[Chip8_batch_chunk_lanes];
+	u64 ST_TICK[Chip8_batch_chunk_lanes];
+	u64 CYCLE[Chip8_batch_chunk_lanes];
+	Chip8::ERROR_TYPE ERROR[Chip8_batch_chunk_lanes];
+	Random_Data RANDOM[Chip8_batch_chunk_lanes];
+
+	// one bit per lane below Chip8_Batch::lane_count
+	u64 lanes;
+
+	// KEYBOARD changed since the last instruction of every lane ; LAST_KEYBOARD is KEYBOARD otherwise
+	int keyboard_changed;
+
+	// one bit per adress of memory written by a lane or different from Chip8_Batch::image in a lane
+	u64 written[Chip8_batch_memory_size / 64u];
+
+	// rows of Chip8::SCREEN[0] in 64x32
+	u64 SCREEN[Chip8_batch_chunk_lanes][32];
+	u64 SCREEN_DIRTY[Chip8_batch_chunk_lanes];
+	u64 SCREEN_GENERATION[Chip8_batch_chunk_lanes];
+
+	u8 memory[Chip8_batch_chunk_lanes][Chip8_batch_memory_size];
+};
+
+static Chip8_Batch_Chunk* Chip8_batch_chunk(Chip8_Batch* batch, u32 lane, int& chunk_lane){
+	ram_assert(lane < batch->lane_count);
+	chunk_lane = (int)(lane % Chip8_batch_chunk_lanes);
+	return &batch->chunks[lane / Chip8_batch_chunk_lanes];
+}
+
+static int Chip8_batch_is_written(Chip8_Batch_Chunk* chunk, u16 adress){
+	return (chunk->written[adress >> 6u] >> (adress & 63u)) & 1u;
+}
+
+static void Chip8_batch_set_written(Chip8_Batch_Chunk* chunk, u16 adress, u16 size){
+	for (u16 ibyte = 0; ibyte != size; ++ibyte){
+		u16 byte_adress = adress + ibyte;
+		chunk->written[byte_adress >> 6u] |= (u64)1u << (byte_adress & 63u);
+	}
+}
+
+// lanes of the chunk where the u16 of rows is value
+static u64 Chip8_batch_equal_lanes(const u16* rows, u16 value){
+	Chip8_Lanes target = Chip8_lanes_set(value);
+
+	u64 lanes = 0u;
+	for (int offset = 0; offset != Chip8_batch_chunk_lanes; offset += Chip8_lanes_width)
+		lanes |= (u64)Chip8_lanes_to_bits(Chip8_lanes_equal(Chip8_lanes_load(rows + offset), target)) << offset;
+	return lanes;
+}
+
+static u16 Chip8_batch_fetch(const u8* memory, u16 adress){
+	return ((u16)memory[adress] << 8) | (u16)memory[adress + 1];
+}
+
+// ---- lanes
+
+Chip8_Batch* Chip8_create_batch(const Chip8* chip8, u32 lane_count){
+	if (chip8->MACHINE != Chip8::CHIP8) return NULL;
+	ram_assert(lane_count);
+
+	Chip8_Batch* batch = (Chip8_Batch*)malloc(sizeof(Chip8_Batch));
+	if (!batch) crash("Failed to allocate the Chip8 batch");
+
+	batch->QUIRKS = chip8->QUIRKS;
+	batch->emulation_speed = chip8->emulation_speed;
+	batch->instructions_per_second = chip8->instructions_per_second;
+	batch->timer_per_second = chip8->timer_per_second;
+	batch->instruction_accumulator = chip8->instruction_accumulator;
+	batch->ROM_HASH = chip8->ROM_HASH;
+
+	batch->lane_count = lane_count;
+	batch->chunk_count = (lane_count + Chip8_batch_chunk_lanes - 1u) / Chip8_batch_chunk_lanes;
+	batch->chunks = (Chip8_Batch_Chunk*)malloc(sizeof(Chip8_Batch_Chunk) * batch->chunk_count);
+	if (!batch->chunks) crash("Failed to allocate %u Chip8 batch lanes", lane_count);
+
+	static_assert(sizeof(Chip8_Batch::image) <= sizeof(Chip8::Memory));
+	memcpy(batch->image, &chip8->memory, sizeof(Chip8_Batch::image));
+	memset(batch->DECODE, 0x00, sizeof(Chip8_Batch::DECODE));
+
+	for (u32 ichunk = 0; ichunk != batch->chunk_count; ++ichunk){
+		Chip8_Batch_Chunk* chunk = &batch->chunks[ichunk];
+		memset(chunk, 0x00, sizeof(Chip8_Batch_Chunk));
+
+		u32 chunk_lane_count = min(lane_count - ichunk * Chip8_batch_chunk_lanes, (u32)Chip8_batch_chunk_lanes);
+		chunk->lanes = chunk_lane_count == 64u ? UINT64_MAX : ((u64)1u << chunk_lane_count) - 1u;
+	}
+
+	for (u32 ilane = 0; ilane != lane_count; ++ilane)
+		Chip8_batch_set_lane(batch, ilane, chip8);
+
+	return batch;
+}
+
+void Chip8_destroy_batch(Chip8_Batch* batch){
+	free(batch->chunks);
+	free(batch);
+}
+
+void Chip8_batch_set_lane(Chip8_Batch* batch, u32 lane, const Chip8* chip8){
+	ram_assert(chip8->MACHINE == Chip8::CHIP8 && chip8->ROM_HASH == batch->ROM_HASH);
+
+	int ilane;
+	Chip8_Batch_Chunk* chunk = Chip8_batch_chunk(batch, lane, ilane);
+
+	for (int ireg = 0; ireg != 16; ++ireg)
+		chunk->V[ireg][ilane] = chip8->registers.by_index[ireg];
+	chunk->I[ilane] = chip8->I;
+	chunk->PC[ilane] = chip8->PC;
+	chunk->SP[ilane] = chip8->SP;
+	for (int istack = 0; istack != 16; ++istack)
+		chunk->STACK[istack][ilane] = chip8->STACK[istack];
+	chunk->KEYBOARD[ilane] = Chip8_keyboard_to_mask(chip8->KEYBOARD);
+	chunk->LAST_KEYBOARD[ilane] = Chip8_keyboard_to_mask(chip8->LAST_KEYBOARD);
+	chunk->keyboard_changed = true;
+
+	chunk->DT[ilane] = chip8->DT;
+	chunk->ST[ilane] = chip8->ST;
+	chunk->DT_TICK[ilane] = chip8->DT_TICK;
+	chunk->ST_TICK[ilane] = chip8->ST_TICK;
+	chunk->CYCLE[ilane] = chip8->CYCLE;
+	chunk->ERROR[ilane] = chip8->ERROR;
+	chunk->RANDOM[ilane] = chip8->RANDOM;
+
+	for (int iy = 0; iy != 32; ++iy)
+		chunk->SCREEN[ilane][iy] = chip8->SCREEN[0][iy][0];
+	chunk->SCREEN_DIRTY[ilane] = chip8->SCREEN_DIRTY;
+	chunk->SCREEN_GENERATION[ilane] = chip8->SCREEN_GENERATION;
+
+	const u8* memory = (const u8*)&chip8->memory;
+	memcpy(chunk->memory[ilane], memory, Chip8_batch_memory_size);
+	for (u16 adress = 0; adress != Chip8_batch_memory_size; ++adress)
+		if (memory[adress] != batch->image[adress]) Chip8_batch_set_written(chunk, adress, 1u);
+}
+
+void Chip8_batch_get_lane(Chip8_Batch* batch, u32 lane, Chip8* chip8){
+	ram_assert(chip8->MACHINE == Chip8::CHIP8 && chip8->ROM_HASH == batch->ROM_HASH);
+
+	int ilane;
+	Chip8_Batch_Chunk* chunk = Chip8_batch_chunk(batch, lane, ilane);
+
+	chip8->QUIRKS = batch->QUIRKS;
+	chip8->emulation_speed = batch->emulation_speed;
+	chip8->instructions_per_second = batch->instructions_per_second;
+	chip8->timer_per_second = batch->timer_per_second;
+	chip8->instruction_accumulator = batch->instruction_accumulator;
+
+	for (int ireg = 0; ireg != 16; ++ireg)
+		chip8->registers.by_index[ireg] = (u8)chunk->V[ireg][ilane];
+	chip8->I = chunk->I[ilane];
+	chip8->PC = chunk->PC[ilane];
+	chip8->SP = chunk->SP[ilane];
+	for (int istack = 0; istack != 16; ++istack)
+		chip8->STACK[istack] = chunk->STACK[istack][ilane];
+	Chip8_keyboard_from_mask(chip8->KEYBOARD, chunk->KEYBOARD[ilane]);
+	Chip8_keyboard_from_mask(chip8->LAST_KEYBOARD, chunk->LAST_KEYBOARD[ilane]);
+
+	chip8->DT = chunk->DT[ilane];
+	chip8->ST = chunk->ST[ilane];
+	chip8->DT_TICK = chunk->DT_TICK[ilane];
+	chip8->ST_TICK = chunk->ST_TICK[ilane];
+	chip8->CYCLE = chunk->CYCLE[ilane];
+	chip8->ERROR = chunk->ERROR[ilane];
+	chip8->RANDOM = chunk->RANDOM[ilane];
+
+	memset(chip8->SCREEN, 0x00, sizeof(Chip8::SCREEN));
+	for (int iy = 0; iy != 32; ++iy)
+		chip8->SCREEN[0][iy][0] = chunk->SCREEN[ilane][iy];
+	chip8->SCREEN_DIRTY = chunk->SCREEN_DIRTY[ilane];
+	chip8->SCREEN_GENERATION = chunk->SCREEN_GENERATION[ilane];
+
+	// only the lines that differ are copied so that the decoded micro-ops and recompiled blocks of the others stay valid
+	u8* memory = (u8*)&chip8->memory;
+	for (u32 adress = 0; adress != Chip8_batch_memory_size; adress += 64u){
+		if (memcmp(memory + adress, chunk->memory[ilane] + adress, 64u) != 0){
+			memcpy(memory + adress, chunk->memory[ilane] + adress, 64u);
+			Chip8_invalidate_decode(chip8, (u16)adress, 64u);
+		}
+	}
+}
+
+void Chip8_batch_set_keyboard(Chip8_Batch* batch, u32 lane, u16 mask){
+	int ilane;
+	Chip8_Batch_Chunk* chunk = Chip8_batch_chunk(batch, lane, ilane);
+
+	chunk->keyboard_changed |= chunk->KEYBOARD[ilane] != mask;
+	chunk->KEYBOARD[ilane] = mask;
+}
+
+Chip8::ERROR_TYPE Chip8_batch_get_error(Chip8_Batch* batch, u32 lane){
+	int ilane;
+	Chip8_Batch_Chunk* chunk = Chip8_batch_chunk(batch, lane, ilane);
+	return chunk->ERROR[ilane];
+}
+
+// ---- execution
+
+// the lane stops at the instruction of step like Chip8_execute_interpreter stops at the instruction that faults
+static void Chip8_batch_fault(Chip8_Batch_Chunk* chunk, int ilane, Chip8::ERROR_TYPE error, int step, u64& running){
+	chunk->ERROR[ilane] = error;
+	chunk->CYCLE[ilane] += (u64)step;
+	running &= ~((u64)1u << ilane);
+}
+
+// Chip8_draw_sprite<Chip8::CHIP8> on the SCREEN of the lane
+static void Chip8_batch_draw_sprite(Chip8_Batch_Chunk* chunk, int ilane, u16 I, u8 x, u8 y, short n){
+	const u8* src = chunk->memory[ilane] + I;
+	u64* SCREEN = chunk->SCREEN[ilane];
+
+	int collision_rows = 0;
+	u64 dirty = 0u;
+	int row = y & 31;
+	for (int iy = 0; iy != n; ++iy){
+		u64 sprite_row = Chip8_rotate_right((u64)src[iy] << 56u, x & 63u);
+		collision_rows += (SCREEN[row] & sprite_row) != 0u;
+		SCREEN[row] ^= sprite_row;
+		dirty |= (u64)(sprite_row != 0u) << row;
+
+		if (++row == 32) row = 0;
+	}
+
+	if (dirty){
+		chunk->SCREEN_DIRTY[ilane] |= dirty;
+		++chunk->SCREEN_GENERATION[ilane];
+	}
+	chunk->V[0xF][ilane] = collision_rows != 0;
+}
+
+// the other micro-ops lane by lane ; the faults leave PC after the instruction like Chip8_execute_interpreter
+template<typename Variant>
+static void Chip8_batch_execute_lanes(Chip8_Batch* batch, Chip8_Batch_Chunk* chunk, u64 group, const Chip8_Op& op, u16 PC, int step, u64& running){
+	u16 (*V)[Chip8_batch_chunk_lanes] = chunk->V;
+	u16 next_PC = PC + 2u;
+
+	for (int offset = 0; offset != Chip8_batch_chunk_lanes; offset += Chip8_lanes_width){
+		u32 bits = (u32)((group >> offset) & Chip8_batch_vector_lanes);
+		if (bits) Chip8_lanes_store(chunk->PC + offset, Chip8_lanes_from_bits(bits), Chip8_lanes_set(next_PC));
+	}
+
+	// the lanes of a group usually share CYCLE and the ticks of the timers
+	u64 ticks_cycle = UINT64_MAX;
+	u64 ticks = 0u;
+
+	switch (op.type){
+	case Chip8_Op::CLS:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u64 dirty = 0u;
+			for (int iy = 0; iy != 32; ++iy)
+				dirty |= (u64)(chunk->SCREEN[ilane][iy] != 0u) << iy;
+			memset(chunk->SCREEN[ilane], 0x00, sizeof(Chip8_Batch_Chunk::SCREEN[0]));
+
+			if (dirty){
+				chunk->SCREEN_DIRTY[ilane] |= dirty;
+				++chunk->SCREEN_GENERATION[ilane];
+			}
+		}
+		break;
+	case Chip8_Op::RET:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16& SP = chunk->SP[ilane];
+			if (SP == 0){
+				Chip8_batch_fault(chunk, ilane, Chip8::SP_INCORRECT, step, running);
+				continue;
+			}
+			--SP;
+			chunk->PC[ilane] = chunk->STACK[SP][ilane];
+		}
+		break;
+	case Chip8_Op::CALL_ADDR:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16& SP = chunk->SP[ilane];
+			Chip8::ERROR_TYPE error = Chip8::NONE;
+			if (SP == carray_size(Chip8::STACK)) error = Chip8::SP_INCORRECT;
+			if (!Chip8_is_valid_memory(op.nnn, 2u, Chip8_batch_reserved_start, Chip8_batch_memory_size)) error = Chip8::MEMORY_OUT_OF_BOUNDS;
+			if (error){
+				Chip8_batch_fault(chunk, ilane, error, step, running);
+				continue;
+			}
+			chunk->STACK[SP++][ilane] = next_PC;
+			chunk->PC[ilane] = op.nnn;
+		}
+		break;
+	case Chip8_Op::JP_V0_ADDR:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16 target = op.nnn + V[Variant::quirks.jump_vx ? op.x : 0][ilane];
+			if (!Chip8_is_valid_memory(target, 2u, Chip8_batch_reserved_start, Chip8_batch_memory_size)){
+				Chip8_batch_fault(chunk, ilane, Chip8::MEMORY_OUT_OF_BOUNDS, step, running);
+				continue;
+			}
+			chunk->PC[ilane] = target;
+		}
+		break;
+	case Chip8_Op::RND_VX_BYTE:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+			V[op.x][ilane] = (u8)random_char(chunk->RANDOM[ilane]) & op.kk;
+		}
+		break;
+	case Chip8_Op::DRW_VX_VY_N:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u8 x = (u8)V[op.x][ilane];
+			u8 y = (u8)V[op.y][ilane];
+			u16 I = chunk->I[ilane];
+
+			Chip8::ERROR_TYPE error = Chip8::NONE;
+			if (x >= 64 || y >= 32) error = Chip8::SCREEN_COORD_INCORRECT;
+			if (!Chip8_is_valid_memory(I, op.n, Chip8_batch_reserved_start, Chip8_batch_memory_size)) error = Chip8::MEMORY_OUT_OF_BOUNDS;
+			if (error){
+				Chip8_batch_fault(chunk, ilane, error, step, running);
+				continue;
+			}
+			Chip8_batch_draw_sprite(chunk, ilane, I, x, y, op.n);
+		}
+		break;
+	case Chip8_Op::SKP_VX:
+	case Chip8_Op::SKNP_VX:
+	{
+		u16 skip_pressed = op.type == Chip8_Op::SKP_VX;
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16 key = V[op.x][ilane];
+			if (key >= carray_size(Chip8::KEYBOARD)){
+				Chip8_batch_fault(chunk, ilane, Chip8::KEY_UNKNOWN, step, running);
+				continue;
+			}
+			if (((chunk->KEYBOARD[ilane] >> key) & 1u) == skip_pressed) chunk->PC[ilane] += op.skip;
+		}
+		break;
+	}
+	case Chip8_Op::LD_VX_DT:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u64 cycle = chunk->CYCLE[ilane] + (u64)step;
+			if (cycle != ticks_cycle){
+				ticks_cycle = cycle;
+				ticks = Chip8_timer_ticks(cycle, batch->timer_per_second, batch->instructions_per_second);
+			}
+			u8 DT = chunk->DT[ilane];
+			u64 elapsed = ticks - chunk->DT_TICK[ilane];
+			V[op.x][ilane] = elapsed < DT ? DT - (u8)elapsed : 0u;
+		}
+		break;
+	case Chip8_Op::LD_VX_K:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16 released = chunk->LAST_KEYBOARD[ilane] & ~chunk->KEYBOARD[ilane];
+			if (released)
+				V[op.x][ilane] = (u16)Chip8_batch_first_lane(released);
+			else
+				chunk->PC[ilane] = PC; // rewind the instruction to wait
+		}
+		break;
+	case Chip8_Op::LD_DT_VX:
+	case Chip8_Op::LD_ST_VX:
+	{
+		u8* timer = op.type == Chip8_Op::LD_DT_VX ? chunk->DT : chunk->ST;
+		u64* timer_tick = op.type == Chip8_Op::LD_DT_VX ? chunk->DT_TICK : chunk->ST_TICK;
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u64 cycle = chunk->CYCLE[ilane] + (u64)step;
+			if (cycle != ticks_cycle){
+				ticks_cycle = cycle;
+				ticks = Chip8_timer_ticks(cycle, batch->timer_per_second, batch->instructions_per_second);
+			}
+			timer[ilane] = (u8)V[op.x][ilane];
+			timer_tick[ilane] = ticks;
+		}
+		break;
+	}
+	case Chip8_Op::LD_B_VX:
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16 I = chunk->I[ilane];
+			if (!Chip8_is_valid_memory(I, 3u, Chip8_batch_reserved_start, Chip8_batch_memory_size)){
+				Chip8_batch_fault(chunk, ilane, Chip8::MEMORY_OUT_OF_BOUNDS, step, running);
+				continue;
+			}
+			u8* memory = chunk->memory[ilane];
+			u8 byte = (u8)V[op.x][ilane];
+			memory[I] = byte / 100;
+			memory[I + 1] = (byte % 100) / 10;
+			memory[I + 2] = byte % 10;
+			Chip8_batch_set_written(chunk, I, 3u);
+		}
+		break;
+	case Chip8_Op::LD_MEM_VX:
+	case Chip8_Op::LD_VX_MEM:
+	{
+		u16 regcount = op.x + 1u;
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			int ilane = Chip8_batch_first_lane(lanes);
+
+			u16& I = chunk->I[ilane];
+			if (!Chip8_is_valid_memory(I, regcount, Chip8_batch_reserved_start, Chip8_batch_memory_size)){
+				Chip8_batch_fault(chunk, ilane, Chip8::MEMORY_OUT_OF_BOUNDS, step, running);
+				continue;
+			}
+			u8* memory = chunk->memory[ilane] + I;
+			if (op.type == Chip8_Op::LD_MEM_VX){
+				for (u16 ireg = 0; ireg != regcount; ++ireg)
+					memory[ireg] = (u8)V[ireg][ilane];
+				Chip8_batch_set_written(chunk, I, regcount);
+			}
+			else{
+				for (u16 ireg = 0; ireg != regcount; ++ireg)
+					V[ireg][ilane] = memory[ireg];
+			}
+
+			if constexpr (Variant::quirks.load_store == Chip8_Quirks::I_PLUS_X_PLUS_1) I += regcount;
+			else if constexpr (Variant::quirks.load_store == Chip8_Quirks::I_PLUS_X) I += regcount - 1u;
+		}
+		break;
+	}
+	default:
+		// UNKNOWN and the JP_ADDR outside of memory
+		for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+			Chip8::ERROR_TYPE error = op.type == Chip8_Op::JP_ADDR ? Chip8::MEMORY_OUT_OF_BOUNDS : Chip8::INSTRUCTION_UNKNOWN;
+			Chip8_batch_fault(chunk, Chip8_batch_first_lane(lanes), error, step, running);
+		}
+		break;
+	}
+}
+
+// the micro-ops of Chip8_batch_is_vector_op in every lane of the group at once
+template<typename Variant>
+static void Chip8_batch_execute_vector(Chip8_Batch_Chunk* chunk, u64 group, const Chip8_Op& op, u16 PC){
+	const Chip8_Lanes one = Chip8_lanes_set(1u);
+	const Chip8_Lanes byte = Chip8_lanes_set(0xFFu);
+	const Chip8_Lanes skip = Chip8_lanes_set(op.skip);
+	const Chip8_Lanes next_PC = Chip8_lanes_set(PC + 2u);
+
+	for (int offset = 0; offset != Chip8_batch_chunk_lanes; offset += Chip8_lanes_width){
+		u32 bits = (u32)((group >> offset) & Chip8_batch_vector_lanes);
+		if (!bits) continue;
+
+		Chip8_Lanes mask = Chip8_lanes_from_bits(bits);
+		u16* Vx = chunk->V[op.x] + offset;
+		u16* Vy = chunk->V[op.y] + offset;
+		u16* VF = chunk->V[0xF] + offset;
+		u16* I = chunk->I + offset;
+
+		// registers are loaded again after VF is written since x or y can be F
+		Chip8_Lanes PC_lanes = next_PC;
+		switch (op.type){
+		case Chip8_Op::JP_ADDR:
+			PC_lanes = Chip8_lanes_set(op.nnn);
+			break;
+		case Chip8_Op::SE_VX_BYTE:
+			PC_lanes = Chip8_lanes_add(next_PC, Chip8_lanes_and(Chip8_lanes_equal(Chip8_lanes_load(Vx), Chip8_lanes_set(op.kk)), skip));
+			break;
+		case Chip8_Op::SNE_VX_BYTE:
+			PC_lanes = Chip8_lanes_add(next_PC, Chip8_lanes_andnot(Chip8_lanes_equal(Chip8_lanes_load(Vx), Chip8_lanes_set(op.kk)), skip));
+			break;
+		case Chip8_Op::SE_VX_VY:
+			PC_lanes = Chip8_lanes_add(next_PC, Chip8_lanes_and(Chip8_lanes_equal(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)), skip));
+			break;
+		case Chip8_Op::SNE_VX_VY:
+			PC_lanes = Chip8_lanes_add(next_PC, Chip8_lanes_andnot(Chip8_lanes_equal(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)), skip));
+			break;
+		case Chip8_Op::LD_VX_BYTE:
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_set(op.kk));
+			break;
+		case Chip8_Op::ADD_VX_BYTE:
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_and(Chip8_lanes_add(Chip8_lanes_load(Vx), Chip8_lanes_set(op.kk)), byte));
+			break;
+		case Chip8_Op::LD_VX_VY:
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_load(Vy));
+			break;
+		case Chip8_Op::OR_VX_VY:
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_or(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)));
+			if constexpr (Variant::quirks.vf_reset) Chip8_lanes_store(VF, mask, Chip8_lanes_set(0u));
+			break;
+		case Chip8_Op::AND_VX_VY:
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_and(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)));
+			if constexpr (Variant::quirks.vf_reset) Chip8_lanes_store(VF, mask, Chip8_lanes_set(0u));
+			break;
+		case Chip8_Op::XOR_VX_VY:
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_xor(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)));
+			if constexpr (Variant::quirks.vf_reset) Chip8_lanes_store(VF, mask, Chip8_lanes_set(0u));
+			break;
+		case Chip8_Op::ADD_VX_VY:
+		{
+			Chip8_Lanes sum = Chip8_lanes_add(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy));
+			Chip8_lanes_store(VF, mask, Chip8_lanes_shift_right(sum, 8));
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_and(sum, byte));
+			break;
+		}
+		case Chip8_Op::SUB_VX_VY:
+			Chip8_lanes_store(VF, mask, Chip8_lanes_and(Chip8_lanes_greater(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)), one));
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_and(Chip8_lanes_sub(Chip8_lanes_load(Vx), Chip8_lanes_load(Vy)), byte));
+			break;
+		case Chip8_Op::SUBN_VX_VY:
+			Chip8_lanes_store(VF, mask, Chip8_lanes_and(Chip8_lanes_greater(Chip8_lanes_load(Vy), Chip8_lanes_load(Vx)), one));
+			Chip8_lanes_store(Vx, mask, Chip8_lanes_and(Chip8_lanes_sub(Chip8_lanes_load(Vy), Chip8_lanes_load(Vx)), byte));
+			break;
+		case Chip8_Op::SHR_VX:
+			if constexpr (Variant::quirks.shift_vy){
+				Chip8_Lanes value = Chip8_lanes_load(Vy);
+				Chip8_lanes_store(VF, mask, Chip8_lanes_and(value, one));
+				Chip8_lanes_store(Vx, mask, Chip8_lanes_shift_right(value, 1));
+			}
+			else{
+				Chip8_lanes_store(VF, mask, Chip8_lanes_and(Chip8_lanes_load(Vx), one));
+				Chip8_lanes_store(Vx, mask, Chip8_lanes_shift_right(Chip8_lanes_load(Vx), 1));
+			}
+			break;
+		case Chip8_Op::SHL_VX:
+			if constexpr (Variant::quirks.shift_vy){
+				Chip8_Lanes value = Chip8_lanes_load(Vy);
+				Chip8_lanes_store(VF, mask, Chip8_lanes_shift_right(value, 7));
+				Chip8_lanes_store(Vx, mask, Chip8_lanes_and(Chip8_lanes_shift_left(value, 1), byte));
+			}
+			else{
+				Chip8_lanes_store(VF, mask, Chip8_lanes_shift_right(Chip8_lanes_load(Vx), 7));
+				Chip8_lanes_store(Vx, mask, Chip8_lanes_and(Chip8_lanes_shift_left(Chip8_lanes_load(Vx), 1), byte));
+			}
+			break;
+		case Chip8_Op::LD_I_ADDR:
+			Chip8_lanes_store(I, mask, Chip8_lanes_set(op.nnn));
+			break;
+		case Chip8_Op::ADD_I_VX:
+			Chip8_lanes_store(I, mask, Chip8_lanes_add(Chip8_lanes_load(I), Chip8_lanes_load(Vx)));
+			break;
+		case Chip8_Op::LD_F_VX:
+		{
+			Chip8_Lanes digit = Chip8_lanes_and(Chip8_lanes_load(Vx), Chip8_lanes_set(0x0Fu));
+			Chip8_lanes_store(I, mask, Chip8_lanes_add(Chip8_lanes_shift_left(digit, 2), digit));
+			break;
+		}
+		default:
+			ram_assert_msg(false, "not a vector micro-op");
+			break;
+		}
+
+		Chip8_lanes_store(chunk->PC + offset, mask, PC_lanes);
+	}
+}
+
+static int Chip8_batch_is_vector_op(const Chip8_Op& op){
+	switch (op.type){
+	case Chip8_Op::JP_ADDR:
+		// the lanes fault one by one otherwise
+		return Chip8_is_valid_memory(op.nnn, 1u, Chip8_batch_reserved_start, Chip8_batch_memory_size);
+	case Chip8_Op::SE_VX_BYTE:
+	case Chip8_Op::SNE_VX_BYTE:
+	case Chip8_Op::SE_VX_VY:
+	case Chip8_Op::SNE_VX_VY:
+	case Chip8_Op::LD_VX_BYTE:
+	case Chip8_Op::ADD_VX_BYTE:
+	case Chip8_Op::LD_VX_VY:
+	case Chip8_Op::OR_VX_VY:
+	case Chip8_Op::AND_VX_VY:
+	case Chip8_Op::XOR_VX_VY:
+	case Chip8_Op::ADD_VX_VY:
+	case Chip8_Op::SUB_VX_VY:
+	case Chip8_Op::SUBN_VX_VY:
+	case Chip8_Op::SHR_VX:
+	case Chip8_Op::SHL_VX:
+	case Chip8_Op::LD_I_ADDR:
+	case Chip8_Op::ADD_I_VX:
+	case Chip8_Op::LD_F_VX:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// the micro-op at PC for the lanes fetching from Chip8_Batch::image
+static Chip8_Op Chip8_batch_decode(Chip8_Batch* batch, u16 PC){
+	Chip8_Op& op = batch->DECODE[PC];
+	if (op.type == Chip8_Op::UNDECODED) op = Chip8_decode(Chip8_batch_fetch(batch->image, PC), Chip8::CHIP8);
+	return op;
+}
+
+// LAST_KEYBOARD is KEYBOARD after every instruction that does not fault
+static void Chip8_batch_update_last_keyboard(Chip8_Batch_Chunk* chunk, u64 lanes){
+	for (int offset = 0; offset != Chip8_batch_chunk_lanes; offset += Chip8_lanes_width){
+		u32 bits = (u32)((lanes >> offset) & Chip8_batch_vector_lanes);
+		if (bits) Chip8_lanes_store(chunk->LAST_KEYBOARD + offset, Chip8_lanes_from_bits(bits), Chip8_lanes_load(chunk->KEYBOARD + offset));
+	}
+}
+
+template<typename Variant>
+static void Chip8_batch_execute(Chip8_Batch* batch, Chip8_Batch_Chunk* chunk, int instruction_count){
+	u64 running = 0u;
+	for (int ilane = 0; ilane != Chip8_batch_chunk_lanes; ++ilane)
+		running |= (u64)(chunk->ERROR[ilane] == Chip8::NONE) << ilane;
+	running &= chunk->lanes;
+
+	for (int step = 0; step != instruction_count && running; ++step){
+		u64 pending = running;
+		while (pending){
+			int leader = Chip8_batch_first_lane(pending);
+			u16 PC = chunk->PC[leader];
+			u64 group = pending & Chip8_batch_equal_lanes(chunk->PC, PC);
+
+			if (!Chip8_is_valid_memory(PC, 2u, Chip8_batch_reserved_start, Chip8_batch_memory_size)){
+				for (u64 lanes = group; lanes; lanes &= lanes - 1u)
+					Chip8_batch_fault(chunk, Chip8_batch_first_lane(lanes), Chip8::MEMORY_OUT_OF_BOUNDS, step, running);
+				pending &= ~group;
+				continue;
+			}
+
+			Chip8_Op op;
+			if (Chip8_batch_is_written(chunk, PC) | Chip8_batch_is_written(chunk, PC + 1u)){
+				// the lanes with another instruction at PC are left for the next groups
+				u16 instruction = Chip8_batch_fetch(chunk->memory[leader], PC);
+				for (u64 lanes = group; lanes; lanes &= lanes - 1u){
+					int ilane = Chip8_batch_first_lane(lanes);
+					if (Chip8_batch_fetch(chunk->memory[ilane], PC) != instruction) group &= ~((u64)1u << ilane);
+				}
+				op = Chip8_decode(instruction, Chip8::CHIP8);
+			}
+			else{
+				op = Chip8_batch_decode(batch, PC);
+			}
+			pending &= ~group;
+
+			if (Chip8_batch_is_vector_op(op)){
+				Chip8_batch_execute_vector<Variant>(chunk, group, op, PC);
+			}
+			else{
+				Chip8_batch_execute_lanes<Variant>(batch, chunk, group, op, PC, step, running);
+			}
+
+			if (chunk->keyboard_changed) Chip8_batch_update_last_keyboard(chunk, group & running);
+		}
+
+		// every lane still running executed an instruction with its KEYBOARD
+		chunk->keyboard_changed = false;
+	}
+
+	for (int ilane = 0; ilane != Chip8_batch_chunk_lanes; ++ilane)
+		if ((running >> ilane) & 1u) chunk->CYCLE[ilane] += (u64)instruction_count;
+}
+
+void Chip8_batch_step(Chip8_Batch* batch, float dtime_sec){
+	dtime_sec *= batch->emulation_speed;
+
+	batch->instruction_accumulator += (float)batch->instructions_per_second * dtime_sec;
+	int instruction_count = (int)floorf(batch->instruction_accumulator);
+	batch->instruction_accumulator -= (float)instruction_count;
+
+	Chip8_batch_run(batch, instruction_count);
+}
+
+void Chip8_batch_run(Chip8_Batch* batch, int instruction_count){
+	typedef void (*Chip8_Batch_Execute)(Chip8_Batch* batch, Chip8_Batch_Chunk* chunk, int instruction_count);
+	static constexpr Chip8_Batch_Execute variants[Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_ROW(Chip8_batch_execute, Chip8::CHIP8);
+
+	for (u32 ichunk = 0; ichunk != batch->chunk_count; ++ichunk)
+		variants[batch->QUIRKS](batch, &batch->chunks[ichunk], instruction_count);
+}
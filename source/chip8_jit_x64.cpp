@@ -0,0 +1,1057 @@
+#include "chip8.h"
+
+// Basic block recompiler for x86-64 Linux
+//
+// * a block starts at Chip8::PC and ends on a jump, an instruction left to Chip8_execute_decoded or when the registers it
+//   uses do not fit in the host register pool ; a jump skipped by the instruction before it does not end the block
+// * V0 - VF are loaded in host registers when a block is entered and the written ones are stored back on exit and around helper calls
+// * SE, SNE, SKP and SKNP branch over the next instruction inside the block
+// * CALL, RET, DRW, RND and the timer and memory instructions call C helpers ; the SUPER-CHIP instructions that do not
+//   jump call Chip8_execute_decoded for one instruction ; a helper leaves the block when the instruction faults so that
+//   Chip8_execute_decoded raises the ERROR
+// * RET jumps to the block of its target through block_entry
+// * LD Vx, K, JP V0, EXIT, JP to itself and the instructions that always fault are executed by Chip8_execute_decoded_to_jump
+//   from the dispatcher so that the idle waits still retire the rest of the step
+// * blocks exit through stubs that are patched into direct jumps once the target block is translated
+// * LD B, Vx and LD [I], Vx writes reach Chip8_jit_invalidate through Chip8_invalidate_decode ; the translation cache is flushed
+//   when they overlap translated code and the block is left after the write
+// * XOCHIP is executed by Chip8_execute_decoded ; its skips depend on the next instruction and its memory is larger than the 4 KB maps
+// * the quirks are read when translating ; the translation cache assumes Chip8::QUIRKS does not change once the ROM runs
+//
+// Translated blocks are listed in /tmp/perf-PID.map for perf with CHIP8_JIT_PERF_MAP ; opening the map costs more than a short run
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// REF: https://www.felixcloutier.com/x86/ [x86 and amd64 instruction reference]
+// REF: https://github.com/torvalds/linux/blob/master/tools/perf/Documentation/jit-interface.txt [perf JIT interface]
+// REF: https://gitlab.com/x86-psABIs/x86-64-ABI [System V AMD64 ABI]
+
+enum X64_Register{
+	RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// host registers holding Chip8 registers inside a block ; the ones preserved by the helper calls come first
+// RBX holds the Chip8 pointer ; RBP holds the remaining instruction budget ; RAX, RCX, RDX are scratch
+static constexpr X64_Register g_jit_register_pool[] = { R12, R13, R14, R15, RSI, RDI, R8, R9, R10, R11 };
+
+static int X64_is_callee_saved(int reg){
+	return reg == RBX || reg == RBP || reg >= R12;
+}
+
+struct Chip8_Jit_Context{
+	s64 budget;
+	// Chip8::CYCLE once the budget is spent ; the helpers set Chip8::CYCLE from it
+	u64 end_cycle;
+	u8* patch_site;
+};
+
+struct Chip8_Jit{
+	enum EXIT_TYPE : u32{
+		EXIT_BUDGET = 1,	// PC is the start of a block longer than the budget
+		EXIT_CHAIN,			// PC is the target of the exit stub at patch_site
+		EXIT_LOOKUP,		// PC is the target of RET without a block yet or follows a write that flushed the translation cache
+		EXIT_INTERPRET,		// PC is an instruction counted by its block that faults ; left to Chip8_execute_decoded to raise the ERROR
+	};
+
+	static constexpr size_t code_capacity = Megabytes(4);
+	static constexpr size_t block_size_max = Kilobytes(16);
+	static constexpr int block_instruction_max = 32;
+	// lookups of an adress without a block before it is translated ; code that runs once is left to Chip8_execute_decoded_to_jump
+	static constexpr u8 translate_threshold = 64;
+
+	Chip8_Jit_Context context;
+
+	u32 (*enter)(Chip8* chip8, void* entry, Chip8_Jit_Context* context);
+	u8* epilogue;
+
+	u8* code;
+	size_t code_size;
+	size_t code_reset_size;
+
+	u8* block_entry[4096];
+	// instructions of the block at each entry ; the budget check of the block needs as many
+	u8 block_length[4096];
+
+	// bytes and 256-byte pages covered by translated instructions
+	u8 code_byte[4096];
+	u8 code_page[16];
+
+	// adresses where Chip8_jit_translate found no instruction to translate ; they are covered by code_byte like a block
+	u8 no_block[4096];
+
+	u8 lookup_count[4096];
+
+	// incremented on every flush ; exit stubs from older generations must not be patched
+	u32 generation;
+
+	FILE* perf_map;
+};
+
+// ---- helpers
+//
+// called by the translated code with the registers stored in Chip8::registers
+// remaining is the instruction_count of Chip8_execute_decoded at the instruction at PC: the instructions of the step left including it
+// a helper returns 0 to continue in the block or an EXIT_TYPE after setting Chip8::PC ; the LD Vx, DT helpers return
+// the instructions they retired without executing them instead
+
+typedef s64 (*Chip8_Jit_Helper)(Chip8* chip8, Chip8_Op op, u16 PC, s64 remaining);
+
+static void Chip8_jit_sync_cycle(Chip8* chip8, s64 remaining){
+	chip8->CYCLE = chip8->JIT_CACHE->context.end_cycle - (u64)remaining;
+}
+
+static s64 Chip8_jit_interpret(Chip8* chip8, u16 PC){
+	chip8->PC = PC;
+	return Chip8_Jit::EXIT_INTERPRET;
+}
+
+// Chip8_load_store_I of Chip8::QUIRKS
+static void Chip8_jit_load_store_I(Chip8* chip8, u16 regcount){
+	Chip8_Quirks::LOAD_STORE_TYPE load_store = Chip8_quirk_sets[chip8->QUIRKS].load_store;
+	if (load_store == Chip8_Quirks::I_PLUS_X_PLUS_1) chip8->I += regcount;
+	else if (load_store == Chip8_Quirks::I_PLUS_X) chip8->I += regcount - 1u;
+}
+
+// the block is left after a write that flushed the translation cache since the rest of its code may have been overwritten
+static s64 Chip8_jit_written(Chip8* chip8, u16 adress, u16 size, u16 PC){
+	u32 generation = chip8->JIT_CACHE->generation;
+	Chip8_invalidate_decode(chip8, adress, size);
+	if (chip8->JIT_CACHE->generation == generation) return 0;
+
+	chip8->PC = PC + 2;
+	return Chip8_Jit::EXIT_LOOKUP;
+}
+
+static s64 Chip8_jit_CALL(Chip8* chip8, Chip8_Op, u16 PC, s64){
+	if (chip8->SP == carray_size(Chip8::STACK)) return Chip8_jit_interpret(chip8, PC);
+
+	chip8->STACK[chip8->SP++] = PC + 2;
+	return 0;
+}
+
+static s64 Chip8_jit_RET(Chip8* chip8, Chip8_Op, u16 PC, s64){
+	if (chip8->SP == 0) return Chip8_jit_interpret(chip8, PC);
+
+	--chip8->SP;
+	chip8->PC = chip8->STACK[chip8->SP];
+	return 0;
+}
+
+template<Chip8::MACHINE_TYPE machine>
+static s64 Chip8_jit_DRW(Chip8* chip8, Chip8_Op op, u16 PC, s64){
+	u8 x = chip8->registers.by_index[op.x];
+	u8 y = chip8->registers.by_index[op.y];
+	if (!Chip8_is_valid_screen_coord<machine>(chip8, x, y) | (op.n >= Chip8_screen_height<machine>(chip8)) | !Chip8_is_valid_memory(chip8, chip8->I, Chip8_sprite_size(chip8, op.n)))
+		return Chip8_jit_interpret(chip8, PC);
+
+	Chip8_draw_sprite<machine>(chip8, x, y, op.n);
+	return 0;
+}
+
+static s64 Chip8_jit_RND(Chip8* chip8, Chip8_Op op, u16, s64){
+	u8 random_byte = random_char(chip8->RANDOM);
+	chip8->registers.by_index[op.x] = random_byte & op.kk;
+	return 0;
+}
+
+static s64 Chip8_jit_LD_VX_DT(Chip8* chip8, Chip8_Op op, u16, s64 remaining){
+	Chip8_jit_sync_cycle(chip8, remaining);
+	chip8->registers.by_index[op.x] = Chip8_get_DT(chip8);
+	return 0;
+}
+
+// LD Vx, DT of a DT wait loop ; the SE Vx, 0 and JP of the loop are the last instructions of the block and keep their budget
+static s64 Chip8_jit_LD_VX_DT_wait(Chip8* chip8, Chip8_Op op, u16, s64 remaining){
+	Chip8_jit_sync_cycle(chip8, remaining);
+	chip8->registers.by_index[op.x] = Chip8_get_DT(chip8);
+
+	int instruction_count = (int)remaining - 2;
+	int skipped_count = instruction_count;
+	Chip8_skip_DT_wait_loop(chip8, op.x, instruction_count);
+	return skipped_count - instruction_count;
+}
+
+static s64 Chip8_jit_LD_DT_VX(Chip8* chip8, Chip8_Op op, u16, s64 remaining){
+	Chip8_jit_sync_cycle(chip8, remaining);
+	Chip8_set_DT(chip8, chip8->registers.by_index[op.x]);
+	return 0;
+}
+
+static s64 Chip8_jit_LD_ST_VX(Chip8* chip8, Chip8_Op op, u16, s64 remaining){
+	Chip8_jit_sync_cycle(chip8, remaining);
+	Chip8_set_ST(chip8, chip8->registers.by_index[op.x]);
+	return 0;
+}
+
+static s64 Chip8_jit_LD_B_VX(Chip8* chip8, Chip8_Op op, u16 PC, s64){
+	if (!Chip8_is_valid_memory(chip8, chip8->I, 3)) return Chip8_jit_interpret(chip8, PC);
+
+	u8 byte = chip8->registers.by_index[op.x];
+	u8* memptr = Chip8_get_memory(chip8, chip8->I);
+
+	memptr[0] = byte / 100;
+	memptr[1] = (byte % 100) / 10;
+	memptr[2] = (byte % 10);
+
+	return Chip8_jit_written(chip8, chip8->I, 3, PC);
+}
+
+static s64 Chip8_jit_LD_MEM_VX(Chip8* chip8, Chip8_Op op, u16 PC, s64){
+	u16 regcount = op.x + 1;
+	if (!Chip8_is_valid_memory(chip8, chip8->I, regcount)) return Chip8_jit_interpret(chip8, PC);
+
+	memcpy(Chip8_get_memory(chip8, chip8->I), chip8->registers.by_index, regcount);
+
+	s64 exit_type = Chip8_jit_written(chip8, chip8->I, regcount, PC);
+	Chip8_jit_load_store_I(chip8, regcount);
+	return exit_type;
+}
+
+static s64 Chip8_jit_LD_VX_MEM(Chip8* chip8, Chip8_Op op, u16 PC, s64){
+	u16 regcount = op.x + 1;
+	if (!Chip8_is_valid_memory(chip8, chip8->I, regcount)) return Chip8_jit_interpret(chip8, PC);
+
+	memcpy(chip8->registers.by_index, Chip8_get_memory(chip8, chip8->I), regcount);
+	Chip8_jit_load_store_I(chip8, regcount);
+	return 0;
+}
+
+// instructions that do not jump nor write memory and are rare enough to be dispatched again
+static s64 Chip8_jit_execute_decoded(Chip8* chip8, Chip8_Op, u16 PC, s64 remaining){
+	Chip8_jit_sync_cycle(chip8, remaining);
+	chip8->PC = PC;
+	Chip8_execute_decoded(chip8, 1);
+
+	// the ERROR is already raised and the instruction was not retired
+	if (chip8->ERROR) return Chip8_Jit::EXIT_INTERPRET;
+	return 0;
+}
+
+// ---- emitter
+
+struct X64_Emitter{
+	void byte(u8 value){ code[size++] = value; }
+	void word(u16 value){ memcpy(code + size, &value, sizeof(value)); size += sizeof(value); }
+	void dword(u32 value){ memcpy(code + size, &value, sizeof(value)); size += sizeof(value); }
+	void qword(u64 value){ memcpy(code + size, &value, sizeof(value)); size += sizeof(value); }
+
+	// REX prefix ; forced when an 8-bit register among SPL, BPL, SIL, DIL is used
+	void rex(int w, int reg, int rm, int force_byte_register = false){
+		u8 prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+		if (prefix != 0x40 || force_byte_register) byte(prefix);
+	}
+	void modrm_register(int reg, int rm){ byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+	void modrm_rbx_disp32(int reg, s32 disp){ byte(0x80 | ((reg & 7) << 3) | RBX); dword((u32)disp); }
+
+	// op r32, r32 with opcode in [ADD 0x01 ; OR 0x09 ; AND 0x21 ; SUB 0x29 ; XOR 0x31 ; CMP 0x39 ; TEST 0x85 ; MOV 0x89]
+	void alu_rr(u8 opcode, int dst, int src){ rex(0, src, dst); byte(opcode); modrm_register(src, dst); }
+	void alu_rr64(u8 opcode, int dst, int src){ rex(1, src, dst); byte(opcode); modrm_register(src, dst); }
+	// op r32, imm32 with extension in [ADD 0 ; AND 4 ; CMP 7]
+	void alu_ri(u8 extension, int dst, u32 imm){ rex(0, 0, dst); byte(0x81); modrm_register(extension, dst); dword(imm); }
+
+	void mov_ri(int dst, u32 imm){ rex(0, 0, dst); byte(0xB8 + (dst & 7)); dword(imm); }
+	void mov_ri64(int dst, u64 imm){ rex(1, 0, dst); byte(0xB8 + (dst & 7)); qword(imm); }
+	void shr_ri(int dst, u8 imm){ rex(0, 0, dst); byte(0xC1); modrm_register(5, dst); byte(imm); }
+	void movzx_r32_r8(int dst, int src){ rex(0, dst, src, src >= RSP && src <= RDI); byte(0x0F); byte(0xB6); modrm_register(dst, src); }
+
+	// lea r64, [rbp + disp32] ; also adds to the budget without changing the flags
+	void lea_rbp(int dst, s32 disp){ rex(1, dst, RBP); byte(0x8D); byte(0x80 | ((dst & 7) << 3) | RBP); dword((u32)disp); }
+
+	void movzx_r32_m8(int dst, s32 disp){ rex(0, dst, 0); byte(0x0F); byte(0xB6); modrm_rbx_disp32(dst, disp); }
+	void mov_m8_r8(s32 disp, int src){ rex(0, src, 0, src >= RSP && src <= RDI); byte(0x88); modrm_rbx_disp32(src, disp); }
+	// cmp byte [rbx + index + disp32], imm8
+	void cmp_m8_indexed_imm8(int index, s32 disp, u8 imm){ rex(0, 0, 0); if (index >= R8) byte(0x42); byte(0x80); byte(0xBC); byte(((index & 7) << 3) | RBX); dword((u32)disp); byte(imm); }
+
+	void movzx_eax_m16(s32 disp){ byte(0x0F); byte(0xB7); modrm_rbx_disp32(RAX, disp); }
+	void mov_m16_ax(s32 disp){ byte(0x66); byte(0x89); modrm_rbx_disp32(RAX, disp); }
+	void mov_m16_imm16(s32 disp, u16 imm){ byte(0x66); byte(0xC7); modrm_rbx_disp32(0, disp); word(imm); }
+
+	void seta_cl(){ byte(0x0F); byte(0x97); byte(0xC1); }
+
+	void call_r(int target){ rex(0, 0, target); byte(0xFF); modrm_register(2, target); }
+	void jmp_r(int target){ rex(0, 0, target); byte(0xFF); modrm_register(4, target); }
+
+	// returns the offset of rel32 for patching
+	size_t jcc_rel32(u8 condition){ byte(0x0F); byte(0x80 | condition); dword(0); return size - 4; }
+	size_t jmp_rel32(){ byte(0xE9); dword(0); return size - 4; }
+	void patch_rel32(size_t offset, u8* target){ s32 rel = (s32)(target - (code + offset + 4)); memcpy(code + offset, &rel, sizeof(rel)); }
+
+	u8* code;
+	size_t size;
+};
+
+static constexpr u8 X64_CONDITION_AE = 0x3;
+static constexpr u8 X64_CONDITION_E = 0x4;
+static constexpr u8 X64_CONDITION_NE = 0x5;
+static constexpr u8 X64_CONDITION_L = 0xC;
+
+static constexpr s32 g_jit_V_offset = (s32)offsetof(Chip8, registers);
+static constexpr s32 g_jit_I_offset = (s32)offsetof(Chip8, I);
+static constexpr s32 g_jit_PC_offset = (s32)offsetof(Chip8, PC);
+static constexpr s32 g_jit_KEYBOARD_offset = (s32)offsetof(Chip8, KEYBOARD);
+
+// ---- translation
+
+static void Chip8_jit_create_trampoline(Chip8_Jit* jit){
+	X64_Emitter emitter;
+	emitter.code = jit->code;
+	emitter.size = 0;
+
+	// u32 enter(Chip8* chip8 [RDI], void* entry [RSI], Chip8_Jit_Context* context [RDX])
+	// RSP is 16-byte aligned inside the blocks for the helper calls
+	emitter.byte(0x53);									// push rbx
+	emitter.byte(0x55);									// push rbp
+	emitter.byte(0x41); emitter.byte(0x54);				// push r12
+	emitter.byte(0x41); emitter.byte(0x55);				// push r13
+	emitter.byte(0x41); emitter.byte(0x56);				// push r14
+	emitter.byte(0x41); emitter.byte(0x57);				// push r15
+	emitter.byte(0x48); emitter.byte(0x83); emitter.byte(0xEC); emitter.byte(0x08);		// sub rsp, 8
+	emitter.byte(0x48); emitter.byte(0x89); emitter.byte(0x14); emitter.byte(0x24);		// mov [rsp], rdx
+	emitter.byte(0x48); emitter.byte(0x89); emitter.byte(0xFB);							// mov rbx, rdi
+	emitter.byte(0x48); emitter.byte(0x8B); emitter.byte(0xAA); emitter.dword(offsetof(Chip8_Jit_Context, budget));	// mov rbp, [rdx + budget]
+	emitter.byte(0xFF); emitter.byte(0xE6);				// jmp rsi
+
+	// epilogue ; EAX holds the EXIT_TYPE and RDX the patch site
+	jit->epilogue = emitter.code + emitter.size;
+	emitter.byte(0x48); emitter.byte(0x8B); emitter.byte(0x0C); emitter.byte(0x24);		// mov rcx, [rsp]
+	emitter.byte(0x48); emitter.byte(0x89); emitter.byte(0xA9); emitter.dword(offsetof(Chip8_Jit_Context, budget));		// mov [rcx + budget], rbp
+	emitter.byte(0x48); emitter.byte(0x89); emitter.byte(0x91); emitter.dword(offsetof(Chip8_Jit_Context, patch_site));	// mov [rcx + patch_site], rdx
+	emitter.byte(0x48); emitter.byte(0x83); emitter.byte(0xC4); emitter.byte(0x08);		// add rsp, 8
+	emitter.byte(0x41); emitter.byte(0x5F);				// pop r15
+	emitter.byte(0x41); emitter.byte(0x5E);				// pop r14
+	emitter.byte(0x41); emitter.byte(0x5D);				// pop r13
+	emitter.byte(0x41); emitter.byte(0x5C);				// pop r12
+	emitter.byte(0x5D);									// pop rbp
+	emitter.byte(0x5B);									// pop rbx
+	emitter.byte(0xC3);									// ret
+
+	jit->enter = (u32 (*)(Chip8*, void*, Chip8_Jit_Context*))jit->code;
+	jit->code_size = emitter.size;
+	jit->code_reset_size = emitter.size;
+}
+
+static void Chip8_jit_flush(Chip8_Jit* jit){
+	++jit->generation;
+	jit->code_size = jit->code_reset_size;
+
+	// the entries of block_entry and no_block are covered by code_byte so only the pages holding code are cleared
+	for (u32 ipage = 0u; ipage != carray_size(Chip8_Jit::code_page); ++ipage){
+		if (!jit->code_page[ipage]) continue;
+
+		memset(jit->block_entry + ipage * 256u, 0x00, 256u * sizeof(u8*));
+		memset(jit->code_byte + ipage * 256u, 0x00, 256u);
+		memset(jit->no_block + ipage * 256u, 0x00, 256u);
+		jit->code_page[ipage] = false;
+	}
+
+	memset(jit->lookup_count, 0x00, sizeof(Chip8_Jit::lookup_count));
+}
+
+// adds refund to the budget for the instructions of the block that are not reached
+// then exit stub ; a jmp rel32 to the next instruction until the target block is known
+static void Chip8_jit_emit_exit(Chip8_Jit* jit, X64_Emitter& emitter, u16 target_PC, int refund){
+	if (refund) emitter.lea_rbp(RBP, refund);
+
+	size_t stub = emitter.size;
+	emitter.jmp_rel32();
+	emitter.patch_rel32(stub + 1, emitter.code + emitter.size);
+
+	emitter.mov_m16_imm16(g_jit_PC_offset, target_PC);
+	emitter.byte(0x48); emitter.byte(0x8D); emitter.byte(0x15);								// lea rdx, [rip + stub]
+	emitter.dword((u32)(s32)(stub - (emitter.size + 4)));
+	emitter.mov_ri(RAX, Chip8_Jit::EXIT_CHAIN);
+	emitter.patch_rel32(emitter.jmp_rel32(), jit->epilogue);
+}
+
+// instructions translated to host code on the registers of the pool
+static int Chip8_jit_is_native(Chip8* chip8, const Chip8_Op& op, u16 PC){
+	switch (op.type){
+		case Chip8_Op::LD_VX_BYTE:
+		case Chip8_Op::ADD_VX_BYTE:
+		case Chip8_Op::LD_VX_VY:
+		case Chip8_Op::OR_VX_VY:
+		case Chip8_Op::AND_VX_VY:
+		case Chip8_Op::XOR_VX_VY:
+		case Chip8_Op::ADD_VX_VY:
+		case Chip8_Op::SUB_VX_VY:
+		case Chip8_Op::SHR_VX:
+		case Chip8_Op::SUBN_VX_VY:
+		case Chip8_Op::SHL_VX:
+		case Chip8_Op::LD_I_ADDR:
+		case Chip8_Op::ADD_I_VX:
+		case Chip8_Op::LD_F_VX:
+		case Chip8_Op::SE_VX_BYTE:
+		case Chip8_Op::SNE_VX_BYTE:
+		case Chip8_Op::SE_VX_VY:
+		case Chip8_Op::SNE_VX_VY:
+		case Chip8_Op::SKP_VX:
+		case Chip8_Op::SKNP_VX:
+			return true;
+		case Chip8_Op::JP_ADDR:
+			// JP to itself is an idle wait of Chip8_execute_decoded
+			return Chip8_is_valid_memory(chip8, op.nnn, 1) && op.nnn != PC;
+		default:
+			return false;
+	}
+}
+
+// instructions translated to a helper call ; NULL for the others
+static Chip8_Jit_Helper Chip8_jit_helper(Chip8* chip8, const Chip8_Op& op, u16 PC){
+	switch (op.type){
+		case Chip8_Op::CALL_ADDR:
+			return Chip8_is_valid_memory(chip8, op.nnn, 2) ? Chip8_jit_CALL : NULL;
+		case Chip8_Op::RET:
+			return Chip8_jit_RET;
+		case Chip8_Op::DRW_VX_VY_N:
+			return chip8->MACHINE == Chip8::CHIP8 ? Chip8_jit_DRW<Chip8::CHIP8> : Chip8_jit_DRW<Chip8::SUPERCHIP>;
+		case Chip8_Op::RND_VX_BYTE:
+			return Chip8_jit_RND;
+		case Chip8_Op::LD_VX_DT:
+			return Chip8_is_DT_wait_loop(chip8, PC, op.x) ? Chip8_jit_LD_VX_DT_wait : Chip8_jit_LD_VX_DT;
+		case Chip8_Op::LD_DT_VX:
+			return Chip8_jit_LD_DT_VX;
+		case Chip8_Op::LD_ST_VX:
+			return Chip8_jit_LD_ST_VX;
+		case Chip8_Op::LD_B_VX:
+			return Chip8_jit_LD_B_VX;
+		case Chip8_Op::LD_MEM_VX:
+			return Chip8_jit_LD_MEM_VX;
+		case Chip8_Op::LD_VX_MEM:
+			return Chip8_jit_LD_VX_MEM;
+		case Chip8_Op::CLS:
+		case Chip8_Op::SCD_N:
+		case Chip8_Op::SCR:
+		case Chip8_Op::SCL:
+		case Chip8_Op::LOW:
+		case Chip8_Op::HIGH:
+		case Chip8_Op::DRW_VX_VY_0:
+		case Chip8_Op::LD_HF_VX:
+		case Chip8_Op::LD_R_VX:
+		case Chip8_Op::LD_VX_R:
+			return Chip8_jit_execute_decoded;
+		default:
+			return NULL;
+	}
+}
+
+static int Chip8_jit_is_jump(const Chip8_Op& op){
+	return op.type == Chip8_Op::JP_ADDR || op.type == Chip8_Op::CALL_ADDR || op.type == Chip8_Op::RET;
+}
+
+static int Chip8_jit_is_skip(const Chip8_Op& op){
+	return op.type == Chip8_Op::SE_VX_BYTE || op.type == Chip8_Op::SNE_VX_BYTE
+		|| op.type == Chip8_Op::SE_VX_VY || op.type == Chip8_Op::SNE_VX_VY
+		|| op.type == Chip8_Op::SKP_VX || op.type == Chip8_Op::SKNP_VX;
+}
+
+// Chip8 registers held in host registers by a native instruction
+static u16 Chip8_jit_register_mask(Chip8* chip8, const Chip8_Op& op){
+	switch (op.type){
+		case Chip8_Op::LD_VX_BYTE:
+		case Chip8_Op::ADD_VX_BYTE:
+		case Chip8_Op::ADD_I_VX:
+		case Chip8_Op::LD_F_VX:
+		case Chip8_Op::SE_VX_BYTE:
+		case Chip8_Op::SNE_VX_BYTE:
+		case Chip8_Op::SKP_VX:
+		case Chip8_Op::SKNP_VX:
+			return 1u << op.x;
+		case Chip8_Op::LD_VX_VY:
+		case Chip8_Op::SE_VX_VY:
+		case Chip8_Op::SNE_VX_VY:
+			return (1u << op.x) | (1u << op.y);
+		case Chip8_Op::OR_VX_VY:
+		case Chip8_Op::AND_VX_VY:
+		case Chip8_Op::XOR_VX_VY:
+			return (1u << op.x) | (1u << op.y) | (Chip8_quirk_sets[chip8->QUIRKS].vf_reset ? 1u << 0xF : 0u);
+		case Chip8_Op::ADD_VX_VY:
+		case Chip8_Op::SUB_VX_VY:
+		case Chip8_Op::SUBN_VX_VY:
+		case Chip8_Op::SHR_VX:
+		case Chip8_Op::SHL_VX:
+			return (1u << op.x) | (1u << op.y) | (1u << 0xF);
+		default:
+			return 0u;
+	}
+}
+
+static u16 Chip8_jit_written_mask(Chip8* chip8, const Chip8_Op& op){
+	switch (op.type){
+		case Chip8_Op::LD_VX_BYTE:
+		case Chip8_Op::ADD_VX_BYTE:
+		case Chip8_Op::LD_VX_VY:
+			return 1u << op.x;
+		case Chip8_Op::OR_VX_VY:
+		case Chip8_Op::AND_VX_VY:
+		case Chip8_Op::XOR_VX_VY:
+			return (1u << op.x) | (Chip8_quirk_sets[chip8->QUIRKS].vf_reset ? 1u << 0xF : 0u);
+		case Chip8_Op::ADD_VX_VY:
+		case Chip8_Op::SUB_VX_VY:
+		case Chip8_Op::SUBN_VX_VY:
+		case Chip8_Op::SHR_VX:
+		case Chip8_Op::SHL_VX:
+			return (1u << op.x) | (1u << 0xF);
+		default:
+			return 0u;
+	}
+}
+
+// Chip8 registers written by the helper of an instruction ; reloaded in host registers after the call
+static u16 Chip8_jit_helper_written_mask(const Chip8_Op& op){
+	switch (op.type){
+		case Chip8_Op::RND_VX_BYTE:
+		case Chip8_Op::LD_VX_DT:
+			return 1u << op.x;
+		case Chip8_Op::LD_VX_MEM:
+		case Chip8_Op::LD_VX_R:
+			return (u16)((2u << op.x) - 1u);
+		case Chip8_Op::DRW_VX_VY_N:
+		case Chip8_Op::DRW_VX_VY_0:
+			return 1u << 0xF;
+		default:
+			return 0u;
+	}
+}
+
+static int Chip8_jit_popcount(u16 mask){
+	int count = 0;
+	for (; mask; mask &= mask - 1) ++count;
+	return count;
+}
+
+// returns NULL when the instruction at PC has to be interpreted
+static u8* Chip8_jit_translate(Chip8_Jit* jit, Chip8* chip8, u16 start_PC){
+	// ---- scan
+
+	Chip8_Op ops[Chip8_Jit::block_instruction_max];
+	int op_count = 0;
+	int op_limit = Chip8_Jit::block_instruction_max;
+	u16 used_mask = 0u;
+
+	u16 PC = start_PC;
+	while (op_count != op_limit){
+		if (!Chip8_is_valid_memory(chip8, PC, 2)) break;
+
+		Chip8_Op op = Chip8_decode(Chip8_fetch(chip8, PC), chip8->MACHINE);
+		if (!Chip8_jit_is_native(chip8, op, PC) && !Chip8_jit_helper(chip8, op, PC)) break;
+
+		u16 new_used_mask = used_mask | Chip8_jit_register_mask(chip8, op);
+		if (Chip8_jit_popcount(new_used_mask) > (int)carray_size(g_jit_register_pool)) break;
+
+		used_mask = new_used_mask;
+		ops[op_count++] = op;
+
+		if (op.type == Chip8_Op::LD_VX_DT && Chip8_is_DT_wait_loop(chip8, PC, op.x))
+			op_limit = min(op_count + 2, op_limit);
+
+		PC += 2;
+
+		int skipped = op_count >= 2 && Chip8_jit_is_skip(ops[op_count - 2]);
+		if (Chip8_jit_is_jump(op) && !skipped) break;
+	}
+
+	if (op_count == 0){
+		jit->no_block[start_PC] = true;
+		for (u32 iadress = start_PC; iadress != start_PC + 2u && iadress < carray_size(Chip8_Jit::code_byte); ++iadress){
+			jit->code_byte[iadress] = true;
+			jit->code_page[iadress >> 8] = true;
+		}
+		return NULL;
+	}
+
+	if (jit->code_size + Chip8_Jit::block_size_max > Chip8_Jit::code_capacity){
+		Chip8_jit_flush(jit);
+		ram_info("Chip8 JIT: translation cache full, flushed");
+	}
+
+	// ---- budget
+	//
+	// the block is entered with a budget of at least op_count instructions
+	// an instruction after a skip inside the block is conditional and subtracts itself from the budget when it starts ; the others are subtracted on entry
+	// an exit adds back the unconditional instructions after it
+
+	int conditional[Chip8_Jit::block_instruction_max];
+	int refund[Chip8_Jit::block_instruction_max];
+	int unconditional_count = 0;
+	for (int iop = 0; iop != op_count; ++iop){
+		conditional[iop] = iop != 0 && Chip8_jit_is_skip(ops[iop - 1]);
+		if (!conditional[iop]) ++unconditional_count;
+	}
+	for (int iop = op_count - 1, count = 0; iop >= 0; --iop){
+		refund[iop] = count;
+		if (!conditional[iop]) ++count;
+	}
+
+	// ---- register assignment
+
+	int host[16];
+	int pool_index = 0;
+	// Chip8 registers in host registers clobbered by the helper calls
+	u16 clobbered_mask = 0u;
+	for (int ireg = 0; ireg != 16; ++ireg){
+		host[ireg] = (used_mask & (1u << ireg)) ? g_jit_register_pool[pool_index++] : -1;
+		if (host[ireg] != -1 && !X64_is_callee_saved(host[ireg])) clobbered_mask |= 1u << ireg;
+	}
+
+	// ---- emission
+
+	X64_Emitter emitter;
+	emitter.code = jit->code;
+	emitter.size = jit->code_size;
+
+	u8* entry = emitter.code + emitter.size;
+
+	// budget check
+	emitter.byte(0x48); emitter.byte(0x81); emitter.byte(0xFD); emitter.dword(op_count);	// cmp rbp, op_count
+	size_t budget_jump = emitter.jcc_rel32(X64_CONDITION_L);
+	emitter.lea_rbp(RBP, -unconditional_count);
+
+	auto load_registers = [&](u16 mask){
+		for (int ireg = 0; ireg != 16; ++ireg)
+			if ((mask & used_mask) & (1u << ireg)) emitter.movzx_r32_m8(host[ireg], g_jit_V_offset + ireg);
+	};
+	auto store_registers = [&](u16 mask){
+		for (int ireg = 0; ireg != 16; ++ireg)
+			if (mask & (1u << ireg)) emitter.mov_m8_r8(g_jit_V_offset + ireg, host[ireg]);
+	};
+
+	load_registers(used_mask);
+
+	// registers written in host registers since they were last stored ; a union over the paths reaching the current instruction
+	u16 dirty = 0u;
+
+	// jumps of the skips to the instruction after the one they skip and the dirty registers at the skip, indexed by that instruction
+	size_t skip_jump[Chip8_Jit::block_instruction_max + 1] = {};
+	u16 skip_dirty[Chip8_Jit::block_instruction_max + 1] = {};
+
+	// jumps to the out of line exits of the helpers and of SKP and SKNP faults
+	struct Leave{
+		size_t jump;
+		int iop;
+		int fault;
+		u16 dirty;
+	};
+	Leave leaves[Chip8_Jit::block_instruction_max];
+	int leave_count = 0;
+
+	auto emit_helper_call = [&](Chip8_Jit_Helper helper, const Chip8_Op& op, u16 op_PC, int iop){
+		u64 op_bits;
+		memcpy(&op_bits, &op, sizeof(op_bits));
+
+		store_registers(dirty);
+		dirty = 0u;
+		emitter.alu_rr64(0x89, RDI, RBX);
+		emitter.mov_ri64(RSI, op_bits);
+		emitter.mov_ri(RDX, op_PC);
+		emitter.lea_rbp(RCX, refund[iop] + 1);
+		emitter.mov_ri64(RAX, (u64)helper);
+		emitter.call_r(RAX);
+	};
+
+	// a skip branches over the next instruction of the block or ends the block with an exit for each outcome
+	auto emit_skip = [&](u8 skip_condition, u16 op_PC, int iop){
+		if (iop + 1 != op_count){
+			skip_jump[iop + 2] = emitter.jcc_rel32(skip_condition);
+			skip_dirty[iop + 2] = dirty;
+			return false;
+		}
+
+		// MOV does not modify the flags
+		store_registers(dirty);
+		size_t jump = emitter.jcc_rel32(skip_condition);
+		Chip8_jit_emit_exit(jit, emitter, op_PC + 2, refund[iop]);
+		emitter.patch_rel32(jump, emitter.code + emitter.size);
+		Chip8_jit_emit_exit(jit, emitter, op_PC + 4, refund[iop]);
+		return true;
+	};
+
+	int terminated = false;
+	u16 op_PC = start_PC;
+	for (int iop = 0; iop != op_count; ++iop, op_PC += 2){
+		const Chip8_Op& op = ops[iop];
+		int X = host[op.x];
+		int Y = host[op.y];
+		int F = host[0xF];
+
+		if (skip_jump[iop]){
+			emitter.patch_rel32(skip_jump[iop], emitter.code + emitter.size);
+			dirty |= skip_dirty[iop];
+		}
+		if (conditional[iop]) emitter.lea_rbp(RBP, -1);
+		terminated = false;
+		dirty |= Chip8_jit_written_mask(chip8, op);
+
+		switch (op.type){
+			case Chip8_Op::LD_VX_BYTE:
+				emitter.mov_ri(X, op.kk);
+				break;
+			case Chip8_Op::ADD_VX_BYTE:
+				emitter.alu_ri(0, X, op.kk);
+				emitter.movzx_r32_r8(X, X);
+				break;
+			case Chip8_Op::LD_VX_VY:
+				emitter.alu_rr(0x89, X, Y);
+				break;
+			case Chip8_Op::OR_VX_VY:
+			case Chip8_Op::AND_VX_VY:
+			case Chip8_Op::XOR_VX_VY:
+			{
+				u8 opcode = op.type == Chip8_Op::OR_VX_VY ? 0x09 : op.type == Chip8_Op::AND_VX_VY ? 0x21 : 0x31;
+				emitter.alu_rr(opcode, X, Y);
+				if (Chip8_quirk_sets[chip8->QUIRKS].vf_reset) emitter.mov_ri(F, 0);
+				break;
+			}
+			case Chip8_Op::ADD_VX_VY:
+				// VF is written before Vx like the interpreter
+				emitter.alu_rr(0x89, RAX, X);
+				emitter.alu_rr(0x01, RAX, Y);
+				emitter.alu_rr(0x89, F, RAX);
+				emitter.shr_ri(F, 8);
+				emitter.movzx_r32_r8(X, RAX);
+				break;
+			case Chip8_Op::SUB_VX_VY:
+				emitter.mov_ri(RCX, 0);
+				emitter.alu_rr(0x39, X, Y);
+				emitter.seta_cl();
+				emitter.alu_rr(0x89, F, RCX);
+				emitter.alu_rr(0x89, RAX, X);
+				emitter.alu_rr(0x29, RAX, Y);
+				emitter.movzx_r32_r8(X, RAX);
+				break;
+			case Chip8_Op::SHR_VX:
+				// shifts Vy into Vx with the shift_vy quirk
+				emitter.alu_rr(0x89, RAX, Chip8_quirk_sets[chip8->QUIRKS].shift_vy ? Y : X);
+				emitter.alu_rr(0x89, RCX, RAX);
+				emitter.alu_ri(4, RCX, 0x01);
+				emitter.shr_ri(RAX, 1);
+				emitter.alu_rr(0x89, F, RCX);
+				emitter.alu_rr(0x89, X, RAX);
+				break;
+			case Chip8_Op::SUBN_VX_VY:
+				emitter.mov_ri(RCX, 0);
+				emitter.alu_rr(0x39, Y, X);
+				emitter.seta_cl();
+				emitter.alu_rr(0x89, F, RCX);
+				emitter.alu_rr(0x89, RAX, Y);
+				emitter.alu_rr(0x29, RAX, X);
+				emitter.movzx_r32_r8(X, RAX);
+				break;
+			case Chip8_Op::SHL_VX:
+				emitter.alu_rr(0x89, RAX, Chip8_quirk_sets[chip8->QUIRKS].shift_vy ? Y : X);
+				emitter.alu_rr(0x89, RCX, RAX);
+				emitter.shr_ri(RCX, 7);
+				emitter.alu_rr(0x01, RAX, RAX);
+				emitter.movzx_r32_r8(RAX, RAX);
+				emitter.alu_rr(0x89, F, RCX);
+				emitter.alu_rr(0x89, X, RAX);
+				break;
+			case Chip8_Op::LD_I_ADDR:
+				emitter.mov_m16_imm16(g_jit_I_offset, op.nnn);
+				break;
+			case Chip8_Op::ADD_I_VX:
+				emitter.movzx_eax_m16(g_jit_I_offset);
+				emitter.alu_rr(0x01, RAX, X);
+				emitter.mov_m16_ax(g_jit_I_offset);
+				break;
+			case Chip8_Op::LD_F_VX:
+				emitter.alu_rr(0x89, RAX, X);
+				emitter.alu_ri(4, RAX, 0x0F);
+				emitter.byte(0x8D); emitter.byte(0x04); emitter.byte(0x80);					// lea eax, [rax + rax * 4]
+				emitter.mov_m16_ax(g_jit_I_offset);
+				break;
+			case Chip8_Op::JP_ADDR:
+				store_registers(dirty);
+				Chip8_jit_emit_exit(jit, emitter, op.nnn, refund[iop]);
+				terminated = true;
+				break;
+			case Chip8_Op::SE_VX_BYTE:
+			case Chip8_Op::SNE_VX_BYTE:
+			case Chip8_Op::SE_VX_VY:
+			case Chip8_Op::SNE_VX_VY:
+			{
+				if (op.type == Chip8_Op::SE_VX_BYTE || op.type == Chip8_Op::SNE_VX_BYTE)
+					emitter.alu_ri(7, X, op.kk);
+				else
+					emitter.alu_rr(0x39, X, Y);
+
+				u8 skip_condition = (op.type == Chip8_Op::SE_VX_BYTE || op.type == Chip8_Op::SE_VX_VY) ? X64_CONDITION_E : X64_CONDITION_NE;
+				terminated = emit_skip(skip_condition, op_PC, iop);
+				break;
+			}
+			case Chip8_Op::SKP_VX:
+			case Chip8_Op::SKNP_VX:
+			{
+				// keys past KEYBOARD fault
+				emitter.alu_ri(7, X, carray_size(Chip8::KEYBOARD));
+				leaves[leave_count++] = { emitter.jcc_rel32(X64_CONDITION_AE), iop, true, dirty };
+
+				emitter.cmp_m8_indexed_imm8(X, g_jit_KEYBOARD_offset, 0);
+				terminated = emit_skip(op.type == Chip8_Op::SKP_VX ? X64_CONDITION_NE : X64_CONDITION_E, op_PC, iop);
+				break;
+			}
+			case Chip8_Op::CALL_ADDR:
+			{
+				emit_helper_call(Chip8_jit_CALL, op, op_PC, iop);
+				emitter.alu_rr64(0x85, RAX, RAX);
+				leaves[leave_count++] = { emitter.jcc_rel32(X64_CONDITION_NE), iop, false, 0u };
+
+				Chip8_jit_emit_exit(jit, emitter, op.nnn, refund[iop]);
+				terminated = true;
+				break;
+			}
+			case Chip8_Op::RET:
+			{
+				emit_helper_call(Chip8_jit_RET, op, op_PC, iop);
+				emitter.alu_rr64(0x85, RAX, RAX);
+				leaves[leave_count++] = { emitter.jcc_rel32(X64_CONDITION_NE), iop, false, 0u };
+
+				// jumps to the block at PC or leaves to translate it
+				if (refund[iop]) emitter.lea_rbp(RBP, refund[iop]);
+				emitter.movzx_eax_m16(g_jit_PC_offset);
+				emitter.alu_ri(7, RAX, carray_size(Chip8_Jit::block_entry));
+				size_t out_of_range_jump = emitter.jcc_rel32(X64_CONDITION_AE);
+				emitter.mov_ri64(RCX, (u64)jit->block_entry);
+				emitter.byte(0x48); emitter.byte(0x8B); emitter.byte(0x04); emitter.byte(0xC1);	// mov rax, [rcx + rax * 8]
+				emitter.alu_rr64(0x85, RAX, RAX);
+				size_t untranslated_jump = emitter.jcc_rel32(X64_CONDITION_E);
+				emitter.jmp_r(RAX);
+
+				emitter.patch_rel32(out_of_range_jump, emitter.code + emitter.size);
+				emitter.patch_rel32(untranslated_jump, emitter.code + emitter.size);
+				emitter.mov_ri(RAX, Chip8_Jit::EXIT_LOOKUP);
+				emitter.patch_rel32(emitter.jmp_rel32(), jit->epilogue);
+				terminated = true;
+				break;
+			}
+			case Chip8_Op::LD_VX_DT:
+			{
+				emit_helper_call(Chip8_jit_helper(chip8, op, op_PC), op, op_PC, iop);
+				emitter.alu_rr64(0x29, RBP, RAX);
+				load_registers(Chip8_jit_helper_written_mask(op) | clobbered_mask);
+				break;
+			}
+			default:
+			{
+				Chip8_Jit_Helper helper = Chip8_jit_helper(chip8, op, op_PC);
+				ram_assert_msg(helper != NULL, "Chip8 JIT: instruction without translation");
+
+				emit_helper_call(helper, op, op_PC, iop);
+				emitter.alu_rr64(0x85, RAX, RAX);
+				leaves[leave_count++] = { emitter.jcc_rel32(X64_CONDITION_NE), iop, false, 0u };
+				load_registers(Chip8_jit_helper_written_mask(op) | clobbered_mask);
+				break;
+			}
+		}
+	}
+
+	// the instruction after the last one is reached by falling through or by a skip over the last one
+	if (skip_jump[op_count]){
+		emitter.patch_rel32(skip_jump[op_count], emitter.code + emitter.size);
+		dirty |= skip_dirty[op_count];
+	}
+	if (!terminated || skip_jump[op_count]){
+		store_registers(dirty);
+		Chip8_jit_emit_exit(jit, emitter, op_PC, 0);
+	}
+
+	// helpers set PC and EAX before leaving ; the registers are already stored
+	for (int ileave = 0; ileave != leave_count; ++ileave){
+		const Leave& leave = leaves[ileave];
+		emitter.patch_rel32(leave.jump, emitter.code + emitter.size);
+
+		if (leave.fault){
+			store_registers(leave.dirty);
+			emitter.mov_m16_imm16(g_jit_PC_offset, start_PC + leave.iop * 2);
+			emitter.mov_ri(RAX, Chip8_Jit::EXIT_INTERPRET);
+		}
+		if (refund[leave.iop]) emitter.lea_rbp(RBP, refund[leave.iop]);
+		emitter.patch_rel32(emitter.jmp_rel32(), jit->epilogue);
+	}
+
+	// budget exit ; PC is the start of the block
+	emitter.patch_rel32(budget_jump, emitter.code + emitter.size);
+	emitter.mov_m16_imm16(g_jit_PC_offset, start_PC);
+	emitter.mov_ri(RDX, 0);
+	emitter.mov_ri(RAX, Chip8_Jit::EXIT_BUDGET);
+	emitter.patch_rel32(emitter.jmp_rel32(), jit->epilogue);
+
+	ram_assert(emitter.size - jit->code_size <= Chip8_Jit::block_size_max);
+
+	// perf reads the map after the run ; it is flushed when the Chip8 is destroyed
+	if (jit->perf_map)
+		fprintf(jit->perf_map, "%llx %llx chip8_block_%03X\n", (unsigned long long)entry, (unsigned long long)(emitter.size - jit->code_size), start_PC);
+
+	jit->code_size = emitter.size;
+	jit->block_entry[start_PC] = entry;
+	jit->block_length[start_PC] = (u8)op_count;
+
+	for (u16 iadress = start_PC; iadress != op_PC; ++iadress){
+		jit->code_byte[iadress] = true;
+		jit->code_page[iadress >> 8] = true;
+	}
+
+	return entry;
+}
+
+static u8* Chip8_jit_lookup(Chip8_Jit* jit, Chip8* chip8, u16 PC){
+	if (PC >= carray_size(Chip8_Jit::block_entry)) return NULL;
+
+	u8* entry = jit->block_entry[PC];
+	if (!entry && !jit->no_block[PC] && ++jit->lookup_count[PC] >= Chip8_Jit::translate_threshold)
+		entry = Chip8_jit_translate(jit, chip8, PC);
+	return entry;
+}
+
+// the JIT of the last Chip8 destroyed on the thread ; its code buffer and tables are already mapped and reused by the next Chip8
+// mapping them again costs more than a short run with page faults on every first write
+static thread_local Chip8_Jit* g_jit_spare = NULL;
+
+static void Chip8_jit_create(Chip8* chip8){
+	Chip8_Jit* jit = g_jit_spare;
+	if (jit){
+		g_jit_spare = NULL;
+		Chip8_jit_flush(jit);
+
+		chip8->JIT_CACHE = jit;
+		return;
+	}
+
+	jit = (Chip8_Jit*)malloc(sizeof(Chip8_Jit));
+	if (!jit) crash("Failed to allocate the Chip8 JIT");
+
+	void* code = mmap(NULL, Chip8_Jit::code_capacity, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED) crash("Failed to mmap the Chip8 JIT code buffer");
+	jit->code = (u8*)code;
+
+	jit->perf_map = NULL;
+#if defined(CHIP8_JIT_PERF_MAP)
+	char perf_map_path[64];
+	snprintf(perf_map_path, sizeof(perf_map_path), "/tmp/perf-%d.map", (int)getpid());
+	jit->perf_map = fopen(perf_map_path, "a");
+#endif
+
+	// every page is cleared by the first flush
+	jit->generation = 0u;
+	memset(jit->code_page, 0x01, sizeof(Chip8_Jit::code_page));
+	Chip8_jit_create_trampoline(jit);
+	Chip8_jit_flush(jit);
+
+	if (jit->perf_map)
+		fprintf(jit->perf_map, "%llx %llx chip8_jit_trampoline\n", (unsigned long long)jit->code, (unsigned long long)jit->code_reset_size);
+
+	chip8->JIT_CACHE = jit;
+}
+
+static void Chip8_jit_free(Chip8_Jit* jit){
+	if (jit->perf_map) fclose(jit->perf_map);
+	munmap(jit->code, Chip8_Jit::code_capacity);
+	free(jit);
+}
+
+void Chip8_jit_destroy(Chip8* chip8){
+	Chip8_Jit* jit = chip8->JIT_CACHE;
+	if (!jit) return;
+
+	if (g_jit_spare) Chip8_jit_free(g_jit_spare);
+	g_jit_spare = jit;
+
+	chip8->JIT_CACHE = NULL;
+}
+
+void Chip8_jit_invalidate(Chip8* chip8, u16 adress, u16 size){
+	Chip8_Jit* jit = chip8->JIT_CACHE;
+
+	int overlap = false;
+	for (u32 iadress = adress; iadress < (u32)adress + size && iadress < carray_size(Chip8_Jit::code_byte); ++iadress){
+		if (jit->code_page[iadress >> 8] && jit->code_byte[iadress]){
+			overlap = true;
+			break;
+		}
+	}
+
+	if (overlap) Chip8_jit_flush(jit);
+}
+
+// runs the instructions without a block up to the next jump, where a block can start, and returns the instruction count left
+static int Chip8_jit_execute_decoded_to_jump(Chip8* chip8, int instruction_count){
+	u64 cycle = chip8->CYCLE;
+	Chip8_execute_decoded_to_jump(chip8, instruction_count);
+	return instruction_count - (int)(chip8->CYCLE - cycle);
+}
+
+void Chip8_execute_jit(Chip8* chip8, int instruction_count){
+	if (chip8->MACHINE == Chip8::XOCHIP){
+		Chip8_execute_decoded(chip8, instruction_count);
+		return;
+	}
+
+	if (!chip8->JIT_CACHE) Chip8_jit_create(chip8);
+	Chip8_Jit* jit = chip8->JIT_CACHE;
+
+	while (instruction_count && !chip8->ERROR){
+		u8* entry = Chip8_jit_lookup(jit, chip8, chip8->PC);
+
+		if (!entry){
+			instruction_count = Chip8_jit_execute_decoded_to_jump(chip8, instruction_count);
+			continue;
+		}
+
+		// the block would exit on its budget check
+		if (instruction_count < jit->block_length[chip8->PC]){
+			Chip8_execute_decoded(chip8, instruction_count);
+			break;
+		}
+
+		jit->context.budget = instruction_count;
+		jit->context.end_cycle = chip8->CYCLE + instruction_count;
+		u32 exit_type = jit->enter(chip8, entry, &jit->context);
+
+		// the instruction at PC was counted by its block without being retired
+		if (exit_type == Chip8_Jit::EXIT_INTERPRET) ++jit->context.budget;
+
+		if (jit->context.budget != instruction_count){
+			// KEYBOARD does not change during a step
+			instruction_count = (int)jit->context.budget;
+			chip8->CYCLE = jit->context.end_cycle - (u64)instruction_count;
+			memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));
+		}
+
+		if (exit_type == Chip8_Jit::EXIT_CHAIN){
+			u32 generation = jit->generation;
+			u8* target = Chip8_jit_lookup(jit, chip8, chip8->PC);
+
+			// the lookup may have flushed the translation cache and the patch site with it
+			if (target && jit->generation == generation){
+				X64_Emitter emitter;
+				emitter.code = jit->context.patch_site;
+				emitter.size = 0;
+				emitter.patch_rel32(1, target);
+			}
+		}
+		else if (exit_type == Chip8_Jit::EXIT_BUDGET){
+			Chip8_execute_decoded(chip8, instruction_count);
+			instruction_count = 0;
+		}
+		else if (exit_type == Chip8_Jit::EXIT_INTERPRET && !chip8->ERROR){
+			instruction_count = Chip8_jit_execute_decoded_to_jump(chip8, instruction_count);
+		}
+	}
+}
+
+#else
+
+void Chip8_execute_jit(Chip8* chip8, int instruction_count){
+	Chip8_execute_decoded(chip8, instruction_count);
+}
+
+void Chip8_jit_invalidate(Chip8* chip8, u16 adress, u16 size){
+}
+
+void Chip8_jit_destroy(Chip8* chip8){
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include "chip8.h"
+
+// Movies
+//
+// * a movie only stores the KEYBOARD transitions ; the Chip8 is deterministic given its ROM, RANDOM and timing
+// * the frames are the Chip8_step of 1 / frames_per_second seconds of the recording
+// * the replay applies the same Chip8_step so it works with every backend and compares Chip8_hash_state at the checkpoints
+
+// "C8MV"
+static constexpr u32 Chip8_movie_magic = 0x564D3843u;
+
+struct Chip8_Movie_Record{
+	enum TAG : u8{
+		KEYS = 0,
+		CHECKPOINT,
+		END,
+	};
+};
+
+// magic ; version ; ROM_HASH ; MACHINE ; QUIRKS ; RANDOM ; instructions_per_second ; timer_per_second ; emulation_speed ; frames_per_second ; checkpoint_period
+static constexpr size_t Chip8_movie_header_size = 4u + 2u + 8u + 1u + 1u + 16u + 4u + 4u + 4u + 4u + 4u;
+
+// ---- writing
+
+static void Chip8_movie_write(FILE* file, u64 value, int byte_count){
+	for (int ibyte = 0; ibyte != byte_count; ++ibyte)
+		fputc((u8)(value >> (8u * ibyte)), file);
+}
+
+// REF: https://en.wikipedia.org/wiki/LEB128 [LEB128]
+static void Chip8_movie_write_LEB128(FILE* file, u64 value){
+	do{
+		u8 byte = value & 0x7Fu;
+		value >>= 7u;
+		fputc(value ? byte | 0x80u : byte, file);
+	} while (value);
+}
+
+static void Chip8_movie_write_record(Chip8_Movie_Recorder& recorder, Chip8_Movie_Record::TAG tag){
+	fputc(tag, recorder.file);
+	Chip8_movie_write_LEB128(recorder.file, recorder.frame - recorder.record_frame);
+	recorder.record_frame = recorder.frame;
+}
+
+int Chip8_movie_record_begin(Chip8_Movie_Recorder& recorder, Chip8* chip8, const char* path, u32 frames_per_second, u32 checkpoint_period){
+	ram_assert(chip8->CYCLE == 0u);
+	ram_assert(frames_per_second && checkpoint_period);
+
+	recorder.file = fopen(path, "wb");
+	if (!recorder.file) return false;
+
+	recorder.checkpoint_period = checkpoint_period;
+	recorder.frame = 0u;
+	recorder.record_frame = 0u;
+	recorder.keys = 0u;
+
+	u32 emulation_speed_bits;
+	memcpy(&emulation_speed_bits, &chip8->emulation_speed, sizeof(u32));
+
+	Chip8_movie_write(recorder.file, Chip8_movie_magic, 4);
+	Chip8_movie_write(recorder.file, Chip8_movie_version, 2);
+	Chip8_movie_write(recorder.file, chip8->ROM_HASH, 8);
+	Chip8_movie_write(recorder.file, chip8->MACHINE, 1);
+	Chip8_movie_write(recorder.file, chip8->QUIRKS, 1);
+	Chip8_movie_write(recorder.file, chip8->RANDOM.seed[0], 8);
+	Chip8_movie_write(recorder.file, chip8->RANDOM.seed[1], 8);
+	Chip8_movie_write(recorder.file, chip8->instructions_per_second, 4);
+	Chip8_movie_write(recorder.file, chip8->timer_per_second, 4);
+	Chip8_movie_write(recorder.file, emulation_speed_bits, 4);
+	Chip8_movie_write(recorder.file, frames_per_second, 4);
+	Chip8_movie_write(recorder.file, checkpoint_period, 4);
+
+	return true;
+}
+
+void Chip8_movie_record_frame(Chip8_Movie_Recorder& recorder, Chip8* chip8){
+	// KEYBOARD does not change during a step so it is the one of the frame
+	u16 keys = Chip8_keyboard_to_mask(chip8->KEYBOARD);
+	if (keys != recorder.keys){
+		Chip8_movie_write_record(recorder, Chip8_Movie_Record::KEYS);
+		Chip8_movie_write(recorder.file, keys, 2);
+		recorder.keys = keys;
+	}
+
+	++recorder.frame;
+	if (recorder.frame % recorder.checkpoint_period == 0u){
+		Chip8_movie_write_record(recorder, Chip8_Movie_Record::CHECKPOINT);
+		Chip8_movie_write(recorder.file, Chip8_hash_state(chip8), 8);
+	}
+}
+
+int Chip8_movie_record_end(Chip8_Movie_Recorder& recorder, Chip8* chip8){
+	Chip8_movie_write_record(recorder, Chip8_Movie_Record::END);
+	Chip8_movie_write(recorder.file, Chip8_hash_state(chip8), 8);
+
+	int written = !ferror(recorder.file);
+	written = fclose(recorder.file) == 0 && written;
+	recorder.file = NULL;
+
+	return written;
+}
+
+// ---- reading ; returns false past the end of the movie
+
+struct Chip8_Movie_Reader{
+	const u8* cursor;
+	const u8* end;
+};
+
+static int Chip8_movie_read(Chip8_Movie_Reader& reader, u64& value, int byte_count){
+	if (reader.end - reader.cursor < byte_count) return false;
+	value = 0u;
+	for (int ibyte = 0; ibyte != byte_count; ++ibyte)
+		value |= (u64)reader.cursor[ibyte] << (8u * ibyte);
+	reader.cursor += byte_count;
+	return true;
+}
+
+static int Chip8_movie_read_LEB128(Chip8_Movie_Reader& reader, u64& value){
+	value = 0u;
+	for (u32 shift = 0u; shift < 64u; shift += 7u){
+		if (reader.cursor == reader.end) return false;
+		u8 byte = *reader.cursor++;
+		value |= (u64)(byte & 0x7Fu) << shift;
+		if (!(byte & 0x80u)) return true;
+	}
+	return false;
+}
+
+int Chip8_movie_replay(Chip8* chip8, const void* movie, size_t size, Chip8_Movie_Replay& replay){
+	replay.frame_count = 0u;
+	replay.checkpoint_count = 0u;
+	replay.mismatch_count = 0u;
+	replay.first_mismatch_frame = UINT64_MAX;
+
+	Chip8_Movie_Reader reader;
+	reader.cursor = (const u8*)movie;
+	reader.end = (const u8*)movie + size;
+
+	u64 magic, version, ROM_hash, machine, quirks, seed[2], instructions_per_second, timer_per_second, emulation_speed_bits, frames_per_second, checkpoint_period;
+	int valid = Chip8_movie_read(reader, magic, 4)
+		&& Chip8_movie_read(reader, version, 2)
+		&& Chip8_movie_read(reader, ROM_hash, 8)
+		&& Chip8_movie_read(reader, machine, 1)
+		&& Chip8_movie_read(reader, quirks, 1)
+		&& Chip8_movie_read(reader, seed[0], 8)
+		&& Chip8_movie_read(reader, seed[1], 8)
+		&& Chip8_movie_read(reader, instructions_per_second, 4)
+		&& Chip8_movie_read(reader, timer_per_second, 4)
+		&& Chip8_movie_read(reader, emulation_speed_bits, 4)
+		&& Chip8_movie_read(reader, frames_per_second, 4)
+		&& Chip8_movie_read(reader, checkpoint_period, 4)
+		&& magic == Chip8_movie_magic
+		&& version == Chip8_movie_version
+		&& ROM_hash == chip8->ROM_HASH
+		&& machine == chip8->MACHINE
+		&& quirks < Chip8_Quirks::TYPE_COUNT
+		&& frames_per_second;
+	if (!valid) return false;
+	ram_assert(reader.cursor == (const u8*)movie + Chip8_movie_header_size);
+
+	u32 emulation_speed_bits32 = (u32)emulation_speed_bits;
+	memcpy(&chip8->emulation_speed, &emulation_speed_bits32, sizeof(float));
+	chip8->instructions_per_second = (u32)instructions_per_second;
+	chip8->timer_per_second = (u32)timer_per_second;
+	chip8->QUIRKS = (Chip8_Quirks::TYPE)quirks;
+	chip8->RANDOM.seed[0] = seed[0];
+	chip8->RANDOM.seed[1] = seed[1];
+
+	float dtime_sec = 1.f / (float)frames_per_second;
+
+	while (true){
+		u64 tag, frame_count, payload;
+		if (!Chip8_movie_read(reader, tag, 1) || !Chip8_movie_read_LEB128(reader, frame_count)) return false;
+
+		for (u64 iframe = 0u; iframe != frame_count; ++iframe)
+			Chip8_step(chip8, dtime_sec);
+		replay.frame_count += frame_count;
+
+		if (tag == Chip8_Movie_Record::KEYS){
+			if (!Chip8_movie_read(reader, payload, 2)) return false;
+			Chip8_keyboard_from_mask(chip8->KEYBOARD, (u16)payload);
+		}
+		else if (tag == Chip8_Movie_Record::CHECKPOINT || tag == Chip8_Movie_Record::END){
+			if (!Chip8_movie_read(reader, payload, 8)) return false;
+
+			++replay.checkpoint_count;
+			if (payload != Chip8_hash_state(chip8)){
+				++replay.mismatch_count;
+				replay.first_mismatch_frame = min(replay.first_mismatch_frame, replay.frame_count);
+			}
+
+			if (tag == Chip8_Movie_Record::END) return reader.cursor == reader.end;
+		}
+		else{
+			return false;
+		}
+	}
+}
@@ -0,0 +1,363 @@
+#include "chip8.h"
+
+// Dynamic opcode sequences
+//
+// * instructions are executed one at a time with Chip8_execute_decoded and recorded before being executed
+// * sequences follow the executed instructions across jumps, calls and steps
+// * superinstructions of the FUSED backend were chosen from these reports
+
+Chip8_Profile* Chip8_create_profile(){
+	Chip8_Profile* profile = (Chip8_Profile*)malloc(sizeof(Chip8_Profile));
+	if (!profile) crash("Failed to allocate the Chip8 profile");
+
+	memset(profile, 0x00, sizeof(Chip8_Profile));
+	profile->previous[0] = Chip8_Op::UNDECODED;
+	profile->previous[1] = Chip8_Op::UNDECODED;
+
+	return profile;
+}
+
+void Chip8_destroy_profile(Chip8_Profile* profile){
+	free(profile);
+}
+
+static void Chip8_memory_profile_count(Chip8* chip8, u16* counters, u16 adress, u16 size){
+	if (!Chip8_is_valid_memory(chip8, adress, size)) return;
+
+	for (u16 iadress = adress; iadress != adress + size; ++iadress)
+		counters[iadress] += counters[iadress] != UINT16_MAX;
+}
+
+// counted before the instruction is executed so that I is the adress being accessed
+static void Chip8_memory_profile_record(Chip8* chip8, Chip8_Memory_Profile* profile, const Chip8_Op& op){
+	Chip8_memory_profile_count(chip8, profile->fetch, chip8->PC, op.type == Chip8_Op::LD_I_LONG ? 4u : 2u);
+
+	u16 range_size = (op.x <= op.y ? op.y - op.x : op.x - op.y) + 1u;
+	switch (op.type){
+		case Chip8_Op::DRW_VX_VY_N:
+			Chip8_memory_profile_count(chip8, profile->read, chip8->I, Chip8_sprite_size(chip8, op.n));
+			break;
+		case Chip8_Op::DRW_VX_VY_0:
+			Chip8_memory_profile_count(chip8, profile->read, chip8->I, Chip8_sprite_size(chip8, 32u));
+			break;
+		case Chip8_Op::LD_VX_MEM:
+			Chip8_memory_profile_count(chip8, profile->read, chip8->I, op.x + 1u);
+			break;
+		case Chip8_Op::LD_MEM_VX:
+			Chip8_memory_profile_count(chip8, profile->write, chip8->I, op.x + 1u);
+			break;
+		case Chip8_Op::LD_B_VX:
+			Chip8_memory_profile_count(chip8, profile->write, chip8->I, 3u);
+			break;
+		case Chip8_Op::LD_VX_VY_MEM:
+			Chip8_memory_profile_count(chip8, profile->read, chip8->I, range_size);
+			break;
+		case Chip8_Op::LD_MEM_VX_VY:
+			Chip8_memory_profile_count(chip8, profile->write, chip8->I, range_size);
+			break;
+		case Chip8_Op::LD_AUDIO:
+			Chip8_memory_profile_count(chip8, profile->read, chip8->I, sizeof(Chip8::AUDIO_PATTERN));
+			break;
+		default:
+			break;
+	}
+}
+
+void Chip8_execute_profiled(Chip8* chip8, int instruction_count){
+	Chip8_Profile* profile = chip8->PROFILE;
+	Chip8_Memory_Profile* memory_profile = chip8->MEMORY_PROFILE;
+
+	while (instruction_count && !chip8->ERROR){
+		Chip8_Op op;
+		op.type = Chip8_Op::UNKNOWN;
+		if (Chip8_is_valid_memory(chip8, chip8->PC, 2))
+			op = Chip8_decode(Chip8_fetch(chip8, chip8->PC), chip8->MACHINE);
+
+		if (memory_profile) Chip8_memory_profile_record(chip8, memory_profile, op);
+
+		Chip8_execute_decoded(chip8, 1);
+		if (chip8->ERROR) break;
+
+		if (profile){
+			Chip8_Op::TYPE type = op.type;
+
+			++profile->instruction_count;
+			if (profile->previous[1] != Chip8_Op::UNDECODED){
+				++profile->pair_count[profile->previous[1]][type];
+				if (profile->previous[0] != Chip8_Op::UNDECODED)
+					++profile->triple_count[profile->previous[0]][profile->previous[1]][type];
+			}
+			profile->previous[0] = profile->previous[1];
+			profile->previous[1] = type;
+		}
+
+		--instruction_count;
+	}
+}
+
+struct Chip8_Profile_Entry{
+	u64 count;
+	Chip8_Op::TYPE types[3];
+};
+
+static int Chip8_profile_entry_compare(const void* A, const void* B){
+	u64 countA = ((const Chip8_Profile_Entry*)A)->count;
+	u64 countB = ((const Chip8_Profile_Entry*)B)->count;
+	return (countA < countB) - (countA > countB);
+}
+
+static void Chip8_profile_report_sequences(Chip8_Profile* profile, FILE* output, int entry_count, int length){
+	constexpr size_t type_count = Chip8_Op::TYPE_COUNT;
+	size_t sequence_count = length == 2 ? type_count * type_count : type_count * type_count * type_count;
+	u64* counts = length == 2 ? &profile->pair_count[0][0] : &profile->triple_count[0][0][0];
+
+	Chip8_Profile_Entry* entries = (Chip8_Profile_Entry*)malloc(sizeof(Chip8_Profile_Entry) * sequence_count);
+	if (!entries) crash("Failed to allocate the Chip8 profile report");
+
+	size_t used_count = 0u;
+	for (size_t isequence = 0; isequence != sequence_count; ++isequence){
+		if (!counts[isequence]) continue;
+
+		Chip8_Profile_Entry& entry = entries[used_count++];
+		entry.count = counts[isequence];
+		entry.types[0] = (Chip8_Op::TYPE)(isequence / (type_count * type_count));
+		entry.types[1] = (Chip8_Op::TYPE)((isequence / type_count) % type_count);
+		entry.types[2] = (Chip8_Op::TYPE)(isequence % type_count);
+	}
+
+	qsort(entries, used_count, sizeof(Chip8_Profile_Entry), Chip8_profile_entry_compare);
+
+	fprintf(output, "---- %s\n", length == 2 ? "pairs" : "triples");
+	for (size_t ientry = 0; ientry != min(used_count, (size_t)entry_count); ++ientry){
+		Chip8_Profile_Entry& entry = entries[ientry];
+		double percentage = 100. * (double)entry.count / (double)max(profile->instruction_count, (u64)1u);
+
+		if (length == 2)
+			fprintf(output, "%6.2f%% ; %s ; %s\n", percentage, Chip8_Op::TYPE_NAME[entry.types[1]], Chip8_Op::TYPE_NAME[entry.types[2]]);
+		else
+			fprintf(output, "%6.2f%% ; %s ; %s ; %s\n", percentage, Chip8_Op::TYPE_NAME[entry.types[0]], Chip8_Op::TYPE_NAME[entry.types[1]], Chip8_Op::TYPE_NAME[entry.types[2]]);
+	}
+
+	free(entries);
+}
+
+void Chip8_profile_report(Chip8_Profile* profile, FILE* output, int entry_count){
+	fprintf(output, "---- %llu instructions\n", (unsigned long long)profile->instruction_count);
+	Chip8_profile_report_sequences(profile, output, entry_count, 2);
+	Chip8_profile_report_sequences(profile, output, entry_count, 3);
+}
+
+// Memory accesses
+//
+// * recorded by Chip8_execute_profiled from the unfused decoding of the instruction at PC
+// * u16 counters keep the three maps of the 4 KB of CHIP8 and SUPERCHIP in 24 KB so that profiling does not evict the Chip8 from the cache
+// * the heatmap stops at the last 4 KB accessed so that only the XOCHIP ROMs using more memory get a taller heatmap
+
+Chip8_Memory_Profile* Chip8_create_memory_profile(){
+	Chip8_Memory_Profile* profile = (Chip8_Memory_Profile*)malloc(sizeof(Chip8_Memory_Profile));
+	if (!profile) crash("Failed to allocate the Chip8 memory profile");
+
+	memset(profile, 0x00, sizeof(Chip8_Memory_Profile));
+
+	return profile;
+}
+
+void Chip8_destroy_memory_profile(Chip8_Memory_Profile* profile){
+	free(profile);
+}
+
+// 0 for no access and 64 - 255 for 1 - UINT16_MAX accesses
+static u8 Chip8_memory_profile_intensity(u16 count){
+	if (!count) return 0x00;
+
+	int log2_count = 0;
+	while (count >> (log2_count + 1)) ++log2_count;
+
+	return (u8)(64 + (191 * log2_count) / 15);
+}
+
+// end of the last 4 KB with an access
+static int Chip8_memory_profile_size(Chip8_Memory_Profile* profile){
+	int size = Kilobytes(4);
+	for (int adress = size; adress != sizeof(Chip8::Memory); ++adress)
+		if (profile->fetch[adress] || profile->read[adress] || profile->write[adress])
+			size = (adress / Kilobytes(4) + 1) * Kilobytes(4);
+	return size;
+}
+
+void Chip8_memory_profile_to_canvas(Chip8_Memory_Profile* profile, Pixel_Canvas& canvas, int scale){
+	constexpr int row_size = 64;
+	int memory_size = Chip8_memory_profile_size(profile);
+	int row_count = memory_size / row_size;
+
+	canvas.set_resolution(row_size * scale, row_count * scale);
+
+	for (int adress = 0; adress != memory_size; ++adress){
+		RGBA color;
+		color.r = Chip8_memory_profile_intensity(profile->write[adress]);
+		color.g = Chip8_memory_profile_intensity(profile->read[adress]);
+		color.b = Chip8_memory_profile_intensity(profile->fetch[adress]);
+		color.a = 0xFF;
+
+		// Pixel_Canvas has a bottom-left origin
+		int x = (adress % row_size) * scale;
+		int y = (row_count - 1 - adress / row_size) * scale;
+		for (int iy = 0; iy != scale; ++iy)
+			for (int ix = 0; ix != scale; ++ix)
+				canvas.set_pixel(x + ix, y + iy, color);
+	}
+}
+
+void Chip8_memory_profile_report(Chip8_Memory_Profile* profile, FILE* output){
+	fprintf(output, "adress,fetch,read,write\n");
+	for (int adress = 0; adress != sizeof(Chip8::Memory); ++adress){
+		if (!profile->fetch[adress] && !profile->read[adress] && !profile->write[adress]) continue;
+		fprintf(output, "0x%03X,%u,%u,%u\n", adress, profile->fetch[adress], profile->read[adress], profile->write[adress]);
+	}
+}
+
+int Chip8_save_memory_profile(Chip8_Memory_Profile* profile, const char* path){
+	char file_path[1024];
+
+	snprintf(file_path, sizeof(file_path), "%s.csv", path);
+	FILE* file = fopen(file_path, "w");
+	if (!file) return false;
+
+	Chip8_memory_profile_report(profile, file);
+	int success = !ferror(file);
+	success &= fclose(file) == 0;
+
+	Pixel_Canvas canvas;
+	canvas.create();
+	Chip8_memory_profile_to_canvas(profile, canvas, 8);
+
+	snprintf(file_path, sizeof(file_path), "%s.ppm", path);
+	success &= canvas.save_PPM(file_path);
+	canvas.destroy();
+
+	return success;
+}
+
+#if defined(CHIP8_OPCODE_STATS)
+
+// Opcode classes
+//
+// * every opcode dispatched by Chip8_execute_counted is counted ; a superinstruction counts once
+// * Chip8_execute_counted is an instantiation of Chip8_execute_decoded that increments OPCODE_STATS::count ; the one used
+//   without OPCODE_STATS has no counting code, and Chip8_run only calls Chip8_execute_sampled when a sample is due in the run
+// * one instruction every sample_period dispatched ones is executed alone by Chip8_execute_sampled and timed around Chip8_execute_counted ;
+//   Chip8_execute_counted stops before the next sample so that the idle loops still retire the rest of a step at once
+// * the cycles of an empty Chip8_execute_counted call are measured once and subtracted from the samples
+// * the cycle counter is rdtsc on x64 and g_timer elsewhere
+
+Chip8_Opcode_Stats* Chip8_create_opcode_stats(u32 sample_period){
+	Chip8_Opcode_Stats* stats = (Chip8_Opcode_Stats*)malloc(sizeof(Chip8_Opcode_Stats));
+	if (!stats) crash("Failed to allocate the Chip8 opcode stats");
+
+	memset(stats, 0x00, sizeof(Chip8_Opcode_Stats));
+	stats->sample_period = sample_period;
+	stats->sample_countdown = sample_period;
+	stats->sample_overhead = UINT64_MAX;
+
+	return stats;
+}
+
+void Chip8_destroy_opcode_stats(Chip8_Opcode_Stats* stats){
+	free(stats);
+}
+
+static void Chip8_opcode_stats_calibrate(Chip8* chip8, Chip8_Opcode_Stats* stats){
+	constexpr int calibration_count = 64;
+
+	for (int icalibration = 0; icalibration != calibration_count; ++icalibration){
+		u64 start = Chip8_read_cycle_counter();
+		Chip8_execute_counted(chip8, 0);
+		u64 end = Chip8_read_cycle_counter();
+		stats->sample_overhead = min(stats->sample_overhead, end - start);
+	}
+}
+
+void Chip8_execute_sampled(Chip8* chip8, int instruction_count){
+	Chip8_Opcode_Stats* stats = chip8->OPCODE_STATS;
+	if (stats->sample_overhead == UINT64_MAX) Chip8_opcode_stats_calibrate(chip8, stats);
+
+	while (instruction_count && !chip8->ERROR){
+		if (stats->sample_countdown){
+			u64 start_cycle = chip8->CYCLE;
+			Chip8_execute_counted(chip8, instruction_count);
+
+			instruction_count -= (int)(chip8->CYCLE - start_cycle);
+			continue;
+		}
+
+		// superinstructions execute their first instruction only when executed alone
+		Chip8_Op::TYPE type = Chip8_Op::UNKNOWN;
+		if (Chip8_is_valid_memory(chip8, chip8->PC, 2))
+			type = Chip8_decode(Chip8_fetch(chip8, chip8->PC), chip8->MACHINE).type;
+
+		stats->sample_countdown = stats->sample_period;
+
+		u64 start = Chip8_read_cycle_counter();
+		Chip8_execute_counted(chip8, 1);
+		u64 end = Chip8_read_cycle_counter();
+
+		u64 cycles = end - start > stats->sample_overhead ? end - start - stats->sample_overhead : 0u;
+
+		int bucket = 0;
+		while (bucket != Chip8_Opcode_Stats::histogram_size - 1 && (cycles >> (bucket + 1)))
+			++bucket;
+
+		++stats->sample_count[type];
+		stats->sample_cycles[type] += cycles;
+		++stats->histogram[type][bucket];
+
+		--instruction_count;
+	}
+}
+
+static int Chip8_opcode_stats_compare(const void* A, const void* B){
+	u64 countA = ((const Chip8_Profile_Entry*)A)->count;
+	u64 countB = ((const Chip8_Profile_Entry*)B)->count;
+	if (countA != countB) return (countA < countB) - (countA > countB);
+
+	Chip8_Op::TYPE typeA = ((const Chip8_Profile_Entry*)A)->types[0];
+	Chip8_Op::TYPE typeB = ((const Chip8_Profile_Entry*)B)->types[0];
+	return (typeA > typeB) - (typeA < typeB);
+}
+
+void Chip8_opcode_stats_report(Chip8_Opcode_Stats* stats, FILE* output){
+	Chip8_Profile_Entry entries[Chip8_Op::TYPE_COUNT];
+
+	u64 total_count = 0u;
+	u64 total_samples = 0u;
+	int used_count = 0;
+	for (int itype = 0; itype != Chip8_Op::TYPE_COUNT; ++itype){
+		total_count += stats->count[itype];
+		total_samples += stats->sample_count[itype];
+		if (!stats->count[itype]) continue;
+
+		Chip8_Profile_Entry& entry = entries[used_count++];
+		entry.count = stats->count[itype];
+		entry.types[0] = (Chip8_Op::TYPE)itype;
+	}
+
+	qsort(entries, used_count, sizeof(Chip8_Profile_Entry), Chip8_opcode_stats_compare);
+
+	fprintf(output, "---- %llu opcodes ; %llu samples\n", (unsigned long long)total_count, (unsigned long long)total_samples);
+	for (int ientry = 0; ientry != used_count; ++ientry){
+		Chip8_Profile_Entry& entry = entries[ientry];
+		Chip8_Op::TYPE type = entry.types[0];
+		double percentage = 100. * (double)entry.count / (double)max(total_count, (u64)1u);
+
+		fprintf(output, "%6.2f%% ; %12llu ; %-20s", percentage, (unsigned long long)entry.count, Chip8_Op::TYPE_NAME[type]);
+		if (stats->sample_count[type]){
+			double mean = (double)stats->sample_cycles[type] / (double)stats->sample_count[type];
+			fprintf(output, " ; %8.1f cycles ; log2 histogram", mean);
+			for (int ibucket = 0; ibucket != Chip8_Opcode_Stats::histogram_size; ++ibucket)
+				fprintf(output, " %llu", (unsigned long long)stats->histogram[type][ibucket]);
+		}
+		fprintf(output, "\n");
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "chip8.h"
+
+// Detection of the quirk set of a ROM by running it with every quirk set
+//
+// * every trial has its own Chip8 and runs on the DECODED backend one instruction at a time so that every
+//   executed adress is counted ; the trials share nothing but the ROM
+// * the keys are pressed in turn so that the ROMs waiting for a key go past their title screen
+// * a wrong quirk set usually raises an ERROR when I or a BXNN jump leaves the memory, or loops in fewer adresses
+
+// frames between two keys ; a key is held for the first g_quirk_key_held_frames of them
+static constexpr u32 g_quirk_key_period = 15u;
+static constexpr u32 g_quirk_key_held_frames = 5u;
+static constexpr u32 g_quirk_frames_per_second = 60u;
+
+void Chip8_quirk_trial(Chip8_Quirk_Trial& trial, const void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine, Chip8_Quirks::TYPE quirks, u32 frame_count){
+	Chip8* chip8 = (Chip8*)malloc(sizeof(Chip8));
+	if (!chip8) crash("Failed to allocate the Chip8 of a quirk trial");
+
+	Chip8_create(chip8, (void*)ROM, ROM_size, machine);
+	chip8->QUIRKS = quirks;
+	chip8->BACKEND = Chip8::DECODED;
+
+	// one bit per adress of the largest memory
+	u64 executed[Kilobytes(64) / 64u] = {};
+
+	trial.quirks = quirks;
+	trial.frame_count = 0u;
+	trial.PC_count = 0u;
+	trial.screen_frame_count = 0u;
+
+	u32 instructions_per_frame = max(chip8->instructions_per_second / g_quirk_frames_per_second, 1u);
+	for (u32 iframe = 0u; iframe != frame_count && !chip8->ERROR; ++iframe){
+		memset(chip8->KEYBOARD, 0, sizeof(Chip8::KEYBOARD));
+		chip8->KEYBOARD[(iframe / g_quirk_key_period) % 16u] = iframe % g_quirk_key_period < g_quirk_key_held_frames;
+
+		u64 screen_generation = chip8->SCREEN_GENERATION;
+		for (u32 iinstruction = 0u; iinstruction != instructions_per_frame && !chip8->ERROR; ++iinstruction){
+			u64 PC_bit = (u64)1u << (chip8->PC % 64u);
+			if (!(executed[chip8->PC / 64u] & PC_bit)){
+				executed[chip8->PC / 64u] |= PC_bit;
+				++trial.PC_count;
+			}
+			Chip8_run(chip8, 1);
+		}
+
+		if (chip8->SCREEN_GENERATION != screen_generation) ++trial.screen_frame_count;
+		if (!chip8->ERROR) ++trial.frame_count;
+	}
+
+	trial.ERROR = chip8->ERROR;
+
+	Chip8_destroy(chip8);
+	free(chip8);
+}
+
+// a quirk set that is not used by the ROM still changes a few adresses and screen frames, so only a lead above
+// 1 / g_quirk_lead_divisor of the other count is taken as a sign of better quirks
+static constexpr u32 g_quirk_lead_divisor = 8u;
+
+static int Chip8_quirk_count_leads(u32 count, u32 other){
+	return count > other + other / g_quirk_lead_divisor;
+}
+
+int Chip8_quirk_trial_is_better(const Chip8_Quirk_Trial& trial, const Chip8_Quirk_Trial& other){
+	if (!trial.ERROR != !other.ERROR) return !trial.ERROR;
+	if (trial.frame_count != other.frame_count) return trial.frame_count > other.frame_count;
+	if (Chip8_quirk_count_leads(other.PC_count, trial.PC_count)) return false;
+	if (Chip8_quirk_count_leads(trial.PC_count, other.PC_count)) return true;
+	return Chip8_quirk_count_leads(trial.screen_frame_count, other.screen_frame_count);
+}
+
+struct Chip8_Quirk_Job{
+	Chip8_Quirk_Trial* trial;
+	const void* ROM;
+	size_t ROM_size;
+	Chip8::MACHINE_TYPE machine;
+	Chip8_Quirks::TYPE quirks;
+};
+
+static void Chip8_quirk_job(void* param){
+	Chip8_Quirk_Job* job = (Chip8_Quirk_Job*)param;
+	Chip8_quirk_trial(*job->trial, job->ROM, job->ROM_size, job->machine, job->quirks, Chip8_quirk_trial_frames);
+}
+
+Chip8_Quirks::TYPE Chip8_detect_quirks(const void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine, Chip8_Quirk_Trial (&trials)[Chip8_Quirks::TYPE_COUNT]){
+	Chip8_Quirk_Job jobs[Chip8_Quirks::TYPE_COUNT];
+	Thread threads[Chip8_Quirks::TYPE_COUNT];
+
+	for (int iquirks = 0; iquirks != Chip8_Quirks::TYPE_COUNT; ++iquirks){
+		Chip8_Quirk_Job& job = jobs[iquirks];
+		job.trial = &trials[iquirks];
+		job.ROM = ROM;
+		job.ROM_size = ROM_size;
+		job.machine = machine;
+		job.quirks = (Chip8_Quirks::TYPE)iquirks;
+		create_thread(&threads[iquirks], Chip8_quirk_job, &job);
+	}
+
+	for (int iquirks = 0; iquirks != Chip8_Quirks::TYPE_COUNT; ++iquirks)
+		join_thread(&threads[iquirks]);
+
+	// the default quirk set of the machine is only replaced by a clearly better trial, so ties keep it
+	Chip8_Quirks::TYPE best = Chip8_default_quirks(machine);
+	for (int iquirks = 0; iquirks != Chip8_Quirks::TYPE_COUNT; ++iquirks)
+		if (Chip8_quirk_trial_is_better(trials[iquirks], trials[best])) best = (Chip8_Quirks::TYPE)iquirks;
+
+	return best;
+}
+
+int Chip8_quirk_cache_find(const char* path, u64 ROM_hash, Chip8_Quirks::TYPE& quirks){
+	FILE* file = fopen(path, "r");
+	if (!file) return false;
+
+	int found = false;
+	char line[64];
+	while (fgets(line, sizeof(line), file)){
+		unsigned long long line_hash;
+		char name[16];
+		Chip8_Quirks::TYPE line_quirks;
+		if (sscanf(line, "%llx %15s", &line_hash, name) == 2 && line_hash == ROM_hash && Chip8_quirks_from_name(name, line_quirks)){
+			quirks = line_quirks;
+			found = true;
+		}
+	}
+
+	fclose(file);
+	return found;
+}
+
+int Chip8_quirk_cache_add(const char* path, u64 ROM_hash, Chip8_Quirks::TYPE quirks){
+	FILE* file = fopen(path, "a");
+	if (!file) return false;
+
+	int written = fprintf(file, "%016llx %s\n", (unsigned long long)ROM_hash, Chip8_Quirks::TYPE_NAME[quirks]) > 0;
+	return (fclose(file) == 0) && written;
+}
@@ -0,0 +1,252 @@
+#include "chip8.h"
+
+// Rewind
+//
+// * the states are the save states of Chip8_save_state so that rewinding restores exactly what loading a save state does
+// * a delta is a list of u16 equal byte count ; u16 XOR byte count ; XOR bytes ; the equal bytes after the last XOR bytes are implicit
+// * XOR bytes end at the first run of equal bytes longer than a token header
+// * runs longer than UINT16_MAX are split ; XOCHIP states can be larger than 64 KB
+// * a keyframe is written instead of a delta when the delta is larger than the state
+
+// u16 equal byte count ; u16 XOR byte count
+static constexpr size_t Chip8_rewind_token_header_size = 4u;
+
+static u32 Chip8_rewind_entry_index(Chip8_Rewind* rewind, u32 age){
+	return (rewind->first_entry + age) % rewind->entry_capacity;
+}
+
+static Chip8_Rewind_Entry& Chip8_rewind_newest_entry(Chip8_Rewind* rewind, u32 rank = 0u){
+	ram_assert(rank < rewind->entry_count);
+	return rewind->entries[Chip8_rewind_entry_index(rewind, rewind->entry_count - 1u - rank)];
+}
+
+// ---- delta
+
+static int Chip8_rewind_equal_words(const u8* A, const u8* B){
+	u64 wordA, wordB;
+	memcpy(&wordA, A, sizeof(u64));
+	memcpy(&wordB, B, sizeof(u64));
+	return wordA == wordB;
+}
+
+// returns false when the delta does not fit in capacity
+static int Chip8_rewind_encode(const u8* A, const u8* B, size_t size, u8* delta, size_t capacity, size_t& delta_size){
+	size_t cursor = 0u;
+	size_t adress = 0u;
+	while (true){
+		size_t equal_begin = adress;
+		while (adress != size){
+			if (adress % 8u == 0u && size - adress >= 8u && Chip8_rewind_equal_words(A + adress, B + adress)) adress += 8u;
+			else if (A[adress] == B[adress]) ++adress;
+			else break;
+		}
+		if (adress == size) break;
+
+		size_t xor_begin = adress;
+		size_t xor_end = adress + 1u;
+		size_t equal_count = 0u;
+		for (adress = xor_end; adress != size && equal_count <= Chip8_rewind_token_header_size; ++adress){
+			if (A[adress] == B[adress]){
+				++equal_count;
+			}
+			else{
+				equal_count = 0u;
+				xor_end = adress + 1u;
+			}
+		}
+		xor_end = min(xor_end, xor_begin + UINT16_MAX);
+		adress = xor_end;
+
+		size_t equal_size = xor_begin - equal_begin;
+		size_t xor_size = xor_end - xor_begin;
+		for (; equal_size > UINT16_MAX; equal_size -= UINT16_MAX){
+			if (capacity - cursor < Chip8_rewind_token_header_size) return false;
+
+			u16 token[2] = {(u16)UINT16_MAX, 0u};
+			memcpy(delta + cursor, token, sizeof(token));
+			cursor += sizeof(token);
+		}
+		if (capacity - cursor < Chip8_rewind_token_header_size + xor_size) return false;
+
+		u16 token[2] = {(u16)equal_size, (u16)xor_size};
+		memcpy(delta + cursor, token, sizeof(token));
+		cursor += sizeof(token);
+		for (size_t ibyte = 0; ibyte != xor_size; ++ibyte)
+			delta[cursor + ibyte] = A[xor_begin + ibyte] ^ B[xor_begin + ibyte];
+		cursor += xor_size;
+	}
+
+	delta_size = cursor;
+	return true;
+}
+
+// XORs the delta into state ; applying the delta of a frame turns the state of its previous frame into its state and back
+static void Chip8_rewind_apply(const u8* delta, size_t delta_size, u8* state){
+	size_t cursor = 0u;
+	size_t adress = 0u;
+	while (cursor != delta_size){
+		u16 token[2];
+		memcpy(token, delta + cursor, sizeof(token));
+		cursor += sizeof(token);
+
+		adress += token[0];
+		for (u16 ibyte = 0u; ibyte != token[1]; ++ibyte)
+			state[adress + ibyte] ^= delta[cursor + ibyte];
+		adress += token[1];
+		cursor += token[1];
+	}
+	ram_assert(adress <= Chip8_state_max_size);
+}
+
+// ---- entries
+
+static void Chip8_rewind_drop_oldest(Chip8_Rewind* rewind){
+	ram_assert(rewind->entry_count);
+	rewind->first_entry = Chip8_rewind_entry_index(rewind, 1u);
+	--rewind->entry_count;
+	if (!rewind->entry_count) rewind->data_head = 0u;
+}
+
+// the deltas of a keyframe are dropped with it so that the oldest entry is always a keyframe
+static void Chip8_rewind_drop_oldest_keyframe(Chip8_Rewind* rewind){
+	do{
+		Chip8_rewind_drop_oldest(rewind);
+	} while (rewind->entry_count && rewind->entries[rewind->first_entry].keyframe_distance);
+}
+
+// drops the oldest entries until size bytes are free at the returned offset
+static u32 Chip8_rewind_allocate(Chip8_Rewind* rewind, size_t size){
+	ram_assert(size <= rewind->data_capacity);
+
+	while (rewind->entry_count == rewind->entry_capacity)
+		Chip8_rewind_drop_oldest_keyframe(rewind);
+
+	size_t offset = rewind->data_head;
+	if (offset + size > rewind->data_capacity){
+		// the entries after the head are the oldest ones
+		while (rewind->entry_count && rewind->entries[rewind->first_entry].offset >= offset)
+			Chip8_rewind_drop_oldest_keyframe(rewind);
+		offset = 0u;
+	}
+
+	while (rewind->entry_count){
+		Chip8_Rewind_Entry& oldest = rewind->entries[rewind->first_entry];
+		if (oldest.offset >= offset + size || oldest.offset + oldest.size <= offset) break;
+		Chip8_rewind_drop_oldest_keyframe(rewind);
+	}
+
+	return (u32)offset;
+}
+
+static void Chip8_rewind_push(Chip8_Rewind* rewind, const u8* payload, size_t size, u32 state_size, u32 keyframe_distance){
+	u32 offset = Chip8_rewind_allocate(rewind, size);
+	memcpy(rewind->data + offset, payload, size);
+
+	Chip8_Rewind_Entry& entry = rewind->entries[Chip8_rewind_entry_index(rewind, rewind->entry_count++)];
+	entry.offset = offset;
+	entry.size = (u32)size;
+	entry.state_size = state_size;
+	entry.keyframe_distance = keyframe_distance;
+
+	rewind->data_head = offset + size;
+}
+
+// ---- rewind
+
+Chip8_Rewind* Chip8_create_rewind(size_t data_capacity, u32 frame_capacity, u32 keyframe_period){
+	ram_assert(data_capacity >= 2u * Chip8_state_max_size && data_capacity <= UINT32_MAX);
+	ram_assert(frame_capacity >= 2u && keyframe_period >= 1u);
+
+	Chip8_Rewind* rewind = (Chip8_Rewind*)malloc(sizeof(Chip8_Rewind));
+	if (!rewind) crash("Failed to allocate the Chip8 rewind");
+
+	rewind->keyframe_period = keyframe_period;
+
+	rewind->data = (u8*)malloc(data_capacity);
+	if (!rewind->data) crash("Failed to allocate %zu bytes of Chip8 rewind", data_capacity);
+	rewind->data_capacity = data_capacity;
+	rewind->data_head = 0u;
+
+	rewind->entries = (Chip8_Rewind_Entry*)malloc(sizeof(Chip8_Rewind_Entry) * frame_capacity);
+	if (!rewind->entries) crash("Failed to allocate %u Chip8 rewind frames", frame_capacity);
+	rewind->entry_capacity = frame_capacity;
+	rewind->first_entry = 0u;
+	rewind->entry_count = 0u;
+
+	memset(rewind->states, 0x00, sizeof(rewind->states));
+	rewind->state_sizes[0] = 0u;
+	rewind->state_sizes[1] = 0u;
+	rewind->newest_state = 0;
+
+	return rewind;
+}
+
+void Chip8_destroy_rewind(Chip8_Rewind* rewind){
+	free(rewind->entries);
+	free(rewind->data);
+	free(rewind);
+}
+
+void Chip8_rewind_capture(Chip8_Rewind* rewind, Chip8* chip8){
+	int current = rewind->newest_state ^ 1;
+	u8* state = rewind->states[current];
+	const u8* previous_state = rewind->states[rewind->newest_state];
+
+	// the bytes of the previous capture in this buffer are zeroed back
+	size_t state_size = Chip8_save_state(chip8, state, Chip8_state_max_size);
+	ram_assert(state_size);
+	if (rewind->state_sizes[current] > state_size)
+		memset(state + state_size, 0x00, rewind->state_sizes[current] - state_size);
+	rewind->state_sizes[current] = (u32)state_size;
+	rewind->newest_state = current;
+
+	if (rewind->entry_count){
+		u32 keyframe_distance = Chip8_rewind_newest_entry(rewind).keyframe_distance + 1u;
+		size_t delta_size;
+		if (keyframe_distance < rewind->keyframe_period
+			&& Chip8_rewind_encode(state, previous_state, max(state_size, (size_t)Chip8_rewind_newest_entry(rewind).state_size),
+				rewind->delta, state_size, delta_size)){
+			Chip8_rewind_push(rewind, rewind->delta, delta_size, (u32)state_size, keyframe_distance);
+
+			// a delta alone has lost its keyframe to the ring wrapping onto it
+			if (rewind->entry_count != 1u) return;
+			Chip8_rewind_drop_oldest(rewind);
+		}
+	}
+
+	Chip8_rewind_push(rewind, state, state_size, (u32)state_size, 0u);
+}
+
+int Chip8_rewind_step_back(Chip8_Rewind* rewind, Chip8* chip8){
+	if (rewind->entry_count < 2u) return false;
+
+	Chip8_Rewind_Entry newest = Chip8_rewind_newest_entry(rewind);
+	Chip8_Rewind_Entry previous = Chip8_rewind_newest_entry(rewind, 1u);
+
+	u8* state = rewind->states[rewind->newest_state];
+	if (newest.keyframe_distance){
+		Chip8_rewind_apply(rewind->data + newest.offset, newest.size, state);
+	}
+	else{
+		// the previous frame is rebuilt from its keyframe
+		Chip8_Rewind_Entry& keyframe = Chip8_rewind_newest_entry(rewind, 1u + previous.keyframe_distance);
+		ram_assert(keyframe.keyframe_distance == 0u);
+
+		memcpy(state, rewind->data + keyframe.offset, keyframe.size);
+		if (rewind->state_sizes[rewind->newest_state] > keyframe.size)
+			memset(state + keyframe.size, 0x00, rewind->state_sizes[rewind->newest_state] - keyframe.size);
+
+		for (u32 irank = previous.keyframe_distance; irank != 0u; --irank){
+			Chip8_Rewind_Entry& delta = Chip8_rewind_newest_entry(rewind, irank);
+			Chip8_rewind_apply(rewind->data + delta.offset, delta.size, state);
+		}
+	}
+
+	--rewind->entry_count;
+	rewind->data_head = previous.offset + previous.size;
+	rewind->state_sizes[rewind->newest_state] = previous.state_size;
+
+	int loaded = Chip8_load_state(chip8, state, previous.state_size);
+	ram_assert(loaded);
+	return true;
+}
@@ -0,0 +1,393 @@
+#include "chip8.h"
+
+// Save states
+//
+// * every field is written byte by byte in little-endian so that states are exchanged between platforms
+// * DT and ST are stored as their values at CYCLE ; the timers count down from CYCLE again after loading
+// * the memory is stored as ranges that differ from Chip8_create_memory ; ranges closer than a range header are merged
+// * loading checks the whole state before modifying the Chip8 and only rewrites the memory that changes
+
+// "C8ST"
+static constexpr u32 Chip8_state_magic = 0x54533843u;
+
+struct Chip8_State_Writer{
+	u8* cursor;
+	u8* end;
+};
+
+struct Chip8_State_Reader{
+	const u8* cursor;
+	const u8* end;
+};
+
+// ---- writing ; the capacity is checked once by Chip8_save_state except for the memory delta
+
+static void Chip8_state_write_u8(Chip8_State_Writer& writer, u8 value){
+	*writer.cursor++ = value;
+}
+
+static void Chip8_state_write_u16(Chip8_State_Writer& writer, u16 value){
+	writer.cursor[0] = (u8)value;
+	writer.cursor[1] = (u8)(value >> 8u);
+	writer.cursor += 2;
+}
+
+static void Chip8_state_write_u32(Chip8_State_Writer& writer, u32 value){
+	for (int ibyte = 0; ibyte != 4; ++ibyte)
+		writer.cursor[ibyte] = (u8)(value >> (8u * ibyte));
+	writer.cursor += 4;
+}
+
+static void Chip8_state_write_u64(Chip8_State_Writer& writer, u64 value){
+	for (int ibyte = 0; ibyte != 8; ++ibyte)
+		writer.cursor[ibyte] = (u8)(value >> (8u * ibyte));
+	writer.cursor += 8;
+}
+
+static void Chip8_state_write_bytes(Chip8_State_Writer& writer, const u8* data, size_t size){
+	memcpy(writer.cursor, data, size);
+	writer.cursor += size;
+}
+
+// ---- reading ; returns false past the end of the state
+
+static int Chip8_state_read_u8(Chip8_State_Reader& reader, u8& value){
+	if (reader.end - reader.cursor < 1) return false;
+	value = *reader.cursor++;
+	return true;
+}
+
+static int Chip8_state_read_u16(Chip8_State_Reader& reader, u16& value){
+	if (reader.end - reader.cursor < 2) return false;
+	value = (u16)(reader.cursor[0] | (reader.cursor[1] << 8u));
+	reader.cursor += 2;
+	return true;
+}
+
+static int Chip8_state_read_u32(Chip8_State_Reader& reader, u32& value){
+	if (reader.end - reader.cursor < 4) return false;
+	value = 0u;
+	for (int ibyte = 0; ibyte != 4; ++ibyte)
+		value |= (u32)reader.cursor[ibyte] << (8u * ibyte);
+	reader.cursor += 4;
+	return true;
+}
+
+static int Chip8_state_read_u64(Chip8_State_Reader& reader, u64& value){
+	if (reader.end - reader.cursor < 8) return false;
+	value = 0u;
+	for (int ibyte = 0; ibyte != 8; ++ibyte)
+		value |= (u64)reader.cursor[ibyte] << (8u * ibyte);
+	reader.cursor += 8;
+	return true;
+}
+
+static int Chip8_state_read_bytes(Chip8_State_Reader& reader, u8* data, size_t size){
+	if ((size_t)(reader.end - reader.cursor) < size) return false;
+	memcpy(data, reader.cursor, size);
+	reader.cursor += size;
+	return true;
+}
+
+// FNV-1a over little-endian u64 words instead of bytes ; the last word is padded with zeros
+// 8 times fewer multiplications than FNV1a so that the checksum does not dominate save and load
+static u64 Chip8_state_checksum(const u8* data, size_t size){
+	u64 hash = FNV1a_offset_basis;
+
+	size_t word_count = size / 8u;
+	for (size_t iword = 0; iword != word_count; ++iword){
+		const u8* bytes = data + iword * 8u;
+		u64 word = (u64)bytes[0] | (u64)bytes[1] << 8u | (u64)bytes[2] << 16u | (u64)bytes[3] << 24u
+			| (u64)bytes[4] << 32u | (u64)bytes[5] << 40u | (u64)bytes[6] << 48u | (u64)bytes[7] << 56u;
+		hash ^= word;
+		hash *= 0x100000001B3ULL;
+	}
+
+	if (size % 8u){
+		u64 word = 0u;
+		for (size_t ibyte = word_count * 8u; ibyte != size; ++ibyte)
+			word |= (u64)data[ibyte] << (8u * (ibyte % 8u));
+		hash ^= word;
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+// ---- memory delta
+
+// equal memory is skipped a chunk at a time with memcmp, which the C runtimes vectorize, then a word at a time
+static constexpr size_t Chip8_state_chunk_size = 256u;
+
+static size_t Chip8_state_skip_equal(const u8* A, const u8* B, size_t adress, size_t memory_size){
+	ram_assert(memory_size % Chip8_state_chunk_size == 0u);
+
+	while (adress != memory_size){
+		if (adress % Chip8_state_chunk_size == 0u && memcmp(A + adress, B + adress, Chip8_state_chunk_size) == 0){
+			adress += Chip8_state_chunk_size;
+		}
+		else if (adress % 8u == 0u && memcmp(A + adress, B + adress, 8u) == 0){
+			adress += 8u;
+		}
+		else if (A[adress] == B[adress]){
+			++adress;
+		}
+		else{
+			break;
+		}
+	}
+	return adress;
+}
+
+// REF: https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord [Determine if a word has a zero byte]
+static int Chip8_state_has_equal_byte(const u8* A, const u8* B){
+	u64 wordA, wordB;
+	memcpy(&wordA, A, sizeof(u64));
+	memcpy(&wordB, B, sizeof(u64));
+	u64 difference = wordA ^ wordB;
+	return ((difference - 0x0101010101010101ULL) & ~difference & 0x8080808080808080ULL) != 0u;
+}
+
+// u16 adress ; u16 size ; size bytes ; ranges longer than UINT16_MAX are split
+static constexpr size_t Chip8_state_range_header_size = 4u;
+
+static int Chip8_state_write_delta(Chip8_State_Writer& writer, const u8* memory, const u8* base, size_t memory_size){
+
+	u8* range_count_cursor = writer.cursor;
+	if (writer.end - writer.cursor < 2) return false;
+	writer.cursor += 2;
+
+	u16 range_count = 0u;
+	size_t adress = 0u;
+	while ((adress = Chip8_state_skip_equal(memory, base, adress, memory_size)) != memory_size){
+
+		// the range ends at the first run of equal bytes longer than a range header
+		size_t range_end = adress + 1u;
+		size_t equal_count = 0u;
+		size_t iadress = range_end;
+		while (iadress != memory_size && equal_count <= Chip8_state_range_header_size){
+			// words without any equal byte are taken whole
+			if (iadress % 8u == 0u && !Chip8_state_has_equal_byte(memory + iadress, base + iadress)){
+				equal_count = 0u;
+				iadress += 8u;
+				range_end = iadress;
+			}
+			else if (memory[iadress] == base[iadress]){
+				++equal_count;
+				++iadress;
+			}
+			else{
+				equal_count = 0u;
+				range_end = ++iadress;
+			}
+		}
+
+		size_t range_size = min(range_end - adress, (size_t)UINT16_MAX);
+		range_end = adress + range_size;
+		if ((size_t)(writer.end - writer.cursor) < Chip8_state_range_header_size + range_size) return false;
+
+		Chip8_state_write_u16(writer, (u16)adress);
+		Chip8_state_write_u16(writer, (u16)range_size);
+		Chip8_state_write_bytes(writer, memory + adress, range_size);
+		++range_count;
+
+		adress = range_end;
+	}
+
+	range_count_cursor[0] = (u8)range_count;
+	range_count_cursor[1] = (u8)(range_count >> 8u);
+	return true;
+}
+
+static int Chip8_state_read_delta(Chip8_State_Reader& reader, u8* memory, size_t memory_size){
+	u16 range_count;
+	if (!Chip8_state_read_u16(reader, range_count)) return false;
+
+	for (u16 irange = 0u; irange != range_count; ++irange){
+		u16 adress, size;
+		if (!Chip8_state_read_u16(reader, adress) || !Chip8_state_read_u16(reader, size)) return false;
+		if ((size_t)adress + size > memory_size) return false;
+		if (!Chip8_state_read_bytes(reader, memory + adress, size)) return false;
+	}
+
+	return true;
+}
+
+// ---- save states
+
+size_t Chip8_save_state(Chip8* chip8, void* data, size_t capacity){
+	// everything except the memory delta and the checksum
+	int word_count = chip8->screen_width / 64;
+	int plane_count = chip8->MACHINE == Chip8::XOCHIP ? 2 : 1;
+	size_t fixed_size = 4u + 2u + 8u + 1u + 8u + 4u + 1u
+		+ sizeof(Chip8::registers) + 2u + 2u + 1u + sizeof(Chip8::STACK) + 1u + 1u
+		+ 1u + 1u + plane_count * chip8->screen_height * word_count * 8u + 2u + 2u + sizeof(Random_Data) + sizeof(Chip8::RPL)
+		+ sizeof(Chip8::AUDIO_PATTERN) + 1u;
+	if (capacity < fixed_size + 2u + 8u) return 0u;
+
+	Chip8_State_Writer writer;
+	writer.cursor = (u8*)data;
+	writer.end = (u8*)data + capacity - 8u;
+
+	u32 accumulator_bits;
+	memcpy(&accumulator_bits, &chip8->instruction_accumulator, sizeof(u32));
+
+	Chip8_state_write_u32(writer, Chip8_state_magic);
+	Chip8_state_write_u16(writer, Chip8_state_version);
+	Chip8_state_write_u64(writer, chip8->ROM_HASH);
+	Chip8_state_write_u8(writer, (u8)chip8->MACHINE);
+	Chip8_state_write_u64(writer, chip8->CYCLE);
+	Chip8_state_write_u32(writer, accumulator_bits);
+	Chip8_state_write_u8(writer, (u8)chip8->ERROR);
+
+	Chip8_state_write_bytes(writer, chip8->registers.by_index, sizeof(Chip8::registers));
+	Chip8_state_write_u16(writer, chip8->I);
+	Chip8_state_write_u16(writer, chip8->PC);
+	Chip8_state_write_u8(writer, (u8)chip8->SP);
+	for (int istack = 0; istack != carray_size(Chip8::STACK); ++istack)
+		Chip8_state_write_u16(writer, chip8->STACK[istack]);
+	Chip8_state_write_u8(writer, Chip8_get_DT(chip8));
+	Chip8_state_write_u8(writer, Chip8_get_ST(chip8));
+
+	Chip8_state_write_u8(writer, (u8)(chip8->screen_width == 128));
+	Chip8_state_write_u8(writer, chip8->PLANES);
+	for (int iplane = 0; iplane != plane_count; ++iplane)
+		for (int irow = 0; irow != chip8->screen_height; ++irow)
+			for (int iword = 0; iword != word_count; ++iword)
+				Chip8_state_write_u64(writer, chip8->SCREEN[iplane][irow][iword]);
+
+	Chip8_state_write_u16(writer, Chip8_keyboard_to_mask(chip8->KEYBOARD));
+	Chip8_state_write_u16(writer, Chip8_keyboard_to_mask(chip8->LAST_KEYBOARD));
+
+	Chip8_state_write_u64(writer, chip8->RANDOM.seed[0]);
+	Chip8_state_write_u64(writer, chip8->RANDOM.seed[1]);
+
+	Chip8_state_write_bytes(writer, chip8->RPL, sizeof(Chip8::RPL));
+	Chip8_state_write_bytes(writer, chip8->AUDIO_PATTERN, sizeof(Chip8::AUDIO_PATTERN));
+	Chip8_state_write_u8(writer, chip8->PITCH);
+
+	ram_assert(writer.cursor == (u8*)data + fixed_size);
+
+	Chip8::Memory base;
+	Chip8_create_memory(base, chip8->ROM, chip8->ROM_SIZE, chip8->MACHINE);
+	if (!Chip8_state_write_delta(writer, (const u8*)&chip8->memory, (const u8*)&base, chip8->memory_size)) return 0u;
+
+	size_t size = writer.cursor - (u8*)data;
+	writer.end += 8u;
+	Chip8_state_write_u64(writer, Chip8_state_checksum((const u8*)data, size));
+
+	return size + 8u;
+}
+
+int Chip8_load_state(Chip8* chip8, const void* data, size_t size){
+	if (size < 8u) return false;
+
+	Chip8_State_Reader checksum_reader;
+	checksum_reader.cursor = (const u8*)data + size - 8u;
+	checksum_reader.end = (const u8*)data + size;
+
+	u64 checksum;
+	Chip8_state_read_u64(checksum_reader, checksum);
+	if (checksum != Chip8_state_checksum((const u8*)data, size - 8u)) return false;
+
+	Chip8_State_Reader reader;
+	reader.cursor = (const u8*)data;
+	reader.end = (const u8*)data + size - 8u;
+
+	u32 magic, accumulator_bits;
+	u16 version, I, PC, STACK[16], keyboard, last_keyboard;
+	u64 ROM_hash, CYCLE, SCREEN[2][64][2] = {}, seed[2];
+	u8 machine, error, registers[16], SP, DT, ST, hires, planes, RPL[16], audio_pattern[16], pitch;
+
+	int valid = Chip8_state_read_u32(reader, magic)
+		&& Chip8_state_read_u16(reader, version)
+		&& Chip8_state_read_u64(reader, ROM_hash)
+		&& Chip8_state_read_u8(reader, machine)
+		&& magic == Chip8_state_magic
+		&& version == Chip8_state_version
+		&& ROM_hash == chip8->ROM_HASH
+		&& machine == chip8->MACHINE
+		&& Chip8_state_read_u64(reader, CYCLE)
+		&& Chip8_state_read_u32(reader, accumulator_bits)
+		&& Chip8_state_read_u8(reader, error)
+		&& Chip8_state_read_bytes(reader, registers, sizeof(registers))
+		&& Chip8_state_read_u16(reader, I)
+		&& Chip8_state_read_u16(reader, PC)
+		&& Chip8_state_read_u8(reader, SP);
+	for (int istack = 0; valid && istack != carray_size(STACK); ++istack)
+		valid = Chip8_state_read_u16(reader, STACK[istack]);
+	valid = valid
+		&& Chip8_state_read_u8(reader, DT)
+		&& Chip8_state_read_u8(reader, ST);
+	valid = valid
+		&& Chip8_state_read_u8(reader, hires)
+		&& hires <= (machine != Chip8::CHIP8)
+		&& Chip8_state_read_u8(reader, planes)
+		&& (machine == Chip8::XOCHIP ? planes <= 3u : planes == 1u);
+	int screen_width = hires ? 128 : 64;
+	int screen_height = hires ? 64 : 32;
+	int plane_count = machine == Chip8::XOCHIP ? 2 : 1;
+	for (int iplane = 0; valid && iplane != plane_count; ++iplane)
+		for (int irow = 0; valid && irow != screen_height; ++irow)
+			for (int iword = 0; valid && iword != screen_width / 64; ++iword)
+				valid = Chip8_state_read_u64(reader, SCREEN[iplane][irow][iword]);
+	valid = valid
+		&& Chip8_state_read_u16(reader, keyboard)
+		&& Chip8_state_read_u16(reader, last_keyboard)
+		&& Chip8_state_read_u64(reader, seed[0])
+		&& Chip8_state_read_u64(reader, seed[1])
+		&& Chip8_state_read_bytes(reader, RPL, sizeof(RPL))
+		&& Chip8_state_read_bytes(reader, audio_pattern, sizeof(audio_pattern))
+		&& Chip8_state_read_u8(reader, pitch)
+		&& SP <= carray_size(Chip8::STACK)
+		&& error <= Chip8::SCREEN_COORD_INCORRECT;
+	if (!valid) return false;
+
+	Chip8::Memory memory;
+	Chip8_create_memory(memory, chip8->ROM, chip8->ROM_SIZE, chip8->MACHINE);
+	if (!Chip8_state_read_delta(reader, (u8*)&memory, chip8->memory_size) || reader.cursor != reader.end) return false;
+
+	// the state is valid ; only the memory that changes is written so that DECODE_CACHE, the JIT and the AOT stay valid elsewhere
+	u8* current = (u8*)&chip8->memory;
+	const u8* target = (const u8*)&memory;
+	size_t adress = 0u;
+	while ((adress = Chip8_state_skip_equal(current, target, adress, chip8->memory_size)) != chip8->memory_size){
+		size_t range_end = adress + 1u;
+		while (range_end != chip8->memory_size && current[range_end] != target[range_end]) ++range_end;
+
+		memcpy(current + adress, target + adress, range_end - adress);
+		Chip8_invalidate_decode(chip8, (u16)adress, (u16)(range_end - adress));
+		adress = range_end;
+	}
+
+	chip8->CYCLE = CYCLE;
+	memcpy(&chip8->instruction_accumulator, &accumulator_bits, sizeof(u32));
+	chip8->ERROR = (Chip8::ERROR_TYPE)error;
+
+	memcpy(chip8->registers.by_index, registers, sizeof(registers));
+	chip8->I = I;
+	chip8->PC = PC;
+	chip8->SP = SP;
+	memcpy(chip8->STACK, STACK, sizeof(STACK));
+	Chip8_set_DT(chip8, DT);
+	Chip8_set_ST(chip8, ST);
+
+	chip8->screen_width = screen_width;
+	chip8->screen_height = screen_height;
+	memcpy(chip8->SCREEN, SCREEN, sizeof(SCREEN));
+	chip8->PLANES = planes;
+	chip8->SCREEN_DIRTY = UINT64_MAX;
+	++chip8->SCREEN_GENERATION;
+
+	Chip8_keyboard_from_mask(chip8->KEYBOARD, keyboard);
+	Chip8_keyboard_from_mask(chip8->LAST_KEYBOARD, last_keyboard);
+
+	chip8->RANDOM.seed[0] = seed[0];
+	chip8->RANDOM.seed[1] = seed[1];
+
+	memcpy(chip8->RPL, RPL, sizeof(RPL));
+	memcpy(chip8->AUDIO_PATTERN, audio_pattern, sizeof(audio_pattern));
+	chip8->PITCH = pitch;
+
+	return true;
+}
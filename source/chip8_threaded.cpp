@@ -0,0 +1,694 @@
+#include "chip8.h"
+
+// REF: https://www.complang.tuwien.ac.at/forth/threaded-code.html [Threaded code]
+// REF: https://eli.thegreenplace.net/2012/07/12/computed-goto-for-efficient-dispatch-tables [Computed goto for efficient dispatch tables]
+
+// Direct-threaded dispatch:
+// * the first nibble indexes a 16-entry table
+// * 0x8XY?, 0xEX?? and 0xFX?? go through a second table
+// * every handler ends with its own copy of the dispatch so that each indirect branch is predicted separately
+//
+// Computed goto is used with GCC / Clang, handler tables of functions otherwise
+
+#if defined(__GNUC__) || defined(__clang__)
+#define Chip8_threaded_computed_goto
+#endif
+
+// ---- instruction semantics ; errors are reported in chip8->ERROR
+// Chip8::CYCLE is brought up to date before dispatching FX?? instructions
+
+#define Chip8_X(instruction) (((instruction) & 0x0F00) >> 8)
+#define Chip8_Y(instruction) (((instruction) & 0x00F0) >> 4)
+#define Chip8_N(instruction) ((instruction) & 0x000F)
+#define Chip8_KK(instruction) ((u8)((instruction) & 0x00FF))
+#define Chip8_NNN(instruction) ((u16)((instruction) & 0x0FFF))
+
+template<typename Variant>
+static inline void Chip8_op_CLS(Chip8* chip8, u16 /*instruction*/){
+	Chip8_clear_screen<Variant::machine>(chip8);
+}
+
+template<typename Variant>
+static inline void Chip8_op_RET(Chip8* chip8, u16 /*instruction*/){
+	if (chip8->SP == 0){
+		chip8->ERROR = Chip8::SP_INCORRECT;
+		return;
+	}
+
+	--chip8->SP;
+	chip8->PC = chip8->STACK[chip8->SP];
+}
+
+template<typename Variant>
+static inline void Chip8_op_JP_ADDR(Chip8* chip8, u16 instruction){
+	u16 addr = Chip8_NNN(instruction);
+
+	Chip8_validate_memory(chip8, addr, 1);
+	if (chip8->ERROR) return;
+
+	chip8->PC = addr;
+}
+
+template<typename Variant>
+static inline void Chip8_op_CALL_ADDR(Chip8* chip8, u16 instruction){
+	u16 addr = Chip8_NNN(instruction);
+
+	if (chip8->SP == carray_size(Chip8::STACK)) chip8->ERROR = Chip8::SP_INCORRECT;
+	Chip8_validate_memory(chip8, addr, 2);
+	if (chip8->ERROR) return;
+
+	chip8->STACK[chip8->SP++] = chip8->PC;
+	chip8->PC = addr;
+}
+
+template<typename Variant>
+static inline void Chip8_op_SE_VX_BYTE(Chip8* chip8, u16 instruction){
+	if (chip8->registers.by_index[Chip8_X(instruction)] == Chip8_KK(instruction)) chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+}
+
+template<typename Variant>
+static inline void Chip8_op_SNE_VX_BYTE(Chip8* chip8, u16 instruction){
+	if (chip8->registers.by_index[Chip8_X(instruction)] != Chip8_KK(instruction)) chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+}
+
+template<typename Variant>
+static void Chip8_op_5XYN_XOCHIP(Chip8* chip8, u16 instruction);
+
+template<typename Variant>
+static inline void Chip8_op_SE_VX_VY(Chip8* chip8, u16 instruction){
+	if (Chip8_N(instruction) != 0x0){
+		Chip8_op_5XYN_XOCHIP<Variant>(chip8, instruction);
+		return;
+	}
+
+	if (chip8->registers.by_index[Chip8_X(instruction)] == chip8->registers.by_index[Chip8_Y(instruction)]) chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_VX_BYTE(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] = Chip8_KK(instruction);
+}
+
+template<typename Variant>
+static inline void Chip8_op_ADD_VX_BYTE(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] += Chip8_KK(instruction);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_VX_VY(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] = chip8->registers.by_index[Chip8_Y(instruction)];
+}
+
+template<typename Variant>
+static inline void Chip8_op_OR_VX_VY(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] |= chip8->registers.by_index[Chip8_Y(instruction)];
+	Chip8_logic_VF<Variant>(chip8);
+}
+
+template<typename Variant>
+static inline void Chip8_op_AND_VX_VY(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] &= chip8->registers.by_index[Chip8_Y(instruction)];
+	Chip8_logic_VF<Variant>(chip8);
+}
+
+template<typename Variant>
+static inline void Chip8_op_XOR_VX_VY(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] ^= chip8->registers.by_index[Chip8_Y(instruction)];
+	Chip8_logic_VF<Variant>(chip8);
+}
+
+template<typename Variant>
+static inline void Chip8_op_ADD_VX_VY(Chip8* chip8, u16 instruction){
+	u8* V = chip8->registers.by_index;
+	short add = V[Chip8_X(instruction)] + V[Chip8_Y(instruction)];
+	chip8->registers.VF = add > 255 ? 1 : 0;
+	V[Chip8_X(instruction)] = (u8)add;
+}
+
+template<typename Variant>
+static inline void Chip8_op_SUB_VX_VY(Chip8* chip8, u16 instruction){
+	u8* V = chip8->registers.by_index;
+	chip8->registers.VF = V[Chip8_X(instruction)] > V[Chip8_Y(instruction)] ? 1 : 0;
+	V[Chip8_X(instruction)] -= V[Chip8_Y(instruction)];
+}
+
+template<typename Variant>
+static inline void Chip8_op_SHR_VX(Chip8* chip8, u16 instruction){
+	u8* V = chip8->registers.by_index;
+	if constexpr (Variant::quirks.shift_vy){
+		u8 value = V[Chip8_Y(instruction)];
+		chip8->registers.VF = value & 0x01;
+		V[Chip8_X(instruction)] = value >> 1;
+	}
+	else{
+		chip8->registers.VF = V[Chip8_X(instruction)] & 0x01;
+		V[Chip8_X(instruction)] >>= 1;
+	}
+}
+
+template<typename Variant>
+static inline void Chip8_op_SUBN_VX_VY(Chip8* chip8, u16 instruction){
+	u8* V = chip8->registers.by_index;
+	chip8->registers.VF = V[Chip8_Y(instruction)] > V[Chip8_X(instruction)] ? 1 : 0;
+	V[Chip8_X(instruction)] = V[Chip8_Y(instruction)] - V[Chip8_X(instruction)];
+}
+
+template<typename Variant>
+static inline void Chip8_op_SHL_VX(Chip8* chip8, u16 instruction){
+	u8* V = chip8->registers.by_index;
+	if constexpr (Variant::quirks.shift_vy){
+		u8 value = V[Chip8_Y(instruction)];
+		chip8->registers.VF = (value & 0x80) >> 7;
+		V[Chip8_X(instruction)] = value << 1;
+	}
+	else{
+		chip8->registers.VF = (V[Chip8_X(instruction)] & 0x80) >> 7;
+		V[Chip8_X(instruction)] <<= 1;
+	}
+}
+
+template<typename Variant>
+static inline void Chip8_op_SNE_VX_VY(Chip8* chip8, u16 instruction){
+	if (Chip8_N(instruction) != 0x0){
+		chip8->ERROR = Chip8::INSTRUCTION_UNKNOWN;
+		return;
+	}
+
+	if (chip8->registers.by_index[Chip8_X(instruction)] != chip8->registers.by_index[Chip8_Y(instruction)]) chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_I_ADDR(Chip8* chip8, u16 instruction){
+	chip8->I = Chip8_NNN(instruction);
+}
+
+template<typename Variant>
+static inline void Chip8_op_JP_V0_ADDR(Chip8* chip8, u16 instruction){
+	// BXNN with jump_vx
+	u16 new_PC = Chip8_NNN(instruction) + chip8->registers.by_index[Variant::quirks.jump_vx ? Chip8_X(instruction) : 0];
+
+	Chip8_validate_memory(chip8, new_PC, 2);
+	if (chip8->ERROR) return;
+
+	chip8->PC = new_PC;
+}
+
+template<typename Variant>
+static inline void Chip8_op_RND_VX_BYTE(Chip8* chip8, u16 instruction){
+	u8 random_byte = random_char(chip8->RANDOM);
+	chip8->registers.by_index[Chip8_X(instruction)] = random_byte & Chip8_KK(instruction);
+}
+
+template<typename Variant>
+static inline void Chip8_op_DRW_VX_VY_N(Chip8* chip8, u16 instruction){
+	u8 x = chip8->registers.by_index[Chip8_X(instruction)];
+	u8 y = chip8->registers.by_index[Chip8_Y(instruction)];
+	short n = Chip8_N(instruction);
+
+	if (n == 0 && Variant::machine != Chip8::CHIP8){
+		if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y))
+			chip8->ERROR = Chip8::SCREEN_COORD_INCORRECT;
+		Chip8_validate_memory(chip8, chip8->I, Chip8_sprite_size(chip8, 32));
+		if (chip8->ERROR) return;
+
+		Chip8_draw_sprite_16<Variant::machine>(chip8, x, y);
+		return;
+	}
+
+	if (!Chip8_is_valid_screen_coord<Variant::machine>(chip8, x, y) || n >= Chip8_screen_height<Variant::machine>(chip8))
+		chip8->ERROR = Chip8::SCREEN_COORD_INCORRECT;
+	Chip8_validate_memory(chip8, chip8->I, Chip8_sprite_size(chip8, n));
+	if (chip8->ERROR) return;
+
+	Chip8_draw_sprite<Variant::machine>(chip8, x, y, n);
+}
+
+template<typename Variant>
+static inline void Chip8_op_SKP_VX(Chip8* chip8, u16 instruction){
+	u8 keyindex = chip8->registers.by_index[Chip8_X(instruction)];
+	if (keyindex >= sizeof(Chip8::KEYBOARD)){
+		chip8->ERROR = Chip8::KEY_UNKNOWN;
+		return;
+	}
+
+	if (chip8->KEYBOARD[keyindex]) chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+}
+
+template<typename Variant>
+static inline void Chip8_op_SKNP_VX(Chip8* chip8, u16 instruction){
+	u8 keyindex = chip8->registers.by_index[Chip8_X(instruction)];
+	if (keyindex >= sizeof(Chip8::KEYBOARD)){
+		chip8->ERROR = Chip8::KEY_UNKNOWN;
+		return;
+	}
+
+	if (!chip8->KEYBOARD[keyindex]) chip8->PC += Chip8_skip_size<Variant::machine>(chip8, chip8->PC);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_VX_DT(Chip8* chip8, u16 instruction){
+	chip8->registers.by_index[Chip8_X(instruction)] = Chip8_get_DT(chip8);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_VX_K(Chip8* chip8, u16 instruction){
+	int keypress = -1;
+	for (int ikey = 0; ikey != carray_size(Chip8::KEYBOARD); ++ikey){
+		if (!chip8->KEYBOARD[ikey] && chip8->LAST_KEYBOARD[ikey]){
+			keypress = ikey;
+			break;
+		}
+	}
+
+	if (keypress != -1)
+		chip8->registers.by_index[Chip8_X(instruction)] = keypress;
+	else
+		chip8->PC -= 2; // rewing the instruction to wait
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_DT_VX(Chip8* chip8, u16 instruction){
+	Chip8_set_DT(chip8, chip8->registers.by_index[Chip8_X(instruction)]);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_ST_VX(Chip8* chip8, u16 instruction){
+	Chip8_set_ST(chip8, chip8->registers.by_index[Chip8_X(instruction)]);
+}
+
+template<typename Variant>
+static inline void Chip8_op_ADD_I_VX(Chip8* chip8, u16 instruction){
+	chip8->I += chip8->registers.by_index[Chip8_X(instruction)];
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_F_VX(Chip8* chip8, u16 instruction){
+	chip8->I = (chip8->registers.by_index[Chip8_X(instruction)] & 0x0F) * 5;
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_B_VX(Chip8* chip8, u16 instruction){
+	Chip8_validate_memory(chip8, chip8->I, 3);
+	if (chip8->ERROR) return;
+
+	u8 byte = chip8->registers.by_index[Chip8_X(instruction)];
+	u8* memptr = Chip8_get_memory(chip8, chip8->I);
+
+	memptr[0] = byte / 100;
+	memptr[1] = (byte % 100) / 10;
+	memptr[2] = (byte % 10);
+
+	Chip8_invalidate_decode(chip8, chip8->I, 3);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_MEM_VX(Chip8* chip8, u16 instruction){
+	u16 regcount = Chip8_X(instruction) + 1;
+
+	Chip8_validate_memory(chip8, chip8->I, regcount);
+	if (chip8->ERROR) return;
+
+	memcpy(Chip8_get_memory(chip8, chip8->I), chip8->registers.by_index, regcount);
+
+	Chip8_invalidate_decode(chip8, chip8->I, regcount);
+	Chip8_load_store_I<Variant>(chip8, regcount);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_VX_MEM(Chip8* chip8, u16 instruction){
+	u16 regcount = Chip8_X(instruction) + 1;
+
+	Chip8_validate_memory(chip8, chip8->I, regcount);
+	if (chip8->ERROR) return;
+
+	memcpy(chip8->registers.by_index, Chip8_get_memory(chip8, chip8->I), regcount);
+	Chip8_load_store_I<Variant>(chip8, regcount);
+}
+
+template<typename Variant>
+static inline void Chip8_op_UNKNOWN(Chip8* chip8, u16 /*instruction*/){
+	chip8->ERROR = Chip8::INSTRUCTION_UNKNOWN;
+}
+
+// ---- SUPER-CHIP ; INSTRUCTION_UNKNOWN with CHIP8
+// 00C?, 00D? and 00F? share the slow path of 0NNN since they are rare
+
+template<typename Variant>
+static void Chip8_op_0NNN_SUPERCHIP(Chip8* chip8, u16 instruction){
+	if (Variant::machine == Chip8::CHIP8) Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+	else if ((instruction & 0xFFF0) == 0x00C0) Chip8_scroll_down(chip8, Chip8_N(instruction));
+	else if ((instruction & 0xFFF0) == 0x00D0 && Variant::machine == Chip8::XOCHIP) Chip8_scroll_up(chip8, Chip8_N(instruction));
+	else if (instruction == 0x00FB) Chip8_scroll_right(chip8);
+	else if (instruction == 0x00FC) Chip8_scroll_left(chip8);
+	else if (instruction == 0x00FD) chip8->PC -= 2; // EXIT
+	else if (instruction == 0x00FE) Chip8_set_resolution(chip8, 64, 32);
+	else if (instruction == 0x00FF) Chip8_set_resolution(chip8, 128, 64);
+	else Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_HF_VX(Chip8* chip8, u16 instruction){
+	if (Variant::machine == Chip8::CHIP8){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	chip8->I = Chip8_big_sprites_adress + (chip8->registers.by_index[Chip8_X(instruction)] & 0x0F) * 10;
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_R_VX(Chip8* chip8, u16 instruction){
+	if (Variant::machine == Chip8::CHIP8 || (Variant::machine == Chip8::SUPERCHIP && Chip8_X(instruction) > 7)){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	memcpy(chip8->RPL, chip8->registers.by_index, Chip8_X(instruction) + 1);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_VX_R(Chip8* chip8, u16 instruction){
+	if (Variant::machine == Chip8::CHIP8 || (Variant::machine == Chip8::SUPERCHIP && Chip8_X(instruction) > 7)){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	memcpy(chip8->registers.by_index, chip8->RPL, Chip8_X(instruction) + 1);
+}
+
+// ---- XO-CHIP ; INSTRUCTION_UNKNOWN with CHIP8 and SUPERCHIP
+
+// LD [I], Vx - Vy and LD Vx - Vy, [I] ; the registers are in reverse order when x > y
+template<typename Variant>
+static void Chip8_op_5XYN_XOCHIP(Chip8* chip8, u16 instruction){
+	if (Variant::machine != Chip8::XOCHIP || (Chip8_N(instruction) != 0x2 && Chip8_N(instruction) != 0x3)){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	u8 x = Chip8_X(instruction);
+	u8 y = Chip8_Y(instruction);
+	u16 regcount = (x <= y ? y - x : x - y) + 1;
+	int regstep = x <= y ? 1 : -1;
+
+	Chip8_validate_memory(chip8, chip8->I, regcount);
+	if (chip8->ERROR) return;
+
+	u8* memptr = Chip8_get_memory(chip8, chip8->I);
+	if (Chip8_N(instruction) == 0x2){
+		for (int ireg = 0; ireg != regcount; ++ireg)
+			memptr[ireg] = chip8->registers.by_index[x + ireg * regstep];
+
+		Chip8_invalidate_decode(chip8, chip8->I, regcount);
+	}
+	else{
+		for (int ireg = 0; ireg != regcount; ++ireg)
+			chip8->registers.by_index[x + ireg * regstep] = memptr[ireg];
+	}
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_I_LONG(Chip8* chip8, u16 instruction){
+	if (Variant::machine != Chip8::XOCHIP || instruction != 0xF000){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	Chip8_validate_memory(chip8, chip8->PC, 2);
+	if (chip8->ERROR) return;
+
+	chip8->I = Chip8_fetch(chip8, chip8->PC);
+	chip8->PC += 2;
+}
+
+template<typename Variant>
+static inline void Chip8_op_PLANE_N(Chip8* chip8, u16 instruction){
+	if (Variant::machine != Chip8::XOCHIP || Chip8_X(instruction) > 3){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	chip8->PLANES = Chip8_X(instruction);
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_AUDIO(Chip8* chip8, u16 instruction){
+	if (Variant::machine != Chip8::XOCHIP || instruction != 0xF002){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	Chip8_validate_memory(chip8, chip8->I, sizeof(Chip8::AUDIO_PATTERN));
+	if (chip8->ERROR) return;
+
+	memcpy(chip8->AUDIO_PATTERN, Chip8_get_memory(chip8, chip8->I), sizeof(Chip8::AUDIO_PATTERN));
+}
+
+template<typename Variant>
+static inline void Chip8_op_LD_PITCH_VX(Chip8* chip8, u16 instruction){
+	if (Variant::machine != Chip8::XOCHIP){
+		Chip8_op_UNKNOWN<Variant>(chip8, instruction);
+		return;
+	}
+
+	chip8->PITCH = chip8->registers.by_index[Chip8_X(instruction)];
+}
+
+// ---- sub-table indices for 0xEX?? and 0xFX?? ; index 0 is INSTRUCTION_UNKNOWN
+
+struct Chip8_KK_Index{
+	u8 index[256];
+};
+
+static constexpr Chip8_KK_Index Chip8_EXKK_index(){
+	Chip8_KK_Index table = {};
+	table.index[0x9E] = 1; // SKP Vx
+	table.index[0xA1] = 2; // SKNP Vx
+	return table;
+}
+
+static constexpr Chip8_KK_Index Chip8_FXKK_index(){
+	Chip8_KK_Index table = {};
+	table.index[0x07] = 1; // LD Vx, DT
+	table.index[0x0A] = 2; // LD Vx, K
+	table.index[0x15] = 3; // LD DT, Vx
+	table.index[0x18] = 4; // LD ST, Vx
+	table.index[0x1E] = 5; // ADD I, Vx
+	table.index[0x29] = 6; // LD F, Vx
+	table.index[0x33] = 7; // LD B, Vx
+	table.index[0x55] = 8; // LD [I], Vx
+	table.index[0x65] = 9; // LD Vx, [I]
+	table.index[0x30] = 10; // LD HF, Vx
+	table.index[0x75] = 11; // LD R, Vx
+	table.index[0x85] = 12; // LD Vx, R
+	table.index[0x00] = 13; // LD I, long
+	table.index[0x01] = 14; // PLANE n
+	table.index[0x02] = 15; // AUDIO
+	table.index[0x3A] = 16; // PITCH Vx
+	return table;
+}
+
+static constexpr Chip8_KK_Index g_EXKK_index = Chip8_EXKK_index();
+static constexpr Chip8_KK_Index g_FXKK_index = Chip8_FXKK_index();
+
+#if defined(Chip8_threaded_computed_goto)
+
+template<typename Variant>
+static void Chip8_execute_threaded(Chip8* chip8, int instruction_count){
+	static void* const nibble_labels[16] = {
+		&&label_0NNN,			&&label_JP_ADDR,		&&label_CALL_ADDR,		&&label_SE_VX_BYTE,
+		&&label_SNE_VX_BYTE,	&&label_SE_VX_VY,		&&label_LD_VX_BYTE,		&&label_ADD_VX_BYTE,
+		&&label_8XYN,			&&label_SNE_VX_VY,		&&label_LD_I_ADDR,		&&label_JP_V0_ADDR,
+		&&label_RND_VX_BYTE,	&&label_DRW_VX_VY_N,	&&label_EXKK,			&&label_FXKK,
+	};
+	static void* const labels_8XYN[16] = {
+		&&label_LD_VX_VY,		&&label_OR_VX_VY,		&&label_AND_VX_VY,		&&label_XOR_VX_VY,
+		&&label_ADD_VX_VY,		&&label_SUB_VX_VY,		&&label_SHR_VX,			&&label_SUBN_VX_VY,
+		&&label_UNKNOWN,		&&label_UNKNOWN,		&&label_UNKNOWN,		&&label_UNKNOWN,
+		&&label_UNKNOWN,		&&label_UNKNOWN,		&&label_SHL_VX,			&&label_UNKNOWN,
+	};
+	static void* const labels_EXKK[3] = {
+		&&label_UNKNOWN,		&&label_SKP_VX,			&&label_SKNP_VX,
+	};
+	static void* const labels_FXKK[17] = {
+		&&label_UNKNOWN,		&&label_LD_VX_DT,		&&label_LD_VX_K,		&&label_LD_DT_VX,
+		&&label_LD_ST_VX,		&&label_ADD_I_VX,		&&label_LD_F_VX,		&&label_LD_B_VX,
+		&&label_LD_MEM_VX,		&&label_LD_VX_MEM,		&&label_LD_HF_VX,		&&label_LD_R_VX,
+		&&label_LD_VX_R,		&&label_LD_I_LONG,		&&label_PLANE_N,		&&label_LD_AUDIO,
+		&&label_LD_PITCH_VX,
+	};
+
+	u16 instruction = 0x0000;
+
+#define Chip8_DISPATCH()												\
+	do{																	\
+		Chip8_validate_memory(chip8, chip8->PC, 2);						\
+		if (chip8->ERROR) goto label_exit;								\
+		instruction = Chip8_fetch(chip8, chip8->PC);					\
+		chip8->PC += 2;													\
+		goto *nibble_labels[instruction >> 12];							\
+	}while(false)
+
+#define Chip8_NEXT()													\
+	do{																	\
+		memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD)); \
+		if (--instruction_count == 0) goto label_exit;					\
+		Chip8_DISPATCH();												\
+	}while(false)
+
+#define Chip8_NEXT_CHECKED()											\
+	do{																	\
+		if (chip8->ERROR) goto label_exit;								\
+		Chip8_NEXT();													\
+	}while(false)
+
+	if (instruction_count == 0) return;
+	u64 end_cycle = chip8->CYCLE + instruction_count;
+	Chip8_DISPATCH();
+
+label_0NNN:
+	if (instruction == 0x00E0) goto label_CLS;
+	if (instruction == 0x00EE) goto label_RET;
+	goto label_0NNN_SUPERCHIP;
+label_8XYN:
+	goto *labels_8XYN[Chip8_N(instruction)];
+label_EXKK:
+	goto *labels_EXKK[g_EXKK_index.index[Chip8_KK(instruction)]];
+label_FXKK:
+	// the timer instructions are all FX??
+	chip8->CYCLE = end_cycle - instruction_count;
+	goto *labels_FXKK[g_FXKK_index.index[Chip8_KK(instruction)]];
+
+label_CLS:			Chip8_op_CLS<Variant>(chip8, instruction);			Chip8_NEXT();
+label_RET:			Chip8_op_RET<Variant>(chip8, instruction);			Chip8_NEXT_CHECKED();
+label_JP_ADDR:		Chip8_op_JP_ADDR<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_CALL_ADDR:	Chip8_op_CALL_ADDR<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_SE_VX_BYTE:	Chip8_op_SE_VX_BYTE<Variant>(chip8, instruction);	Chip8_NEXT();
+label_SNE_VX_BYTE:	Chip8_op_SNE_VX_BYTE<Variant>(chip8, instruction);	Chip8_NEXT();
+label_SE_VX_VY:		Chip8_op_SE_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_VX_BYTE:	Chip8_op_LD_VX_BYTE<Variant>(chip8, instruction);	Chip8_NEXT();
+label_ADD_VX_BYTE:	Chip8_op_ADD_VX_BYTE<Variant>(chip8, instruction);	Chip8_NEXT();
+label_LD_VX_VY:		Chip8_op_LD_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT();
+label_OR_VX_VY:		Chip8_op_OR_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT();
+label_AND_VX_VY:	Chip8_op_AND_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT();
+label_XOR_VX_VY:	Chip8_op_XOR_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT();
+label_ADD_VX_VY:	Chip8_op_ADD_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT();
+label_SUB_VX_VY:	Chip8_op_SUB_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT();
+label_SHR_VX:		Chip8_op_SHR_VX<Variant>(chip8, instruction);		Chip8_NEXT();
+label_SUBN_VX_VY:	Chip8_op_SUBN_VX_VY<Variant>(chip8, instruction);	Chip8_NEXT();
+label_SHL_VX:		Chip8_op_SHL_VX<Variant>(chip8, instruction);		Chip8_NEXT();
+label_SNE_VX_VY:	Chip8_op_SNE_VX_VY<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_I_ADDR:	Chip8_op_LD_I_ADDR<Variant>(chip8, instruction);		Chip8_NEXT();
+label_JP_V0_ADDR:	Chip8_op_JP_V0_ADDR<Variant>(chip8, instruction);	Chip8_NEXT_CHECKED();
+label_RND_VX_BYTE:	Chip8_op_RND_VX_BYTE<Variant>(chip8, instruction);	Chip8_NEXT();
+label_DRW_VX_VY_N:	Chip8_op_DRW_VX_VY_N<Variant>(chip8, instruction);	Chip8_NEXT_CHECKED();
+label_SKP_VX:		Chip8_op_SKP_VX<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_SKNP_VX:		Chip8_op_SKNP_VX<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_VX_DT:		Chip8_op_LD_VX_DT<Variant>(chip8, instruction);		Chip8_NEXT();
+label_LD_VX_K:		Chip8_op_LD_VX_K<Variant>(chip8, instruction);		Chip8_NEXT();
+label_LD_DT_VX:		Chip8_op_LD_DT_VX<Variant>(chip8, instruction);		Chip8_NEXT();
+label_LD_ST_VX:		Chip8_op_LD_ST_VX<Variant>(chip8, instruction);		Chip8_NEXT();
+label_ADD_I_VX:		Chip8_op_ADD_I_VX<Variant>(chip8, instruction);		Chip8_NEXT();
+label_LD_F_VX:		Chip8_op_LD_F_VX<Variant>(chip8, instruction);		Chip8_NEXT();
+label_LD_B_VX:		Chip8_op_LD_B_VX<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_MEM_VX:	Chip8_op_LD_MEM_VX<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_VX_MEM:	Chip8_op_LD_VX_MEM<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_0NNN_SUPERCHIP:	Chip8_op_0NNN_SUPERCHIP<Variant>(chip8, instruction);	Chip8_NEXT_CHECKED();
+label_LD_HF_VX:		Chip8_op_LD_HF_VX<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_R_VX:		Chip8_op_LD_R_VX<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_VX_R:		Chip8_op_LD_VX_R<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_I_LONG:	Chip8_op_LD_I_LONG<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_PLANE_N:		Chip8_op_PLANE_N<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_AUDIO:		Chip8_op_LD_AUDIO<Variant>(chip8, instruction);		Chip8_NEXT_CHECKED();
+label_LD_PITCH_VX:	Chip8_op_LD_PITCH_VX<Variant>(chip8, instruction);	Chip8_NEXT_CHECKED();
+label_UNKNOWN:		Chip8_op_UNKNOWN<Variant>(chip8, instruction);		goto label_exit;
+
+label_exit:
+	chip8->CYCLE = end_cycle - instruction_count;
+	return;
+
+#undef Chip8_NEXT_CHECKED
+#undef Chip8_NEXT
+#undef Chip8_DISPATCH
+}
+
+#else
+
+typedef void (*Chip8_Handler)(Chip8* chip8, u16 instruction);
+
+template<typename Variant>
+static void Chip8_op_0NNN(Chip8* chip8, u16 instruction){
+	if (instruction == 0x00E0) Chip8_op_CLS<Variant>(chip8, instruction);
+	else if (instruction == 0x00EE) Chip8_op_RET<Variant>(chip8, instruction);
+	else Chip8_op_0NNN_SUPERCHIP<Variant>(chip8, instruction);
+}
+
+// sub-table handlers tail-call into their group table, one set of tables per variant
+template<typename Variant>
+static void Chip8_op_8XYN(Chip8* chip8, u16 instruction){
+	static const Chip8_Handler handlers_8XYN[16] = {
+		Chip8_op_LD_VX_VY<Variant>,		Chip8_op_OR_VX_VY<Variant>,		Chip8_op_AND_VX_VY<Variant>,		Chip8_op_XOR_VX_VY<Variant>,
+		Chip8_op_ADD_VX_VY<Variant>,		Chip8_op_SUB_VX_VY<Variant>,		Chip8_op_SHR_VX<Variant>,		Chip8_op_SUBN_VX_VY<Variant>,
+		Chip8_op_UNKNOWN<Variant>,		Chip8_op_UNKNOWN<Variant>,		Chip8_op_UNKNOWN<Variant>,		Chip8_op_UNKNOWN<Variant>,
+		Chip8_op_UNKNOWN<Variant>,		Chip8_op_UNKNOWN<Variant>,		Chip8_op_SHL_VX<Variant>,		Chip8_op_UNKNOWN<Variant>,
+	};
+	return handlers_8XYN[Chip8_N(instruction)](chip8, instruction);
+}
+template<typename Variant>
+static void Chip8_op_EXKK(Chip8* chip8, u16 instruction){
+	static const Chip8_Handler handlers_EXKK[3] = {
+		Chip8_op_UNKNOWN<Variant>,		Chip8_op_SKP_VX<Variant>,		Chip8_op_SKNP_VX<Variant>,
+	};
+	return handlers_EXKK[g_EXKK_index.index[Chip8_KK(instruction)]](chip8, instruction);
+}
+template<typename Variant>
+static void Chip8_op_FXKK(Chip8* chip8, u16 instruction){
+	static const Chip8_Handler handlers_FXKK[17] = {
+		Chip8_op_UNKNOWN<Variant>,		Chip8_op_LD_VX_DT<Variant>,		Chip8_op_LD_VX_K<Variant>,		Chip8_op_LD_DT_VX<Variant>,
+		Chip8_op_LD_ST_VX<Variant>,		Chip8_op_ADD_I_VX<Variant>,		Chip8_op_LD_F_VX<Variant>,		Chip8_op_LD_B_VX<Variant>,
+		Chip8_op_LD_MEM_VX<Variant>,		Chip8_op_LD_VX_MEM<Variant>,		Chip8_op_LD_HF_VX<Variant>,		Chip8_op_LD_R_VX<Variant>,
+		Chip8_op_LD_VX_R<Variant>,		Chip8_op_LD_I_LONG<Variant>,		Chip8_op_PLANE_N<Variant>,		Chip8_op_LD_AUDIO<Variant>,
+		Chip8_op_LD_PITCH_VX<Variant>,
+	};
+	return handlers_FXKK[g_FXKK_index.index[Chip8_KK(instruction)]](chip8, instruction);
+}
+
+template<typename Variant>
+static void Chip8_execute_threaded(Chip8* chip8, int instruction_count){
+	static const Chip8_Handler handlers_nibble[16] = {
+		Chip8_op_0NNN<Variant>,			Chip8_op_JP_ADDR<Variant>,		Chip8_op_CALL_ADDR<Variant>,		Chip8_op_SE_VX_BYTE<Variant>,
+		Chip8_op_SNE_VX_BYTE<Variant>,	Chip8_op_SE_VX_VY<Variant>,		Chip8_op_LD_VX_BYTE<Variant>,	Chip8_op_ADD_VX_BYTE<Variant>,
+		Chip8_op_8XYN<Variant>,			Chip8_op_SNE_VX_VY<Variant>,		Chip8_op_LD_I_ADDR<Variant>,		Chip8_op_JP_V0_ADDR<Variant>,
+		Chip8_op_RND_VX_BYTE<Variant>,	Chip8_op_DRW_VX_VY_N<Variant>,	Chip8_op_EXKK<Variant>,			Chip8_op_FXKK<Variant>,
+	};
+
+	u64 end_cycle = chip8->CYCLE + instruction_count;
+
+	while (instruction_count)
+	{
+		Chip8_validate_memory(chip8, chip8->PC, 2);
+		if (chip8->ERROR) break;
+
+		u16 instruction = Chip8_fetch(chip8, chip8->PC);
+		chip8->PC += 2;
+
+		// the timer instructions are all FX??
+		if (instruction >= 0xF000) chip8->CYCLE = end_cycle - instruction_count;
+
+		handlers_nibble[instruction >> 12](chip8, instruction);
+		if (chip8->ERROR) break;
+
+		memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));
+
+		--instruction_count;
+	}
+
+	chip8->CYCLE = end_cycle - instruction_count;
+}
+
+#endif
+
+void Chip8_execute_threaded(Chip8* chip8, int instruction_count){
+	static constexpr Chip8_Execute variants[Chip8::MACHINE_COUNT][Chip8_Quirks::TYPE_COUNT] = Chip8_VARIANT_TABLE(Chip8_execute_threaded);
+	variants[chip8->MACHINE][chip8->QUIRKS](chip8, instruction_count);
+}
@@ -74,18 +74,31 @@ static void xoroshiro128P_LONG_JUMP(Random_Data& data){
 thread_local Random_Data g_default_random;
 
 void create_default_random(){
-    g_default_random.seed_low = 0x357638792F423F45ULL;
-    g_default_random.seed_high = 0x635266556A586E32ULL;
+	create_default_random(g_default_random);
 
     //int nLJMP = thread_id();
 	//for (int iLJMP = 0; iLJMP != nLJMP; ++iLJMP) xoroshiro128P_LONG_JUMP(g_default_random);
 }
 
+void create_default_random(Random_Data& data){
+    data.seed_low = 0x357638792F423F45ULL;
+    data.seed_high = 0x635266556A586E32ULL;
+}
+
 char random_char(Random_Data& data){ return xoroshiro128P_NEXT(data) >> 56; }
 short random_short(Random_Data& data){ return xoroshiro128P_NEXT(data) >> 48; }
 int random_int(Random_Data& data){ return xoroshiro128P_NEXT(data) >> 32; }
 int64 random_int64(Random_Data& data){ return xoroshiro128P_NEXT(data); }
 
+u64 FNV1a(const void* data, size_t size, u64 hash){
+	const u8* bytes = (const u8*)data;
+	for (size_t ibyte = 0; ibyte != size; ++ibyte){
+		hash ^= bytes[ibyte];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
 void Frame_Controller::create() { memset( this, 0x00, sizeof( Frame_Controller ) ); }
 void Frame_Controller::destroy() {}
 
@@ -206,3 +219,24 @@ void Pixel_Canvas::clear(RGBA color){
 	for (int ipix = 0; ipix != pix_count; ++ipix) canvas[ipix] = color;
 
 }
+
+// REF: https://netpbm.sourceforge.net/doc/ppm.html [PPM Format Specification]
+int Pixel_Canvas::save_PPM(const char* path){
+	FILE* file = fopen(path, "wb");
+	if (!file) return false;
+
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+	// PPM rows are top-down
+	for (int iy = height - 1; iy >= 0; --iy){
+		for (int ix = 0; ix != width; ++ix){
+			RGBA pixel = canvas[iy * width + ix];
+			u8 rgb[3] = {pixel.r, pixel.g, pixel.b};
+			fwrite(rgb, 1u, sizeof(rgb), file);
+		}
+	}
+
+	int success = !ferror(file);
+	success &= fclose(file) == 0;
+	return success;
+}
@@ -4,6 +4,11 @@
 
 // REF: http://www.isthe.com/chongo/tech/comp/fnv/index.html [FNV Hash]
 
+constexpr u64 FNV1a_offset_basis = 0xCBF29CE484222325ULL;
+
+// 64 bits FNV-1a ; buffers are chained by passing the previous result as hash
+u64 FNV1a(const void* data, size_t size, u64 hash = FNV1a_offset_basis);
+
 // REF: https://prng.di.unimi.it/ [xoshiro / xoroshiro generators]
 
 union Random_Data{
@@ -17,6 +22,7 @@ union Random_Data{
 extern thread_local Random_Data g_default_random;
 
 void create_default_random();
+void create_default_random(Random_Data& data);
 
 char random_char(Random_Data& = g_default_random);
 short random_short(Random_Data& = g_default_random);
@@ -93,6 +99,9 @@ struct Pixel_Canvas{
 	void set_pixel(int x, int y, RGBA color);
 	void clear(RGBA color);
 
+	// binary PPM ; alpha is dropped
+	int save_PPM(const char* path);
+
 	int width;
 	int height;
 	RGBA* canvas;
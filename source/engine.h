@@ -4,13 +4,17 @@
 
 #define ram_project "Chip8tle"
 
+// the build can select the configuration with -D ; ram_debug otherwise
+#if !defined(ram_debug) && !defined(ram_release) && !defined(ram_retail)
 #define ram_debug
 //#define ram_release
 //#define ram_retail
+#endif
 
 // ---- standard library
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cinttypes>
 #include <cstdio>
@@ -56,7 +60,11 @@ typedef int64_t int64;
 #define ram_function	__FUNC__
 #define ram_linenumber	__LINE__
 
+#if defined(_WIN32)
 #define ram_path_separator '\\'
+#else
+#define ram_path_separator '/'
+#endif
 
 #define ram_file() []() consteval { constexpr size_t index = strrchr(ram_filepath, ram_project ram_path_separator); static_assert(index != SIZE_MAX); return ram_filepath + index; }()
 
@@ -73,7 +81,11 @@ typedef int64_t int64;
 
 #if defined(ram_debug) || defined(ram_release)
 	#define ram_assert_dependency(exp) exp
+#if defined(_MSC_VER)
 	#define ram_debugbreak() do{ __debugbreak(); } while(false)
+#else
+	#define ram_debugbreak() do{ __builtin_trap(); } while(false)
+#endif
 	#define ram_assert_internal(exp) do{ if((exp) == false){ ram_error("FAILED assert: " #exp); ram_debugbreak(); } }while(false)
 	#define ram_assert(exp) ram_assert_internal(exp)
 	#define ram_assert_msg_internal(exp, msg, ...) do{ if((exp) == false){ ram_error("FAILED assert: " #exp " with msg: " #msg); ram_debugbreak(); } }while(false)
@@ -81,8 +93,8 @@ typedef int64_t int64;
 #else
 	#define ram_assert_dependency(exp)
 	#define ram_debugbreak()
-	#define ram_assert(exp) ignore_exp
-	#define ram_assert_msg(exp, msg, ...) ignore_exp
+	#define ram_assert(exp) ignore_exp(exp)
+	#define ram_assert_msg(exp, msg, ...) ignore_exp(exp)
 #endif
 
 #define ram_defer(captures) DEFER_Container ram_concatenate(DEFER_variable_at_, __LINE__) = [captures]() mutable
@@ -173,6 +185,17 @@ struct alignas(8) MutexRW{
 void create_mutexRW(MutexRW* mutex);
 void destroy_mutexRW(MutexRW* mutex);
 
+typedef void (*Thread_Function)(void* param);
+
+// the Thread must stay valid until join_thread
+struct alignas(8) Thread{
+	u8 memory[32];
+};
+
+void create_thread(Thread* thread, Thread_Function function, void* param);
+// waits for the function of the thread to return
+void join_thread(Thread* thread);
+
 // Mu-ltiple Pro-ducers Si-ngle Co-nsumer 
 template<typename T>
 struct MuProSiCo{
@@ -278,6 +301,8 @@ struct Window{
 	void get_size(int& width, int& height);
 
 	int user_requested_close;
+	// set when the window content was lost and the whole image has to be copied again
+	int needs_repaint;
 };
 struct Window_Manager{
 	Window* create_window();
@@ -301,6 +326,8 @@ struct RGBA{
 	u8 a;
 };
 void copy_image_to_window(int width, int height, RGBA* data, Window* window);
+// copies the rows [row_begin, row_begin + row_count[ of the image ; rows are bottom-up like Pixel_Canvas
+void copy_image_rows_to_window(int width, int height, RGBA* data, int row_begin, int row_count, Window* window);
 
 struct Audio_DSP{
 	void* get_param();
@@ -447,6 +474,8 @@ enum RAM_Key{
 	RAMK_X,
 	RAMK_C,
 	RAMK_V,
+	RAMK_BACKSPACE,
+	RAMK_TAB,
 };
 u32 RAMKey_to_scancode(RAM_Key key);
 
@@ -0,0 +1,748 @@
+#include "engine.h"
+#include "core.h"
+
+// ---- platform includes
+
+#include <cstdarg>
+#include <cerrno>
+#include <csignal>
+
+#include <unistd.h>			// syscall, close
+#include <sys/syscall.h>	// SYS_futex, SYS_gettid
+#include <linux/futex.h>	// FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#include <sys/mman.h>		// mmap, munmap
+#include <sys/stat.h>		// fstat
+#include <fcntl.h>			// open
+#include <time.h>			// clock_gettime, clock_nanosleep
+#include <pthread.h>		// pthread_create, pthread_join
+
+// Linux implementation of engine.h for the servers and the headless builds
+//
+// * there is no window, audio or input device: windows only keep their size, DSPs are consumed by update_audio
+//   without output and listener actions are never pressed
+// * SIGINT and SIGTERM set Window::user_requested_close on every window
+// * the main loop is paced at 60 frames per second instead of DwmFlush
+
+// ---- DECLARATION
+
+// REF: https://akkadia.org/drepper/futex.pdf [Futexes Are Tricky]
+
+// 0: unlocked ; 1: locked ; 2: locked with waiters
+struct Mutex_Posix{
+	u32 state;
+};
+static_assert(sizeof(Mutex_Posix) <= sizeof(Mutex), "Mutex_Posix too big compared to Mutex");
+
+// state is writer_bit | reader_count ; waiters counts the threads sleeping on state
+struct MutexRW_Posix{
+	static constexpr u32 writer_bit = 0x80000000u;
+
+	u32 state;
+	u32 waiters;
+};
+static_assert(sizeof(MutexRW_Posix) <= sizeof(MutexRW), "MutexRW_Posix too big compared to MutexRW");
+
+struct Thread_Posix{
+	pthread_t handle;
+	Thread_Function function;
+	void* param;
+};
+static_assert(sizeof(Thread_Posix) <= sizeof(Thread), "Thread_Posix too big compared to Thread");
+
+struct Logger_Posix : Logger {
+	static constexpr const char* log_path = ram_project ".log";
+
+	Mutex mutex;
+	FILE* file;
+};
+
+struct Window_Posix : Window {
+	int width;
+	int height;
+};
+
+struct Window_Manager_Posix : Window_Manager {
+};
+
+struct Audio_Null : Audio {
+};
+
+struct Input_Null : Input {
+};
+
+struct Engine_Posix : Engine {
+};
+
+// ---- EXTERN & STATIC DATA
+
+static int g_main_thread_id;
+
+static int g_main_argc;
+static char** g_main_argv;
+
+static volatile sig_atomic_t g_quit_signal;
+
+static constexpr u64 g_frame_per_second = 60u;
+static constexpr u64 g_nanoseconds_per_second = 1000000000u;
+
+static struct Crash_Handler_Posix {
+	static constexpr size_t memory_size = Megabytes(4);
+
+	Mutex mutex;
+	void* memory;
+} g_crash_handler;
+
+// ---- IMPLEMENTATION
+
+static long futex_wait(u32* adress, u32 expected){
+	return syscall(SYS_futex, adress, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static long futex_wake(u32* adress, u32 count){
+	return syscall(SYS_futex, adress, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+char atomic_read(char volatile* src){ return __atomic_load_n(src, __ATOMIC_SEQ_CST); }
+short atomic_read(short volatile* src){ return __atomic_load_n(src, __ATOMIC_SEQ_CST); }
+uint atomic_read(uint volatile* src){ return __atomic_load_n(src, __ATOMIC_SEQ_CST); }
+int64 atomic_read(int64 volatile* src){ return __atomic_load_n(src, __ATOMIC_SEQ_CST); }
+
+// same semantic as the Interlocked functions: increment and decrement return the new value, exchange and compare_exchange the previous one
+short atomic_increment(short volatile* dst){ return __atomic_add_fetch(dst, 1, __ATOMIC_SEQ_CST); };
+uint atomic_increment(uint volatile* dst){ return __atomic_add_fetch(dst, 1u, __ATOMIC_SEQ_CST); };
+int64 atomic_increment(int64 volatile* dst){ return __atomic_add_fetch(dst, 1, __ATOMIC_SEQ_CST); };
+
+short atomic_decrement(short volatile* dst){ return __atomic_sub_fetch(dst, 1, __ATOMIC_SEQ_CST); };
+uint atomic_decrement(uint volatile* dst){ return __atomic_sub_fetch(dst, 1u, __ATOMIC_SEQ_CST); };
+int64 atomic_decrement(int64 volatile* dst){ return __atomic_sub_fetch(dst, 1, __ATOMIC_SEQ_CST); };
+
+char atomic_exchange(char volatile* dst, char src){ return __atomic_exchange_n(dst, src, __ATOMIC_SEQ_CST); };
+short atomic_exchange(short volatile* dst, short src){ return __atomic_exchange_n(dst, src, __ATOMIC_SEQ_CST); };
+uint atomic_exchange(uint volatile* dst, uint src){ return __atomic_exchange_n(dst, src, __ATOMIC_SEQ_CST); };
+int64 atomic_exchange(int64 volatile* dst, int64 src){ return __atomic_exchange_n(dst, src, __ATOMIC_SEQ_CST); };
+
+char atomic_compare_exchange(char volatile* dst, char src, char cmp){ __atomic_compare_exchange_n(dst, &cmp, src, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return cmp; }
+short atomic_compare_exchange(short volatile* dst, short src, short cmp){ __atomic_compare_exchange_n(dst, &cmp, src, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return cmp; }
+uint atomic_compare_exchange(uint volatile* dst, uint src, uint cmp){ __atomic_compare_exchange_n(dst, &cmp, src, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return cmp; }
+int64 atomic_compare_exchange(int64 volatile* dst, int64 src, int64 cmp){ __atomic_compare_exchange_n(dst, &cmp, src, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return cmp; }
+
+void Mutex::acquire(){
+	Mutex_Posix* posix = (Mutex_Posix*)this;
+
+	u32 state = atomic_compare_exchange(&posix->state, 1u, 0u);
+	if (state == 0u) return;
+
+	if (state != 2u) state = atomic_exchange(&posix->state, 2u);
+	while (state != 0u){
+		futex_wait(&posix->state, 2u);
+		state = atomic_exchange(&posix->state, 2u);
+	}
+}
+
+void Mutex::release(){
+	Mutex_Posix* posix = (Mutex_Posix*)this;
+
+	if (atomic_decrement(&posix->state) != 0u){
+		atomic_exchange(&posix->state, 0u);
+		futex_wake(&posix->state, 1u);
+	}
+}
+
+void create_mutex(Mutex* mutex){
+	Mutex_Posix* posix = (Mutex_Posix*)mutex;
+	posix->state = 0u;
+}
+
+void destroy_mutex(Mutex* mutex){
+	Mutex_Posix* posix = (Mutex_Posix*)mutex;
+	ram_assert(posix->state == 0u);
+}
+
+// waiters is incremented before sleeping so that a release either sees the waiter or changes state before the futex_wait
+static void mutexRW_wait(MutexRW_Posix* posix, u32 state){
+	atomic_increment(&posix->waiters);
+	futex_wait(&posix->state, state);
+	atomic_decrement(&posix->waiters);
+}
+
+static void mutexRW_wake(MutexRW_Posix* posix){
+	if (atomic_read(&posix->waiters)) futex_wake(&posix->state, INT32_MAX);
+}
+
+void MutexRW::acquire_read(){
+	MutexRW_Posix* posix = (MutexRW_Posix*)this;
+	while (true){
+		u32 state = atomic_read(&posix->state);
+		if (state & MutexRW_Posix::writer_bit)
+			mutexRW_wait(posix, state);
+		else if (atomic_compare_exchange(&posix->state, state + 1u, state) == state)
+			return;
+	}
+}
+
+void MutexRW::release_read(){
+	MutexRW_Posix* posix = (MutexRW_Posix*)this;
+	if (atomic_decrement(&posix->state) == 0u) mutexRW_wake(posix);
+}
+
+void MutexRW::acquire_write(){
+	MutexRW_Posix* posix = (MutexRW_Posix*)this;
+	while (true){
+		u32 state = atomic_compare_exchange(&posix->state, MutexRW_Posix::writer_bit, 0u);
+		if (state == 0u) return;
+		mutexRW_wait(posix, state);
+	}
+}
+
+void MutexRW::release_write(){
+	MutexRW_Posix* posix = (MutexRW_Posix*)this;
+	atomic_exchange(&posix->state, 0u);
+	mutexRW_wake(posix);
+}
+
+void create_mutexRW(MutexRW* mutex){
+	MutexRW_Posix* posix = (MutexRW_Posix*)mutex;
+	posix->state = 0u;
+	posix->waiters = 0u;
+}
+
+void destroy_mutexRW(MutexRW* mutex){
+}
+
+static void* Thread_Posix_proc(void* param){
+	Thread_Posix* posix = (Thread_Posix*)param;
+	posix->function(posix->param);
+	return NULL;
+}
+
+void create_thread(Thread* thread, Thread_Function function, void* param){
+	Thread_Posix* posix = (Thread_Posix*)thread;
+	posix->function = function;
+	posix->param = param;
+	if (pthread_create(&posix->handle, NULL, Thread_Posix_proc, posix) != 0) crash("pthread_create failed");
+}
+
+void join_thread(Thread* thread){
+	Thread_Posix* posix = (Thread_Posix*)thread;
+	pthread_join(posix->handle, NULL);
+}
+
+int thread_id(){
+	return (int)syscall(SYS_gettid);
+}
+
+int main_thread_id(){
+	return g_main_thread_id;
+}
+
+void create_argc_argv(){
+	g_argc = g_main_argc;
+	g_argv = g_main_argv;
+}
+
+void destroy_argc_argv(){
+
+}
+
+void crash( const char* context_format, ... )
+{
+	int error_code = errno;
+
+	g_crash_handler.mutex.acquire();
+
+	if (g_crash_handler.memory) munmap(g_crash_handler.memory, Crash_Handler_Posix::memory_size);
+	g_crash_handler.memory = NULL;
+
+	char context_msg[Logger::msg_max_size];
+	va_list args;
+	va_start(args, context_format);
+	vsnprintf(context_msg, sizeof(context_msg), context_format, args);
+	va_end(args);
+
+	fprintf(stderr, ram_project " - FATAL ERROR\n%s\n%s\n", context_msg, error_code ? strerror(error_code) : "");
+
+	Logger_Posix* posix = (Logger_Posix*)g_logger;
+	if (posix && posix->file){
+		fprintf(posix->file, ram_project " - FATAL ERROR\n%s\n%s\n", context_msg, error_code ? strerror(error_code) : "");
+		fflush(posix->file);
+	}
+
+	_exit( 42 );
+}
+
+void create_crash_handler()
+{
+	create_mutex(&g_crash_handler.mutex);
+
+	void* memory = mmap(NULL, Crash_Handler_Posix::memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) crash("Failed to allocate crash handler memory");
+
+	memset(memory, 0xFF, Crash_Handler_Posix::memory_size);
+	g_crash_handler.memory = memory;
+}
+
+void destroy_crash_handler()
+{
+	munmap(g_crash_handler.memory, Crash_Handler_Posix::memory_size);
+	g_crash_handler.memory = NULL;
+
+	destroy_mutex(&g_crash_handler.mutex);
+}
+
+void Logger::log_message_from_macro(log_type type, int line, const char* filepath, const char* format, ...){
+	Logger_Posix* posix = (Logger_Posix*)this;
+	ram_assert(type < Logger::log_type_count);
+
+	Log log;
+	log.type = type;
+	log.line = line;
+	log.filepath = filepath;
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(log.message, sizeof(Log::message), format, args);
+	va_end(args);
+
+	// filepath(line):[HH:MM:SS] type message
+	char time_str[16];
+	time_t cur_time = time(NULL);
+	tm loc_time;
+	localtime_r(&cur_time, &loc_time);
+	strftime(time_str, sizeof(time_str), "[%H:%M:%S]", &loc_time);
+
+	posix->mutex.acquire();
+
+	fprintf(stderr, "%s(%d):%s %s %s\n", filepath, line, time_str, Logger::log_type_str[type], log.message);
+	if (posix->file){
+		fprintf(posix->file, "%s(%d):%s %s %s\n", filepath, line, time_str, Logger::log_type_str[type], log.message);
+		fflush(posix->file);
+	}
+
+	posix->mutex.release();
+}
+
+void create_logger(){
+	Logger_Posix* posix = (Logger_Posix*)malloc(sizeof(Logger_Posix));
+	if (!posix) crash("Failed to allocate the logger");
+
+	create_mutex(&posix->mutex);
+	posix->file = fopen(Logger_Posix::log_path, "w");
+
+	g_logger = (Logger*)posix;
+
+	if (!posix->file) ram_warning("Failed to open the log file %s", Logger_Posix::log_path);
+}
+
+void destroy_logger(){
+	Logger_Posix* posix = (Logger_Posix*)g_logger;
+	if (posix->file) fclose(posix->file);
+	destroy_mutex(&posix->mutex);
+
+	free(g_logger);
+	g_logger = NULL;
+}
+
+void Window::set_title(const char* title){
+}
+
+void Window::enable_resizing(){
+}
+
+void Window::disable_resizing(){
+}
+
+void Window::set_size(int width, int height){
+	Window_Posix* posix = (Window_Posix*)this;
+	posix->width = width;
+	posix->height = height;
+	posix->needs_repaint = true;
+}
+
+void Window::get_size(int& width, int& height){
+	Window_Posix* posix = (Window_Posix*)this;
+	width = posix->width;
+	height = posix->height;
+}
+
+Window* Window_Manager::create_window(){
+	ram_assert(!debug_update_window_manager_guard.get());
+
+	Window_Posix* posix = (Window_Posix*)malloc(sizeof(Window_Posix));
+	if (!posix) crash("Failed to allocate a window");
+
+	posix->user_requested_close = false;
+	posix->needs_repaint = true;
+	posix->width = 640;
+	posix->height = 320;
+
+	windows_mutex.acquire();
+	windows.push(posix);
+	windows_mutex.release();
+
+	return posix;
+}
+
+void Window_Manager::destroy_window(Window* window){
+	ram_assert(!debug_update_window_manager_guard.get());
+
+	int found_window = false;
+
+	windows_mutex.acquire();
+
+	for (u64 iwindow = 0; iwindow != windows.size(); ++iwindow){
+		if (windows[iwindow] == window){
+			windows.remove(iwindow);
+			found_window = true;
+			break;
+		}
+	}
+
+	windows_mutex.release();
+
+	if (!found_window) ram_error("Destroying a window that is unknown to the window manager");
+
+	free(window);
+}
+
+static void quit_signal_handler(int signal){
+	g_quit_signal = 1;
+}
+
+void create_window_manager(){
+	Window_Manager_Posix* posix = (Window_Manager_Posix*)malloc(sizeof(Window_Manager_Posix));
+	if (!posix) crash("Failed to allocate the window manager");
+
+	ram_assert_dependency(debug_update_window_manager_guard.set(false));
+
+	create_mutex(&posix->windows_mutex);
+
+	posix->windows.create();
+	g_window_manager = posix;
+
+	g_quit_signal = 0;
+	signal(SIGINT, quit_signal_handler);
+	signal(SIGTERM, quit_signal_handler);
+}
+
+void update_window_manager()
+{
+	ram_assert_dependency(debug_update_window_manager_guard.set(true);)
+
+	if (g_quit_signal){
+		g_window_manager->windows_mutex.acquire();
+		for (u64 iwindow = 0; iwindow != g_window_manager->windows.size(); ++iwindow)
+			g_window_manager->windows[iwindow]->user_requested_close = true;
+		g_window_manager->windows_mutex.release();
+	}
+
+	ram_assert_dependency(debug_update_window_manager_guard.set(false);)
+}
+
+void destroy_window_manager(){
+	Window_Manager_Posix* posix = (Window_Manager_Posix*)g_window_manager;
+
+	for (u64 iwin = 0; iwin != posix->windows.size(); ++iwin)
+		free(posix->windows[iwin]);
+
+	posix->windows.destroy();
+	destroy_mutex(&posix->windows_mutex);
+
+	free(g_window_manager);
+	g_window_manager = NULL;
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+}
+
+void copy_image_to_window(int width, int height, RGBA* data, Window* window){
+	copy_image_rows_to_window(width, height, data, 0, height, window);
+}
+
+void copy_image_rows_to_window(int width, int height, RGBA* data, int row_begin, int row_count, Window* window){
+	ram_assert(row_begin >= 0 && row_count >= 0 && row_begin + row_count <= height);
+}
+
+// the main thread plays the role of the audio thread in update_audio
+int Audio::audio_thread_id(){
+	return g_main_thread_id;
+}
+
+void create_audio(){
+	Audio_Null* null = (Audio_Null*)malloc(sizeof(Audio_Null));
+	if (!null) crash("Failed to allocate the audio");
+
+	null->audio_thread_counter.set(0);
+	for (int istate = 0; istate != Audio::max_DSP_count; ++istate) null->DSP_states[istate].set(Audio::Available);
+	g_audio = (Audio*)null;
+}
+
+void update_audio()
+{
+	Audio_Null* null = (Audio_Null*)g_audio;
+
+	for (int iDSP = 0; iDSP != Audio::max_DSP_count; ++iDSP){
+		Audio::DSP_State state = null->DSP_states[iDSP].get();
+
+		if (state == Audio::Active)
+			null->DSPs[iDSP].audio_thread_update_param();
+		else if (state == Audio::Inactive)
+			null->DSP_states[iDSP].set(Audio::Destroyable);
+	}
+	null->audio_thread_counter.increment();
+
+	null->destroy_destroyable_DSPs();
+}
+
+void destroy_audio(){
+	Audio_Null* null = (Audio_Null*)g_audio;
+
+	for (int iDSP = 0; iDSP != Audio::max_DSP_count; ++iDSP){
+		null->DSP_states[iDSP].compare_exchange(Audio::Active, Audio::Destroyable);
+		null->DSP_states[iDSP].compare_exchange(Audio::Inactive, Audio::Destroyable);
+	}
+
+	null->destroy_destroyable_DSPs();
+
+	free(g_audio);
+	g_audio = NULL;
+}
+
+struct File_System_Posix{
+};
+
+// the file is mapped and copied to memory owned by the caller ; data is NULL on failure
+void File_System::ReadFile(const char* path, void*& data, size_t& data_size){
+	data = NULL;
+	data_size = 0u;
+
+	int file = open(path, O_RDONLY);
+	if (file == -1){
+		ram_error("Failed to open with path : %s ; %s", path, strerror(errno));
+		return;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) == -1){
+		ram_error("Failed to fstat with path : %s ; %s", path, strerror(errno));
+		close(file);
+		return;
+	}
+
+	size_t size = (size_t)status.st_size;
+	void* memory = malloc(max(size, (size_t)1u));
+	if (!memory) crash("Failed to allocate %zu bytes for %s", size, path);
+
+	if (size){
+		void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping == MAP_FAILED){
+			ram_error("Failed to mmap with path : %s ; %s", path, strerror(errno));
+			free(memory);
+			close(file);
+			return;
+		}
+
+		memcpy(memory, mapping, size);
+		munmap(mapping, size);
+	}
+
+	close(file);
+
+	data_size = size;
+	data = memory;
+}
+
+void create_file_system(){
+	File_System_Posix* posix = (File_System_Posix*)malloc(sizeof(File_System));
+	g_file_system = (File_System*)posix;
+}
+
+void destroy_file_system(){
+	free(g_file_system);
+	g_file_system = NULL;
+}
+
+// CLOCK_MONOTONIC_RAW is not slewed by NTP ; ticks are nanoseconds
+struct Timer_Posix{
+};
+
+u64 Timer::ticks(){
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+	return (u64)time.tv_sec * g_nanoseconds_per_second + (u64)time.tv_nsec;
+}
+
+u64 Timer::ticks_per_second(){
+	return g_nanoseconds_per_second;
+}
+
+float Timer::as_ms(u64 ticks){
+	double ms = (double)ticks / (double)ticks_per_second() * 1000.;
+	return (float)ms;
+}
+
+float Timer::as_seconds(u64 ticks){
+	double seconds = (double)ticks / (double)ticks_per_second();
+	return (float)seconds;
+}
+
+void create_timer(){
+	Timer_Posix* posix = (Timer_Posix*)malloc(sizeof(Timer));
+	g_timer = (Timer*)posix;
+}
+
+void destroy_timer(){
+	free(g_timer);
+	g_timer = NULL;
+}
+
+Input::Listener* Input::create_listener(){
+	ram_assert(!debug_update_input_guard.get());
+
+	Input::Listener* listener = (Input::Listener*)malloc(sizeof(Input::Listener));
+	if (!listener) crash("Failed to allocate a listener");
+
+	listener->actions.create();
+	listener->device_type = Input::Device_None;
+	listener->pairing_mode = Input::Pairing_None;
+
+	listeners_mutex.acquire();
+	listeners.push(listener);
+	listeners_mutex.release();
+
+	return listener;
+}
+
+void Input::destroy_listener(Input::Listener* to_destroy){
+	ram_assert(!debug_update_input_guard.get());
+
+	int found_listener = false;
+
+	listeners_mutex.acquire();
+
+	for (u64 ilistener = 0; ilistener != listeners.size(); ++ilistener){
+		if (listeners[ilistener] == to_destroy){
+			listeners.remove(ilistener);
+			found_listener = true;
+			break;
+		}
+	}
+
+	listeners_mutex.release();
+
+	if (!found_listener) ram_error("Destroying a listener that is unknown to the input manager");
+
+	to_destroy->actions.destroy();
+	free(to_destroy);
+}
+
+// there is no keyboard ; the key is used as its own scancode
+u32 RAMKey_to_scancode(RAM_Key key){
+	return (u32)key;
+}
+
+void create_input(){
+	Input_Null* null = (Input_Null*)malloc(sizeof(Input_Null));
+	if (!null) crash("Failed to allocate the input");
+
+	null->frame_counter = 0u;
+	create_mutex(&null->listeners_mutex);
+	null->listeners.create();
+
+	g_input = (Input*)null;
+}
+
+void update_input(){
+	ram_assert_dependency(debug_update_input_guard.set(true);)
+	++g_input->frame_counter;
+	ram_assert_dependency(debug_update_input_guard.set(false);)
+}
+
+void destroy_input(){
+	Input_Null* null = (Input_Null*)g_input;
+	null->listeners.destroy();
+	destroy_mutex(&null->listeners_mutex);
+
+	free(g_input);
+	g_input = NULL;
+}
+
+void create_engine(){
+	Engine_Posix* posix = (Engine_Posix*)malloc(sizeof(Engine_Posix));
+	if (!posix) crash("Failed to allocate the engine");
+
+	g_engine = (Engine*)posix;
+}
+void destroy_engine(){
+	Engine_Posix* posix = (Engine_Posix*)g_engine;
+	free(posix);
+	g_engine = NULL;
+}
+
+// sleeps until the next frame deadline ; the deadline restarts from now after a frame longer than a period
+static void wait_next_frame(timespec& deadline){
+	constexpr u64 period = g_nanoseconds_per_second / g_frame_per_second;
+
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	u64 deadline_ns = (u64)deadline.tv_sec * g_nanoseconds_per_second + (u64)deadline.tv_nsec + period;
+	u64 now_ns = (u64)now.tv_sec * g_nanoseconds_per_second + (u64)now.tv_nsec;
+	if (deadline_ns < now_ns) deadline_ns = now_ns;
+
+	deadline.tv_sec = (time_t)(deadline_ns / g_nanoseconds_per_second);
+	deadline.tv_nsec = (long)(deadline_ns % g_nanoseconds_per_second);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR && !g_quit_signal);
+}
+
+int main(int argc, char* argv[]){
+	g_main_argc = argc;
+	g_main_argv = argv;
+	create_argc_argv();
+	g_main_thread_id = thread_id();
+
+	create_crash_handler();
+
+	create_logger();
+	create_window_manager();
+	create_audio();
+	create_file_system();
+	create_timer();
+	create_input();
+	create_default_random();
+	create_engine();
+
+	g_game_create();
+
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	while (true)
+	{
+		update_window_manager();
+		update_input();
+		update_audio();
+
+		int quit_request = false;
+		quit_request = g_game_update();
+		if (quit_request) break;
+
+		g_game_render();
+
+		wait_next_frame(deadline);
+	}
+
+	g_game_destroy();
+
+	destroy_engine();
+	destroy_input();
+	destroy_timer();
+	destroy_file_system();
+	destroy_audio();
+	destroy_window_manager();
+	destroy_logger();
+
+	destroy_crash_handler();
+
+	return 0;
+}
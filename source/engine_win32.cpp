@@ -49,11 +49,30 @@ struct MutexRW_Win32{
 };
 static_assert(sizeof(MutexRW_Win32) <= sizeof(MutexRW), "MutexRW_Win32 too bing compare to MutexRW");
 
+struct Thread_Win32{
+	HANDLE handle;
+	Thread_Function function;
+	void* param;
+};
+static_assert(sizeof(Thread_Win32) <= sizeof(Thread), "Thread_Win32 too big compared to Thread");
+
 struct Logger_Win32 : Logger {
 };
 
+struct BGRA{
+	u8 b;
+	u8 g;
+	u8 r;
+	u8 a;
+};
+
 struct Window_Win32 : Window {
 	HWND handle;
+
+	// converted copy of the last image, kept between calls so that unchanged rows are not converted again
+	BGRA* bitmap;
+	int bitmap_width;
+	int bitmap_height;
 };
 
 LRESULT CALLBACK Window_Win32_WindowProc(HWND handle, UINT message, WPARAM wparam, LPARAM lparam);
@@ -61,13 +80,6 @@ LRESULT CALLBACK Window_Win32_WindowProc(HWND handle, UINT message, WPARAM wpara
 struct Window_Manager_Win32 : Window_Manager {
 };
 
-struct BGRA{
-	u8 b;
-	u8 g;
-	u8 r;
-	u8 a;
-};
-
 struct Audio_WASAPI : Audio {
 	enum Request : int{
 		None,
@@ -281,6 +293,26 @@ void create_mutexRW(MutexRW* mutex){
 void destroy_mutexRW(MutexRW* mutex){
 }
 
+static DWORD WINAPI Thread_Win32_proc(LPVOID lpparam){
+	Thread_Win32* win32 = (Thread_Win32*)lpparam;
+	win32->function(win32->param);
+	return 0;
+}
+
+void create_thread(Thread* thread, Thread_Function function, void* param){
+	Thread_Win32* win32 = (Thread_Win32*)thread;
+	win32->function = function;
+	win32->param = param;
+	win32->handle = CreateThread(NULL, 0, Thread_Win32_proc, win32, 0, NULL);
+	if (!win32->handle) crash("CreateThread failed");
+}
+
+void join_thread(Thread* thread){
+	Thread_Win32* win32 = (Thread_Win32*)thread;
+	WaitForSingleObject(win32->handle, INFINITE);
+	CloseHandle(win32->handle);
+}
+
 int thread_id(){
 	return GetCurrentThreadId();
 }
@@ -597,6 +629,7 @@ void Window::set_size(int width, int height){
 	int wheight = wrect.bottom - wrect.top;
 
 	SetWindowPos(win32->handle, 0, 0, 0, wwidth, wheight, SWP_NOZORDER | SWP_NOMOVE);
+	win32->needs_repaint = true;
 }
 
 void Window::get_size(int& width, int& height){
@@ -631,6 +664,10 @@ LRESULT CALLBACK Window_Win32_WindowProc(HWND handle, UINT message, WPARAM wpara
 		win32 = (Window_Win32*)createstruct->lpCreateParams;
 
 		win32->user_requested_close = false;
+		win32->needs_repaint = true;
+		win32->bitmap = NULL;
+		win32->bitmap_width = 0;
+		win32->bitmap_height = 0;
 
 		win32->handle = handle;
 		SetWindowLongPtrA(handle, GWLP_USERDATA, (LONG_PTR)win32);
@@ -672,6 +709,7 @@ LRESULT CALLBACK Window_Win32_WindowProc(HWND handle, UINT message, WPARAM wpara
 		PAINTSTRUCT paint;
 		HDC context = BeginPaint(handle, &paint);
 		FillRect(context, &paint.rcPaint, (HBRUSH)COLOR_BACKGROUND);
+		win32->needs_repaint = true;
 		g_game_render();
 		EndPaint(handle, &paint);
 		return false;
@@ -744,6 +782,7 @@ Window* Window_Manager::create_window(){
 
 static void destroy_window_ptr(Window_Win32* win32){
 	DestroyWindow(win32->handle);
+	free(win32->bitmap);
 	free(win32);
 }
 
@@ -814,7 +853,24 @@ void destroy_window_manager(){
 };
 
 void copy_image_to_window(int width, int height, RGBA* data, Window* window){
+	copy_image_rows_to_window(width, height, data, 0, height, window);
+}
+
+void copy_image_rows_to_window(int width, int height, RGBA* data, int row_begin, int row_count, Window* window){
 	Window_Win32* window_win32 = (Window_Win32*)window;
+	ram_assert(row_begin >= 0 && row_count >= 0 && row_begin + row_count <= height);
+
+	if (window_win32->bitmap_width != width || window_win32->bitmap_height != height){
+		free(window_win32->bitmap);
+		window_win32->bitmap = (BGRA*)malloc(width * height * sizeof(BGRA));
+		if (!window_win32->bitmap) crash("Failed to allocate the window bitmap");
+		window_win32->bitmap_width = width;
+		window_win32->bitmap_height = height;
+
+		row_begin = 0;
+		row_count = height;
+	}
+	if (!row_count) return;
 
 	int win_width, win_height;
 	window_win32->get_size(win_width, win_height);
@@ -827,27 +883,28 @@ void copy_image_to_window(int width, int height, RGBA* data, Window* window){
 	info.bmiHeader.biBitCount = sizeof(BGRA) * 8;
 	info.bmiHeader.biCompression = BI_RGB;
 
-	// TODO: use scratch memory
-	BGRA* BITMAP_DATA = (BGRA*)malloc(width * height * sizeof(BGRA));
-	for (int ipix = 0; ipix != width * height; ++ipix){
+	BGRA* BITMAP_DATA = window_win32->bitmap;
+	for (int ipix = row_begin * width; ipix != (row_begin + row_count) * width; ++ipix){
 		BITMAP_DATA[ipix].b = data[ipix].b;
 		BITMAP_DATA[ipix].g = data[ipix].g;
 		BITMAP_DATA[ipix].r = data[ipix].r;
 		BITMAP_DATA[ipix].a = data[ipix].a;
 	}
 
+	// the source rectangle of a bottom-up DIB starts from its bottom row and the destination rectangle from the top of the window
+	int dest_top = win_height * (height - row_begin - row_count) / height;
+	int dest_bottom = win_height * (height - row_begin) / height;
+
 	HDC device_context = GetDC(window_win32->handle);
 	if (device_context){
 		StretchDIBits(device_context,
-			0, 0, win_width, win_height,
-			0, 0, width, height,
+			0, dest_top, win_width, dest_bottom - dest_top,
+			0, row_begin, width, row_count,
 			BITMAP_DATA, &info,
 			DIB_RGB_COLORS, SRCCOPY
 		);
 		ReleaseDC(window_win32->handle, device_context);
 	}
-
-	free(BITMAP_DATA);
 }
 
 int Audio::audio_thread_id(){
@@ -1745,6 +1802,8 @@ void create_input(){
 	g_RAMKey_to_scancode[RAMK_X] = 45;
 	g_RAMKey_to_scancode[RAMK_C] = 46;
 	g_RAMKey_to_scancode[RAMK_V] = 47;
+	g_RAMKey_to_scancode[RAMK_BACKSPACE] = 14;
+	g_RAMKey_to_scancode[RAMK_TAB] = 15;
 
 	RAWINPUTDEVICE RIDs[1];
 
@@ -1,5 +1,6 @@
 #include "engine.h"
 #include "core.h"
+#include "chip8.h"
 
 struct LFO_Param{
 	void set_frequency(float frequency){
@@ -36,769 +37,360 @@ void LFO_Processor(u32 frame_count, s16* output, void* in_param, void* in_intern
 	}
 }
 
-// REF: http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#1.0 [Cowgod's Chip-8 Technical Reference v1.0]
-
-struct Chip8{
-	int screen_width;
-	int screen_height;
-
-	float emulation_speed;
-
-	float instructions_per_second;
-	float timer_per_second;
-
-	float instruction_accumulator;
-	float timer_accumulator;
-
-	struct Memory{
-		// interpreter memory covers adresses 0x000 - 0x1FF
-		struct Interpreter{
-			u8 sprites[80];
-			u8 unused[512 - sizeof(sprites)];
-		} interpreter_range;
-
-		// user memory covers adresses 0x1FF - 0xFFF
-		u8 user_range[Kilobytes(4) - sizeof(Interpreter)];
-	} memory;
-
-	union Registers
-	{
-		struct
-		{
-			u8 V0;
-			u8 V1;
-			u8 V2;
-			u8 V3;
-			u8 V4;
-			u8 V5;
-			u8 V6;
-			u8 V7;
-			u8 V8;
-			u8 V9;
-			u8 VA;
-			u8 VB;
-			u8 VC;
-			u8 VD;
-			u8 VE;
-			u8 VF; // flag register
-		};
-		u8 by_index[16];
-	} registers;
-
-	u16 I;
-
-	u8 DT; // delay timer register
-	u8 ST; // sound timer register
-
-	u16 PC; // program counter
-	u16 SP; // stack pointer
-
-	u16 STACK[16];
-
-	// monochrome ; 64x32 ; column major ; (0, 0) top-left ; (63, 31) bottom-right
-	u8 SCREEN[256]; 
-
-	// 0 1 2 3 4 5 6 7 8 9 A B C D E F
-	// with original layout
-	// 1 2 3 C
-	// 4 5 6 D
-	// 7 8 9 E
-	// A 0 B F
-	u8 KEYBOARD[16];
-	u8 LAST_KEYBOARD[16];
-
-	enum ERROR_TYPE{
-		NONE = 0,
-		MEMORY_OUT_OF_BOUNDS,
-		REGISTER_OUT_OF_BOUNDS,
-		PC_INCORRECT,
-		SP_INCORRECT,
-		INSTRUCTION_UNKNOWN,
-		KEY_UNKNOWN,
-		SCREEN_COORD_INCORRECT,
-	};
-	ERROR_TYPE ERROR;
-};
-
-void Chip8_validate_memory(Chip8* chip8, u16 adress, u16 size){
-	if ((adress > sizeof(Chip8::Memory::Interpreter::sprites) && adress < 0x200) || (adress + size) > 0xFFF){
-		chip8->ERROR = Chip8::MEMORY_OUT_OF_BOUNDS;
-		ram_assert_msg(false, "MEMORY_OUT_OF_BOUNDS");
-	}
-}
-
-u8* Chip8_get_memory(Chip8* chip8, u16 adress){
-	return (u8*)&chip8->memory + adress;
-}
-
-void Chip8_validate_registers(Chip8* chip8, u16 register_index, u16 register_count){
-	if ((register_index + register_count) > 16){
-		chip8->ERROR = Chip8::REGISTER_OUT_OF_BOUNDS;
-		ram_assert_msg(false, "REGISTER_OUT_OF_BOUNDS");
+// XO-CHIP plays the 128 bits of AUDIO_PATTERN in a loop, most significant bit of the first byte first, at Chip8_audio_rate(PITCH) bits per second
+// REF: https://johnearnest.github.io/Octo/docs/XO-ChipSpecification.html [XO-CHIP Specification - Audio]
+struct Pattern_Param{
+	void set_rate(float bits_per_second){
+		bits_per_sample = (float)((double)bits_per_second / (double)Audio::samples_per_second);
 	}
-}
-
-void Chip8_create( Chip8* chip8, void* ROM, size_t ROM_size )
-{
-	chip8->screen_width = 64;
-	chip8->screen_height = 32;
-
-	chip8->emulation_speed = 1.f;
-
-	chip8->instructions_per_second = 500.f;
-	chip8->timer_per_second = 60.f;
-
-	chip8->instruction_accumulator = 0.f;
-	chip8->timer_accumulator = 0.f;
-
-	memset(&chip8->memory, 0x00, sizeof(Chip8::memory));
-	memset(&chip8->registers, 0x00, sizeof(Chip8::registers));
 
-	chip8->I = 0;
-
-	chip8->DT = 0;
-	chip8->ST = 0;
-
-	chip8->PC = 0;
-	chip8->SP = 0;
-
-	memset(&chip8->STACK, 0x00, sizeof(Chip8::STACK));
-	memset(&chip8->SCREEN, 0x00, sizeof(Chip8::SCREEN));
-	memset(&chip8->KEYBOARD, 0x00, sizeof(Chip8::KEYBOARD));
-	memset(&chip8->LAST_KEYBOARD, 0x00, sizeof(Chip8::KEYBOARD));
-
-	chip8->ERROR = Chip8::NONE;
-
-	static_assert(offsetof(Chip8::Memory, user_range) == 0x200);
-	static_assert(sizeof(Chip8::Memory) == 4096);
-
-	u8 sprite_data[] = {
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-	};
-
-	// sizeof(sprite_data) == sizeof(Chip8::memory::interpreter_range::sprites)
-	static_assert(sizeof(sprite_data) == sizeof(Chip8::Memory::Interpreter::sprites));
+	int pause;
+	u8 pattern[16];
+	float bits_per_sample;
+};
+struct Pattern_Data{
+	float bit_cursor; // in [0 ; 128[
+};
+void Pattern_Processor(u32 frame_count, s16* output, void* in_param, void* in_internal_data){
+	Pattern_Param* param = (Pattern_Param*)in_param;
+	Pattern_Data* internal_data = (Pattern_Data*)in_internal_data;
 
-	memcpy(chip8->memory.interpreter_range.sprites, sprite_data, sizeof(Chip8::Memory::Interpreter::sprites));
+	constexpr float pattern_bits = 128.f;
+	// the pattern is a square wave at full scale so it is attenuated to the loudness of the sine of LFO_Processor
+	constexpr s16 amplitude = INT16_MAX / 2;
 
-	chip8->PC = 0x200;
+	if (!param->pause){
+		float cursor = internal_data->bit_cursor;
 
-	ram_assert(ROM_size <= sizeof(Chip8::Memory::user_range));
-	memcpy((void*)(chip8->memory.user_range), ROM, ROM_size);
-}
+		for (u32 isample = 0; isample != frame_count; ++isample){
+			u32 ibit = (u32)cursor;
+			u32 bit = (param->pattern[ibit >> 3u] >> (7u - (ibit & 7u))) & 1u;
 
-void Chip8_destroy(Chip8* chip8){
+			output[isample] += bit ? amplitude : -amplitude;
+			cursor = fmodf(cursor + param->bits_per_sample, pattern_bits);
+		}
 
+		internal_data->bit_cursor = cursor;
+	}
 }
 
-void Chip8_step(Chip8* chip8, float dtime_sec ){
-	dtime_sec *= chip8->emulation_speed;
+struct Game{
+	static constexpr int update_per_second = 60;
+	static constexpr u32 rewind_frame_capacity = 10u * 60u * update_per_second;
+	static constexpr u32 rewind_keyframe_period = update_per_second;
+	static constexpr u32 movie_checkpoint_period = update_per_second;
+	static constexpr u64 turbo_frame_maximum = 100000u;
+	// quirk sets of the ROMs detected by Chip8_detect_quirks ; see Chip8_quirk_cache_find
+	static constexpr const char* quirk_cache_path = ram_project "_quirks.txt";
 	
-	chip8->instruction_accumulator += chip8->instructions_per_second * dtime_sec;
-	int instruction_count = (int)floorf(chip8->instruction_accumulator);
-	chip8->instruction_accumulator -= (float)instruction_count;
-
-	float step_timer_decrement = chip8->timer_per_second * dtime_sec;
-	float timer_decrement_per_instruction = step_timer_decrement / instruction_count;
-
-	short instruction = 0x0000;
-	char* instruction_byte = (char*)&instruction;
-
-	//instruction_count = 1;
-	while (instruction_count)
-	{
-		chip8->timer_accumulator += timer_decrement_per_instruction;
-		int timer_decrement = (int)chip8->timer_accumulator;
-		chip8->timer_accumulator -= (float)timer_decrement;
-
-		chip8->DT -= min(chip8->DT, (u8)timer_decrement);
-		chip8->ST -= min(chip8->ST, (u8)timer_decrement);
-
-		Chip8_validate_memory(chip8, chip8->PC, 2);
-		if (chip8->ERROR) break;
-
-		u8* memptr = Chip8_get_memory(chip8, chip8->PC);
-		instruction_byte[1] = *memptr;
-		++memptr;
-		instruction_byte[0] = *memptr;
-		chip8->PC += 2;
-
-		if( instruction == 0x00E0 ) // CLS
-		{
-			memset( chip8->SCREEN, 0x00, sizeof( Chip8::SCREEN ) );
-		}
-		else if( instruction == 0x00EE ) // RET
-		{
-			if (chip8->SP == 0){
-				chip8->ERROR = Chip8::SP_INCORRECT;
-				break;
-			}
-
-			--chip8->SP;
-			chip8->PC = chip8->STACK[chip8->SP];
-		}
-		else if( ( instruction & 0xF000 ) == 0x1000 ) // JP addr
-		{
-			short addr = instruction & 0x0FFF;
-
-			Chip8_validate_memory(chip8, addr, 1);
-			if (chip8->ERROR) break;
-
-			chip8->PC = addr;
-		}
-		else if( ( instruction & 0xF000 ) == 0x2000 ) // CALL addr
-		{
-			short addr = instruction & 0x0FFF;
-
-			if (chip8->SP == sizeof(Chip8::STACK) - 1) chip8->ERROR = Chip8::SP_INCORRECT;
-			Chip8_validate_memory(chip8, addr, 2);
-			if (chip8->ERROR) break;
-
-			chip8->STACK[chip8->SP++] = chip8->PC;
-			chip8->PC = addr;
-		}
-		else if( ( instruction & 0xF000 ) == 0x3000 ) // SE Vx, byte
-		{
-			short regindex = (instruction & 0x0F00) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			short regcmp = instruction & 0x00FF;
-			if (chip8->registers.by_index[regindex] == regcmp)
-				chip8->PC = chip8->PC + 2;
-		}
-		else if( ( instruction & 0xF000 ) == 0x4000 ) // SNE Vx, byte
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			short regcmp = ( instruction & 0x00FF );
-			if( chip8->registers.by_index[regindex] != regcmp )
-				chip8->PC = chip8->PC + 2;
-		}
-		else if( ( instruction & 0xF00F ) == 0x5000 ) // SE Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
-
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
-
-			if (chip8->registers.by_index[regA] == chip8->registers.by_index[regB])
-				chip8->PC = chip8->PC + 2;
-		}
-		else if( (instruction & 0xF000) == 0x6000 ) // LD Vx, byte
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
+	Window* window;
+	// smallest client size of the window ; the window is a multiple of the Chip8 resolution at least as large
+	int min_window_width;
+	int min_window_height;
+	int min_window_ratio;
+	int window_ratio;
 
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
+	Frame_Controller controller; 
 
-			short regvalue = ( instruction & 0x00FF );
-			chip8->registers.by_index[regindex] = (u8)regvalue;
-		}
-		else if( (instruction & 0xF000) == 0x7000 ) // ADD Vx, byte
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
+	// holding the turbo action runs as many frames as fit in turbo_budget_ticks per host frame instead of the frames of controller
+	// turbo_ticks_per_frame is the smoothed cost of a frame ; 0 until the first turbo frame
+	u64 turbo_budget_ticks;
+	u64 turbo_ticks_per_frame;
 
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
+	Input::Listener* listener;
 
-			short regadd = ( instruction & 0x00FF );
-			chip8->registers.by_index[regindex] += regadd;
-		}
-		else if( (instruction & 0xF00F) == 0x8000 ) // LD Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
+	Chip8 chip8;
+	Pixel_Canvas screen;
+	// color of the pixels by plane bits ; lit pixels of plane 0 are palette[1], of plane 1 palette[2] and of both palette[3]
+	RGBA palette[4];
+	// Chip8::SCREEN_GENERATION of the last image copied to the window
+	u64 screen_generation;
 
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
+	// Chip8::MEMORY_PROFILE is saved to memory_profile_path.csv and memory_profile_path.ppm on exit
+	const char* memory_profile_path;
 
-			chip8->registers.by_index[regA] = chip8->registers.by_index[regB];
-		}
-		else if( (instruction & 0xF00F) == 0x8001 ) // OR Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
+	// every frame is captured ; holding the rewind action steps back one frame per frame instead of running the Chip8
+	// NULL with -rewind=0 and -record since movies only go forward
+	Chip8_Rewind* rewind;
 
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
+	// every frame is recorded to movie_path with -record ; replayed by chip8_run -replay
+	const char* movie_path;
+	Chip8_Movie_Recorder movie;
 
-			chip8->registers.by_index[regA] |= chip8->registers.by_index[regB];
-		}
-		else if( (instruction & 0xF00F) == 0x8002 ) // AND Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
+	// Pattern_Processor with XOCHIP and LFO_Processor otherwise
+	Audio_DSP* DSP;
+};
 
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
+static Game* g_game;
 
-			chip8->registers.by_index[regA] &= chip8->registers.by_index[regB];
-		}
-		else if( (instruction & 0xF00F) == 0x8003 ) // XOR Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
+// usage: Chip8tle ROM [-backend=interpreter|decoded|fused|threaded|jit|aot] [-machine=chip8|superchip|xochip] [-quirks=auto|cowgod|vip|chip48|superchip|xochip] [-profile] [-memory_profile=PATH] [-opcode_stats[=SAMPLE_PERIOD]] [-rewind=MEGABYTES] [-record=MOVIE] [-turbo_budget=MS] [-color_on=RRGGBB] [-color_off=RRGGBB] [-color_2=RRGGBB] [-color_3=RRGGBB]
+//        Chip8tle -benchmark ROM [ROM ...]
+struct Game_Options{
+	const char* ROM_paths[64];
+	int ROM_count;
+
+	Chip8::BACKEND_TYPE backend;
+	// Chip8::MACHINE_COUNT when detected from the ROM
+	Chip8::MACHINE_TYPE machine;
+	// Chip8_Quirks::TYPE_COUNT when detected from the ROM ; the benchmark uses the default quirks of the machine instead
+	Chip8_Quirks::TYPE quirks;
+	int benchmark;
+	int profile;
+	const char* memory_profile_path;
+	int opcode_stats;
+	u32 opcode_sample_period;
+	u32 rewind_megabytes;
+	const char* movie_path;
+	u32 turbo_budget_ms;
+
+	// Game::palette ; -color_off and -color_on set the colors 0 and 1
+	RGBA palette[4];
+};
 
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
+static RGBA parse_color(const char* arg, const char* hexadecimal){
+	char* end;
+	unsigned long value = strtoul(hexadecimal, &end, 16);
+	if (end == hexadecimal || *end != '\0' || value > 0xFFFFFFu)
+		crash("Invalid color: %s", arg);
+
+	RGBA color;
+	color.r = (u8)(value >> 16u);
+	color.g = (u8)(value >> 8u);
+	color.b = (u8)value;
+	color.a = 0xFF;
+	return color;
+}
 
-			chip8->registers.by_index[regA] ^= chip8->registers.by_index[regB];
-		}
-		else if( (instruction & 0xF00F) == 0x8004 ) // ADD Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
-
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
-
-			short add = chip8->registers.by_index[regA] + chip8->registers.by_index[regB];
-			chip8->registers.VF = add > 255 ? 1 : 0;
-			chip8->registers.by_index[regA] = (u8)add;
-		}
-		else if( (instruction & 0xF00F) == 0x8005 ) // SUB Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
+static void parse_options(Game_Options& options){
+	options.ROM_count = 0;
+	options.backend = Chip8::DECODED;
+	options.machine = Chip8::MACHINE_COUNT;
+	options.quirks = Chip8_Quirks::TYPE_COUNT;
+	options.benchmark = false;
+	options.profile = false;
+	options.memory_profile_path = NULL;
+	options.opcode_stats = false;
+	options.opcode_sample_period = 0u;
+	options.rewind_megabytes = 4u;
+	options.movie_path = NULL;
+	options.turbo_budget_ms = 10u;
+	options.palette[0] = {0x00, 0x00, 0x00, 0xFF};
+	options.palette[1] = {0xFF, 0xFF, 0xFF, 0xFF};
+	options.palette[2] = {0xFF, 0x66, 0x00, 0xFF};
+	options.palette[3] = {0x66, 0x22, 0x00, 0xFF};
 
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
+	for (int iarg = 1; iarg != g_argc; ++iarg){
+		const char* arg = g_argv[iarg];
 
-			chip8->registers.VF = chip8->registers.by_index[regA] > chip8->registers.by_index[regB] ? 1 : 0;
-			chip8->registers.by_index[regA] -= chip8->registers.by_index[regB];
+		if (strncmp(arg, "-backend=", cstring_size("-backend=")) == 0){
+			if (!Chip8_backend_from_name(arg + cstring_size("-backend="), options.backend))
+				crash("Unknown backend: %s", arg);
 		}
-		else if( (instruction & 0xF00F) == 0x8006 ) // SHR Vx {, Vy}
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			chip8->registers.VF = chip8->registers.by_index[regindex] & 0x01;
-			chip8->registers.by_index[regindex] >>= 1;
+		else if (strncmp(arg, "-machine=", cstring_size("-machine=")) == 0){
+			if (!Chip8_machine_from_name(arg + cstring_size("-machine="), options.machine))
+				crash("Unknown machine: %s", arg);
 		}
-		else if( (instruction & 0xF00F) == 0x8007 ) // SUBN Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
-
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
-
-			chip8->registers.VF = chip8->registers.by_index[regB] > chip8->registers.by_index[regA] ? 1 : 0;
-			chip8->registers.by_index[regA] = chip8->registers.by_index[regB] - chip8->registers.by_index[regA];
+		else if (strcmp(arg, "-quirks=auto") == 0){
+			options.quirks = Chip8_Quirks::TYPE_COUNT;
 		}
-		else if( (instruction & 0xF00F) == 0x800E ) // SHL Vx {, Vy}
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			chip8->registers.VF = (chip8->registers.by_index[regindex] & 0x80) >> 7;
-			chip8->registers.by_index[regindex] <<= 1;
+		else if (strncmp(arg, "-quirks=", cstring_size("-quirks=")) == 0){
+			if (!Chip8_quirks_from_name(arg + cstring_size("-quirks="), options.quirks))
+				crash("Unknown quirks: %s", arg);
 		}
-		else if( (instruction & 0xF00F) == 0x9000 ) // SNE Vx, Vy
-		{
-			short regA = ( instruction & 0x0F00 ) >> 8;
-			short regB = ( instruction & 0x00F0 ) >> 4;
-
-			Chip8_validate_registers(chip8, regA, 1);
-			Chip8_validate_registers(chip8, regB, 1);
-			if (chip8->ERROR) break;
-
-			if (chip8->registers.by_index[regA] != chip8->registers.by_index[regB])
-				chip8->PC = chip8->PC + 2;
+		else if (strcmp(arg, "-benchmark") == 0){
+			options.benchmark = true;
 		}
-		else if( ( instruction & 0xF000 ) == 0xA000 ) // LD I, addr
-		{
-			short regvalue = ( instruction & 0x0FFF );
-			chip8->I = regvalue;
+		else if (strcmp(arg, "-profile") == 0){
+			options.profile = true;
 		}
-		else if( ( instruction & 0xF000 ) == 0xB000 ) // JP V0, addr
-		{
-			short regvalue = (instruction & 0x0FFF);
-
-			short new_PC = regvalue + chip8->registers.V0;
-
-			Chip8_validate_memory(chip8, new_PC, 2);
-			if (chip8->ERROR) break;
-
-			chip8->PC = new_PC;
+		else if (strncmp(arg, "-memory_profile=", cstring_size("-memory_profile=")) == 0){
+			options.memory_profile_path = arg + cstring_size("-memory_profile=");
 		}
-		else if( ( instruction & 0xF000 ) == 0xC000 ) // RND Vx, byte
-		{
-			short regindex = (instruction & 0x0F00) >> 8;
-			short regvalue = (instruction & 0x00FF);
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			u8 random_byte = random_char();
-			chip8->registers.by_index[regindex] = random_byte & (u8)regvalue;
+		else if (strcmp(arg, "-opcode_stats") == 0 || strncmp(arg, "-opcode_stats=", cstring_size("-opcode_stats=")) == 0){
+#if !defined(CHIP8_OPCODE_STATS)
+			crash("%s requires a build with CHIP8_OPCODE_STATS ; see premake5 --opcode_stats", arg);
+#endif
+			options.opcode_stats = true;
+			if (arg[cstring_size("-opcode_stats")] == '=')
+				options.opcode_sample_period = (u32)strtoul(arg + cstring_size("-opcode_stats="), NULL, 10);
 		}
-		else if( ( instruction & 0xF000 ) == 0xD000 ) // DRW Vx, Vy, nibble
-		{
-			short regx = (instruction & 0x0F00) >> 8;
-			short regy = (instruction & 0x00F0) >> 4;
-			short n = (instruction & 0x000F);
-
-			Chip8_validate_registers(chip8, regx, 1);
-			Chip8_validate_registers(chip8, regy, 1);
-			if (chip8->ERROR) break;
-
-			u8 x = chip8->registers.by_index[regx];
-			u8 y = chip8->registers.by_index[regy];
-
-			if (x >= chip8->screen_width || y >= chip8->screen_height || n >= chip8->screen_height)
-				chip8->ERROR = Chip8::SCREEN_COORD_INCORRECT;
-			Chip8_validate_memory(chip8, chip8->I, n);
-			if (chip8->ERROR) break;
-
-			// 3-byte sprite that usually looks like:
-			// [A][A']
-			// [B][B']
-			//
-			// on screen at (21, 2):
-			// [B'] 11111000 00000000 00000111 [B}
-			//      00000000 00000000 00000000
-			//      11111000 00000000 00000111
-			// [A'] 11111000 00000000 00000111 [A]
-			//
-			// and on screen at (13, 2):
-			//               [B] [B']
-			// 00000000 00000111 11111000
-			// 00000000 00000000 00000000 
-			// 00000000 00000111 11111000 
-			// 00000000 00000111 11111000
-			//               [A] [A']
-
-			short AB_byte_x = x / 8;
-			short AB_bitstart = x % 8;
-
-			short ABdash_byte_x = (AB_byte_x + 1) % (chip8->screen_width / 8);
-			short ABdash_bitcount = 8 - AB_bitstart;
-
-			short A_start_y = y;
-			short A_height = min((int)n, chip8->screen_height - y);
-			
-			short B_start_y = 0;
-			short B_height = n - A_height;
-
-			u8* src = Chip8_get_memory(chip8, chip8->I);
-			u8 erasure = 0;
-
-			for (int iy = 0; iy != A_height; ++iy){
-				int SCREENindex = AB_byte_x * chip8->screen_height + A_start_y + iy;
-				ram_assert(SCREENindex < sizeof(Chip8::SCREEN));
-
-				u8 SCREENbyte = chip8->SCREEN[SCREENindex];
-				u8 SRCbyte = src[iy] >> AB_bitstart;
-				u8 new_SCREENbyte = SCREENbyte ^ SRCbyte;
-
-				erasure |= (SCREENbyte & ~new_SCREENbyte) ? 1 : 0;
-
-				chip8->SCREEN[SCREENindex] = new_SCREENbyte;
-			}
-
-			for (int iy = 0; iy != B_height; ++iy){
-				int SCREENindex = AB_byte_x * chip8->screen_height + B_start_y + iy;
-				ram_assert(SCREENindex < sizeof(Chip8::SCREEN));
-
-				u8 SCREENbyte = chip8->SCREEN[SCREENindex];
-				u8 SRCbyte = src[A_height + iy] >> AB_bitstart;
-				u8 new_SCREENbyte = SCREENbyte ^ SRCbyte;
-
-				erasure |= (SCREENbyte & ~new_SCREENbyte) ? 1 : 0;
-
-				chip8->SCREEN[SCREENindex] = new_SCREENbyte;
-			}
-
-			if (ABdash_bitcount != 8){
-				for (int iy = 0; iy != A_height; ++iy){
-					int SCREENindex = ABdash_byte_x * chip8->screen_height + A_start_y + iy;
-					ram_assert(SCREENindex < sizeof(Chip8::SCREEN));
-
-					u8 SCREENbyte = chip8->SCREEN[SCREENindex];
-					u8 SRCbyte = src[iy] << ABdash_bitcount;
-					u8 new_SCREENbyte = SCREENbyte ^ SRCbyte;
-
-					erasure |= (SCREENbyte & ~new_SCREENbyte) ? 1 : 0;
-
-					chip8->SCREEN[SCREENindex] = new_SCREENbyte;
-				}
-
-				for (int iy = 0; iy != B_height; ++iy){
-					int SCREENindex = ABdash_byte_x * chip8->screen_height + B_start_y + iy;
-					ram_assert(SCREENindex < sizeof(Chip8::SCREEN));
-
-					u8 SCREENbyte = chip8->SCREEN[SCREENindex];
-					u8 SRCbyte = src[A_height + iy] << ABdash_bitcount;
-					u8 new_SCREENbyte = SCREENbyte ^ SRCbyte;
-
-					erasure |= (SCREENbyte & ~new_SCREENbyte) ? 1 : 0;
-
-					chip8->SCREEN[SCREENindex] = new_SCREENbyte;
-				}
-			}
-
-			chip8->registers.VF = erasure;
+		else if (strncmp(arg, "-rewind=", cstring_size("-rewind=")) == 0){
+			options.rewind_megabytes = (u32)strtoul(arg + cstring_size("-rewind="), NULL, 10);
 		}
-		else if( ( instruction & 0xF0FF ) == 0xE09E ) // SKP Vx
-		{
-			short regindex = (instruction & 0x0F00) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			u8 keyindex = chip8->registers.by_index[regindex];
-
-			if( keyindex > sizeof( Chip8::KEYBOARD ) )
-			{
-				chip8->ERROR = Chip8::KEY_UNKNOWN;
-				break;
-			}
-
-			if( chip8->KEYBOARD[keyindex] )
-				chip8->PC += 2;
+		else if (strncmp(arg, "-record=", cstring_size("-record=")) == 0){
+			options.movie_path = arg + cstring_size("-record=");
 		}
-		else if( ( instruction & 0xF0FF ) == 0xE0A1 ) // SKNP Vx
-		{
-			short regindex = (instruction & 0x0F00) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			u8 keyindex = chip8->registers.by_index[regindex];
-
-			if( keyindex >= sizeof( Chip8::KEYBOARD ) )
-			{
-				chip8->ERROR = Chip8::KEY_UNKNOWN;
-				break;
-			}
-
-			if (!chip8->KEYBOARD[keyindex])
-				chip8->PC += 2;
+		else if (strncmp(arg, "-turbo_budget=", cstring_size("-turbo_budget=")) == 0){
+			options.turbo_budget_ms = (u32)strtoul(arg + cstring_size("-turbo_budget="), NULL, 10);
+			if (!options.turbo_budget_ms) crash("Invalid turbo budget: %s", arg);
 		}
-		else if( ( instruction & 0xF0FF ) == 0xF007 ) // LD Vx, DT
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if( chip8->ERROR ) break;
-
-			chip8->registers.by_index[regindex] = chip8->DT;
+		else if (strncmp(arg, "-color_on=", cstring_size("-color_on=")) == 0){
+			options.palette[1] = parse_color(arg, arg + cstring_size("-color_on="));
 		}
-		else if( ( instruction & 0xF0FF ) == 0xF00A ) // LD Vx, K
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if( chip8->ERROR ) break;
-
-			int keypress = -1;
-			for (int ikey = 0; ikey != carray_size(Chip8::KEYBOARD); ++ikey){
-				if (!chip8->KEYBOARD[ikey] && chip8->LAST_KEYBOARD[ikey]){
-					keypress = ikey;
-					break;
-				}
-			}
-
-			if (keypress != -1)
-				chip8->registers.by_index[regindex] = keypress;
-			else
-				chip8->PC -= 2; // rewing the instruction to wait
+		else if (strncmp(arg, "-color_off=", cstring_size("-color_off=")) == 0){
+			options.palette[0] = parse_color(arg, arg + cstring_size("-color_off="));
 		}
-		else if( ( instruction & 0xF0FF ) == 0xF015 ) // LD DT, Vx
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			chip8->DT = chip8->registers.by_index[regindex];
+		else if (strncmp(arg, "-color_2=", cstring_size("-color_2=")) == 0){
+			options.palette[2] = parse_color(arg, arg + cstring_size("-color_2="));
 		}
-		else if( ( instruction & 0xF0FF ) == 0xF018 ) // LD ST, Vx
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			chip8->ST = chip8->registers.by_index[regindex];
+		else if (strncmp(arg, "-color_3=", cstring_size("-color_3=")) == 0){
+			options.palette[3] = parse_color(arg, arg + cstring_size("-color_3="));
 		}
-		else if( ( instruction & 0xF0FF ) == 0xF01E ) // ADD I, Vx
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			chip8->I += chip8->registers.by_index[regindex];
+		else if (options.ROM_count != carray_size(Game_Options::ROM_paths)){
+			options.ROM_paths[options.ROM_count++] = arg;
 		}
-		else if( ( instruction & 0xF0FF ) == 0xF029 ) // LD F, Vx
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
-
-			Chip8_validate_registers(chip8, regindex, 1);
-			if (chip8->ERROR) break;
-
-			u8 charindex = chip8->registers.by_index[regindex] & 0x0F;
-			short addr = (short)charindex * 5;
+	}
+}
 
-			if( addr >= sizeof( Chip8::Memory::Interpreter::sprites) )
-			{
-				chip8->ERROR = Chip8::KEY_UNKNOWN;
-				break;
-			}
+#if defined(CHIP8_AOT)
+// generated by tools/chip8_aot.cpp
+extern const Chip8_AOT_Program g_chip8_aot_programs[];
+extern const int g_chip8_aot_program_count;
+#endif
+
+static Chip8::MACHINE_TYPE ROM_machine(Game_Options& options, const char* ROM_path, void* ROM, size_t ROM_size){
+	Chip8::MACHINE_TYPE machine = options.machine != Chip8::MACHINE_COUNT ? options.machine : Chip8_detect_machine(ROM, ROM_size);
+	if (ROM_size > Chip8_memory_size(machine) - sizeof(Chip8::Memory::Interpreter))
+		crash("%s does not fit in the memory of %s", ROM_path, Chip8::MACHINE_NAME[machine]);
+	return machine;
+}
 
-			chip8->I = addr;
-		}
-		else if( ( instruction & 0xF0FF ) == 0xF033 ) // LD B, VX
-		{
-			short regindex = ( instruction & 0x0F00 ) >> 8;
+// the quirk set of Game::quirk_cache_path or the one detected and added to it
+static Chip8_Quirks::TYPE ROM_quirks(const char* ROM_path, void* ROM, size_t ROM_size, Chip8::MACHINE_TYPE machine, u64 ROM_hash){
+	Chip8_Quirks::TYPE quirks;
+	if (Chip8_quirk_cache_find(Game::quirk_cache_path, ROM_hash, quirks)) return quirks;
 
-			Chip8_validate_registers(chip8, regindex, 1);
-			Chip8_validate_memory(chip8, chip8->I, 3);
-			if (chip8->ERROR) break;
+	u64 start = g_timer->ticks();
+	Chip8_Quirk_Trial trials[Chip8_Quirks::TYPE_COUNT];
+	quirks = Chip8_detect_quirks(ROM, ROM_size, machine, trials);
 
-			u8 byte = chip8->registers.by_index[regindex];
+	for (int iquirks = 0; iquirks != Chip8_Quirks::TYPE_COUNT; ++iquirks){
+		const Chip8_Quirk_Trial& trial = trials[iquirks];
+		ram_info("Chip8 quirk trial: %s ; %u frames ; %u adresses ; %u screen frames ; ERROR %d",
+			Chip8_Quirks::TYPE_NAME[trial.quirks], trial.frame_count, trial.PC_count, trial.screen_frame_count, trial.ERROR);
+	}
+	ram_info("Chip8 quirks of %s detected in %.1f ms", ROM_path, g_timer->as_ms(g_timer->ticks() - start));
 
-			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+	if (!Chip8_quirk_cache_add(Game::quirk_cache_path, ROM_hash, quirks))
+		ram_warning("Failed to add %s to %s", ROM_path, Game::quirk_cache_path);
+	return quirks;
+}
 
-			*memptr = byte / 100;
-			++memptr;
-			*memptr = (byte % 100) / 10;
-			++memptr;
-			*memptr = (byte % 10);
-		}
-		else if( ( instruction & 0xF0FF ) == 0xF055 ) // LD [I], Vx
-		{
-			short regcount = ( instruction & 0x0F00 ) >> 8;
+static void bind_aot_program(Chip8* chip8, void* ROM, size_t ROM_size){
+#if defined(CHIP8_AOT)
+	chip8->AOT_PROGRAM = Chip8_aot_find(g_chip8_aot_programs, g_chip8_aot_program_count, ROM, ROM_size);
+	if (chip8->AOT_PROGRAM) ram_info("Chip8 AOT program: %s", chip8->AOT_PROGRAM->name);
+#endif
+}
 
-			Chip8_validate_registers( chip8, 0, regcount + 1 );
-			Chip8_validate_memory( chip8, chip8->I, regcount + 1 );
-			if( chip8->ERROR ) break;
+// runs every ROM with every backend for the same emulated duration and reports the time per instruction on stdout
+static void benchmark_backends(Game_Options& options){
+	constexpr int benchmark_frames = 600;
+	constexpr u32 benchmark_instructions_per_second = 1000000u;
 
-			++regcount;	
+	Chip8* chip8 = (Chip8*)malloc(sizeof(Chip8));
 
-			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+	for (int irom = 0; irom != options.ROM_count; ++irom){
+		void* chip8_ROM;
+		size_t chip8_ROM_size;
+		g_file_system->ReadFile(options.ROM_paths[irom], chip8_ROM, chip8_ROM_size);
+		if (!chip8_ROM) continue;
 
-			for (int ireg = 0; ireg != regcount; ++ireg)
-				memptr[ireg] = chip8->registers.by_index[ireg];
-		}
-		else if( ( instruction & 0xF0FF ) == 0xF065 ) // LD Vx, [I]
-		{
-			short regcount = ( instruction & 0xF00 ) >> 8;
+		for (int ibackend = 0; ibackend != Chip8::BACKEND_COUNT; ++ibackend){
+			Chip8_create(chip8, chip8_ROM, chip8_ROM_size, ROM_machine(options, options.ROM_paths[irom], chip8_ROM, chip8_ROM_size));
+			if (options.quirks != Chip8_Quirks::TYPE_COUNT) chip8->QUIRKS = options.quirks;
+			bind_aot_program(chip8, chip8_ROM, chip8_ROM_size);
+			chip8->BACKEND = (Chip8::BACKEND_TYPE)ibackend;
+			chip8->instructions_per_second = benchmark_instructions_per_second;
 
-			Chip8_validate_registers( chip8, 0, regcount + 1 );
-			Chip8_validate_memory( chip8, chip8->I, regcount + 1 );
-			if( chip8->ERROR ) break;
+			int frame_count = 0;
+			u64 start = g_timer->ticks();
+			for (; frame_count != benchmark_frames && !chip8->ERROR; ++frame_count)
+				Chip8_step(chip8, 1.f / (float)Game::update_per_second);
+			u64 end = g_timer->ticks();
 
-			++regcount;
+			double instruction_count = (double)frame_count * benchmark_instructions_per_second / (double)Game::update_per_second;
+			double ns_per_instruction = (double)g_timer->as_ms(end - start) * 1000000. / instruction_count;
 
-			u8* memptr = Chip8_get_memory( chip8, chip8->I );
+			printf("%s ; %s ; %.3f ns/instruction ; %d frames ; ERROR %d\n", options.ROM_paths[irom], Chip8::BACKEND_NAME[ibackend], ns_per_instruction, frame_count, chip8->ERROR);
+			ram_info("%s ; %s ; %.3f ns/instruction ; %d frames ; ERROR %d", options.ROM_paths[irom], Chip8::BACKEND_NAME[ibackend], ns_per_instruction, frame_count, chip8->ERROR);
 
-			for( int ireg = 0; ireg != regcount; ++ireg )
-				chip8->registers.by_index[ireg] = memptr[ireg];
+			Chip8_destroy(chip8);
 		}
-		else
-		{
-			chip8->ERROR = Chip8::INSTRUCTION_UNKNOWN;
-			break;
-		}
-
-		memcpy(chip8->LAST_KEYBOARD, chip8->KEYBOARD, sizeof(Chip8::KEYBOARD));
 
-		--instruction_count;
+		free(chip8_ROM);
 	}
-}
 
-void Chip8_to_screen(Chip8* chip8, Pixel_Canvas& screen){
-	RGBA color_on;
-	color_on.r = 255;
-	color_on.g = 255;
-	color_on.b = 255;
+	free(chip8);
+}
 
-	RGBA color_off;
-	color_off.r = 0;
-	color_off.g = 0;
-	color_off.b = 0;
+// smallest multiple of the Chip8 resolution covering width x height and the minimum size of the window
+static void game_fit_window(Game* game, int width, int height){
+	int screen_width = game->chip8.screen_width;
+	int screen_height = game->chip8.screen_height;
 
-	for (int ix = 0; ix != chip8->screen_width; ++ix){
-		int byte_x = ix / 8 * chip8->screen_height;
-		int bit_x = ix % 8;
+	int min_ratiox = game->min_window_width / screen_width + ((game->min_window_width % screen_width) ? 1 : 0);
+	int min_ratioy = game->min_window_height / screen_height + ((game->min_window_height % screen_height) ? 1 : 0);
+	int min_ratio = max(1, max(min_ratiox, min_ratioy));
+	game->min_window_ratio = min_ratio;
 
-		for (int iy = 0; iy != chip8->screen_height; ++iy){
-			int SCREENindex = byte_x + iy;
+	int ratiox = width / screen_width + ((width % screen_width) ? 1 : 0);
+	int ratioy = height / screen_height + ((height % screen_height) ? 1 : 0);
+	int ratio = max(min_ratio, max(ratiox, ratioy));
+	game->window_ratio = ratio;
 
-			u8 pixel = (chip8->SCREEN[SCREENindex] >> (7 - bit_x)) & 0x01;
-			screen.set_pixel(ix, screen.height - 1 - iy, pixel ? color_on : color_off);
-		}
-	}
+	game->window->set_size(screen_width * ratio, screen_height * ratio);
+	game->window->needs_repaint = true;
 }
 
-struct Game{
-	static constexpr int update_per_second = 60;
-	
-	Window* window;
-	int min_window_ratio;
-	int window_ratio;
-
-	Frame_Controller controller; 
-
-	Input::Listener* listener;
-
-	Chip8 chip8;
-	Pixel_Canvas screen;
+void game_create(){
+	Game_Options options;
+	parse_options(options);
 
-	Audio_DSP* DSP;
-};
+	if( options.ROM_count < 1 ) crash("No argument !");
 
-static Game* g_game;
+	if (options.benchmark){
+		benchmark_backends(options);
+		return;
+	}
 
-void game_create(){
 	Game* game = (Game*)malloc(sizeof(Game));
 	game->window = NULL;
 	game->listener = NULL;
+	game->rewind = NULL;
+	game->movie_path = NULL;
 	game->DSP = NULL;
 
 	// Chip8
 
-	if( g_argc < 2 ) crash("No argument !");
 	void* chip8_ROM;
 	size_t chip8_ROM_size;
-	g_file_system->ReadFile( g_argv[1], chip8_ROM, chip8_ROM_size );
-	Chip8_create(&game->chip8, chip8_ROM, chip8_ROM_size);
+	g_file_system->ReadFile( options.ROM_paths[0], chip8_ROM, chip8_ROM_size );
+	Chip8_create(&game->chip8, chip8_ROM, chip8_ROM_size, ROM_machine(options, options.ROM_paths[0], chip8_ROM, chip8_ROM_size));
+	bind_aot_program(&game->chip8, chip8_ROM, chip8_ROM_size);
+	game->chip8.QUIRKS = options.quirks != Chip8_Quirks::TYPE_COUNT ? options.quirks
+		: ROM_quirks(options.ROM_paths[0], chip8_ROM, chip8_ROM_size, game->chip8.MACHINE, game->chip8.ROM_HASH);
+	ram_info("Chip8 machine: %s ; quirks: %s", Chip8::MACHINE_NAME[game->chip8.MACHINE], Chip8_Quirks::TYPE_NAME[game->chip8.QUIRKS]);
+	game->chip8.BACKEND = options.backend;
+	if (options.profile) game->chip8.PROFILE = Chip8_create_profile();
+	if (options.memory_profile_path){
+		game->chip8.MEMORY_PROFILE = Chip8_create_memory_profile();
+		game->memory_profile_path = options.memory_profile_path;
+	}
+#if defined(CHIP8_OPCODE_STATS)
+	if (options.opcode_stats) game->chip8.OPCODE_STATS = Chip8_create_opcode_stats(options.opcode_sample_period);
+#endif
+	if (options.movie_path){
+		if (!Chip8_movie_record_begin(game->movie, &game->chip8, options.movie_path, Game::update_per_second, Game::movie_checkpoint_period))
+			crash("Failed to create the movie %s", options.movie_path);
+		game->movie_path = options.movie_path;
+	}
+	else if (options.rewind_megabytes){
+		game->rewind = Chip8_create_rewind((size_t)options.rewind_megabytes * Megabytes(1), Game::rewind_frame_capacity, Game::rewind_keyframe_period);
+		Chip8_rewind_capture(game->rewind, &game->chip8);
+	}
+	memcpy(game->palette, options.palette, sizeof(Game::palette));
+	game->screen_generation = UINT64_MAX;
 
 	// window
 
@@ -812,21 +404,9 @@ void game_create(){
 	window->get_size(current_width, current_height);
 
 	window->set_size(0, 0);
+	window->get_size(game->min_window_width, game->min_window_height);
 
-	int minx, miny;
-	window->get_size(minx, miny);
-
-	int min_ratiox = minx / game->chip8.screen_width + ((minx % game->chip8.screen_width) ? 1 : 0);
-	int min_ratioy = miny / game->chip8.screen_height + ((miny % game->chip8.screen_height) ? 1 : 0);
-	int min_ratio = max(1, max(min_ratiox, min_ratioy));
-	game->min_window_ratio = min_ratio;
-
-	int ratiox = current_width / game->chip8.screen_width + ((current_width % game->chip8.screen_width) ? 1 : 0);
-	int ratioy = current_height / game->chip8.screen_height + ((current_height % game->chip8.screen_height) ? 1 : 0);
-	int ratio = max(1, max(ratiox, ratioy));
-	game->window_ratio = ratio;
-
-	window->set_size(game->chip8.screen_width * ratio, game->chip8.screen_height * ratio);
+	game_fit_window(game, current_width, current_height);
 
 	// frame controller
 
@@ -839,6 +419,9 @@ void game_create(){
 	game->controller.add_snapping_frequency(120);
 	game->controller.add_snapping_frequency(30);
 
+	game->turbo_budget_ticks = max(g_timer->ticks_per_second() * options.turbo_budget_ms / 1000u, (u64)1u);
+	game->turbo_ticks_per_frame = 0u;
+
 	Input::Listener* listener = g_input->create_listener();
 	listener->device_type = Input::Device_Keyboard;
 	listener->pairing_mode = Input::Pairing_Most_Recent_Persistent;
@@ -859,6 +442,8 @@ void game_create(){
 	listener->register_action("0", Input::Control_Button, RAMKey_to_scancode(RAMK_X));
 	listener->register_action("B", Input::Control_Button, RAMKey_to_scancode(RAMK_C));
 	listener->register_action("F", Input::Control_Button, RAMKey_to_scancode(RAMK_V));
+	listener->register_action("rewind", Input::Control_Button, RAMKey_to_scancode(RAMK_BACKSPACE));
+	listener->register_action("turbo", Input::Control_Button, RAMKey_to_scancode(RAMK_TAB));
 	
 	game->listener = listener;
 
@@ -869,24 +454,74 @@ void game_create(){
 
 	// audio
 
-	LFO_Data data;
-	data.period_cursor = 0.f;
-
-	Audio_DSP* DSP = g_audio->create_DSP(sizeof(LFO_Param), &data, sizeof(LFO_Data));
-	game->DSP = DSP;
+	Audio_DSP* DSP;
+	if (game->chip8.MACHINE == Chip8::XOCHIP){
+		Pattern_Data data;
+		data.bit_cursor = 0.f;
+
+		DSP = g_audio->create_DSP(sizeof(Pattern_Param), &data, sizeof(Pattern_Data));
+		DSP->process = Pattern_Processor;
+
+		Pattern_Param* param = (Pattern_Param*)DSP->get_param();
+		param->pause = true;
+		memcpy(param->pattern, game->chip8.AUDIO_PATTERN, sizeof(Pattern_Param::pattern));
+		param->set_rate(Chip8_audio_rate(game->chip8.PITCH));
+		DSP->commit_param();
+	}
+	else{
+		LFO_Data data;
+		data.period_cursor = 0.f;
 
-	DSP->process = LFO_Processor;
+		DSP = g_audio->create_DSP(sizeof(LFO_Param), &data, sizeof(LFO_Data));
+		DSP->process = LFO_Processor;
 
-	LFO_Param* param = (LFO_Param*)DSP->get_param();
-	param->pause = true;
-	param->set_frequency(440);
-	DSP->commit_param();
+		LFO_Param* param = (LFO_Param*)DSP->get_param();
+		param->pause = true;
+		param->set_frequency(440);
+		DSP->commit_param();
+	}
+	game->DSP = DSP;
 
 	g_audio->activate_DSP(DSP);
 
 	g_game = game;
 }
 
+// runs one frame of the Chip8 and records it ; returns false when the Chip8 stopped on an error
+static int game_step(float dtime_sec){
+	Chip8_step(&g_game->chip8, dtime_sec);
+	if (g_game->movie_path) Chip8_movie_record_frame(g_game->movie, &g_game->chip8);
+	if (g_game->chip8.ERROR){
+		ram_error("Chip8 ERROR: %d", g_game->chip8.ERROR);
+		return false;
+	}
+	if (g_game->rewind) Chip8_rewind_capture(g_game->rewind, &g_game->chip8);
+	return true;
+}
+
+// as many frames as the smoothed frame cost allows in the budget ; game_render still draws once per host frame
+static void game_turbo(float dtime_sec){
+	u64 frame_count = 1u;
+	if (g_game->turbo_ticks_per_frame)
+		frame_count = min(max(g_game->turbo_budget_ticks / g_game->turbo_ticks_per_frame, (u64)1u), Game::turbo_frame_maximum);
+
+	u64 start = g_timer->ticks();
+	u64 iframe = 0u;
+	while (iframe != frame_count){
+		++iframe;
+		if (!game_step(dtime_sec)) break;
+	}
+	u64 ticks_per_frame = max((g_timer->ticks() - start) / iframe, (u64)1u);
+
+	// a single slow batch only moves the estimate by a quarter
+	if (g_game->turbo_ticks_per_frame)
+		ticks_per_frame = (3u * g_game->turbo_ticks_per_frame + ticks_per_frame) / 4u;
+	g_game->turbo_ticks_per_frame = ticks_per_frame;
+
+	// the controller starts from the current time instead of catching up when the turbo is released
+	g_game->controller.resync_next_step();
+}
+
 int game_update(){
 	if (!g_game) return 1;
 
@@ -945,19 +580,40 @@ int game_update(){
 	if( memcmp( g_game->chip8.KEYBOARD, g_game->chip8.LAST_KEYBOARD, sizeof( Chip8::KEYBOARD ) ) )
 		ram_info( "KEYBOARD: %.16s", state );
 
+	int rewinding = g_game->rewind && g_game->listener->get_action_status("rewind").button.down;
+	int turbo = !rewinding && g_game->listener->get_action_status("turbo").button.down;
+
 	float dtime_sec = 1.f / (float)Game::update_per_second;
-	u64 time = g_timer->ticks();
-	int step_count = g_game->controller.update_time(time);
-	for (int istep = 0; istep != step_count; ++istep){
-		Chip8_step(&g_game->chip8, dtime_sec);
-		if (g_game->chip8.ERROR){
-			ram_error("Chip8 ERROR: %d", g_game->chip8.ERROR);
-			break;
+	if (turbo){
+		game_turbo(dtime_sec);
+	}
+	else{
+		u64 time = g_timer->ticks();
+		int step_count = g_game->controller.update_time(time);
+		for (int istep = 0; istep != step_count; ++istep){
+			// the keyboard of the rewound frames is restored with them
+			if (rewinding){
+				Chip8_rewind_step_back(g_game->rewind, &g_game->chip8);
+				continue;
+			}
+
+			if (!game_step(dtime_sec)) break;
 		}
 	}
 
-	LFO_Param* param = (LFO_Param*)g_game->DSP->get_param();
-	param->pause = g_game->chip8.ST > 0 ? false : true;
+	Chip8* chip8 = &g_game->chip8;
+	int pause = Chip8_get_ST(chip8) > 0 ? false : true;
+	if (chip8->MACHINE == Chip8::XOCHIP){
+		// F002 and FX3A change the pattern and the pitch between frames
+		Pattern_Param* param = (Pattern_Param*)g_game->DSP->get_param();
+		param->pause = pause;
+		memcpy(param->pattern, chip8->AUDIO_PATTERN, sizeof(Pattern_Param::pattern));
+		param->set_rate(Chip8_audio_rate(chip8->PITCH));
+	}
+	else{
+		LFO_Param* param = (LFO_Param*)g_game->DSP->get_param();
+		param->pause = pause;
+	}
 	g_game->DSP->commit_param();
 	
 	if (g_game->window->user_requested_close) return true;
@@ -967,27 +623,77 @@ int game_update(){
 void game_render(){
 	if( !g_game ) return;
 
-	RGBA color_none;
-	color_none.r = 0xF5;
-	color_none.g = 0x42;
-	color_none.b = 0x72;
-	color_none.a = 0xFF;
-	g_game->screen.clear(color_none);
-
-	Chip8_to_screen(&g_game->chip8, g_game->screen);
-
-	copy_image_to_window(
-		g_game->screen.width,
-		g_game->screen.height,
-		g_game->screen.canvas,
-		g_game->window
-	);
+	Window* window = g_game->window;
+	Chip8* chip8 = &g_game->chip8;
+
+	// most frames do not modify the screen
+	if (chip8->SCREEN_GENERATION == g_game->screen_generation && !window->needs_repaint) return;
+	g_game->screen_generation = chip8->SCREEN_GENERATION;
+
+	// SUPERCHIP switches between 64x32 and 128x64 ; the window keeps its size when it is a multiple of both
+	if (g_game->screen.width != chip8->screen_width || g_game->screen.height != chip8->screen_height){
+		g_game->screen.set_resolution(chip8->screen_width, chip8->screen_height);
+
+		int width, height;
+		window->get_size(width, height);
+		game_fit_window(g_game, width, height);
+	}
+
+	// only the dirty rows are written so the canvas is not cleared
+	u64 dirty = Chip8_to_screen(chip8, g_game->screen, g_game->palette);
+
+	if (window->needs_repaint){
+		window->needs_repaint = false;
+		copy_image_to_window(
+			g_game->screen.width,
+			g_game->screen.height,
+			g_game->screen.canvas,
+			window
+		);
+	}
+	else if (dirty){
+		// band of canvas rows covering the dirty SCREEN rows ; canvas rows are bottom-up
+		int first_row = 0;
+		while (!(dirty & ((u64)1u << first_row))) ++first_row;
+		int last_row = chip8->screen_height - 1;
+		while (!(dirty & ((u64)1u << last_row))) --last_row;
+
+		copy_image_rows_to_window(
+			g_game->screen.width,
+			g_game->screen.height,
+			g_game->screen.canvas,
+			g_game->screen.height - 1 - last_row,
+			last_row - first_row + 1,
+			window
+		);
+	}
 }
 
 void game_destroy(){
 	if( !g_game ) return;
 	g_audio->deactivate_DSP(g_game->DSP);
 
+	if (g_game->chip8.PROFILE){
+		Chip8_profile_report(g_game->chip8.PROFILE, stdout, 20);
+		Chip8_destroy_profile(g_game->chip8.PROFILE);
+	}
+	if (g_game->chip8.MEMORY_PROFILE){
+		if (!Chip8_save_memory_profile(g_game->chip8.MEMORY_PROFILE, g_game->memory_profile_path))
+			ram_warning("Failed to save the memory profile to %s", g_game->memory_profile_path);
+		Chip8_destroy_memory_profile(g_game->chip8.MEMORY_PROFILE);
+	}
+#if defined(CHIP8_OPCODE_STATS)
+	if (g_game->chip8.OPCODE_STATS){
+		Chip8_opcode_stats_report(g_game->chip8.OPCODE_STATS, stdout);
+		Chip8_destroy_opcode_stats(g_game->chip8.OPCODE_STATS);
+	}
+#endif
+
+	if (g_game->movie_path){
+		if (!Chip8_movie_record_end(g_game->movie, &g_game->chip8))
+			ram_warning("Failed to write the movie %s", g_game->movie_path);
+	}
+	if (g_game->rewind) Chip8_destroy_rewind(g_game->rewind);
 	Chip8_destroy(&g_game->chip8);
 
 	g_game->screen.destroy();
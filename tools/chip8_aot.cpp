@@ -0,0 +1,650 @@
+#include "chip8.h"
+
+#include <cstdarg>
+
+// Static recompiler from Chip8 ROMs to a C++ translation unit
+//
+// USAGE: chip8_aot OUTPUT.cpp [-quirks=NAME] ROM [[-quirks=NAME] ROM ...]
+//
+// * -quirks selects the quirk set of the ROMs that follow it, cowgod by default ; the blocks are recompiled for
+//   that quirk set and the aot backend only runs them when Chip8::QUIRKS matches
+//
+// * basic blocks are recovered by following the control flow from 0x200 ; every block is a function
+//   that keeps the Chip8 registers it uses in local variables
+// * every ROM is listed in g_chip8_aot_programs ; define CHIP8_AOT and link OUTPUT.cpp with the emulator
+//   to use the recompiled blocks with the aot backend
+// * targets of BXXX and RET that were not found statically, LD Vx, K and blocks whose code was overwritten are
+//   executed by the interpreter at runtime ; so are the SUPER-CHIP instructions, which depend on the machine
+//
+// Recompiled blocks must behave exactly like Chip8_step: Chip8::CYCLE is set before accessing the timers,
+// ERROR values and the PC left on an ERROR are the same as the interpreter
+
+static constexpr u16 g_aot_start_adress = 0x200;
+static constexpr int g_aot_block_instruction_max = 64;
+static constexpr int g_aot_ROM_max = 256;
+// XOCHIP is not recompiled ; the ROMs of the other machines fit in their 4 KB
+static constexpr u32 g_aot_memory_size = Kilobytes(4);
+// the blocks run with both machines: the adresses only valid with SUPERCHIP are left to the interpreter
+static const u32 g_aot_reserved_start = Chip8_reserved_start(Chip8::CHIP8);
+
+struct AOT_ROM{
+	const char* path;
+	char identifier[64];
+	Chip8_Quirks::TYPE quirks;
+
+	u8 data[g_aot_memory_size - sizeof(Chip8::Memory::Interpreter)];
+	size_t size;
+};
+
+struct AOT_Block{
+	u16 adress;
+
+	int op_count;
+	Chip8_Op ops[g_aot_block_instruction_max];
+	u16 instructions[g_aot_block_instruction_max];
+
+	u16 used_registers;
+	u16 written_registers;
+};
+
+// at most one block per adress
+struct AOT_Block_List{
+	AOT_Block blocks[4096];
+	int block_count;
+};
+
+// ---- ROM
+
+static int read_ROM(const char* path, AOT_ROM& ROM){
+	FILE* file = fopen(path, "rb");
+	if (!file) return false;
+
+	ROM.size = fread(ROM.data, 1u, sizeof(AOT_ROM::data), file);
+	int end_of_file = fgetc(file) == EOF;
+	fclose(file);
+
+	return end_of_file;
+}
+
+static void ROM_identifier(const char* path, char (&identifier)[64]){
+	const char* name = path;
+	for (const char* c = path; *c; ++c)
+		if (*c == '/' || *c == '\\') name = c + 1;
+
+	size_t size = 0u;
+	for (const char* c = name; *c && size != sizeof(identifier) - 8u; ++c){
+		int alnum = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9');
+		identifier[size++] = alnum ? *c : '_';
+	}
+	identifier[size] = '\0';
+}
+
+static int ROM_contains(const AOT_ROM& ROM, u16 adress, u16 size){
+	return adress >= g_aot_start_adress && (size_t)(adress + size) <= g_aot_start_adress + ROM.size;
+}
+
+static u16 ROM_fetch(const AOT_ROM& ROM, u16 adress){
+	const u8* memptr = ROM.data + (adress - g_aot_start_adress);
+	return ((u16)memptr[0] << 8) | (u16)memptr[1];
+}
+
+// ---- control flow
+
+// instructions executed by the interpreter at runtime that continue to the next instruction
+static int is_interpreted(const Chip8_Op& op){
+	switch (op.type){
+		case Chip8_Op::LD_VX_K:
+		// SUPER-CHIP instructions with SUPERCHIP ; INSTRUCTION_UNKNOWN and DRW Vx, Vy, 0 with CHIP8
+		case Chip8_Op::SCD_N:
+		case Chip8_Op::SCR:
+		case Chip8_Op::SCL:
+		case Chip8_Op::LOW:
+		case Chip8_Op::HIGH:
+		case Chip8_Op::DRW_VX_VY_0:
+		case Chip8_Op::LD_HF_VX:
+		case Chip8_Op::LD_R_VX:
+		case Chip8_Op::LD_VX_R:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static int is_recompiled(const Chip8_Op& op){
+	if (is_interpreted(op)) return false;
+
+	switch (op.type){
+		case Chip8_Op::UNDECODED:
+		case Chip8_Op::UNKNOWN:
+		case Chip8_Op::EXIT:
+			return false;
+		case Chip8_Op::JP_ADDR:
+			return Chip8_is_valid_memory(op.nnn, 1, g_aot_reserved_start, g_aot_memory_size);
+		case Chip8_Op::CALL_ADDR:
+			return Chip8_is_valid_memory(op.nnn, 2, g_aot_reserved_start, g_aot_memory_size);
+		default:
+			return true;
+	}
+}
+
+static int is_terminator(const Chip8_Op& op){
+	switch (op.type){
+		case Chip8_Op::RET:
+		case Chip8_Op::JP_ADDR:
+		case Chip8_Op::CALL_ADDR:
+		case Chip8_Op::SE_VX_BYTE:
+		case Chip8_Op::SNE_VX_BYTE:
+		case Chip8_Op::SE_VX_VY:
+		case Chip8_Op::SNE_VX_VY:
+		case Chip8_Op::JP_V0_ADDR:
+		case Chip8_Op::SKP_VX:
+		case Chip8_Op::SKNP_VX:
+		// writes to memory may overwrite the rest of the block
+		case Chip8_Op::LD_B_VX:
+		case Chip8_Op::LD_MEM_VX:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static u16 register_mask(const Chip8_Op& op, const Chip8_Quirks& quirks, u16& written){
+	u16 x = 1u << op.x;
+	u16 y = 1u << op.y;
+	u16 F = 1u << 0xF;
+	u16 V0_to_Vx = (u16)((1u << (op.x + 1)) - 1u);
+
+	switch (op.type){
+		case Chip8_Op::SE_VX_BYTE:
+		case Chip8_Op::SNE_VX_BYTE:
+		case Chip8_Op::SKP_VX:
+		case Chip8_Op::SKNP_VX:
+		case Chip8_Op::LD_DT_VX:
+		case Chip8_Op::LD_ST_VX:
+		case Chip8_Op::ADD_I_VX:
+		case Chip8_Op::LD_F_VX:
+		case Chip8_Op::LD_B_VX:
+			return x;
+		case Chip8_Op::SE_VX_VY:
+		case Chip8_Op::SNE_VX_VY:
+			return x | y;
+		case Chip8_Op::LD_VX_BYTE:
+		case Chip8_Op::ADD_VX_BYTE:
+		case Chip8_Op::RND_VX_BYTE:
+		case Chip8_Op::LD_VX_DT:
+			written |= x;
+			return x;
+		case Chip8_Op::LD_VX_VY:
+			written |= x;
+			return x | y;
+		case Chip8_Op::OR_VX_VY:
+		case Chip8_Op::AND_VX_VY:
+		case Chip8_Op::XOR_VX_VY:
+			if (quirks.vf_reset){
+				written |= x | F;
+				return x | y | F;
+			}
+			written |= x;
+			return x | y;
+		case Chip8_Op::ADD_VX_VY:
+		case Chip8_Op::SUB_VX_VY:
+		case Chip8_Op::SUBN_VX_VY:
+			written |= x | F;
+			return x | y | F;
+		case Chip8_Op::SHR_VX:
+		case Chip8_Op::SHL_VX:
+			written |= x | F;
+			return quirks.shift_vy ? x | y | F : x | F;
+		case Chip8_Op::DRW_VX_VY_N:
+			written |= F;
+			return x | y | F;
+		case Chip8_Op::JP_V0_ADDR:
+			return quirks.jump_vx ? x : 1u;
+		case Chip8_Op::LD_MEM_VX:
+			return V0_to_Vx;
+		case Chip8_Op::LD_VX_MEM:
+			written |= V0_to_Vx;
+			return V0_to_Vx;
+		default:
+			return 0u;
+	}
+}
+
+static void recover_blocks(const AOT_ROM& ROM, AOT_Block_List& list){
+	u8 visited[4096] = {};
+	u16 leaders[4096];
+	int leader_count = 0;
+
+	auto add_leader = [&](u16 adress){
+		if (adress < carray_size(visited) && !visited[adress] && leader_count != carray_size(leaders))
+			leaders[leader_count++] = adress;
+	};
+
+	list.block_count = 0;
+	add_leader(g_aot_start_adress);
+
+	while (leader_count){
+		u16 adress = leaders[--leader_count];
+
+		if (visited[adress]) continue;
+		visited[adress] = true;
+
+		AOT_Block& block = list.blocks[list.block_count];
+		block.adress = adress;
+		block.op_count = 0;
+		block.used_registers = 0u;
+		block.written_registers = 0u;
+
+		u16 PC = adress;
+		int terminated = false;
+		while (block.op_count != g_aot_block_instruction_max){
+			if (!Chip8_is_valid_memory(PC, 2, g_aot_reserved_start, g_aot_memory_size) || !ROM_contains(ROM, PC, 2)) break;
+
+			u16 instruction = ROM_fetch(ROM, PC);
+			// SUPERCHIP decodes every instruction of both machines ; the SUPER-CHIP ones are not recompiled
+			Chip8_Op op = Chip8_decode(instruction, Chip8::SUPERCHIP);
+
+			if (!is_recompiled(op)){
+				// executed by the interpreter, which then continues after it
+				if (is_interpreted(op)) add_leader(PC + 2);
+				break;
+			}
+
+			block.ops[block.op_count] = op;
+			block.instructions[block.op_count] = instruction;
+			++block.op_count;
+			block.used_registers |= register_mask(op, Chip8_quirk_sets[ROM.quirks], block.written_registers);
+			PC += 2;
+
+			if (is_terminator(op)){
+				terminated = true;
+
+				switch (op.type){
+					case Chip8_Op::JP_ADDR:
+						add_leader(op.nnn);
+						break;
+					case Chip8_Op::CALL_ADDR:
+						add_leader(op.nnn);
+						add_leader(PC);
+						break;
+					case Chip8_Op::SE_VX_BYTE:
+					case Chip8_Op::SNE_VX_BYTE:
+					case Chip8_Op::SE_VX_VY:
+					case Chip8_Op::SNE_VX_VY:
+					case Chip8_Op::SKP_VX:
+					case Chip8_Op::SKNP_VX:
+						add_leader(PC);
+						add_leader(PC + 2);
+						break;
+					case Chip8_Op::LD_B_VX:
+					case Chip8_Op::LD_MEM_VX:
+						add_leader(PC);
+						break;
+					default:
+						break;
+				}
+				break;
+			}
+		}
+
+		if (block.op_count){
+			if (!terminated) add_leader(PC);
+			++list.block_count;
+		}
+	}
+
+	qsort(list.blocks, list.block_count, sizeof(AOT_Block), [](const void* A, const void* B){
+		return (int)((const AOT_Block*)A)->adress - (int)((const AOT_Block*)B)->adress;
+	});
+}
+
+// ---- code generation
+
+static const char* g_register_name[16] = {
+	"V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7",
+	"V8", "V9", "VA", "VB", "VC", "VD", "VE", "VF"
+};
+
+static const char* g_quirks_enum_name[Chip8_Quirks::TYPE_COUNT] = {
+	"COWGOD", "VIP", "CHIP48", "SUPERCHIP", "XOCHIP"
+};
+
+struct AOT_Writer{
+	void exit(const char* PC_format, int executed, ...);
+
+	FILE* file;
+	const AOT_Block* block;
+	const Chip8_Quirks* quirks;
+};
+
+// stores the registers written by the block, sets Chip8::PC and returns the number of instructions executed
+void AOT_Writer::exit(const char* PC_format, int executed, ...){
+	for (int ireg = 0; ireg != 16; ++ireg)
+		if (block->written_registers & (1u << ireg))
+			fprintf(file, "\t\tchip8->registers.%s = %s;\n", g_register_name[ireg], g_register_name[ireg]);
+
+	va_list args;
+	va_start(args, executed);
+	fprintf(file, "\t\tchip8->PC = ");
+	vfprintf(file, PC_format, args);
+	fprintf(file, ";\n");
+	va_end(args);
+
+	fprintf(file, "\t\treturn %d;\n", executed);
+}
+
+// I after LD [I], Vx and LD Vx, [I] ; see Chip8_load_store_I
+static void write_load_store_I(FILE* file, const Chip8_Quirks& quirks, const Chip8_Op& op){
+	if (quirks.load_store == Chip8_Quirks::I_PLUS_X_PLUS_1) fprintf(file, "\t\tchip8->I += %u;\n", op.x + 1u);
+	else if (quirks.load_store == Chip8_Quirks::I_PLUS_X) fprintf(file, "\t\tchip8->I += %u;\n", op.x);
+}
+
+static void write_instruction(AOT_Writer& writer, const Chip8_Op& op, u16 PC, int iop){
+	FILE* file = writer.file;
+	const Chip8_Quirks& quirks = *writer.quirks;
+	const char* X = g_register_name[op.x];
+	const char* Y = g_register_name[op.y];
+
+	u16 next_PC = PC + 2;
+	u16 skip_PC = PC + 4;
+
+	auto error_exit = [&](){
+		fprintf(file, "\tif (chip8->ERROR){\n");
+		writer.exit("0x%03X", iop, next_PC);
+		fprintf(file, "\t}\n");
+	};
+
+	switch (op.type){
+		case Chip8_Op::CLS:
+			fprintf(file, "\tChip8_clear_screen(chip8);\n");
+			break;
+		case Chip8_Op::RET:
+			fprintf(file, "\tif (chip8->SP == 0) chip8->ERROR = Chip8::SP_INCORRECT;\n");
+			error_exit();
+			fprintf(file, "\t--chip8->SP;\n\t{\n");
+			writer.exit("chip8->STACK[chip8->SP]", iop + 1);
+			fprintf(file, "\t}\n");
+			break;
+		case Chip8_Op::JP_ADDR:
+			fprintf(file, "\t{\n");
+			writer.exit("0x%03X", iop + 1, op.nnn);
+			fprintf(file, "\t}\n");
+			break;
+		case Chip8_Op::CALL_ADDR:
+			fprintf(file, "\tif (chip8->SP == carray_size(Chip8::STACK)) chip8->ERROR = Chip8::SP_INCORRECT;\n");
+			error_exit();
+			fprintf(file, "\tchip8->STACK[chip8->SP++] = 0x%03X;\n\t{\n", next_PC);
+			writer.exit("0x%03X", iop + 1, op.nnn);
+			fprintf(file, "\t}\n");
+			break;
+		case Chip8_Op::SE_VX_BYTE:
+		case Chip8_Op::SNE_VX_BYTE:
+		case Chip8_Op::SE_VX_VY:
+		case Chip8_Op::SNE_VX_VY:
+		{
+			const char* comparison = (op.type == Chip8_Op::SE_VX_BYTE || op.type == Chip8_Op::SE_VX_VY) ? "==" : "!=";
+			char operand[8];
+			if (op.type == Chip8_Op::SE_VX_BYTE || op.type == Chip8_Op::SNE_VX_BYTE)
+				snprintf(operand, sizeof(operand), "0x%02X", op.kk);
+			else
+				snprintf(operand, sizeof(operand), "%s", Y);
+
+			fprintf(file, "\t{\n");
+			writer.exit("(%s %s %s) ? 0x%03X : 0x%03X", iop + 1, X, comparison, operand, skip_PC, next_PC);
+			fprintf(file, "\t}\n");
+			break;
+		}
+		case Chip8_Op::LD_VX_BYTE:	fprintf(file, "\t%s = 0x%02X;\n", X, op.kk); break;
+		case Chip8_Op::ADD_VX_BYTE:	fprintf(file, "\t%s += 0x%02X;\n", X, op.kk); break;
+		case Chip8_Op::LD_VX_VY:	fprintf(file, "\t%s = %s;\n", X, Y); break;
+		case Chip8_Op::OR_VX_VY:
+		case Chip8_Op::AND_VX_VY:
+		case Chip8_Op::XOR_VX_VY:
+		{
+			const char* operation = op.type == Chip8_Op::OR_VX_VY ? "|=" : op.type == Chip8_Op::AND_VX_VY ? "&=" : "^=";
+			fprintf(file, "\t%s %s %s;\n", X, operation, Y);
+			if (quirks.vf_reset) fprintf(file, "\tVF = 0;\n");
+			break;
+		}
+		// VF is written before Vx like the interpreter when x or y is F
+		case Chip8_Op::ADD_VX_VY:
+			fprintf(file, "\t{\n\t\tshort add = %s + %s;\n\t\tVF = add > 255 ? 1 : 0;\n\t\t%s = (u8)add;\n\t}\n", X, Y, X);
+			break;
+		case Chip8_Op::SUB_VX_VY:
+			fprintf(file, "\tVF = %s > %s ? 1 : 0;\n\t%s -= %s;\n", X, Y, X, Y);
+			break;
+		case Chip8_Op::SHR_VX:
+			if (quirks.shift_vy) fprintf(file, "\t{\n\t\tu8 value = %s;\n\t\tVF = value & 0x01;\n\t\t%s = value >> 1;\n\t}\n", Y, X);
+			else fprintf(file, "\tVF = %s & 0x01;\n\t%s >>= 1;\n", X, X);
+			break;
+		case Chip8_Op::SUBN_VX_VY:
+			fprintf(file, "\tVF = %s > %s ? 1 : 0;\n\t%s = %s - %s;\n", Y, X, X, Y, X);
+			break;
+		case Chip8_Op::SHL_VX:
+			if (quirks.shift_vy) fprintf(file, "\t{\n\t\tu8 value = %s;\n\t\tVF = (value & 0x80) >> 7;\n\t\t%s = value << 1;\n\t}\n", Y, X);
+			else fprintf(file, "\tVF = (%s & 0x80) >> 7;\n\t%s <<= 1;\n", X, X);
+			break;
+		case Chip8_Op::LD_I_ADDR:
+			fprintf(file, "\tchip8->I = 0x%03X;\n", op.nnn);
+			break;
+		case Chip8_Op::JP_V0_ADDR:
+		{
+			const char* offset = quirks.jump_vx ? X : "V0";
+			fprintf(file, "\tChip8_validate_memory(chip8, 0x%03X + %s, 2);\n", op.nnn, offset);
+			error_exit();
+			fprintf(file, "\t{\n");
+			writer.exit("0x%03X + %s", iop + 1, op.nnn, offset);
+			fprintf(file, "\t}\n");
+			break;
+		}
+		case Chip8_Op::RND_VX_BYTE:
+			fprintf(file, "\t%s = (u8)random_char(chip8->RANDOM) & 0x%02X;\n", X, op.kk);
+			break;
+		case Chip8_Op::DRW_VX_VY_N:
+			fprintf(file, "\tif (!Chip8_is_valid_screen_coord(chip8, %s, %s) || %d >= chip8->screen_height) chip8->ERROR = Chip8::SCREEN_COORD_INCORRECT;\n", X, Y, op.n);
+			fprintf(file, "\tChip8_validate_memory(chip8, chip8->I, %u);\n", op.n);
+			error_exit();
+			fprintf(file, "\tChip8_draw_sprite(chip8, %s, %s, %u);\n", X, Y, op.n);
+			fprintf(file, "\tVF = chip8->registers.VF;\n");
+			break;
+		case Chip8_Op::SKP_VX:
+		case Chip8_Op::SKNP_VX:
+		{
+			const char* pressed = op.type == Chip8_Op::SKP_VX ? "" : "!";
+
+			fprintf(file, "\tif (%s >= sizeof(Chip8::KEYBOARD)) chip8->ERROR = Chip8::KEY_UNKNOWN;\n", X);
+			error_exit();
+			fprintf(file, "\t{\n");
+			writer.exit("%schip8->KEYBOARD[%s] ? 0x%03X : 0x%03X", iop + 1, pressed, X, skip_PC, next_PC);
+			fprintf(file, "\t}\n");
+			break;
+		}
+		case Chip8_Op::LD_VX_DT:	fprintf(file, "\tchip8->CYCLE = cycle + %d;\n\t%s = Chip8_get_DT(chip8);\n", iop, X); break;
+		case Chip8_Op::LD_DT_VX:	fprintf(file, "\tchip8->CYCLE = cycle + %d;\n\tChip8_set_DT(chip8, %s);\n", iop, X); break;
+		case Chip8_Op::LD_ST_VX:	fprintf(file, "\tchip8->CYCLE = cycle + %d;\n\tChip8_set_ST(chip8, %s);\n", iop, X); break;
+		case Chip8_Op::ADD_I_VX:	fprintf(file, "\tchip8->I += %s;\n", X); break;
+		case Chip8_Op::LD_F_VX:		fprintf(file, "\tchip8->I = (%s & 0x0F) * 5;\n", X); break;
+		case Chip8_Op::LD_B_VX:
+			fprintf(file, "\tChip8_validate_memory(chip8, chip8->I, 3);\n");
+			error_exit();
+			fprintf(file, "\t{\n\t\tu8* memptr = Chip8_get_memory(chip8, chip8->I);\n");
+			fprintf(file, "\t\tmemptr[0] = %s / 100;\n\t\tmemptr[1] = (%s %% 100) / 10;\n\t\tmemptr[2] = (%s %% 10);\n", X, X, X);
+			fprintf(file, "\t\tChip8_invalidate_decode(chip8, chip8->I, 3);\n");
+			writer.exit("0x%03X", iop + 1, next_PC);
+			fprintf(file, "\t}\n");
+			break;
+		case Chip8_Op::LD_MEM_VX:
+			fprintf(file, "\tChip8_validate_memory(chip8, chip8->I, %u);\n", op.x + 1u);
+			error_exit();
+			fprintf(file, "\t{\n\t\tu8* memptr = Chip8_get_memory(chip8, chip8->I);\n");
+			for (int ireg = 0; ireg <= op.x; ++ireg)
+				fprintf(file, "\t\tmemptr[%d] = %s;\n", ireg, g_register_name[ireg]);
+			fprintf(file, "\t\tChip8_invalidate_decode(chip8, chip8->I, %u);\n", op.x + 1u);
+			write_load_store_I(file, quirks, op);
+			writer.exit("0x%03X", iop + 1, next_PC);
+			fprintf(file, "\t}\n");
+			break;
+		case Chip8_Op::LD_VX_MEM:
+			fprintf(file, "\tChip8_validate_memory(chip8, chip8->I, %u);\n", op.x + 1u);
+			error_exit();
+			fprintf(file, "\t{\n\t\tu8* memptr = Chip8_get_memory(chip8, chip8->I);\n");
+			for (int ireg = 0; ireg <= op.x; ++ireg)
+				fprintf(file, "\t\t%s = memptr[%d];\n", g_register_name[ireg], ireg);
+			write_load_store_I(file, quirks, op);
+			fprintf(file, "\t}\n");
+			break;
+		default:
+			fprintf(stderr, "chip8_aot: instruction 0x%03X without translation\n", PC);
+			break;
+	}
+}
+
+static void write_block(FILE* file, const AOT_ROM& ROM, const AOT_Block& block){
+	int op_count = block.op_count;
+	u16 end = block.adress + op_count * 2;
+
+	u64 lines = 0u;
+	for (u32 iline = block.adress / 64u; iline <= (end - 1u) / 64u; ++iline)
+		lines |= (u64)1u << iline;
+
+	fprintf(file, "static int Chip8_aot_%s_%03X(Chip8* chip8, int instruction_count){\n", ROM.identifier, block.adress);
+	fprintf(file, "\tif (instruction_count < %d) return -1;\n", op_count);
+	fprintf(file, "\tif ((chip8->AOT_WRITTEN_LINES & 0x%016llXull) && memcmp(Chip8_get_memory(chip8, 0x%03X), g_%s_ROM + 0x%03X, %d) != 0) return -1;\n\n",
+		(unsigned long long)lines, block.adress, ROM.identifier, block.adress - g_aot_start_adress, op_count * 2);
+
+	for (int ireg = 0; ireg != 16; ++ireg)
+		if (block.used_registers & (1u << ireg))
+			fprintf(file, "\tu8 %s = chip8->registers.%s;\n", g_register_name[ireg], g_register_name[ireg]);
+
+	// cycle of the first instruction ; the runtime sets Chip8::CYCLE when the block returns
+	for (int iop = 0; iop != op_count; ++iop){
+		Chip8_Op::TYPE type = block.ops[iop].type;
+		if (type == Chip8_Op::LD_VX_DT || type == Chip8_Op::LD_DT_VX || type == Chip8_Op::LD_ST_VX){
+			fprintf(file, "\tu64 cycle = chip8->CYCLE;\n");
+			break;
+		}
+	}
+
+	AOT_Writer writer;
+	writer.file = file;
+	writer.block = &block;
+	writer.quirks = &Chip8_quirk_sets[ROM.quirks];
+
+	u16 PC = block.adress;
+	for (int iop = 0; iop != op_count; ++iop, PC += 2){
+		fprintf(file, "\n\t// 0x%03X ; %04X\n", PC, block.instructions[iop]);
+		write_instruction(writer, block.ops[iop], PC, iop);
+	}
+
+	if (!is_terminator(block.ops[op_count - 1])){
+		fprintf(file, "\n\t{\n");
+		writer.exit("0x%03X", op_count, PC);
+		fprintf(file, "\t}\n");
+	}
+
+	fprintf(file, "}\n\n");
+}
+
+static void write_ROM(FILE* file, const AOT_ROM& ROM, const AOT_Block_List& list){
+	fprintf(file, "// ---- %s\n\n", ROM.path);
+
+	fprintf(file, "static const u8 g_%s_ROM[%zu] = {", ROM.identifier, ROM.size);
+	for (size_t ibyte = 0; ibyte != ROM.size; ++ibyte)
+		fprintf(file, "%s0x%02X,", (ibyte % 16) ? " " : "\n\t", ROM.data[ibyte]);
+	fprintf(file, "\n};\n\n");
+
+	for (int iblock = 0; iblock != list.block_count; ++iblock)
+		write_block(file, ROM, list.blocks[iblock]);
+
+	fprintf(file, "static int Chip8_aot_%s_execute_block(Chip8* chip8, int instruction_count){\n", ROM.identifier);
+	fprintf(file, "\tswitch (chip8->PC){\n");
+	for (int iblock = 0; iblock != list.block_count; ++iblock){
+		u16 adress = list.blocks[iblock].adress;
+		fprintf(file, "\t\tcase 0x%03X: return Chip8_aot_%s_%03X(chip8, instruction_count);\n", adress, ROM.identifier, adress);
+	}
+	fprintf(file, "\t\tdefault: return -1;\n");
+	fprintf(file, "\t}\n}\n\n");
+}
+
+int main(int argc, char* argv[]){
+	int ROM_count = 0;
+	for (int iarg = 2; iarg < argc; ++iarg)
+		if (strncmp(argv[iarg], "-quirks=", cstring_size("-quirks=")) != 0) ++ROM_count;
+
+	if (ROM_count == 0 || ROM_count > g_aot_ROM_max){
+		fprintf(stderr, "USAGE: chip8_aot OUTPUT.cpp [-quirks=NAME] ROM [[-quirks=NAME] ROM ...]\n");
+		return 1;
+	}
+
+	AOT_ROM* ROMs = (AOT_ROM*)malloc(sizeof(AOT_ROM) * ROM_count);
+	AOT_Block_List* list = (AOT_Block_List*)malloc(sizeof(AOT_Block_List));
+
+	Chip8_Quirks::TYPE quirks = Chip8_Quirks::COWGOD;
+	int irom = 0;
+	for (int iarg = 2; iarg < argc; ++iarg){
+		const char* arg = argv[iarg];
+		if (strncmp(arg, "-quirks=", cstring_size("-quirks=")) == 0){
+			const char* name = arg + cstring_size("-quirks=");
+			int itype = 0;
+			while (itype != Chip8_Quirks::TYPE_COUNT && strcmp(name, Chip8_Quirks::TYPE_NAME[itype]) != 0) ++itype;
+			if (itype == Chip8_Quirks::TYPE_COUNT){
+				fprintf(stderr, "chip8_aot: unknown quirks %s\n", name);
+				return 1;
+			}
+			quirks = (Chip8_Quirks::TYPE)itype;
+			continue;
+		}
+
+		AOT_ROM& ROM = ROMs[irom];
+		ROM.path = arg;
+		ROM.quirks = quirks;
+		ROM_identifier(ROM.path, ROM.identifier);
+
+		if (!read_ROM(ROM.path, ROM)){
+			fprintf(stderr, "chip8_aot: failed to read %s or it does not fit in 4 KB\n", ROM.path);
+			return 1;
+		}
+
+		for (int iother = 0; iother != irom; ++iother){
+			if (strcmp(ROMs[iother].identifier, ROM.identifier) == 0){
+				size_t size = strlen(ROM.identifier);
+				snprintf(ROM.identifier + size, sizeof(AOT_ROM::identifier) - size, "_%d", irom);
+				break;
+			}
+		}
+		++irom;
+	}
+
+	FILE* file = fopen(argv[1], "w");
+	if (!file){
+		fprintf(stderr, "chip8_aot: failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	fprintf(file, "// generated by tools/chip8_aot.cpp ; do not edit\n\n");
+	fprintf(file, "#include \"chip8.h\"\n\n");
+
+	for (int irom = 0; irom != ROM_count; ++irom){
+		recover_blocks(ROMs[irom], *list);
+		write_ROM(file, ROMs[irom], *list);
+
+		printf("%s ; %d blocks\n", ROMs[irom].path, list->block_count);
+	}
+
+	fprintf(file, "// ----\n\n");
+	fprintf(file, "extern const Chip8_AOT_Program g_chip8_aot_programs[%d] = {\n", ROM_count);
+	for (int irom = 0; irom != ROM_count; ++irom){
+		const char* identifier = ROMs[irom].identifier;
+		fprintf(file, "\t{ \"%s\", g_%s_ROM, sizeof(g_%s_ROM), Chip8_Quirks::%s, Chip8_aot_%s_execute_block },\n",
+			identifier, identifier, identifier, g_quirks_enum_name[ROMs[irom].quirks], identifier);
+	}
+	fprintf(file, "};\n");
+	fprintf(file, "extern const int g_chip8_aot_program_count = %d;\n", ROM_count);
+
+	fclose(file);
+
+	free(list);
+	free(ROMs);
+
+	return 0;
+}
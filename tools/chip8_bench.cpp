@@ -0,0 +1,357 @@
+#include "chip8.h"
+
+#include <cmath>
+
+// Throughput benchmark of the Chip8 core over the bundled ROMs ; the report is written to stdout as JSON
+//
+// USAGE: chip8_bench [-instructions=N] [-runs=N] [-backend=NAME] [-ips=N] [-data=DIRECTORY] [ROM ...]
+//
+// * every ROM of data/chip8 and data/superchip8 is run unless ROMs are given ; -data is the directory containing data/
+// * every run executes instructions (10 000 000 by default) with Chip8_step in frames of 1 / 60 seconds
+//   at -ips instructions per second ; a ROM stops early on a Chip8 ERROR
+// * the keypad is drawn from a xoroshiro128+ seeded identically for every run so that every run executes the same instructions
+// * DRW and Chip8_to_screen are measured after the run on the final state of the ROM
+// * the instructions retired by the idle loops without being dispatched (Chip8::IDLE_CYCLE) count in instructions
+//   and instructions_per_second but not in dispatched and the per dispatch metrics, which give the cost of the backend
+// * every metric is reported with its mean, standard deviation, min and max over -runs runs (5 by default)
+
+static constexpr int g_bench_update_per_second = 60;
+static constexpr int g_bench_key_period = 10;
+static constexpr int g_bench_run_max = 64;
+static constexpr int g_bench_DRW_count = 100000;
+static constexpr int g_bench_to_screen_count = 10000;
+
+static constexpr const char* g_bench_ROMs[] = {
+	"data/chip8/15PUZZLE",
+	"data/chip8/BLINKY",
+	"data/chip8/BLITZ",
+	"data/chip8/BRIX",
+	"data/chip8/CONNECT4",
+	"data/chip8/GUESS",
+	"data/chip8/HIDDEN",
+	"data/chip8/INVADERS",
+	"data/chip8/KALEID",
+	"data/chip8/MAZE",
+	"data/chip8/MERLIN",
+	"data/chip8/MISSILE",
+	"data/chip8/PONG",
+	"data/chip8/PONG2",
+	"data/chip8/PUZZLE",
+	"data/chip8/SYZYGY",
+	"data/chip8/TANK",
+	"data/chip8/TETRIS",
+	"data/chip8/TICTAC",
+	"data/chip8/UFO",
+	"data/chip8/VBRIX",
+	"data/chip8/VERS",
+	"data/chip8/WIPEOFF",
+	"data/chip8/chip8-test-rom-with-audio",
+	"data/chip8/chiptest",
+	"data/chip8/chiptest-mini",
+	"data/superchip8/ALIEN",
+	"data/superchip8/ANT",
+	"data/superchip8/BLINKY",
+	"data/superchip8/CAR",
+	"data/superchip8/FIELD",
+	"data/superchip8/JOUST",
+	"data/superchip8/PIPER",
+	"data/superchip8/RACE",
+	"data/superchip8/SPACEFIG",
+	"data/superchip8/UBOAT",
+	"data/superchip8/WORM3",
+};
+
+struct Bench_Options{
+	const char* data_directory;
+	const char* ROM_paths[256];
+	int ROM_count;
+
+	u64 instructions;
+	int runs;
+
+	int all_backends;
+	Chip8::BACKEND_TYPE backend;
+	u32 instructions_per_second;
+};
+
+struct Bench_Run{
+	u64 hash;
+	u64 instructions;
+	u64 dispatched;
+	u64 frames;
+	int error;
+
+	double instructions_per_second;
+	double ns_per_instruction;
+	double dispatched_per_second;
+	double ns_per_dispatch;
+	double ns_per_DRW;
+	double ns_per_to_screen;
+};
+
+struct Bench_Statistics{
+	double mean;
+	double stddev;
+	double min;
+	double max;
+};
+
+// ---- options
+
+static void parse_options(int argc, char* argv[], Bench_Options& options){
+	options.data_directory = ".";
+	options.ROM_count = 0;
+	options.instructions = 10000000u;
+	options.runs = 5;
+	options.all_backends = true;
+	options.backend = Chip8::DECODED;
+	options.instructions_per_second = 1000000u;
+
+	for (int iarg = 1; iarg != argc; ++iarg){
+		const char* arg = argv[iarg];
+
+		if (strncmp(arg, "-instructions=", cstring_size("-instructions=")) == 0){
+			options.instructions = strtoull(arg + cstring_size("-instructions="), NULL, 10);
+			if (!options.instructions) crash("Invalid instruction count: %s", arg);
+		}
+		else if (strncmp(arg, "-runs=", cstring_size("-runs=")) == 0){
+			options.runs = atoi(arg + cstring_size("-runs="));
+			if (options.runs < 1 || options.runs > g_bench_run_max) crash("Invalid run count: %s", arg);
+		}
+		else if (strncmp(arg, "-backend=", cstring_size("-backend=")) == 0){
+			if (!Chip8_backend_from_name(arg + cstring_size("-backend="), options.backend))
+				crash("Unknown backend: %s", arg);
+			options.all_backends = false;
+		}
+		else if (strncmp(arg, "-ips=", cstring_size("-ips=")) == 0){
+			options.instructions_per_second = (u32)strtoul(arg + cstring_size("-ips="), NULL, 10);
+			if (!options.instructions_per_second) crash("Invalid instructions per second: %s", arg);
+		}
+		else if (strncmp(arg, "-data=", cstring_size("-data=")) == 0){
+			options.data_directory = arg + cstring_size("-data=");
+		}
+		else if (options.ROM_count != carray_size(Bench_Options::ROM_paths)){
+			options.ROM_paths[options.ROM_count++] = arg;
+		}
+	}
+}
+
+// ---- measures
+
+static int read_ROM(const char* path, u8* data, size_t& size){
+	FILE* file = fopen(path, "rb");
+	if (!file) return false;
+
+	size = fread(data, 1u, sizeof(Chip8::Memory::user_range), file);
+	int end_of_file = fgetc(file) == EOF;
+	fclose(file);
+
+	return end_of_file;
+}
+
+#if defined(CHIP8_AOT)
+// generated by tools/chip8_aot.cpp
+extern const Chip8_AOT_Program g_chip8_aot_programs[];
+extern const int g_chip8_aot_program_count;
+#endif
+
+static double elapsed_ns(u64 start, u64 end){
+	return (double)(end - start) * 1000000000. / (double)g_timer->ticks_per_second();
+}
+
+// DRW at pseudo-random positions with the sprite at I ; SCREEN and VF are modified
+static double measure_DRW(Chip8* chip8, Random_Data& random){
+	u16 I = Chip8_is_valid_memory(chip8, chip8->I, Chip8_sprite_size(chip8, 15u)) ? chip8->I : 0x200;
+	chip8->I = I;
+
+	u64 start = g_timer->ticks();
+	for (int iDRW = 0; iDRW != g_bench_DRW_count; ++iDRW){
+		u32 value = (u32)random_int(random);
+		u8 x = (u8)(value % chip8->screen_width);
+		u8 y = (u8)((value >> 8u) % chip8->screen_height);
+		short n = (short)(1u + (value >> 16u) % 15u);
+		Chip8_draw_sprite(chip8, x, y, n);
+	}
+	u64 end = g_timer->ticks();
+
+	return elapsed_ns(start, end) / (double)g_bench_DRW_count;
+}
+
+// full frames ie every row is dirty
+static double measure_to_screen(Chip8* chip8, Pixel_Canvas& screen){
+	RGBA palette[4] = {{0x00, 0x00, 0x00, 0xFF}, {0xFF, 0xFF, 0xFF, 0xFF}, {0xFF, 0x66, 0x00, 0xFF}, {0x66, 0x22, 0x00, 0xFF}};
+
+	u64 start = g_timer->ticks();
+	for (int iframe = 0; iframe != g_bench_to_screen_count; ++iframe){
+		chip8->SCREEN_DIRTY = UINT64_MAX;
+		Chip8_to_screen(chip8, screen, palette);
+	}
+	u64 end = g_timer->ticks();
+
+	return elapsed_ns(start, end) / (double)g_bench_to_screen_count;
+}
+
+static void run_benchmark(Chip8* chip8, Pixel_Canvas& screen, const u8* ROM, size_t ROM_size, Chip8::BACKEND_TYPE backend, Bench_Options& options, Bench_Run& run){
+	Chip8_create(chip8, (void*)ROM, ROM_size, Chip8_detect_machine(ROM, ROM_size));
+#if defined(CHIP8_AOT)
+	chip8->AOT_PROGRAM = Chip8_aot_find(g_chip8_aot_programs, g_chip8_aot_program_count, ROM, ROM_size);
+#endif
+	chip8->BACKEND = backend;
+	chip8->instructions_per_second = options.instructions_per_second;
+
+	Random_Data keys;
+	keys.seed_low = 0x9E3779B97F4A7C15ULL;
+	keys.seed_high = 0xBF58476D1CE4E5B9ULL;
+
+	u64 frames = 0u;
+	u64 ticks = 0u;
+	while (chip8->CYCLE < options.instructions && !chip8->ERROR){
+		if (frames % g_bench_key_period == 0u){
+			for (int ikey = 0; ikey != carray_size(Chip8::KEYBOARD); ++ikey)
+				chip8->KEYBOARD[ikey] = (random_char(keys) & 0x07) == 0;
+		}
+
+		u64 start = g_timer->ticks();
+		Chip8_step(chip8, 1.f / (float)g_bench_update_per_second);
+		ticks += g_timer->ticks() - start;
+
+		++frames;
+	}
+
+	run.hash = Chip8_hash_state(chip8);
+	run.instructions = chip8->CYCLE;
+	run.dispatched = chip8->CYCLE - chip8->IDLE_CYCLE;
+	run.frames = frames;
+	run.error = chip8->ERROR;
+
+	double ns = elapsed_ns(0u, ticks);
+	run.ns_per_instruction = ns / (double)max(run.instructions, (u64)1u);
+	run.instructions_per_second = ns > 0. ? (double)run.instructions * 1000000000. / ns : 0.;
+	run.ns_per_dispatch = ns / (double)max(run.dispatched, (u64)1u);
+	run.dispatched_per_second = ns > 0. ? (double)run.dispatched * 1000000000. / ns : 0.;
+
+	run.ns_per_DRW = measure_DRW(chip8, keys);
+
+	screen.set_resolution(chip8->screen_width, chip8->screen_height);
+	run.ns_per_to_screen = measure_to_screen(chip8, screen);
+
+	Chip8_destroy(chip8);
+}
+
+static Bench_Statistics compute_statistics(Bench_Run* runs, int run_count, double Bench_Run::* metric){
+	Bench_Statistics statistics;
+	statistics.min = runs[0].*metric;
+	statistics.max = runs[0].*metric;
+
+	double sum = 0.;
+	for (int irun = 0; irun != run_count; ++irun){
+		double value = runs[irun].*metric;
+		sum += value;
+		statistics.min = min(statistics.min, value);
+		statistics.max = max(statistics.max, value);
+	}
+	statistics.mean = sum / (double)run_count;
+
+	double squares = 0.;
+	for (int irun = 0; irun != run_count; ++irun){
+		double deviation = runs[irun].*metric - statistics.mean;
+		squares += deviation * deviation;
+	}
+	statistics.stddev = run_count > 1 ? sqrt(squares / (double)(run_count - 1)) : 0.;
+
+	return statistics;
+}
+
+// ---- JSON
+
+static void print_json_string(const char* str){
+	putchar('"');
+	for (; *str; ++str){
+		if (*str == '"' || *str == '\\') putchar('\\');
+		if ((u8)*str < 0x20) printf("\\u%04x", (u8)*str);
+		else putchar(*str);
+	}
+	putchar('"');
+}
+
+static void print_json_statistics(const char* name, Bench_Run* runs, int run_count, double Bench_Run::* metric, const char* separator){
+	Bench_Statistics statistics = compute_statistics(runs, run_count, metric);
+	printf("\t\t\t\"%s\": {\"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"max\": %.3f}%s\n",
+		name, statistics.mean, statistics.stddev, statistics.min, statistics.max, separator);
+}
+
+int main(int argc, char* argv[]){
+	Bench_Options options;
+	parse_options(argc, argv, options);
+
+	int use_bundled_ROMs = options.ROM_count == 0;
+	int ROM_count = use_bundled_ROMs ? (int)carray_size(g_bench_ROMs) : options.ROM_count;
+
+	Chip8* chip8 = (Chip8*)malloc(sizeof(Chip8));
+	if (!chip8) crash("Failed to allocate the Chip8");
+
+	Pixel_Canvas screen;
+	screen.create();
+
+	static u8 ROM[sizeof(Chip8::Memory::user_range)];
+	Bench_Run runs[g_bench_run_max];
+
+	printf("{\n");
+	printf("\t\"instructions\": %" PRIu64 ",\n", options.instructions);
+	printf("\t\"instructions_per_second\": %u,\n", options.instructions_per_second);
+	printf("\t\"runs\": %d,\n", options.runs);
+	printf("\t\"results\": [");
+
+	int result_count = 0;
+	for (int irom = 0; irom != ROM_count; ++irom){
+		char path[1024];
+		if (use_bundled_ROMs)
+			snprintf(path, sizeof(path), "%s/%s", options.data_directory, g_bench_ROMs[irom]);
+		else
+			snprintf(path, sizeof(path), "%s", options.ROM_paths[irom]);
+
+		size_t ROM_size;
+		if (!read_ROM(path, ROM, ROM_size)){
+			fprintf(stderr, "chip8_bench: failed to read %s\n", path);
+			continue;
+		}
+
+		for (int ibackend = 0; ibackend != Chip8::BACKEND_COUNT; ++ibackend){
+			if (!options.all_backends && ibackend != options.backend) continue;
+			Chip8::BACKEND_TYPE backend = (Chip8::BACKEND_TYPE)ibackend;
+
+			for (int irun = 0; irun != options.runs; ++irun)
+				run_benchmark(chip8, screen, ROM, ROM_size, backend, options, runs[irun]);
+
+			// every run executes the same instructions
+			int deterministic = true;
+			for (int irun = 1; irun != options.runs; ++irun)
+				deterministic &= runs[irun].hash == runs[0].hash;
+
+			printf("%s\n\t\t{\n", result_count++ ? "," : "");
+			printf("\t\t\t\"ROM\": "); print_json_string(path); printf(",\n");
+			printf("\t\t\t\"backend\": \"%s\",\n", Chip8::BACKEND_NAME[ibackend]);
+			printf("\t\t\t\"hash\": \"%016" PRIx64 "\",\n", runs[0].hash);
+			printf("\t\t\t\"deterministic\": %s,\n", deterministic ? "true" : "false");
+			printf("\t\t\t\"error\": %d,\n", runs[0].error);
+			printf("\t\t\t\"instructions\": %" PRIu64 ",\n", runs[0].instructions);
+			printf("\t\t\t\"dispatched\": %" PRIu64 ",\n", runs[0].dispatched);
+			printf("\t\t\t\"frames\": %" PRIu64 ",\n", runs[0].frames);
+			print_json_statistics("instructions_per_second", runs, options.runs, &Bench_Run::instructions_per_second, ",");
+			print_json_statistics("ns_per_instruction", runs, options.runs, &Bench_Run::ns_per_instruction, ",");
+			print_json_statistics("dispatched_per_second", runs, options.runs, &Bench_Run::dispatched_per_second, ",");
+			print_json_statistics("ns_per_dispatch", runs, options.runs, &Bench_Run::ns_per_dispatch, ",");
+			print_json_statistics("ns_per_DRW", runs, options.runs, &Bench_Run::ns_per_DRW, ",");
+			print_json_statistics("ns_per_to_screen", runs, options.runs, &Bench_Run::ns_per_to_screen, "");
+			printf("\t\t}");
+			fflush(stdout);
+		}
+	}
+
+	printf("\n\t]\n}\n");
+
+	screen.destroy();
+	free(chip8);
+
+	return 0;
+}
@@ -0,0 +1,376 @@
+#include "chip8.h"
+
+// Headless runner of the Chip8 core, without window, audio or input
+//
+// USAGE: chip8_run ROM [-frames=N | -instructions=N] [-backend=NAME] [-machine=chip8|superchip|xochip] [-quirks=auto|cowgod|vip|chip48|superchip|xochip] [-ips=N] [-keys=FRAME:KEYS[,FRAME:KEYS ...]] [-replay=MOVIE] [-batch=N] [-memory_profile=PATH] [-opcode_stats[=SAMPLE_PERIOD]]
+//
+// * -frames runs N frames of 1 / 60 seconds with Chip8_step like the game (600 by default)
+// * -instructions runs N instructions in frames of instructions_per_second / 60 instructions
+// * -machine forces the machine instead of Chip8_detect_machine
+// * -quirks forces the quirk set instead of Chip8_default_quirks of the machine ; -replay uses the one of the movie
+//   auto runs Chip8_detect_quirks and prints the trials on stderr
+// * -keys holds the keys of the hexadecimal mask KEYS from FRAME onwards ; bit k is key k ; FRAME is increasing
+// * the state hash is printed on stdout and is identical for every backend
+// * -replay runs the frames and keys of a movie recorded by Chip8tle -record instead of -frames, -instructions, -ips and -keys
+//   and compares the state hash at its checkpoints ; the exit code is 3 on mismatch
+// * -batch runs N copies of a CHIP8 ROM with the same keys in a Chip8_Batch and prints the hash of the first lane,
+//   the lane instructions per second and the number of lanes whose hash differs from the first one
+// * -memory_profile writes the fetch, read and write counts per adress to PATH.csv and their heatmap to PATH.ppm
+// * -opcode_stats prints the executed opcode classes after the hash and times one opcode every SAMPLE_PERIOD ; requires CHIP8_OPCODE_STATS
+//
+// engine_win32.cpp is not linked: the logger, crash and the timer used by the core are in tools/tool_platform.cpp
+
+static constexpr int g_run_update_per_second = 60;
+static constexpr int g_run_key_event_max = 256;
+
+struct Run_Key_Event{
+	u64 frame;
+	u16 keys;
+};
+
+struct Run_Options{
+	const char* ROM_path;
+
+	u64 frames;
+	u64 instructions;
+
+	Chip8::BACKEND_TYPE backend;
+	// Chip8::MACHINE_COUNT when detected from the ROM
+	Chip8::MACHINE_TYPE machine;
+	// Chip8_Quirks::TYPE_COUNT for the default quirks of the machine
+	Chip8_Quirks::TYPE quirks;
+	int detect_quirks;
+	u32 instructions_per_second;
+
+	Run_Key_Event key_events[g_run_key_event_max];
+	int key_event_count;
+
+	const char* movie_path;
+
+	// 0 without batch
+	u32 batch_lane_count;
+
+	const char* memory_profile_path;
+
+	int opcode_stats;
+	u32 opcode_sample_period;
+};
+
+// ---- options
+
+static void parse_keys(const char* arg, const char* script, Run_Options& options){
+	const char* cursor = script;
+	while (*cursor){
+		if (options.key_event_count == g_run_key_event_max) crash("Too many key events: %s", arg);
+
+		char* end;
+		Run_Key_Event& event = options.key_events[options.key_event_count++];
+		event.frame = strtoull(cursor, &end, 10);
+		if (end == cursor || *end != ':') crash("Invalid key events: %s", arg);
+
+		cursor = end + 1;
+		unsigned long keys = strtoul(cursor, &end, 16);
+		if (end == cursor || keys > 0xFFFFu) crash("Invalid key events: %s", arg);
+		event.keys = (u16)keys;
+
+		if (options.key_event_count > 1 && event.frame < options.key_events[options.key_event_count - 2].frame)
+			crash("Key events are not in frame order: %s", arg);
+
+		cursor = end;
+		if (*cursor == ',') ++cursor;
+		else if (*cursor) crash("Invalid key events: %s", arg);
+	}
+}
+
+static void parse_options(int argc, char* argv[], Run_Options& options){
+	options.ROM_path = NULL;
+	options.frames = 600u;
+	options.instructions = 0u;
+	options.backend = Chip8::DECODED;
+	options.machine = Chip8::MACHINE_COUNT;
+	options.quirks = Chip8_Quirks::TYPE_COUNT;
+	options.detect_quirks = false;
+	options.instructions_per_second = 500u;
+	options.key_event_count = 0;
+	options.movie_path = NULL;
+	options.batch_lane_count = 0u;
+	options.memory_profile_path = NULL;
+	options.opcode_stats = false;
+	options.opcode_sample_period = 0u;
+
+	for (int iarg = 1; iarg != argc; ++iarg){
+		const char* arg = argv[iarg];
+
+		if (strncmp(arg, "-frames=", cstring_size("-frames=")) == 0){
+			options.frames = strtoull(arg + cstring_size("-frames="), NULL, 10);
+			options.instructions = 0u;
+		}
+		else if (strncmp(arg, "-instructions=", cstring_size("-instructions=")) == 0){
+			options.instructions = strtoull(arg + cstring_size("-instructions="), NULL, 10);
+			options.frames = 0u;
+		}
+		else if (strncmp(arg, "-backend=", cstring_size("-backend=")) == 0){
+			if (!Chip8_backend_from_name(arg + cstring_size("-backend="), options.backend))
+				crash("Unknown backend: %s", arg);
+		}
+		else if (strncmp(arg, "-machine=", cstring_size("-machine=")) == 0){
+			if (!Chip8_machine_from_name(arg + cstring_size("-machine="), options.machine))
+				crash("Unknown machine: %s", arg);
+		}
+		else if (strcmp(arg, "-quirks=auto") == 0){
+			options.detect_quirks = true;
+		}
+		else if (strncmp(arg, "-quirks=", cstring_size("-quirks=")) == 0){
+			options.detect_quirks = false;
+			if (!Chip8_quirks_from_name(arg + cstring_size("-quirks="), options.quirks))
+				crash("Unknown quirks: %s", arg);
+		}
+		else if (strncmp(arg, "-ips=", cstring_size("-ips=")) == 0){
+			options.instructions_per_second = (u32)strtoul(arg + cstring_size("-ips="), NULL, 10);
+			if (!options.instructions_per_second) crash("Invalid instructions per second: %s", arg);
+		}
+		else if (strncmp(arg, "-keys=", cstring_size("-keys=")) == 0){
+			parse_keys(arg, arg + cstring_size("-keys="), options);
+		}
+		else if (strncmp(arg, "-replay=", cstring_size("-replay=")) == 0){
+			options.movie_path = arg + cstring_size("-replay=");
+		}
+		else if (strncmp(arg, "-batch=", cstring_size("-batch=")) == 0){
+			options.batch_lane_count = (u32)strtoul(arg + cstring_size("-batch="), NULL, 10);
+			if (!options.batch_lane_count) crash("Invalid lane count: %s", arg);
+		}
+		else if (strncmp(arg, "-memory_profile=", cstring_size("-memory_profile=")) == 0){
+			options.memory_profile_path = arg + cstring_size("-memory_profile=");
+		}
+		else if (strcmp(arg, "-opcode_stats") == 0 || strncmp(arg, "-opcode_stats=", cstring_size("-opcode_stats=")) == 0){
+#if !defined(CHIP8_OPCODE_STATS)
+			crash("%s requires a build with CHIP8_OPCODE_STATS ; see premake5 --opcode_stats", arg);
+#endif
+			options.opcode_stats = true;
+			if (arg[cstring_size("-opcode_stats")] == '=')
+				options.opcode_sample_period = (u32)strtoul(arg + cstring_size("-opcode_stats="), NULL, 10);
+		}
+		else if (!options.ROM_path){
+			options.ROM_path = arg;
+		}
+		else{
+			crash("Unexpected argument: %s", arg);
+		}
+	}
+
+	// the batch executes the lanes without Chip8 to profile
+	if (options.batch_lane_count && (options.memory_profile_path || options.opcode_stats))
+		crash("-batch does not support -memory_profile and -opcode_stats");
+}
+
+// ---- run
+
+static int read_ROM(const char* path, u8* data, size_t& size){
+	FILE* file = fopen(path, "rb");
+	if (!file) return false;
+
+	size = fread(data, 1u, sizeof(Chip8::Memory::user_range), file);
+	int end_of_file = fgetc(file) == EOF;
+	fclose(file);
+
+	return end_of_file;
+}
+
+static int run_frames(Chip8* chip8, Run_Options& options){
+	u64 frame_instructions = max((u64)options.instructions_per_second / g_run_update_per_second, (u64)1u);
+	int ikey_event = 0;
+
+	u64 frame = 0u;
+	u64 start = g_timer->ticks();
+	while (!chip8->ERROR){
+		if (options.instructions ? chip8->CYCLE >= options.instructions : frame == options.frames) break;
+
+		for (; ikey_event != options.key_event_count && options.key_events[ikey_event].frame <= frame; ++ikey_event)
+			Chip8_keyboard_from_mask(chip8->KEYBOARD, options.key_events[ikey_event].keys);
+
+		if (options.instructions)
+			Chip8_run(chip8, (int)min(frame_instructions, options.instructions - chip8->CYCLE));
+		else
+			Chip8_step(chip8, 1.f / (float)g_run_update_per_second);
+
+		++frame;
+	}
+	u64 end = g_timer->ticks();
+
+	double seconds = max((double)(end - start) / (double)g_timer->ticks_per_second(), 1e-9);
+
+	printf("%s ; %s ; hash %016" PRIx64 " ; %" PRIu64 " instructions ; %" PRIu64 " frames ; %.0f instructions/second ; ERROR %d\n",
+		options.ROM_path, Chip8::BACKEND_NAME[chip8->BACKEND], Chip8_hash_state(chip8),
+		chip8->CYCLE, frame, (double)chip8->CYCLE / seconds, chip8->ERROR);
+
+	return chip8->ERROR ? 2 : 0;
+}
+
+// the keys are given to every lane ; stops when the first lane has an ERROR
+static int run_batch(Chip8* chip8, Run_Options& options){
+	Chip8_Batch* batch = Chip8_create_batch(chip8, options.batch_lane_count);
+	if (!batch) crash("-batch requires the %s machine", Chip8::MACHINE_NAME[Chip8::CHIP8]);
+
+	u64 frame_instructions = max((u64)options.instructions_per_second / g_run_update_per_second, (u64)1u);
+	int ikey_event = 0;
+
+	u64 frame = 0u;
+	u64 cycle = 0u;
+	u64 start = g_timer->ticks();
+	while (!Chip8_batch_get_error(batch, 0u)){
+		if (options.instructions ? cycle >= options.instructions : frame == options.frames) break;
+
+		for (; ikey_event != options.key_event_count && options.key_events[ikey_event].frame <= frame; ++ikey_event){
+			for (u32 ilane = 0; ilane != batch->lane_count; ++ilane)
+				Chip8_batch_set_keyboard(batch, ilane, options.key_events[ikey_event].keys);
+		}
+
+		if (options.instructions){
+			int count = (int)min(frame_instructions, options.instructions - cycle);
+			Chip8_batch_run(batch, count);
+			cycle += (u64)count;
+		}
+		else{
+			Chip8_batch_step(batch, 1.f / (float)g_run_update_per_second);
+		}
+
+		++frame;
+	}
+	u64 end = g_timer->ticks();
+
+	double seconds = max((double)(end - start) / (double)g_timer->ticks_per_second(), 1e-9);
+
+	Chip8_batch_get_lane(batch, 0u, chip8);
+	u64 hash = Chip8_hash_state(chip8);
+	u64 lane_instructions = chip8->CYCLE;
+	u32 different_lane_count = 0u;
+	for (u32 ilane = 1u; ilane != batch->lane_count; ++ilane){
+		Chip8_batch_get_lane(batch, ilane, chip8);
+		lane_instructions += chip8->CYCLE;
+		different_lane_count += Chip8_hash_state(chip8) != hash;
+	}
+	Chip8_batch_get_lane(batch, 0u, chip8);
+
+	printf("%s ; batch of %u ; hash %016" PRIx64 " ; %" PRIu64 " instructions ; %" PRIu64 " frames ; %.0f lane instructions/second ; %u different lanes ; ERROR %d\n",
+		options.ROM_path, batch->lane_count, hash, chip8->CYCLE, frame, (double)lane_instructions / seconds, different_lane_count, chip8->ERROR);
+
+	Chip8_destroy_batch(batch);
+
+	return chip8->ERROR ? 2 : different_lane_count ? 3 : 0;
+}
+
+// returns a buffer to free or NULL
+static u8* read_movie(const char* path, size_t& size){
+	FILE* file = fopen(path, "rb");
+	if (!file) return NULL;
+
+	u8* data = NULL;
+	if (fseek(file, 0, SEEK_END) == 0){
+		long file_size = ftell(file);
+		if (file_size >= 0 && fseek(file, 0, SEEK_SET) == 0){
+			size = (size_t)file_size;
+			data = (u8*)malloc(max(size, (size_t)1u));
+			if (data && fread(data, 1u, size, file) != size){
+				free(data);
+				data = NULL;
+			}
+		}
+	}
+	fclose(file);
+
+	return data;
+}
+
+static int replay_movie(Chip8* chip8, Run_Options& options){
+	size_t movie_size = 0;
+	u8* movie = read_movie(options.movie_path, movie_size);
+	if (!movie) crash("Failed to read %s", options.movie_path);
+
+	Chip8_Movie_Replay replay;
+	u64 start = g_timer->ticks();
+	int valid = Chip8_movie_replay(chip8, movie, movie_size, replay);
+	u64 end = g_timer->ticks();
+	free(movie);
+
+	if (!valid) crash("Invalid movie or movie of another ROM: %s", options.movie_path);
+
+	double seconds = max((double)(end - start) / (double)g_timer->ticks_per_second(), 1e-9);
+
+	printf("%s ; %s ; movie %s ; hash %016" PRIx64 " ; %" PRIu64 " frames ; %u checkpoints ; %u mismatches",
+		options.ROM_path, Chip8::BACKEND_NAME[chip8->BACKEND], options.movie_path, Chip8_hash_state(chip8),
+		replay.frame_count, replay.checkpoint_count, replay.mismatch_count);
+	if (replay.mismatch_count) printf(" from frame %" PRIu64, replay.first_mismatch_frame);
+	printf(" ; %.0f frames/second ; ERROR %d\n", (double)replay.frame_count / seconds, chip8->ERROR);
+
+	return replay.mismatch_count ? 3 : 0;
+}
+
+#if defined(CHIP8_AOT)
+// generated by tools/chip8_aot.cpp
+extern const Chip8_AOT_Program g_chip8_aot_programs[];
+extern const int g_chip8_aot_program_count;
+#endif
+
+int main(int argc, char* argv[]){
+	Run_Options options;
+	parse_options(argc, argv, options);
+
+	if (!options.ROM_path){
+		fprintf(stderr, "USAGE: chip8_run ROM [-frames=N | -instructions=N] [-backend=NAME] [-machine=chip8|superchip|xochip] [-quirks=auto|cowgod|vip|chip48|superchip|xochip] [-ips=N] [-keys=FRAME:KEYS[,FRAME:KEYS ...]] [-replay=MOVIE] [-batch=N] [-memory_profile=PATH] [-opcode_stats[=SAMPLE_PERIOD]]\n");
+		return 1;
+	}
+
+	static u8 ROM[sizeof(Chip8::Memory::user_range)];
+	size_t ROM_size = 0;
+	if (!read_ROM(options.ROM_path, ROM, ROM_size)) crash("Failed to read %s", options.ROM_path);
+
+	Chip8* chip8 = (Chip8*)malloc(sizeof(Chip8));
+	if (!chip8) crash("Failed to allocate the Chip8");
+
+	Chip8::MACHINE_TYPE machine = options.machine != Chip8::MACHINE_COUNT ? options.machine : Chip8_detect_machine(ROM, ROM_size);
+	if (ROM_size > Chip8_memory_size(machine) - sizeof(Chip8::Memory::Interpreter))
+		crash("%s does not fit in the memory of %s", options.ROM_path, Chip8::MACHINE_NAME[machine]);
+	Chip8_create(chip8, ROM, ROM_size, machine);
+	if (options.quirks != Chip8_Quirks::TYPE_COUNT) chip8->QUIRKS = options.quirks;
+	if (options.detect_quirks){
+		Chip8_Quirk_Trial trials[Chip8_Quirks::TYPE_COUNT];
+		chip8->QUIRKS = Chip8_detect_quirks(ROM, ROM_size, machine, trials);
+		for (int iquirks = 0; iquirks != Chip8_Quirks::TYPE_COUNT; ++iquirks){
+			const Chip8_Quirk_Trial& trial = trials[iquirks];
+			fprintf(stderr, "%s%s ; %u frames ; %u adresses ; %u screen frames ; ERROR %d\n", trial.quirks == chip8->QUIRKS ? "* " : "  ",
+				Chip8_Quirks::TYPE_NAME[trial.quirks], trial.frame_count, trial.PC_count, trial.screen_frame_count, trial.ERROR);
+		}
+	}
+#if defined(CHIP8_AOT)
+	chip8->AOT_PROGRAM = Chip8_aot_find(g_chip8_aot_programs, g_chip8_aot_program_count, ROM, ROM_size);
+#endif
+	chip8->BACKEND = options.backend;
+	chip8->instructions_per_second = options.instructions_per_second;
+	if (options.memory_profile_path) chip8->MEMORY_PROFILE = Chip8_create_memory_profile();
+#if defined(CHIP8_OPCODE_STATS)
+	if (options.opcode_stats) chip8->OPCODE_STATS = Chip8_create_opcode_stats(options.opcode_sample_period);
+#endif
+
+	int result;
+	if (options.movie_path) result = replay_movie(chip8, options);
+	else if (options.batch_lane_count) result = run_batch(chip8, options);
+	else result = run_frames(chip8, options);
+
+	if (chip8->MEMORY_PROFILE){
+		if (!Chip8_save_memory_profile(chip8->MEMORY_PROFILE, options.memory_profile_path))
+			crash("Failed to save the memory profile to %s", options.memory_profile_path);
+		Chip8_destroy_memory_profile(chip8->MEMORY_PROFILE);
+	}
+
+#if defined(CHIP8_OPCODE_STATS)
+	if (chip8->OPCODE_STATS){
+		Chip8_opcode_stats_report(chip8->OPCODE_STATS, stdout);
+		Chip8_destroy_opcode_stats(chip8->OPCODE_STATS);
+	}
+#endif
+
+	Chip8_destroy(chip8);
+	free(chip8);
+
+	return result;
+}
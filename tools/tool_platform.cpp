@@ -0,0 +1,121 @@
+#include "engine.h"
+
+#include <cstdarg>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#undef NOMINMAX
+#else
+#include <pthread.h>
+#endif
+
+// Part of engine.h used by the Chip8 core, for the console tools that do not link a platform layer
+//
+// * logs and crash messages are written to stderr ; crash exits with status 1
+// * the timer counts nanoseconds with timespec_get
+// * threads are Win32 threads on Windows and pthreads elsewhere
+
+static Logger g_tool_logger;
+Logger* g_logger = &g_tool_logger;
+
+static Timer g_tool_timer;
+Timer* g_timer = &g_tool_timer;
+
+void Logger::log_message_from_macro(log_type type, int line, const char* filepath, const char* format, ...){
+	char message[msg_max_size];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	fprintf(stderr, "[%s] %s(%d): %s\n", log_type_str[type], filepath, line, message);
+}
+
+void crash(const char* context_format, ...){
+	va_list args;
+	va_start(args, context_format);
+	vfprintf(stderr, context_format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+
+	exit(1);
+}
+
+u64 Timer::ticks(){
+	timespec time;
+	timespec_get(&time, TIME_UTC);
+	return (u64)time.tv_sec * 1000000000u + (u64)time.tv_nsec;
+}
+
+u64 Timer::ticks_per_second(){
+	return 1000000000u;
+}
+
+float Timer::as_ms(u64 ticks){
+	return (float)ticks / 1000000.f;
+}
+
+float Timer::as_seconds(u64 ticks){
+	return (float)ticks / 1000000000.f;
+}
+
+#if defined(_WIN32)
+
+struct Thread_Tool{
+	HANDLE handle;
+	Thread_Function function;
+	void* param;
+};
+
+static DWORD WINAPI Thread_Tool_proc(LPVOID lpparam){
+	Thread_Tool* tool = (Thread_Tool*)lpparam;
+	tool->function(tool->param);
+	return 0;
+}
+
+void create_thread(Thread* thread, Thread_Function function, void* param){
+	Thread_Tool* tool = (Thread_Tool*)thread;
+	tool->function = function;
+	tool->param = param;
+	tool->handle = CreateThread(NULL, 0, Thread_Tool_proc, tool, 0, NULL);
+	if (!tool->handle) crash("CreateThread failed");
+}
+
+void join_thread(Thread* thread){
+	Thread_Tool* tool = (Thread_Tool*)thread;
+	WaitForSingleObject(tool->handle, INFINITE);
+	CloseHandle(tool->handle);
+}
+
+#else
+
+struct Thread_Tool{
+	pthread_t handle;
+	Thread_Function function;
+	void* param;
+};
+
+static void* Thread_Tool_proc(void* param){
+	Thread_Tool* tool = (Thread_Tool*)param;
+	tool->function(tool->param);
+	return NULL;
+}
+
+void create_thread(Thread* thread, Thread_Function function, void* param){
+	Thread_Tool* tool = (Thread_Tool*)thread;
+	tool->function = function;
+	tool->param = param;
+	if (pthread_create(&tool->handle, NULL, Thread_Tool_proc, tool) != 0) crash("pthread_create failed");
+}
+
+void join_thread(Thread* thread){
+	Thread_Tool* tool = (Thread_Tool*)thread;
+	pthread_join(tool->handle, NULL);
+}
+
+#endif
+
+static_assert(sizeof(Thread_Tool) <= sizeof(Thread), "Thread_Tool too big compared to Thread");